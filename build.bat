@@ -5,7 +5,13 @@ where /Q cl || (
     echo error: run this on a msvc enabled shell
     exit /b 1
 )
-set CL=-nologo -std:c17 -utf-8 -external:W0 -external:anglebrackets -external:I . -Z7 -Od -MTd -RTCcsu -WX -Wall
+set CL=-nologo -std:c17 -utf-8 -external:W0 -external:anglebrackets -external:I . -Z7 -WX -Wall -wd4820 -wd5045 -wd4752
+if "%1" == "release" (
+    rem NOTE: optimized build for benchmarks, inlining reports are informational only
+    set CL=%CL% -O2 -MT -wd4710 -wd4711
+) else (
+    set CL=%CL% -Od -MTd -RTCcsu
+)
 set _CL_=-link -incremental:no
 
 cl opengl45.c
@@ -10,6 +10,31 @@
 // - index buffer object (IBO)
 // - uniform buffer object (UBO)
 // - textures
+// - sub-allocated vertex, index and uniform ranges (TLSF) from a few big buffers
+// - memory mapped binary mesh files uploaded without parsing or copies
+// - 8/16/32 bit indices with big meshes split into 16 bit submeshes and delta compressed index blobs
+// - transient per frame arena (triple buffered, one sub-arena per thread) for cpu side render data
+// - SSE/AVX2/NEON math with batched structure of arrays transforms for per object matrices
+// - work stealing job system (chase-lev deques) for the per frame scene update
+// - draw lists recorded in parallel into binary command buffers executed on the context thread
+// - baked command lists for static draws (replayed as a flat loop or as GL_NV_command_list tokens)
+// - render graph (pass culling, minimal memory barriers, aliased transient render targets)
+// - render target and framebuffer pool with resize headroom and hysteresis
+// - optional depth prepass (position only vertex stream, front to back draws, GL_EQUAL main pass)
+// - structure of arrays frustum culling of bounding boxes (8 at a time with AVX2) into a compact visible list
+// - bounding volume hierarchy (binned SAH build, incremental refit) for hierarchical frustum culling and picking
+// - materials sampled through bindless texture handles in a storage buffer (texture array layers without
+//   GL_ARB_bindless_texture) so draws with different textures share binds and multi draws
+// - gamma correct mip chains (AVX2 box filter) sampled through deduplicated sampler objects instead of texture state
+// - block compressed textures from KTX2 and DDS files (BC1-BC7, ETC2, ASTC), decoded on the cpu when unsupported
+// - multithreaded BC1/BC3/BC7 encoder (AVX2 index search, fast and high quality tiers) for textures made at runtime
+// - two phase gpu occlusion culling against a hi-z depth pyramid (compute) drawn with multi draw indirect
+// - occlusion queries on bounding box proxies with conditional rendering that never waits on them (`GL_QUERY_NO_WAIT`)
+// - virtual texturing (page table, feedback pass read back without stalls, prioritized page streaming into a fixed cache,
+//   page table committed sparsely with GL_ARB_sparse_texture)
+// - texture streaming (mip residency from on screen size measured while culling, gpu memory budget with lru eviction)
+// - multithreaded PNG, JPEG and QOI decoding (simd rgb expansion, premultiplied alpha in linear light for srgb colors)
+// - video textures (yuv planes through a persistently mapped pixel buffer ring into R8/RG8 textures, converted in the shader)
 //
 // this was made following using this guide to modern opengl functions as a reference:
 // https://github.com/fendevel/Guide-to-Modern-OpenGL-Functions
@@ -30,6 +55,14 @@
 // NOTE: download https://www.khronos.org/registry/EGL/api/KHR/khrplatform.h and put in "KHR" folder
 
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include <intrin.h>
+#if defined(_M_ARM64)
+#include <arm64_neon.h>
+#endif
 
 typedef enum { false, true } bool;
 
@@ -38,8 +71,11 @@ typedef enum { false, true } bool;
     ((void)printf("%s:%d: %s (last error: %ld)\n", __FILE__, __LINE__, #invariant, GetLastError()), (void)UNREACHABLE, 0))
 #define LEN(array) (sizeof(array) / sizeof((array)[0]))
 #define OFFSET_OF(type, member) ((size_t)&(((type*)0)->member))
+#define ALIGN_UP(value, alignment) (((value) + (alignment) - 1) / (alignment) * (alignment))
 
 #define DEBUG_LAYER
+//#define BENCHMARKS // NOTE: best built with `build.bat release`
+//#define GPU_MIP_CHAINS // NOTE: mip chains from `glGenerateTextureMipmap` instead of the gamma correct cpu downsampler
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 // used opengl procedures table
@@ -48,11 +84,41 @@ typedef enum { false, true } bool;
 X(PFNGLDEBUGMESSAGECALLBACKPROC, glDebugMessageCallback)\
 X(PFNGLCLIPCONTROLPROC, glClipControl)\
 X(PFNGLCLEARNAMEDFRAMEBUFFERFVPROC, glClearNamedFramebufferfv)\
+X(PFNGLCLEARNAMEDFRAMEBUFFERUIVPROC, glClearNamedFramebufferuiv)\
+X(PFNGLGETSTRINGIPROC, glGetStringi)\
+X(PFNGLMEMORYBARRIERPROC, glMemoryBarrier)\
+X(PFNGLCREATEQUERIESPROC, glCreateQueries)\
+X(PFNGLDELETEQUERIESPROC, glDeleteQueries)\
+X(PFNGLBEGINQUERYPROC, glBeginQuery)\
+X(PFNGLENDQUERYPROC, glEndQuery)\
+X(PFNGLGETQUERYOBJECTUI64VPROC, glGetQueryObjectui64v)\
+X(PFNGLBEGINCONDITIONALRENDERPROC, glBeginConditionalRender)\
+X(PFNGLENDCONDITIONALRENDERPROC, glEndConditionalRender)\
+X(PFNGLDISPATCHCOMPUTEPROC, glDispatchCompute)\
+X(PFNGLBINDIMAGETEXTUREPROC, glBindImageTexture)\
+X(PFNGLFENCESYNCPROC, glFenceSync)\
+X(PFNGLCLIENTWAITSYNCPROC, glClientWaitSync)\
+X(PFNGLDELETESYNCPROC, glDeleteSync)\
+\
+X(PFNGLCREATEFRAMEBUFFERSPROC, glCreateFramebuffers)\
+X(PFNGLDELETEFRAMEBUFFERSPROC, glDeleteFramebuffers)\
+X(PFNGLBINDFRAMEBUFFERPROC, glBindFramebuffer)\
+X(PFNGLNAMEDFRAMEBUFFERTEXTUREPROC, glNamedFramebufferTexture)\
+X(PFNGLNAMEDFRAMEBUFFERDRAWBUFFERSPROC, glNamedFramebufferDrawBuffers)\
+X(PFNGLNAMEDFRAMEBUFFERREADBUFFERPROC, glNamedFramebufferReadBuffer)\
+X(PFNGLCHECKNAMEDFRAMEBUFFERSTATUSPROC, glCheckNamedFramebufferStatus)\
+X(PFNGLBLITNAMEDFRAMEBUFFERPROC, glBlitNamedFramebuffer)\
 \
 X(PFNGLCREATEBUFFERSPROC, glCreateBuffers)\
 X(PFNGLCREATEVERTEXARRAYSPROC, glCreateVertexArrays)\
 X(PFNGLBINDVERTEXARRAYPROC, glBindVertexArray)\
+X(PFNGLDELETEVERTEXARRAYSPROC, glDeleteVertexArrays)\
 X(PFNGLBINDBUFFERBASEPROC, glBindBufferBase)\
+X(PFNGLBINDBUFFERRANGEPROC, glBindBufferRange)\
+X(PFNGLDELETEBUFFERSPROC, glDeleteBuffers)\
+X(PFNGLBINDBUFFERPROC, glBindBuffer)\
+X(PFNGLDRAWELEMENTSBASEVERTEXPROC, glDrawElementsBaseVertex)\
+X(PFNGLMULTIDRAWELEMENTSINDIRECTPROC, glMultiDrawElementsIndirect)\
 \
 X(PFNGLCREATESHADERPROGRAMVPROC, glCreateShaderProgramv)\
 X(PFNGLCREATESHADERPROC, glCreateShader)\
@@ -65,104 +131,13904 @@ X(PFNGLLINKPROGRAMPROC, glLinkProgram)\
 X(PFNGLGETSHADERINFOLOGPROC, glGetShaderInfoLog)\
 X(PFNGLDELETESHADERPROC, glDeleteShader)\
 X(PFNGLUSEPROGRAMPROC, glUseProgram)\
+X(PFNGLDELETEPROGRAMPROC, glDeleteProgram)\
+X(PFNGLGETPROGRAMIVPROC, glGetProgramiv)\
+X(PFNGLGETPROGRAMINFOLOGPROC, glGetProgramInfoLog)\
+X(PFNGLPROGRAMUNIFORM1IPROC, glProgramUniform1i)\
+X(PFNGLPROGRAMUNIFORM1UIPROC, glProgramUniform1ui)\
+X(PFNGLPROGRAMUNIFORM2IPROC, glProgramUniform2i)\
+X(PFNGLPROGRAMUNIFORM3FVPROC, glProgramUniform3fv)\
+X(PFNGLPROGRAMUNIFORM1FPROC, glProgramUniform1f)\
+X(PFNGLPROGRAMUNIFORM4FVPROC, glProgramUniform4fv)\
+X(PFNGLPROGRAMUNIFORMMATRIX4FVPROC, glProgramUniformMatrix4fv)\
 \
 X(PFNGLNAMEDBUFFERSTORAGEPROC, glNamedBufferStorage)\
 X(PFNGLNAMEDBUFFERSUBDATAPROC, glNamedBufferSubData)\
+X(PFNGLGETNAMEDBUFFERSUBDATAPROC, glGetNamedBufferSubData)\
+X(PFNGLCLEARNAMEDBUFFERDATAPROC, glClearNamedBufferData)\
+X(PFNGLMAPNAMEDBUFFERRANGEPROC, glMapNamedBufferRange)\
+X(PFNGLUNMAPNAMEDBUFFERPROC, glUnmapNamedBuffer)\
 X(PFNGLVERTEXARRAYVERTEXBUFFERPROC, glVertexArrayVertexBuffer)\
 X(PFNGLVERTEXARRAYELEMENTBUFFERPROC, glVertexArrayElementBuffer)\
 X(PFNGLENABLEVERTEXARRAYATTRIBPROC, glEnableVertexArrayAttrib)\
 X(PFNGLVERTEXARRAYATTRIBFORMATPROC, glVertexArrayAttribFormat)\
+X(PFNGLVERTEXARRAYATTRIBIFORMATPROC, glVertexArrayAttribIFormat)\
 X(PFNGLVERTEXARRAYATTRIBBINDINGPROC, glVertexArrayAttribBinding)\
 X(PFNGLVERTEXARRAYBINDINGDIVISORPROC, glVertexArrayBindingDivisor)\
+X(PFNGLGETVERTEXARRAYIVPROC, glGetVertexArrayiv)\
+X(PFNGLGETVERTEXARRAYINDEXEDIVPROC, glGetVertexArrayIndexediv)\
+X(PFNGLGETVERTEXARRAYINDEXED64IVPROC, glGetVertexArrayIndexed64iv)\
 \
 X(PFNGLCREATETEXTURESPROC, glCreateTextures)\
 X(PFNGLTEXTUREPARAMETERIPROC, glTextureParameteri)\
+X(PFNGLGETTEXTUREPARAMETERIVPROC, glGetTextureParameteriv)\
+X(PFNGLGETINTERNALFORMATIVPROC, glGetInternalformativ)\
+X(PFNGLGENERATETEXTUREMIPMAPPROC, glGenerateTextureMipmap)\
 X(PFNGLTEXTURESTORAGE2DPROC, glTextureStorage2D)\
+X(PFNGLTEXTURESTORAGE2DMULTISAMPLEPROC, glTextureStorage2DMultisample)\
 X(PFNGLTEXTURESUBIMAGE2DPROC, glTextureSubImage2D)\
+X(PFNGLTEXTURESTORAGE3DPROC, glTextureStorage3D)\
+X(PFNGLTEXTURESUBIMAGE3DPROC, glTextureSubImage3D)\
+X(PFNGLCOMPRESSEDTEXTURESUBIMAGE2DPROC, glCompressedTextureSubImage2D)\
+X(PFNGLCOMPRESSEDTEXTURESUBIMAGE3DPROC, glCompressedTextureSubImage3D)\
+X(PFNGLCLEARTEXIMAGEPROC, glClearTexImage)\
+X(PFNGLCLEARTEXSUBIMAGEPROC, glClearTexSubImage)\
+X(PFNGLGETTEXTURESUBIMAGEPROC, glGetTextureSubImage)\
+X(PFNGLGETTEXTUREIMAGEPROC, glGetTextureImage)\
+X(PFNGLCOPYIMAGESUBDATAPROC, glCopyImageSubData)\
 X(PFNGLBINDTEXTUREUNITPROC, glBindTextureUnit)\
+X(PFNGLBINDTEXTURESPROC, glBindTextures)\
+\
+X(PFNGLCREATESAMPLERSPROC, glCreateSamplers)\
+X(PFNGLDELETESAMPLERSPROC, glDeleteSamplers)\
+X(PFNGLSAMPLERPARAMETERIPROC, glSamplerParameteri)\
+X(PFNGLSAMPLERPARAMETERFPROC, glSamplerParameterf)\
+X(PFNGLBINDSAMPLERPROC, glBindSampler)\
+X(PFNGLBINDSAMPLERSPROC, glBindSamplers)\
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// optional opengl procedures table (GL_NV_command_list and the bindless buffer extensions it needs)
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#define GL_NV_COMMAND_LIST_PROCS \
+X(PFNGLCREATESTATESNVPROC, glCreateStatesNV)\
+X(PFNGLDELETESTATESNVPROC, glDeleteStatesNV)\
+X(PFNGLSTATECAPTURENVPROC, glStateCaptureNV)\
+X(PFNGLGETCOMMANDHEADERNVPROC, glGetCommandHeaderNV)\
+X(PFNGLGETSTAGEINDEXNVPROC, glGetStageIndexNV)\
+X(PFNGLDRAWCOMMANDSSTATESNVPROC, glDrawCommandsStatesNV)\
+X(PFNGLGETNAMEDBUFFERPARAMETERUI64VNVPROC, glGetNamedBufferParameterui64vNV)\
+X(PFNGLISNAMEDBUFFERRESIDENTNVPROC, glIsNamedBufferResidentNV)\
+X(PFNGLMAKENAMEDBUFFERRESIDENTNVPROC, glMakeNamedBufferResidentNV)\
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// optional opengl procedures table (GL_ARB_bindless_texture)
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#define GL_ARB_BINDLESS_TEXTURE_PROCS \
+X(PFNGLGETTEXTURESAMPLERHANDLEARBPROC, glGetTextureSamplerHandleARB)\
+X(PFNGLMAKETEXTUREHANDLERESIDENTARBPROC, glMakeTextureHandleResidentARB)\
+X(PFNGLMAKETEXTUREHANDLENONRESIDENTARBPROC, glMakeTextureHandleNonResidentARB)\
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// optional opengl procedures table (GL_ARB_sparse_texture)
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#define GL_ARB_SPARSE_TEXTURE_PROCS \
+X(PFNGLTEXPAGECOMMITMENTARBPROC, glTexPageCommitmentARB)\
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// used wgl procedures table
+///////////////////////////////////////////////////////////////////////////////////////////////////
+#define WGL_PROCS \
+X(PFNWGLGETEXTENSIONSSTRINGARBPROC, wglGetExtensionsStringARB)\
+X(PFNWGLCHOOSEPIXELFORMATARBPROC, wglChoosePixelFormatARB)\
+X(PFNWGLCREATECONTEXTATTRIBSARBPROC, wglCreateContextAttribsARB)\
+X(PFNWGLSWAPINTERVALEXTPROC, wglSwapIntervalEXT)\
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// NOTE: declare all used opengl and wgl procedures
+#define X(type, name) static type name;
+GL_PROCS
+GL_NV_COMMAND_LIST_PROCS
+GL_ARB_BINDLESS_TEXTURE_PROCS
+GL_ARB_SPARSE_TEXTURE_PROCS
+WGL_PROCS
+#undef X
+
+#define LOAD_PROC(type, name) do { name = (type)(void*)wglGetProcAddress(#name); ASSERT(name); } while (0)
+#define LOAD_OPTIONAL_PROC(type, name) ((name = (type)(void*)wglGetProcAddress(#name)) != NULL)
+
+static const wchar_t* window_class_name = L"DefaultWindowClass";
+static bool should_quit = false;
+static bool depth_prepass_enabled = true; // NOTE: toggled with the P key
+
+enum OcclusionCullingMode {
+    OCCLUSION_CULLING_NONE,
+    OCCLUSION_CULLING_DEPTH_PYRAMID,
+    OCCLUSION_CULLING_QUERIES,
+    OCCLUSION_CULLING_MODE_COUNT,
+};
+
+static const char* occlusion_culling_mode_names[OCCLUSION_CULLING_MODE_COUNT] = {"off", "depth pyramid", "occlusion queries"};
+static enum OcclusionCullingMode occlusion_culling_mode = OCCLUSION_CULLING_DEPTH_PYRAMID; // NOTE: cycled with the O key
+
+// NOTE: a left click picks the object under the cursor (in client area pixels) the next frame
+static bool pick_requested = false;
+static int32_t pick_x = 0;
+static int32_t pick_y = 0;
+
+static LRESULT WINAPI
+process_window_message(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
+    if (uMsg == WM_CLOSE) {
+        should_quit = true;
+    }
+    if (uMsg == WM_KEYDOWN && wParam == 'P') {
+        depth_prepass_enabled = !depth_prepass_enabled;
+        printf("depth prepass = %s\n", depth_prepass_enabled ? "on" : "off");
+    }
+    if (uMsg == WM_KEYDOWN && wParam == 'O') {
+        occlusion_culling_mode = (occlusion_culling_mode + 1) % OCCLUSION_CULLING_MODE_COUNT;
+        printf("occlusion culling = %s\n", occlusion_culling_mode_names[occlusion_culling_mode]);
+    }
+    if (uMsg == WM_LBUTTONDOWN) {
+        pick_requested = true;
+        pick_x = (int32_t)(short)LOWORD(lParam);
+        pick_y = (int32_t)(short)HIWORD(lParam);
+    }
+    return DefWindowProcW(hwnd, uMsg, wParam, lParam);
+}
+
+static void APIENTRY
+gl_debug_message_callback(
+    GLenum source, GLenum type, GLuint id, GLenum severity,
+    GLsizei length, const GLchar* message, const void* user
+) {
+    (void)source;
+    (void)type;
+    (void)id;
+    (void)length;
+    (void)user;
+
+    #define PREFIX "GL DEBUG MESSAGE CALLBACK: "
+
+    printf(PREFIX);
+    puts(message);
+
+    OutputDebugStringA(PREFIX);
+    OutputDebugStringA(message);
+    OutputDebugStringA("\n");
+
+    #undef PREFIX
+
+    bool error;
+
+    error =
+        type == GL_DEBUG_SOURCE_API ||
+        type == GL_DEBUG_SOURCE_WINDOW_SYSTEM ||
+        type == GL_DEBUG_SOURCE_SHADER_COMPILER ||
+        type == GL_DEBUG_SOURCE_THIRD_PARTY ||
+        type == GL_DEBUG_SOURCE_APPLICATION;
+    if (error) {
+        UNREACHABLE;
+    }
+
+    error =
+        severity == GL_DEBUG_SEVERITY_HIGH ||
+        severity == GL_DEBUG_SEVERITY_MEDIUM ||
+        severity == GL_DEBUG_SEVERITY_LOW;
+    if (error) {
+        UNREACHABLE;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// os memory and memory mapped files
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// NOTE: counts every os allocation so the frame path can be checked to never allocate
+static volatile LONG os_allocation_count = 0;
+
+static void*
+os_alloc(size_t size) {
+    InterlockedIncrement(&os_allocation_count);
+    void* memory = VirtualAlloc(/* lpAddress */ NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    ASSERT(memory);
+    return memory;
+}
+
+static void
+os_free(void* memory) {
+    if (memory) {
+        ASSERT(VirtualFree(memory, /* dwSize */ 0, MEM_RELEASE));
+    }
+}
+
+struct MappedFile {
+    HANDLE file;
+    HANDLE mapping;
+    const void* data;
+    size_t size;
+};
+
+// NOTE: maps a whole file as read only, returns false if it can't be opened or is empty
+static bool
+mapped_file_open(struct MappedFile* mapped_file, const char* path) {
+    memset(mapped_file, 0, sizeof(*mapped_file));
+
+    HANDLE file = CreateFileA(
+        path,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        /* lpSecurityAttributes */ NULL,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        /* hTemplateFile */ NULL
+    );
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER file_size = {0};
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart <= 0) {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, /* lpFileMappingAttributes */ NULL, PAGE_READONLY, 0, 0, /* lpName */ NULL);
+    if (!mapping) {
+        CloseHandle(file);
+        return false;
+    }
+
+    const void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, /* dwNumberOfBytesToMap (whole file) */ 0);
+    if (!data) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    mapped_file->file = file;
+    mapped_file->mapping = mapping;
+    mapped_file->data = data;
+    mapped_file->size = (size_t)file_size.QuadPart;
+    return true;
+}
+
+static void
+mapped_file_close(struct MappedFile* mapped_file) {
+    if (mapped_file->data) {
+        UnmapViewOfFile(mapped_file->data);
+    }
+    if (mapped_file->mapping) {
+        CloseHandle(mapped_file->mapping);
+    }
+    if (mapped_file->file) {
+        CloseHandle(mapped_file->file);
+    }
+    memset(mapped_file, 0, sizeof(*mapped_file));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// frame arena
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// transient cpu memory for everything the render path builds each frame (draw lists, sort keys,
+// uniform blocks, ...). allocating is just bumping an offset and everything is released at once
+// when the frame memory is reset, so after startup the frame path never allocates from the os.
+// every thread gets its own sub-arena so there's no contention, and there are
+// `FRAME_ARENA_FRAME_COUNT` sets of them so data built for the frames still in flight stays valid
+
+#define FRAME_ARENA_FRAME_COUNT 3
+#define FRAME_ARENA_MAX_THREADS 64
+
+struct LinearArena {
+    unsigned char* base;
+    size_t capacity;
+    size_t used;
+    size_t high_water_mark;
+    unsigned char padding[32]; // NOTE: keep each thread's arena on its own cache line
+};
+
+struct FrameArena {
+    unsigned char* memory;
+    size_t thread_capacity;
+    uint32_t thread_count;
+    uint32_t frame_index;
+    uint64_t frame_number;
+    struct LinearArena arenas[FRAME_ARENA_FRAME_COUNT][FRAME_ARENA_MAX_THREADS];
+};
+
+// NOTE: running out of frame memory is a bug, the capacity should be raised instead
+static void*
+linear_arena_alloc(struct LinearArena* arena, size_t size, size_t alignment) {
+    ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    size_t offset = ALIGN_UP(arena->used, alignment);
+    ASSERT(offset <= arena->capacity && size <= arena->capacity - offset);
+    arena->used = offset + size;
+    arena->high_water_mark = arena->used > arena->high_water_mark ? arena->used : arena->high_water_mark;
+    return arena->base + offset;
+}
+
+#define LINEAR_ALLOC(arena, type, count) ((type*)linear_arena_alloc((arena), sizeof(type) * (count), _Alignof(type)))
+
+static void
+frame_arena_init(struct FrameArena* frame_arena, uint32_t thread_count, size_t thread_capacity) {
+    ASSERT(thread_count > 0 && thread_count <= FRAME_ARENA_MAX_THREADS);
+    memset(frame_arena, 0, sizeof(*frame_arena));
+
+    thread_capacity = ALIGN_UP(thread_capacity, 4096);
+    frame_arena->memory = os_alloc(FRAME_ARENA_FRAME_COUNT * thread_count * thread_capacity);
+    frame_arena->thread_capacity = thread_capacity;
+    frame_arena->thread_count = thread_count;
+
+    for (uint32_t frame = 0; frame < FRAME_ARENA_FRAME_COUNT; frame++) {
+        for (uint32_t thread = 0; thread < thread_count; thread++) {
+            struct LinearArena* arena = &frame_arena->arenas[frame][thread];
+            arena->base = frame_arena->memory + ((size_t)frame * thread_count + thread) * thread_capacity;
+            arena->capacity = thread_capacity;
+        }
+    }
+}
+
+static void
+frame_arena_deinit(struct FrameArena* frame_arena) {
+    os_free(frame_arena->memory);
+    memset(frame_arena, 0, sizeof(*frame_arena));
+}
+
+// NOTE: moves to the next set of sub-arenas and resets them, must be called once per frame before
+// any thread allocates. the memory being reset was last used `FRAME_ARENA_FRAME_COUNT` frames ago
+static void
+frame_arena_begin(struct FrameArena* frame_arena) {
+    frame_arena->frame_number += 1;
+    frame_arena->frame_index = (uint32_t)(frame_arena->frame_number % FRAME_ARENA_FRAME_COUNT);
+    for (uint32_t thread = 0; thread < frame_arena->thread_count; thread++) {
+        frame_arena->arenas[frame_arena->frame_index][thread].used = 0;
+    }
+}
+
+static struct LinearArena*
+frame_arena_thread(struct FrameArena* frame_arena, uint32_t thread_index) {
+    ASSERT(thread_index < frame_arena->thread_count);
+    return &frame_arena->arenas[frame_arena->frame_index][thread_index];
+}
+
+static void
+frame_arena_print_stats(const struct FrameArena* frame_arena) {
+    size_t high_water_mark = 0;
+    for (uint32_t frame = 0; frame < FRAME_ARENA_FRAME_COUNT; frame++) {
+        for (uint32_t thread = 0; thread < frame_arena->thread_count; thread++) {
+            size_t mark = frame_arena->arenas[frame][thread].high_water_mark;
+            high_water_mark = mark > high_water_mark ? mark : high_water_mark;
+        }
+    }
+    printf(
+        "frame arena: %u frames x %u threads x %zu KB, high water mark %zu KB\n",
+        FRAME_ARENA_FRAME_COUNT,
+        frame_arena->thread_count,
+        frame_arena->thread_capacity / 1024,
+        high_water_mark / 1024
+    );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// job system
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// work stealing scheduler: every worker (the main thread is worker 0) owns a chase-lev deque.
+// it pushes and pops jobs at the bottom of its own deque while idle workers steal from the top of
+// the others, so most pushes and pops never contend. completion is tracked with counters that are
+// decremented as jobs finish and whoever waits on a counter keeps running jobs until it reaches zero,
+// which is also how a job can depend on the jobs it spawned.
+// see "dynamic circular work-stealing deque" (chase, lev) and "correct and efficient work-stealing
+// for weak memory models" (le, pop, cohen, nardelli)
+
+#define JOB_QUEUE_CAPACITY 4096 // NOTE: must be a power of two
+#define JOB_MAX_WORKERS FRAME_ARENA_MAX_THREADS
+#define JOB_IDLE_SPIN_COUNT 256
+
+struct Job {
+    void (*function)(void* data, uint32_t first, uint32_t count, uint32_t worker_index);
+    void* data;
+    uint32_t first;
+    uint32_t count;
+    volatile LONG* counter;
+};
+
+struct JobQueue {
+    volatile LONG64 top;
+    unsigned char padding0[56]; // NOTE: keep top (thieves) and bottom (owner) on different cache lines
+    volatile LONG64 bottom;
+    unsigned char padding1[56];
+    struct Job jobs[JOB_QUEUE_CAPACITY];
+};
+
+struct JobWorker {
+    struct JobSystem* system;
+    uint32_t index;
+    uint32_t random_state;
+};
+
+struct JobSystem {
+    uint32_t worker_count; // NOTE: includes the main thread
+    volatile LONG should_quit;
+    HANDLE semaphore;
+    struct JobQueue* queues;
+    struct JobWorker workers[JOB_MAX_WORKERS];
+    HANDLE threads[JOB_MAX_WORKERS];
+};
+
+// NOTE: only called by the queue owner
+static bool
+job_queue_push(struct JobQueue* queue, const struct Job* job) {
+    LONG64 bottom = queue->bottom;
+    LONG64 top = queue->top;
+    if (bottom - top >= JOB_QUEUE_CAPACITY) {
+        return false;
+    }
+    queue->jobs[bottom & (JOB_QUEUE_CAPACITY - 1)] = *job;
+    MemoryBarrier();
+    queue->bottom = bottom + 1;
+    return true;
+}
+
+// NOTE: only called by the queue owner
+static bool
+job_queue_pop(struct JobQueue* queue, struct Job* job) {
+    LONG64 bottom = queue->bottom - 1;
+    queue->bottom = bottom;
+    MemoryBarrier();
+    LONG64 top = queue->top;
+
+    if (top > bottom) {
+        queue->bottom = bottom + 1;
+        return false;
+    }
+
+    *job = queue->jobs[bottom & (JOB_QUEUE_CAPACITY - 1)];
+    if (top == bottom) {
+        // NOTE: last job, race against thieves for it
+        bool won = InterlockedCompareExchange64(&queue->top, top + 1, top) == top;
+        queue->bottom = bottom + 1;
+        return won;
+    }
+    return true;
+}
+
+static bool
+job_queue_steal(struct JobQueue* queue, struct Job* job) {
+    LONG64 top = queue->top;
+    MemoryBarrier();
+    LONG64 bottom = queue->bottom;
+    if (top >= bottom) {
+        return false;
+    }
+
+    *job = queue->jobs[top & (JOB_QUEUE_CAPACITY - 1)];
+    return InterlockedCompareExchange64(&queue->top, top + 1, top) == top;
+}
+
+static void
+job_run(const struct Job* job, uint32_t worker_index) {
+    job->function(job->data, job->first, job->count, worker_index);
+    if (job->counter) {
+        InterlockedDecrement(job->counter);
+    }
+}
+
+// NOTE: runs one job from the worker's own queue or stolen from another one, returns false if none was found
+static bool
+job_system_run_one(struct JobSystem* system, uint32_t worker_index) {
+    struct Job job = {0};
+    if (job_queue_pop(&system->queues[worker_index], &job)) {
+        job_run(&job, worker_index);
+        return true;
+    }
+
+    // NOTE: start stealing from a random worker so thieves spread out
+    struct JobWorker* worker = &system->workers[worker_index];
+    worker->random_state ^= worker->random_state << 13;
+    worker->random_state ^= worker->random_state >> 17;
+    worker->random_state ^= worker->random_state << 5;
+    uint32_t first_victim = worker->random_state % system->worker_count;
+    for (uint32_t i = 0; i < system->worker_count; i++) {
+        uint32_t victim = (first_victim + i) % system->worker_count;
+        if (victim != worker_index && job_queue_steal(&system->queues[victim], &job)) {
+            job_run(&job, worker_index);
+            return true;
+        }
+    }
+    return false;
+}
+
+static DWORD WINAPI
+job_worker_thread(LPVOID parameter) {
+    struct JobWorker* worker = parameter;
+    struct JobSystem* system = worker->system;
+    for (;;) {
+        uint32_t spin_count = 0;
+        while (spin_count < JOB_IDLE_SPIN_COUNT) {
+            if (system->should_quit) {
+                return 0;
+            }
+            if (job_system_run_one(system, worker->index)) {
+                spin_count = 0;
+            } else {
+                YieldProcessor();
+                spin_count += 1;
+            }
+        }
+        WaitForSingleObject(system->semaphore, INFINITE);
+    }
+}
+
+// NOTE: `worker_count` includes the calling (main) thread, 0 picks one worker per logical processor
+static void
+job_system_init(struct JobSystem* system, uint32_t worker_count) {
+    memset(system, 0, sizeof(*system));
+    if (worker_count == 0) {
+        SYSTEM_INFO system_info = {0};
+        GetSystemInfo(&system_info);
+        worker_count = (uint32_t)system_info.dwNumberOfProcessors;
+    }
+    worker_count = worker_count < 1 ? 1 : worker_count > JOB_MAX_WORKERS ? JOB_MAX_WORKERS : worker_count;
+
+    system->worker_count = worker_count;
+    system->queues = os_alloc(worker_count * sizeof(struct JobQueue));
+    system->semaphore = CreateSemaphoreA(/* lpSemaphoreAttributes */ NULL, /* lInitialCount */ 0, /* lMaximumCount */ 0x7fffffff, /* lpName */ NULL);
+    ASSERT(system->semaphore);
+
+    for (uint32_t i = 0; i < worker_count; i++) {
+        system->workers[i].system = system;
+        system->workers[i].index = i;
+        system->workers[i].random_state = 0x9e3779b9u * (i + 1);
+    }
+    for (uint32_t i = 1; i < worker_count; i++) {
+        system->threads[i] = CreateThread(
+            /* lpThreadAttributes */ NULL,
+            /* dwStackSize */ 0,
+            &job_worker_thread,
+            &system->workers[i],
+            /* dwCreationFlags */ 0,
+            /* lpThreadId */ NULL
+        );
+        ASSERT(system->threads[i]);
+    }
+}
+
+static void
+job_system_deinit(struct JobSystem* system) {
+    InterlockedExchange(&system->should_quit, 1);
+    if (system->worker_count > 1) {
+        ReleaseSemaphore(system->semaphore, (LONG)(system->worker_count - 1), /* lpPreviousCount */ NULL);
+    }
+    for (uint32_t i = 1; i < system->worker_count; i++) {
+        WaitForSingleObject(system->threads[i], INFINITE);
+        CloseHandle(system->threads[i]);
+    }
+    CloseHandle(system->semaphore);
+    os_free(system->queues);
+    memset(system, 0, sizeof(*system));
+}
+
+// NOTE: splits `[0, item_count)` into jobs of up to `batch_size` items and pushes them to the calling worker's
+// queue. `counter` is incremented by the job count and gets back to zero once they're all done.
+// if the queue is full the remaining jobs just run right away
+static void
+job_system_parallel_for(
+    struct JobSystem* system,
+    uint32_t worker_index,
+    void (*function)(void* data, uint32_t first, uint32_t count, uint32_t worker_index),
+    void* data,
+    uint32_t item_count,
+    uint32_t batch_size,
+    volatile LONG* counter
+) {
+    ASSERT(batch_size > 0);
+    uint32_t job_count = (item_count + batch_size - 1) / batch_size;
+    InterlockedExchangeAdd(counter, (LONG)job_count);
+
+    struct JobQueue* queue = &system->queues[worker_index];
+    for (uint32_t i = 0; i < job_count; i++) {
+        struct Job job = {
+            .function = function,
+            .data = data,
+            .first = i * batch_size,
+            .count = item_count - i * batch_size < batch_size ? item_count - i * batch_size : batch_size,
+            .counter = counter,
+        };
+        if (!job_queue_push(queue, &job)) {
+            job_run(&job, worker_index);
+        }
+    }
+
+    uint32_t wake_count = job_count < system->worker_count - 1 ? job_count : system->worker_count - 1;
+    if (wake_count > 0) {
+        ReleaseSemaphore(system->semaphore, (LONG)wake_count, /* lpPreviousCount */ NULL);
+    }
+}
+
+// NOTE: helps running jobs (from any queue) until the counter reaches zero
+static void
+job_system_wait(struct JobSystem* system, uint32_t worker_index, volatile LONG* counter) {
+    while (*counter > 0) {
+        if (!job_system_run_one(system, worker_index)) {
+            YieldProcessor();
+        }
+    }
+    MemoryBarrier();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// index codec
 ///////////////////////////////////////////////////////////////////////////////////////////////////
+// lossless index buffer compression for storage. indices are delta coded against the previous index,
+// zigzag encoded and packed in blocks of 16 where every block uses the smallest width (1, 2 or 4 bytes)
+// that fits all of its deltas:
+//
+// | width code (1 byte) | 16 deltas (16 * width bytes) | width code | ...
+//
+// meshes optimized for the vertex cache reuse recent vertices so most deltas fit in a single byte,
+// which is helped by rotating each triangle (keeping its winding) to start close to the previous one.
+// decoding is a prefix sum which is done 4 indices at a time with SSE2
+
+#define INDEX_CODEC_BLOCK_SIZE 16
+
+static uint32_t
+index_codec_zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static size_t
+index_codec_encoded_bound(uint32_t index_count) {
+    size_t block_count = (index_count + INDEX_CODEC_BLOCK_SIZE - 1) / INDEX_CODEC_BLOCK_SIZE;
+    return block_count * (1 + INDEX_CODEC_BLOCK_SIZE * sizeof(uint32_t));
+}
+
+// NOTE: rotates each triangle so its first index is the closest to the last index of the previous one
+static void
+index_codec_rotate_triangles(uint32_t* indices, uint32_t index_count) {
+    uint32_t previous = 0;
+    for (uint32_t i = 0; i + 2 < index_count; i += 3) {
+        uint32_t best_rotation = 0;
+        uint32_t best_cost = UINT32_MAX;
+        for (uint32_t rotation = 0; rotation < 3; rotation++) {
+            uint32_t a = indices[i + rotation];
+            uint32_t b = indices[i + (rotation + 1) % 3];
+            uint32_t c = indices[i + (rotation + 2) % 3];
+            uint32_t cost =
+                index_codec_zigzag((int32_t)(a - previous)) +
+                index_codec_zigzag((int32_t)(b - a)) +
+                index_codec_zigzag((int32_t)(c - b));
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_rotation = rotation;
+            }
+        }
+
+        uint32_t triangle[3] = {indices[i], indices[i + 1], indices[i + 2]};
+        for (uint32_t j = 0; j < 3; j++) {
+            indices[i + j] = triangle[(best_rotation + j) % 3];
+        }
+        previous = indices[i + 2];
+    }
+}
+
+// NOTE: returns the encoded size, `out` must hold at least `index_codec_encoded_bound` bytes
+static size_t
+index_codec_encode(const uint32_t* indices, uint32_t index_count, unsigned char* out) {
+    size_t size = 0;
+    uint32_t previous = 0;
+    for (uint32_t block = 0; block < index_count; block += INDEX_CODEC_BLOCK_SIZE) {
+        uint32_t deltas[INDEX_CODEC_BLOCK_SIZE] = {0};
+        uint32_t max_delta = 0;
+        for (uint32_t i = 0; i < INDEX_CODEC_BLOCK_SIZE && block + i < index_count; i++) {
+            uint32_t index = indices[block + i];
+            deltas[i] = index_codec_zigzag((int32_t)(index - previous));
+            max_delta = deltas[i] > max_delta ? deltas[i] : max_delta;
+            previous = index;
+        }
+
+        uint32_t width = max_delta <= 0xff ? 1 : max_delta <= 0xffff ? 2 : 4;
+        out[size++] = (unsigned char)width;
+        for (uint32_t i = 0; i < INDEX_CODEC_BLOCK_SIZE; i++) {
+            for (uint32_t j = 0; j < width; j++) {
+                out[size++] = (unsigned char)((deltas[i] >> (j * 8)) & 0xff);
+            }
+        }
+    }
+    return size;
+}
+
+// NOTE: decodes 16 deltas into absolute indices, `previous` is the last decoded index
+static uint32_t
+index_codec_decode_block(const unsigned char* data, uint32_t width, uint32_t previous, uint32_t* out) {
+#if defined(_M_X64)
+    __m128i zero = _mm_setzero_si128();
+    __m128i one = _mm_set1_epi32(1);
+    __m128i lanes[4];
+    if (width == 1) {
+        __m128i bytes = _mm_loadu_si128((const __m128i*)data);
+        __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+        __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+        lanes[0] = _mm_unpacklo_epi16(lo, zero);
+        lanes[1] = _mm_unpackhi_epi16(lo, zero);
+        lanes[2] = _mm_unpacklo_epi16(hi, zero);
+        lanes[3] = _mm_unpackhi_epi16(hi, zero);
+    } else if (width == 2) {
+        __m128i lo = _mm_loadu_si128((const __m128i*)data);
+        __m128i hi = _mm_loadu_si128((const __m128i*)(data + 16));
+        lanes[0] = _mm_unpacklo_epi16(lo, zero);
+        lanes[1] = _mm_unpackhi_epi16(lo, zero);
+        lanes[2] = _mm_unpacklo_epi16(hi, zero);
+        lanes[3] = _mm_unpackhi_epi16(hi, zero);
+    } else {
+        for (uint32_t i = 0; i < 4; i++) {
+            lanes[i] = _mm_loadu_si128((const __m128i*)(data + i * 16));
+        }
+    }
+
+    __m128i running = _mm_set1_epi32((int)previous);
+    for (uint32_t i = 0; i < 4; i++) {
+        // NOTE: undo zigzag: (v >> 1) ^ -(v & 1)
+        __m128i v = lanes[i];
+        v = _mm_xor_si128(_mm_srli_epi32(v, 1), _mm_sub_epi32(zero, _mm_and_si128(v, one)));
+        // NOTE: inclusive prefix sum of the 4 lanes then add the last decoded index
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 4));
+        v = _mm_add_epi32(v, _mm_slli_si128(v, 8));
+        v = _mm_add_epi32(v, running);
+        _mm_storeu_si128((__m128i*)(out + i * 4), v);
+        running = _mm_shuffle_epi32(v, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+    return out[INDEX_CODEC_BLOCK_SIZE - 1];
+#else
+    for (uint32_t i = 0; i < INDEX_CODEC_BLOCK_SIZE; i++) {
+        uint32_t delta = 0;
+        for (uint32_t j = 0; j < width; j++) {
+            delta |= (uint32_t)data[i * width + j] << (j * 8);
+        }
+        previous += (delta >> 1) ^ (0u - (delta & 1));
+        out[i] = previous;
+    }
+    return previous;
+#endif
+}
+
+// NOTE: decodes `index_count` indices into `out` with `index_size` bytes each
+// returns false if the encoded data is truncated or malformed
+static bool
+index_codec_decode(const void* data, size_t size, uint32_t index_count, void* out, uint32_t index_size) {
+    const unsigned char* bytes = data;
+    size_t offset = 0;
+    uint32_t previous = 0;
+    for (uint32_t block = 0; block < index_count; block += INDEX_CODEC_BLOCK_SIZE) {
+        if (offset >= size) {
+            return false;
+        }
+        uint32_t width = bytes[offset++];
+        if ((width != 1 && width != 2 && width != 4) || size - offset < INDEX_CODEC_BLOCK_SIZE * width) {
+            return false;
+        }
+
+        uint32_t decoded[INDEX_CODEC_BLOCK_SIZE];
+        previous = index_codec_decode_block(bytes + offset, width, previous, decoded);
+        offset += INDEX_CODEC_BLOCK_SIZE * width;
+
+        uint32_t count = index_count - block < INDEX_CODEC_BLOCK_SIZE ? index_count - block : INDEX_CODEC_BLOCK_SIZE;
+        if (index_size == 4) {
+            memcpy((uint32_t*)out + block, decoded, count * sizeof(uint32_t));
+            continue;
+        }
+
+#if defined(_M_X64)
+        if (count == INDEX_CODEC_BLOCK_SIZE) {
+            // NOTE: narrow with a sign extending shift so `_mm_packs_epi32` keeps the low 16 bits as is
+            __m128i narrowed[2];
+            for (uint32_t i = 0; i < 2; i++) {
+                __m128i lo = _mm_loadu_si128((const __m128i*)(decoded + i * 8));
+                __m128i hi = _mm_loadu_si128((const __m128i*)(decoded + i * 8 + 4));
+                lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+                hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+                narrowed[i] = _mm_packs_epi32(lo, hi);
+            }
+            if (index_size == 2) {
+                _mm_storeu_si128((__m128i*)((uint16_t*)out + block), narrowed[0]);
+                _mm_storeu_si128((__m128i*)((uint16_t*)out + block + 8), narrowed[1]);
+            } else {
+                _mm_storeu_si128((__m128i*)((uint8_t*)out + block), _mm_packus_epi16(narrowed[0], narrowed[1]));
+            }
+            continue;
+        }
+#endif
+        for (uint32_t i = 0; i < count; i++) {
+            if (index_size == 2) {
+                ((uint16_t*)out)[block + i] = (uint16_t)(decoded[i] & 0xffff);
+            } else {
+                ((uint8_t*)out)[block + i] = (uint8_t)(decoded[i] & 0xff);
+            }
+        }
+    }
+    return offset == size;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// mesh file
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// gpu ready mesh container meant to be memory mapped and uploaded without any parsing:
+//
+// | MeshFileHeader | lod table | submesh table | meshlet table | vertex blob | index blob |
+//
+// all offsets are in bytes from the start of the file and all values are little endian.
+// the vertex and index blobs start at `MESH_FILE_BLOB_ALIGNMENT` so they can be handed directly
+// to `glNamedBufferStorage` (or copied as is into a persistently mapped staging buffer).
+// lods are made of submeshes which are ranges inside the index blob with their own base vertex
+// (big meshes are split so every submesh can still use 16 bit indices) and meshlets are smaller
+// ranges inside a submesh. everything can be drawn with `glDrawElementsBaseVertex`.
+// the index blob may be compressed with the index codec in which case it's decoded at load time
+// straight into the (mapped) gpu buffer.
+
+#define MESH_FILE_MAGIC 0x4853454d // "MESH"
+#define MESH_FILE_VERSION 2
+#define MESH_FILE_BLOB_ALIGNMENT 256
+#define MESH_FILE_MAX_ATTRIBUTES 8
+#define MESH_FILE_MAX_LODS 8
+#define MESH_FILE_MAX_SUBMESHES 64
+
+#define MESH_FILE_INDEX_ENCODING_NONE 0
+#define MESH_FILE_INDEX_ENCODING_DELTA 1
+
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+// NOTE: describes one vertex shader input, the same arguments `glVertexArrayAttribFormat` takes
+struct MeshFileAttribute {
+    uint32_t location;
+    uint32_t component_count;
+    uint32_t component_type; // GL_FLOAT, GL_UNSIGNED_BYTE, ...
+    uint32_t normalized;
+    uint32_t relative_offset;
+};
+
+struct MeshFileLod {
+    uint32_t first_submesh;
+    uint32_t submesh_count;
+    uint32_t index_count;
+    float error;
+};
+
+struct MeshFileSubmesh {
+    uint32_t first_index;
+    uint32_t index_count;
+    uint32_t base_vertex;
+    uint32_t vertex_count;
+    uint32_t first_meshlet;
+    uint32_t meshlet_count;
+};
+
+// NOTE: a small cluster of triangles with its bounding sphere and normal cone
+// the cone is built from `cross(p1 - p0, p2 - p0)` so it's backfacing from `camera` when
+// `dot(center - camera, cone_axis) >= cone_cutoff * length(center - camera) + radius`
+struct MeshFileMeshlet {
+    uint32_t first_index;
+    uint32_t index_count;
+    uint32_t base_vertex;
+    float center[3];
+    float radius;
+    float cone_axis[3];
+    float cone_cutoff;
+    uint32_t reserved;
+};
+
+struct MeshFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t file_size;
+
+    uint32_t vertex_count;
+    uint32_t vertex_stride;
+    uint32_t index_count;
+    uint32_t index_type; // GL_UNSIGNED_BYTE, GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    uint32_t index_encoding; // MESH_FILE_INDEX_ENCODING_*
+    uint32_t attribute_count;
+    uint32_t lod_count;
+    uint32_t submesh_count;
+    uint32_t meshlet_count;
+    uint32_t reserved;
+    struct MeshFileAttribute attributes[MESH_FILE_MAX_ATTRIBUTES];
+    float bounds_min[3];
+    float bounds_max[3];
+
+    uint64_t lod_table_offset;
+    uint64_t submesh_table_offset;
+    uint64_t meshlet_table_offset;
+    uint64_t vertex_data_offset;
+    uint64_t vertex_data_size;
+    uint64_t index_data_offset;
+    uint64_t index_data_size; // NOTE: encoded size when the indices are compressed
+};
+
+// NOTE: a parsed mesh file, all pointers alias the file memory
+struct MeshFile {
+    const struct MeshFileHeader* header;
+    const struct MeshFileLod* lods;
+    const struct MeshFileSubmesh* submeshes;
+    const struct MeshFileMeshlet* meshlets;
+    const void* vertex_data;
+    const void* index_data;
+};
+
+static uint32_t
+index_type_size(GLenum index_type) {
+    switch (index_type) {
+        case GL_UNSIGNED_BYTE: return 1;
+        case GL_UNSIGNED_SHORT: return 2;
+        case GL_UNSIGNED_INT: return 4;
+        default: return 0;
+    }
+}
+
+// NOTE: picks the smallest index type that can address `vertex_count` vertices. 8 bit indices are only
+// picked with `allow_8bit` since some hardware has no native support for them and converts on draw, every
+// mesh built here passes it because they're small enough that the conversion doesn't matter
+static GLenum
+index_type_for_vertex_count(uint32_t vertex_count, bool allow_8bit) {
+    if (allow_8bit && vertex_count <= 0x100) {
+        return GL_UNSIGNED_BYTE;
+    }
+    if (vertex_count <= 0x10000) {
+        return GL_UNSIGNED_SHORT;
+    }
+    return GL_UNSIGNED_INT;
+}
+
+static uint32_t
+vertex_attribute_type_size(GLenum type) {
+    switch (type) {
+        case GL_BYTE:
+        case GL_UNSIGNED_BYTE:
+            return 1;
+        case GL_SHORT:
+        case GL_UNSIGNED_SHORT:
+        case GL_HALF_FLOAT:
+            return 2;
+        case GL_INT:
+        case GL_UNSIGNED_INT:
+        case GL_FLOAT:
+            return 4;
+        default:
+            return 0;
+    }
+}
+
+static bool
+mesh_file_range_is_valid(uint64_t offset, uint64_t size, uint64_t alignment, uint64_t file_size) {
+    return offset % alignment == 0 && offset <= file_size && size <= file_size - offset;
+}
+
+// NOTE: only validates the header and its ranges, nothing is copied or converted
+static bool
+mesh_file_parse(struct MeshFile* mesh, const void* data, size_t size) {
+    memset(mesh, 0, sizeof(*mesh));
+
+    if (size < sizeof(struct MeshFileHeader)) {
+        return false;
+    }
+
+    const struct MeshFileHeader* header = data;
+    if (header->magic != MESH_FILE_MAGIC || header->version != MESH_FILE_VERSION || header->file_size != size) {
+        return false;
+    }
+
+    uint32_t index_size = index_type_size(header->index_type);
+    bool valid_index_data =
+        header->index_encoding == MESH_FILE_INDEX_ENCODING_NONE ?
+            header->index_data_size == (uint64_t)header->index_count * index_size :
+            header->index_encoding == MESH_FILE_INDEX_ENCODING_DELTA;
+    bool valid_counts =
+        index_size > 0 &&
+        valid_index_data &&
+        header->vertex_stride > 0 &&
+        header->attribute_count <= MESH_FILE_MAX_ATTRIBUTES &&
+        header->lod_count > 0 &&
+        header->lod_count <= MESH_FILE_MAX_LODS &&
+        header->submesh_count <= MESH_FILE_MAX_SUBMESHES &&
+        header->vertex_data_size == (uint64_t)header->vertex_count * header->vertex_stride;
+    if (!valid_counts) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < header->attribute_count; i++) {
+        const struct MeshFileAttribute* attribute = &header->attributes[i];
+        uint32_t attribute_size = attribute->component_count * vertex_attribute_type_size(attribute->component_type);
+        bool valid_attribute =
+            attribute->component_count >= 1 &&
+            attribute->component_count <= 4 &&
+            attribute_size > 0 &&
+            attribute->relative_offset + attribute_size <= header->vertex_stride;
+        if (!valid_attribute) {
+            return false;
+        }
+    }
+
+    bool valid_ranges =
+        mesh_file_range_is_valid(header->lod_table_offset, header->lod_count * sizeof(struct MeshFileLod), 8, size) &&
+        mesh_file_range_is_valid(header->submesh_table_offset, header->submesh_count * sizeof(struct MeshFileSubmesh), 8, size) &&
+        mesh_file_range_is_valid(header->meshlet_table_offset, header->meshlet_count * sizeof(struct MeshFileMeshlet), 8, size) &&
+        mesh_file_range_is_valid(header->vertex_data_offset, header->vertex_data_size, MESH_FILE_BLOB_ALIGNMENT, size) &&
+        mesh_file_range_is_valid(header->index_data_offset, header->index_data_size, MESH_FILE_BLOB_ALIGNMENT, size);
+    if (!valid_ranges) {
+        return false;
+    }
+
+    const unsigned char* bytes = data;
+    const struct MeshFileLod* lods = (const struct MeshFileLod*)(bytes + header->lod_table_offset);
+    const struct MeshFileSubmesh* submeshes = (const struct MeshFileSubmesh*)(bytes + header->submesh_table_offset);
+    const struct MeshFileMeshlet* meshlets = (const struct MeshFileMeshlet*)(bytes + header->meshlet_table_offset);
+
+    for (uint32_t i = 0; i < header->lod_count; i++) {
+        if ((uint64_t)lods[i].first_submesh + lods[i].submesh_count > header->submesh_count) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header->submesh_count; i++) {
+        const struct MeshFileSubmesh* submesh = &submeshes[i];
+        bool valid_submesh =
+            (uint64_t)submesh->first_index + submesh->index_count <= header->index_count &&
+            (uint64_t)submesh->base_vertex + submesh->vertex_count <= header->vertex_count &&
+            (uint64_t)submesh->first_meshlet + submesh->meshlet_count <= header->meshlet_count;
+        if (!valid_submesh) {
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header->meshlet_count; i++) {
+        bool valid_meshlet =
+            (uint64_t)meshlets[i].first_index + meshlets[i].index_count <= header->index_count &&
+            meshlets[i].base_vertex < header->vertex_count;
+        if (!valid_meshlet) {
+            return false;
+        }
+    }
+
+    mesh->header = header;
+    mesh->lods = lods;
+    mesh->submeshes = submeshes;
+    mesh->meshlets = meshlets;
+    mesh->vertex_data = bytes + header->vertex_data_offset;
+    mesh->index_data = bytes + header->index_data_offset;
+    return true;
+}
+
+// NOTE: splits a range of triangles into consecutive submeshes that each reference at most `max_vertices`
+// vertices so they can use smaller indices. for every submesh its triangles are written to `local_indices`
+// (starting at `first_index`) and its vertices to `vertex_remap` (starting at `base_vertex`) which maps
+// them back to the original vertices. `vertex_map` must have room for every original vertex and be
+// filled with UINT32_MAX, it's left that way when done. false when it takes more than `max_submeshes`
+static bool
+mesh_split(
+    const uint32_t* indices,
+    uint32_t index_count,
+    uint32_t max_vertices,
+    struct MeshFileSubmesh* submeshes,
+    uint32_t max_submeshes,
+    uint32_t* local_indices,
+    uint32_t* vertex_remap,
+    uint32_t* vertex_map,
+    uint32_t* submesh_count
+) {
+    ASSERT(max_vertices >= 3);
+
+    *submesh_count = 0;
+    struct MeshFileSubmesh* submesh = NULL;
+    uint32_t remap_count = 0;
+
+    for (uint32_t i = 0; i < index_count; i += 3) {
+        uint32_t new_vertex_count = 0;
+        for (uint32_t j = 0; j < 3; j++) {
+            bool repeated = false;
+            for (uint32_t k = 0; k < j; k++) {
+                repeated = repeated || indices[i + k] == indices[i + j];
+            }
+            new_vertex_count += vertex_map[indices[i + j]] == UINT32_MAX && !repeated ? 1 : 0;
+        }
+
+        if (!submesh || submesh->vertex_count + new_vertex_count > max_vertices) {
+            if (submesh) {
+                for (uint32_t j = 0; j < submesh->vertex_count; j++) {
+                    vertex_map[vertex_remap[submesh->base_vertex + j]] = UINT32_MAX;
+                }
+            }
+            if (*submesh_count == max_submeshes) {
+                return false;
+            }
+            submesh = &submeshes[*submesh_count];
+            *submesh_count += 1;
+            memset(submesh, 0, sizeof(*submesh));
+            submesh->first_index = i;
+            submesh->base_vertex = remap_count;
+        }
+
+        for (uint32_t j = 0; j < 3; j++) {
+            uint32_t index = indices[i + j];
+            if (vertex_map[index] == UINT32_MAX) {
+                vertex_map[index] = submesh->vertex_count++;
+                vertex_remap[remap_count++] = index;
+            }
+            local_indices[i + j] = vertex_map[index];
+        }
+        submesh->index_count += 3;
+    }
+
+    if (submesh) {
+        for (uint32_t j = 0; j < submesh->vertex_count; j++) {
+            vertex_map[vertex_remap[submesh->base_vertex + j]] = UINT32_MAX;
+        }
+    }
+    return true;
+}
+
+// NOTE: everything needed to serialize a mesh, indices are always given as 32 bits
+// and lod 0 is expected to be the full detail one
+struct MeshFileBuildDesc {
+    const void* vertices;
+    uint32_t vertex_count;
+    uint32_t vertex_stride;
+    const struct MeshFileAttribute* attributes;
+    uint32_t attribute_count;
+    uint32_t lod_count;
+    const uint32_t* lod_indices[MESH_FILE_MAX_LODS];
+    uint32_t lod_index_counts[MESH_FILE_MAX_LODS];
+    float lod_errors[MESH_FILE_MAX_LODS];
+
+    // NOTE: meshes with more vertices are split into submeshes (0 to never split)
+    uint32_t max_submesh_vertices;
+    bool allow_8bit_indices;
+    bool compress_indices;
+};
+
+static const float*
+mesh_vertex_position(const unsigned char* positions, uint32_t stride, uint32_t index) {
+    return (const float*)(positions + (size_t)index * stride);
+}
+
+static void
+meshlet_compute_bounds(
+    struct MeshFileMeshlet* meshlet,
+    const uint32_t* indices,
+    uint32_t index_count,
+    const unsigned char* positions,
+    uint32_t stride
+) {
+    float min[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+    float max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    float normal_sum[3] = {0.0f, 0.0f, 0.0f};
+
+    for (uint32_t i = 0; i < index_count; i += 3) {
+        const float* p[3];
+        for (uint32_t j = 0; j < 3; j++) {
+            p[j] = mesh_vertex_position(positions, stride, indices[i + j]);
+            for (uint32_t k = 0; k < 3; k++) {
+                min[k] = fminf(min[k], p[j][k]);
+                max[k] = fmaxf(max[k], p[j][k]);
+            }
+        }
+
+        float e0[3] = {p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2]};
+        float e1[3] = {p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2]};
+        float n[3] = {e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0]};
+        float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length > 0.0f) {
+            for (uint32_t k = 0; k < 3; k++) {
+                normal_sum[k] += n[k] / length;
+            }
+        }
+    }
+
+    float radius = 0.0f;
+    for (uint32_t k = 0; k < 3; k++) {
+        meshlet->center[k] = (min[k] + max[k]) * 0.5f;
+    }
+    for (uint32_t i = 0; i < index_count; i++) {
+        const float* p = mesh_vertex_position(positions, stride, indices[i]);
+        float d[3] = {p[0] - meshlet->center[0], p[1] - meshlet->center[1], p[2] - meshlet->center[2]};
+        radius = fmaxf(radius, sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]));
+    }
+    meshlet->radius = radius;
+
+    float axis_length = sqrtf(normal_sum[0] * normal_sum[0] + normal_sum[1] * normal_sum[1] + normal_sum[2] * normal_sum[2]);
+    if (axis_length <= 0.0f) {
+        // NOTE: normals cancel out, the cluster can never be cone culled
+        meshlet->cone_axis[0] = 0.0f;
+        meshlet->cone_axis[1] = 0.0f;
+        meshlet->cone_axis[2] = 1.0f;
+        meshlet->cone_cutoff = 1.0f;
+        return;
+    }
+    for (uint32_t k = 0; k < 3; k++) {
+        meshlet->cone_axis[k] = normal_sum[k] / axis_length;
+    }
+
+    float min_dot = 1.0f;
+    for (uint32_t i = 0; i < index_count; i += 3) {
+        const float* p0 = mesh_vertex_position(positions, stride, indices[i + 0]);
+        const float* p1 = mesh_vertex_position(positions, stride, indices[i + 1]);
+        const float* p2 = mesh_vertex_position(positions, stride, indices[i + 2]);
+        float e0[3] = {p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2]};
+        float e1[3] = {p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2]};
+        float n[3] = {e0[1] * e1[2] - e0[2] * e1[1], e0[2] * e1[0] - e0[0] * e1[2], e0[0] * e1[1] - e0[1] * e1[0]};
+        float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length > 0.0f) {
+            float dot = (n[0] * meshlet->cone_axis[0] + n[1] * meshlet->cone_axis[1] + n[2] * meshlet->cone_axis[2]) / length;
+            min_dot = fminf(min_dot, dot);
+        }
+    }
+
+    // NOTE: store the sine of the cone spread, a spread wider than 90 degrees can't be culled
+    meshlet->cone_cutoff = min_dot <= 0.0f ? 1.0f : sqrtf(1.0f - min_dot * min_dot);
+}
+
+// NOTE: greedily groups consecutive triangles into meshlets and returns how many were made
+// `meshlets` can be NULL to only count them, otherwise `positions` must point to the submesh first vertex
+static uint32_t
+meshlets_build(
+    struct MeshFileMeshlet* meshlets,
+    const uint32_t* indices,
+    uint32_t index_count,
+    uint32_t first_index,
+    uint32_t base_vertex,
+    const unsigned char* positions,
+    uint32_t stride
+) {
+    uint32_t meshlet_count = 0;
+    uint32_t meshlet_vertices[MESHLET_MAX_VERTICES];
+    uint32_t meshlet_vertex_count = 0;
+    uint32_t meshlet_first_index = 0;
+
+    for (uint32_t i = 0; i <= index_count; i += 3) {
+        uint32_t new_vertex_count = 0;
+        if (i < index_count) {
+            for (uint32_t j = 0; j < 3; j++) {
+                bool found = false;
+                for (uint32_t k = 0; k < meshlet_vertex_count && !found; k++) {
+                    found = meshlet_vertices[k] == indices[i + j];
+                }
+                for (uint32_t k = 0; k < j && !found; k++) {
+                    found = indices[i + k] == indices[i + j];
+                }
+                new_vertex_count += found ? 0 : 1;
+            }
+        }
+
+        uint32_t triangle_count = (i - meshlet_first_index) / 3;
+        bool is_full =
+            meshlet_vertex_count + new_vertex_count > MESHLET_MAX_VERTICES ||
+            triangle_count + 1 > MESHLET_MAX_TRIANGLES;
+        if (triangle_count > 0 && (i == index_count || is_full)) {
+            if (meshlets) {
+                struct MeshFileMeshlet* meshlet = &meshlets[meshlet_count];
+                meshlet->first_index = first_index + meshlet_first_index;
+                meshlet->index_count = i - meshlet_first_index;
+                meshlet->base_vertex = base_vertex;
+                meshlet_compute_bounds(meshlet, indices + meshlet_first_index, meshlet->index_count, positions, stride);
+            }
+            meshlet_count += 1;
+            meshlet_vertex_count = 0;
+            meshlet_first_index = i;
+        }
+
+        if (i < index_count) {
+            for (uint32_t j = 0; j < 3; j++) {
+                bool found = false;
+                for (uint32_t k = 0; k < meshlet_vertex_count && !found; k++) {
+                    found = meshlet_vertices[k] == indices[i + j];
+                }
+                if (!found) {
+                    meshlet_vertices[meshlet_vertex_count++] = indices[i + j];
+                }
+            }
+        }
+    }
+
+    return meshlet_count;
+}
+
+// NOTE: serializes a mesh into the mesh file format and returns its size in bytes
+// `buffer` is only written to when `buffer_size` is big enough so it can be called once to query the size.
+// returns 0 when the mesh doesn't fit the format: more indices than 32 bits can count or, split, more than
+// `MESH_FILE_MAX_SUBMESHES` submeshes
+static size_t
+mesh_file_build(const struct MeshFileBuildDesc* desc, void* buffer, size_t buffer_size) {
+    ASSERT(desc->attribute_count <= MESH_FILE_MAX_ATTRIBUTES);
+    ASSERT(desc->lod_count > 0 && desc->lod_count <= MESH_FILE_MAX_LODS);
+
+    // NOTE: meshlet bounds come from the attribute at location 0 which must be a float3 position
+    uint32_t position_offset = UINT32_MAX;
+    for (uint32_t i = 0; i < desc->attribute_count; i++) {
+        const struct MeshFileAttribute* attribute = &desc->attributes[i];
+        if (attribute->location == 0 && attribute->component_type == GL_FLOAT && attribute->component_count >= 3) {
+            position_offset = attribute->relative_offset;
+        }
+    }
+    ASSERT(position_offset != UINT32_MAX);
+
+    uint64_t total_index_count = 0;
+    for (uint32_t i = 0; i < desc->lod_count; i++) {
+        ASSERT(desc->lod_index_counts[i] % 3 == 0);
+        total_index_count += desc->lod_index_counts[i];
+    }
+    if (total_index_count > UINT32_MAX) {
+        return 0;
+    }
+    uint32_t index_count = (uint32_t)total_index_count;
+
+    // NOTE: gather every lod into a single index stream, split into submeshes if needed
+    bool split = desc->max_submesh_vertices > 0 && desc->vertex_count > desc->max_submesh_vertices;
+    uint32_t* local_indices = os_alloc((size_t)(index_count > 0 ? index_count : 1) * sizeof(uint32_t));
+    uint32_t* vertex_remap = NULL;
+    uint32_t* vertex_map = NULL;
+    if (split) {
+        vertex_remap = os_alloc((size_t)(index_count > 0 ? index_count : 1) * sizeof(uint32_t));
+        vertex_map = os_alloc((size_t)desc->vertex_count * sizeof(uint32_t));
+        memset(vertex_map, 0xff, (size_t)desc->vertex_count * sizeof(uint32_t));
+    }
+
+    struct MeshFileLod lods[MESH_FILE_MAX_LODS];
+    struct MeshFileSubmesh submeshes[MESH_FILE_MAX_SUBMESHES];
+    uint32_t submesh_count = 0;
+    uint32_t vertex_count = split ? 0 : desc->vertex_count;
+    uint32_t max_submesh_vertex_count = 0;
+
+    uint32_t first_index = 0;
+    for (uint32_t i = 0; i < desc->lod_count; i++) {
+        const uint32_t* lod_indices = desc->lod_indices[i];
+        uint32_t lod_index_count = desc->lod_index_counts[i];
+        for (uint32_t j = 0; j < lod_index_count; j++) {
+            ASSERT(lod_indices[j] < desc->vertex_count);
+        }
+
+        struct MeshFileLod* lod = &lods[i];
+        lod->first_submesh = submesh_count;
+        lod->index_count = lod_index_count;
+        lod->error = desc->lod_errors[i];
+
+        if (split) {
+            uint32_t lod_first_vertex = vertex_count;
+            bool fits = mesh_split(
+                lod_indices,
+                lod_index_count,
+                desc->max_submesh_vertices,
+                submeshes + submesh_count,
+                MESH_FILE_MAX_SUBMESHES - submesh_count,
+                local_indices + first_index,
+                vertex_remap + vertex_count,
+                vertex_map,
+                &lod->submesh_count
+            );
+            if (!fits) {
+                os_free(vertex_map);
+                os_free(vertex_remap);
+                os_free(local_indices);
+                return 0;
+            }
+            for (uint32_t j = 0; j < lod->submesh_count; j++) {
+                submeshes[submesh_count + j].first_index += first_index;
+                submeshes[submesh_count + j].base_vertex += lod_first_vertex;
+                vertex_count += submeshes[submesh_count + j].vertex_count;
+            }
+        } else {
+            ASSERT(submesh_count < MESH_FILE_MAX_SUBMESHES);
+            lod->submesh_count = 1;
+            submeshes[submesh_count] = (struct MeshFileSubmesh){
+                .first_index = first_index,
+                .index_count = lod_index_count,
+                .base_vertex = 0,
+                .vertex_count = desc->vertex_count,
+            };
+            memcpy(local_indices + first_index, lod_indices, (size_t)lod_index_count * sizeof(uint32_t));
+        }
+
+        for (uint32_t j = 0; j < lod->submesh_count; j++) {
+            uint32_t submesh_vertex_count = submeshes[submesh_count + j].vertex_count;
+            max_submesh_vertex_count = submesh_vertex_count > max_submesh_vertex_count ? submesh_vertex_count : max_submesh_vertex_count;
+        }
+        submesh_count += lod->submesh_count;
+        first_index += lod_index_count;
+    }
+
+    if (desc->compress_indices) {
+        index_codec_rotate_triangles(local_indices, index_count);
+    }
+
+    uint32_t meshlet_count = 0;
+    for (uint32_t i = 0; i < submesh_count; i++) {
+        struct MeshFileSubmesh* submesh = &submeshes[i];
+        submesh->first_meshlet = meshlet_count;
+        submesh->meshlet_count = meshlets_build(NULL, local_indices + submesh->first_index, submesh->index_count, 0, 0, NULL, 0);
+        meshlet_count += submesh->meshlet_count;
+    }
+
+    GLenum index_type = index_type_for_vertex_count(max_submesh_vertex_count, desc->allow_8bit_indices);
+    uint32_t index_size = index_type_size(index_type);
+
+    // NOTE: indices are only stored compressed when that's actually smaller
+    unsigned char* encoded_indices = NULL;
+    uint64_t index_data_size = (uint64_t)index_count * index_size;
+    if (desc->compress_indices) {
+        encoded_indices = os_alloc(index_codec_encoded_bound(index_count) + 1);
+        size_t encoded_size = index_codec_encode(local_indices, index_count, encoded_indices);
+        if (encoded_size < index_data_size) {
+            index_data_size = encoded_size;
+        } else {
+            os_free(encoded_indices);
+            encoded_indices = NULL;
+        }
+    }
+
+    uint64_t lod_table_offset = ALIGN_UP(sizeof(struct MeshFileHeader), 8);
+    uint64_t submesh_table_offset = ALIGN_UP(lod_table_offset + desc->lod_count * sizeof(struct MeshFileLod), 8);
+    uint64_t meshlet_table_offset = ALIGN_UP(submesh_table_offset + submesh_count * sizeof(struct MeshFileSubmesh), 8);
+    uint64_t vertex_data_offset = ALIGN_UP(meshlet_table_offset + meshlet_count * sizeof(struct MeshFileMeshlet), MESH_FILE_BLOB_ALIGNMENT);
+    uint64_t vertex_data_size = (uint64_t)vertex_count * desc->vertex_stride;
+    uint64_t index_data_offset = ALIGN_UP(vertex_data_offset + vertex_data_size, MESH_FILE_BLOB_ALIGNMENT);
+    uint64_t file_size = index_data_offset + index_data_size;
+
+    if (buffer && buffer_size >= file_size) {
+        unsigned char* bytes = buffer;
+        memset(bytes, 0, (size_t)file_size);
+
+        struct MeshFileHeader* header = (struct MeshFileHeader*)bytes;
+        header->magic = MESH_FILE_MAGIC;
+        header->version = MESH_FILE_VERSION;
+        header->file_size = file_size;
+        header->vertex_count = vertex_count;
+        header->vertex_stride = desc->vertex_stride;
+        header->index_count = index_count;
+        header->index_type = index_type;
+        header->index_encoding = encoded_indices ? MESH_FILE_INDEX_ENCODING_DELTA : MESH_FILE_INDEX_ENCODING_NONE;
+        header->attribute_count = desc->attribute_count;
+        header->lod_count = desc->lod_count;
+        header->submesh_count = submesh_count;
+        header->meshlet_count = meshlet_count;
+        memcpy(header->attributes, desc->attributes, desc->attribute_count * sizeof(struct MeshFileAttribute));
+        header->lod_table_offset = lod_table_offset;
+        header->submesh_table_offset = submesh_table_offset;
+        header->meshlet_table_offset = meshlet_table_offset;
+        header->vertex_data_offset = vertex_data_offset;
+        header->vertex_data_size = vertex_data_size;
+        header->index_data_offset = index_data_offset;
+        header->index_data_size = index_data_size;
+
+        unsigned char* vertex_data = bytes + vertex_data_offset;
+        if (split) {
+            for (uint32_t i = 0; i < vertex_count; i++) {
+                const unsigned char* vertex = (const unsigned char*)desc->vertices + (size_t)vertex_remap[i] * desc->vertex_stride;
+                memcpy(vertex_data + (size_t)i * desc->vertex_stride, vertex, desc->vertex_stride);
+            }
+        } else {
+            memcpy(vertex_data, desc->vertices, (size_t)vertex_data_size);
+        }
+
+        const unsigned char* positions = vertex_data + position_offset;
+        for (uint32_t k = 0; k < 3; k++) {
+            header->bounds_min[k] = FLT_MAX;
+            header->bounds_max[k] = -FLT_MAX;
+        }
+        for (uint32_t i = 0; i < vertex_count; i++) {
+            const float* p = mesh_vertex_position(positions, desc->vertex_stride, i);
+            for (uint32_t k = 0; k < 3; k++) {
+                header->bounds_min[k] = fminf(header->bounds_min[k], p[k]);
+                header->bounds_max[k] = fmaxf(header->bounds_max[k], p[k]);
+            }
+        }
+
+        memcpy(bytes + lod_table_offset, lods, desc->lod_count * sizeof(struct MeshFileLod));
+        memcpy(bytes + submesh_table_offset, submeshes, submesh_count * sizeof(struct MeshFileSubmesh));
+
+        struct MeshFileMeshlet* meshlets = (struct MeshFileMeshlet*)(bytes + meshlet_table_offset);
+        for (uint32_t i = 0; i < submesh_count; i++) {
+            const struct MeshFileSubmesh* submesh = &submeshes[i];
+            meshlets_build(
+                meshlets + submesh->first_meshlet,
+                local_indices + submesh->first_index,
+                submesh->index_count,
+                submesh->first_index,
+                submesh->base_vertex,
+                positions + (size_t)submesh->base_vertex * desc->vertex_stride,
+                desc->vertex_stride
+            );
+        }
+
+        unsigned char* index_data = bytes + index_data_offset;
+        if (encoded_indices) {
+            memcpy(index_data, encoded_indices, (size_t)index_data_size);
+        } else {
+            for (uint32_t i = 0; i < index_count; i++) {
+                switch (index_size) {
+                    case 1: ((uint8_t*)index_data)[i] = (uint8_t)(local_indices[i] & 0xff); break;
+                    case 2: ((uint16_t*)index_data)[i] = (uint16_t)(local_indices[i] & 0xffff); break;
+                    default: ((uint32_t*)index_data)[i] = local_indices[i]; break;
+                }
+            }
+        }
+    }
+
+    os_free(encoded_indices);
+    os_free(vertex_map);
+    os_free(vertex_remap);
+    os_free(local_indices);
+    return (size_t)file_size;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// timing and bit helpers
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+static int64_t
+timer_now(void) {
+    LARGE_INTEGER counter = {0};
+    QueryPerformanceCounter(&counter);
+    return counter.QuadPart;
+}
+
+static double
+timer_seconds(int64_t ticks) {
+    static LARGE_INTEGER frequency = {0};
+    if (frequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&frequency);
+    }
+    return (double)ticks / (double)frequency.QuadPart;
+}
+
+// NOTE: index of the lowest set bit, `mask` must not be zero
+static uint32_t
+bit_scan_forward(uint32_t mask) {
+    unsigned long index = 0;
+    _BitScanForward(&index, mask);
+    return (uint32_t)index;
+}
+
+// NOTE: index of the highest set bit, `mask` must not be zero
+static uint32_t
+bit_scan_reverse(uint32_t mask) {
+    unsigned long index = 0;
+    _BitScanReverse(&index, mask);
+    return (uint32_t)index;
+}
+
+static uint32_t
+greatest_common_divisor(uint32_t a, uint32_t b) {
+    while (b != 0) {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// cpu features
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+struct CpuFeatures {
+    bool avx2; // NOTE: also implies fma and that the os saves the ymm registers
+};
+
+static struct CpuFeatures cpu_features = {0};
+
+static void
+cpu_features_detect(void) {
+    memset(&cpu_features, 0, sizeof(cpu_features));
+#if defined(_M_X64)
+    int info[4] = {0};
+    __cpuid(info, 0);
+    int max_leaf = info[0];
+
+    __cpuid(info, 1);
+    bool has_fma = (info[2] & (1 << 12)) != 0;
+    bool has_osxsave = (info[2] & (1 << 27)) != 0;
+    bool has_avx = (info[2] & (1 << 28)) != 0;
+    bool os_saves_ymm = has_osxsave && (_xgetbv(0) & 0x6) == 0x6;
+
+    bool has_avx2 = false;
+    if (max_leaf >= 7) {
+        __cpuidex(info, 7, 0);
+        has_avx2 = (info[1] & (1 << 5)) != 0;
+    }
+
+    cpu_features.avx2 = has_avx && has_avx2 && has_fma && os_saves_ymm;
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// math
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// right handed with column major matrices (`columns[c][r]`, the same layout glsl expects for a `mat4`).
+// projections target `glClipControl(GL_UPPER_LEFT, GL_ZERO_TO_ONE)`: depth goes from 0 (near) to 1 (far)
+// and y is flipped so world space is y up even though the framebuffer origin is the upper left corner.
+// single matrices go through the 4 wide `f32x4` (SSE or NEON) while the `*_array` functions transform
+// structure of arrays data 8 objects at a time with AVX2 (when the cpu has it) or 4 at a time otherwise
+
+#if defined(_M_X64) || defined(_M_IX86)
+typedef __m128 f32x4;
+#define f32x4_load(pointer) _mm_loadu_ps(pointer)
+#define f32x4_store(pointer, value) _mm_storeu_ps((pointer), (value))
+#define f32x4_splat(value) _mm_set1_ps(value)
+#define f32x4_add(a, b) _mm_add_ps((a), (b))
+#define f32x4_mul(a, b) _mm_mul_ps((a), (b))
+#define f32x4_mul_add(a, b, c) _mm_add_ps(_mm_mul_ps((a), (b)), (c))
+#elif defined(_M_ARM64)
+typedef float32x4_t f32x4;
+#define f32x4_load(pointer) vld1q_f32(pointer)
+#define f32x4_store(pointer, value) vst1q_f32((pointer), (value))
+#define f32x4_splat(value) vdupq_n_f32(value)
+#define f32x4_add(a, b) vaddq_f32((a), (b))
+#define f32x4_mul(a, b) vmulq_f32((a), (b))
+#define f32x4_mul_add(a, b, c) vfmaq_f32((c), (a), (b))
+#else
+#error "unsupported architecture"
+#endif
+
+// NOTE: arrays are padded to this many elements so every batch can be processed without a scalar tail
+#define MATH_BATCH_WIDTH 8
+
+struct Vec3 {
+    float x;
+    float y;
+    float z;
+};
+
+struct Mat4 {
+    float columns[4][4];
+};
+
+// NOTE: structure of arrays, element (column c, row r) of matrix i is `elements[c * 4 + r][i]`
+struct Mat4Array {
+    float* elements[16];
+    uint32_t count;
+};
+
+struct Vec4Array {
+    float* components[4];
+    uint32_t count;
+};
+
+static struct Vec3
+vec3_sub(struct Vec3 a, struct Vec3 b) {
+    return (struct Vec3){a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+static float
+vec3_dot(struct Vec3 a, struct Vec3 b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+static struct Vec3
+vec3_cross(struct Vec3 a, struct Vec3 b) {
+    return (struct Vec3){a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+
+static struct Vec3
+vec3_normalize(struct Vec3 v) {
+    float length = sqrtf(vec3_dot(v, v));
+    ASSERT(length > 0.0f);
+    return (struct Vec3){v.x / length, v.y / length, v.z / length};
+}
+
+// NOTE: `w` is 1 for points and 0 for directions
+static struct Vec3
+mat4_mul_vec3(const struct Mat4* m, struct Vec3 v, float w) {
+    float result[3];
+    for (uint32_t i = 0; i < 3; i++) {
+        result[i] = m->columns[0][i] * v.x + m->columns[1][i] * v.y + m->columns[2][i] * v.z + m->columns[3][i] * w;
+    }
+    return (struct Vec3){result[0], result[1], result[2]};
+}
+
+static struct Mat4
+mat4_mul(const struct Mat4* a, const struct Mat4* b) {
+    f32x4 a0 = f32x4_load(a->columns[0]);
+    f32x4 a1 = f32x4_load(a->columns[1]);
+    f32x4 a2 = f32x4_load(a->columns[2]);
+    f32x4 a3 = f32x4_load(a->columns[3]);
+
+    struct Mat4 result = {0};
+    for (uint32_t i = 0; i < 4; i++) {
+        f32x4 column = f32x4_mul(a0, f32x4_splat(b->columns[i][0]));
+        column = f32x4_mul_add(a1, f32x4_splat(b->columns[i][1]), column);
+        column = f32x4_mul_add(a2, f32x4_splat(b->columns[i][2]), column);
+        column = f32x4_mul_add(a3, f32x4_splat(b->columns[i][3]), column);
+        f32x4_store(result.columns[i], column);
+    }
+    return result;
+}
+
+// NOTE: rotates `angle` radians around the normalized `axis`, then scales uniformly, then translates
+static struct Mat4
+mat4_transform(struct Vec3 translation, struct Vec3 axis, float angle, float scale) {
+    float c = cosf(angle);
+    float s = sinf(angle);
+    float t = 1.0f - c;
+    struct Mat4 result = {
+        .columns = {
+            {(t * axis.x * axis.x + c) * scale, (t * axis.x * axis.y + s * axis.z) * scale, (t * axis.x * axis.z - s * axis.y) * scale, 0.0f},
+            {(t * axis.x * axis.y - s * axis.z) * scale, (t * axis.y * axis.y + c) * scale, (t * axis.y * axis.z + s * axis.x) * scale, 0.0f},
+            {(t * axis.x * axis.z + s * axis.y) * scale, (t * axis.y * axis.z - s * axis.x) * scale, (t * axis.z * axis.z + c) * scale, 0.0f},
+            {translation.x, translation.y, translation.z, 1.0f},
+        },
+    };
+    return result;
+}
+
+// NOTE: right handed view matrix, the camera looks down its -z axis
+static struct Mat4
+mat4_look_at(struct Vec3 eye, struct Vec3 target, struct Vec3 up) {
+    struct Vec3 f = vec3_normalize(vec3_sub(target, eye));
+    struct Vec3 s = vec3_normalize(vec3_cross(f, up));
+    struct Vec3 u = vec3_cross(s, f);
+    struct Mat4 result = {
+        .columns = {
+            {s.x, u.x, -f.x, 0.0f},
+            {s.y, u.y, -f.y, 0.0f},
+            {s.z, u.z, -f.z, 0.0f},
+            {-vec3_dot(s, eye), -vec3_dot(u, eye), vec3_dot(f, eye), 1.0f},
+        },
+    };
+    return result;
+}
+
+// NOTE: maps view space depth `-near` to 0 and `-far` to 1 and flips y for the upper left origin
+static struct Mat4
+mat4_perspective(float fov_y, float aspect_ratio, float near_plane, float far_plane) {
+    float h = 1.0f / tanf(fov_y * 0.5f);
+    float depth_scale = far_plane / (near_plane - far_plane);
+    struct Mat4 result = {
+        .columns = {
+            {h / aspect_ratio, 0.0f, 0.0f, 0.0f},
+            {0.0f, -h, 0.0f, 0.0f},
+            {0.0f, 0.0f, depth_scale, -1.0f},
+            {0.0f, 0.0f, near_plane * depth_scale, 0.0f},
+        },
+    };
+    return result;
+}
+
+static uint32_t
+math_array_capacity(uint32_t count) {
+    return ALIGN_UP(count > 0 ? count : 1, MATH_BATCH_WIDTH);
+}
+
+static struct Mat4Array
+mat4_array_alloc(struct LinearArena* arena, uint32_t count) {
+    struct Mat4Array array = {.count = count};
+    size_t capacity = math_array_capacity(count);
+    float* elements = linear_arena_alloc(arena, 16 * capacity * sizeof(float), 32);
+    for (uint32_t i = 0; i < 16; i++) {
+        array.elements[i] = elements + i * capacity;
+    }
+    return array;
+}
+
+static struct Vec4Array
+vec4_array_alloc(struct LinearArena* arena, uint32_t count) {
+    struct Vec4Array array = {.count = count};
+    size_t capacity = math_array_capacity(count);
+    float* components = linear_arena_alloc(arena, 4 * capacity * sizeof(float), 32);
+    for (uint32_t i = 0; i < 4; i++) {
+        array.components[i] = components + i * capacity;
+    }
+    return array;
+}
+
+// NOTE: extracts the planes bounding the clip volume of `matrix` (gribb, hartmann) for zero to one depth,
+// in the space the matrix transforms from. normals are normalized and point inside
+static void
+frustum_planes_from_matrix(const struct Mat4* matrix, float planes[6][4]) {
+    for (uint32_t i = 0; i < 4; i++) {
+        float row0 = matrix->columns[i][0];
+        float row1 = matrix->columns[i][1];
+        float row2 = matrix->columns[i][2];
+        float row3 = matrix->columns[i][3];
+        planes[0][i] = row3 + row0;
+        planes[1][i] = row3 - row0;
+        planes[2][i] = row3 + row1;
+        planes[3][i] = row3 - row1;
+        planes[4][i] = row2;
+        planes[5][i] = row3 - row2;
+    }
+    for (uint32_t i = 0; i < 6; i++) {
+        float length = sqrtf(planes[i][0] * planes[i][0] + planes[i][1] * planes[i][1] + planes[i][2] * planes[i][2]);
+        for (uint32_t j = 0; j < 4; j++) {
+            planes[i][j] /= length;
+        }
+    }
+}
+
+static void
+mat4_array_set(struct Mat4Array* array, uint32_t index, const struct Mat4* matrix) {
+    ASSERT(index < array->count);
+    for (uint32_t i = 0; i < 16; i++) {
+        array->elements[i][index] = matrix->columns[i / 4][i % 4];
+    }
+}
+
+static void
+mat4_array_get(const struct Mat4Array* array, uint32_t index, struct Mat4* matrix) {
+    ASSERT(index < array->count);
+    for (uint32_t i = 0; i < 16; i++) {
+        matrix->columns[i / 4][i % 4] = array->elements[i][index];
+    }
+}
+
+static void
+mat4_array_mul_f32x4(const struct Mat4* a, const struct Mat4Array* b, struct Mat4Array* out) {
+    for (uint32_t i = 0; i < b->count; i += 4) {
+        for (uint32_t column = 0; column < 4; column++) {
+            f32x4 b0 = f32x4_load(b->elements[column * 4 + 0] + i);
+            f32x4 b1 = f32x4_load(b->elements[column * 4 + 1] + i);
+            f32x4 b2 = f32x4_load(b->elements[column * 4 + 2] + i);
+            f32x4 b3 = f32x4_load(b->elements[column * 4 + 3] + i);
+            for (uint32_t row = 0; row < 4; row++) {
+                f32x4 value = f32x4_mul(f32x4_splat(a->columns[0][row]), b0);
+                value = f32x4_mul_add(f32x4_splat(a->columns[1][row]), b1, value);
+                value = f32x4_mul_add(f32x4_splat(a->columns[2][row]), b2, value);
+                value = f32x4_mul_add(f32x4_splat(a->columns[3][row]), b3, value);
+                f32x4_store(out->elements[column * 4 + row] + i, value);
+            }
+        }
+    }
+}
+
+static void
+mat4_mul_vec4_array_f32x4(const struct Mat4* m, const struct Vec4Array* v, struct Vec4Array* out) {
+    for (uint32_t i = 0; i < v->count; i += 4) {
+        f32x4 x = f32x4_load(v->components[0] + i);
+        f32x4 y = f32x4_load(v->components[1] + i);
+        f32x4 z = f32x4_load(v->components[2] + i);
+        f32x4 w = f32x4_load(v->components[3] + i);
+        for (uint32_t row = 0; row < 4; row++) {
+            f32x4 value = f32x4_mul(f32x4_splat(m->columns[0][row]), x);
+            value = f32x4_mul_add(f32x4_splat(m->columns[1][row]), y, value);
+            value = f32x4_mul_add(f32x4_splat(m->columns[2][row]), z, value);
+            value = f32x4_mul_add(f32x4_splat(m->columns[3][row]), w, value);
+            f32x4_store(out->components[row] + i, value);
+        }
+    }
+}
+
+#if defined(_M_X64)
+static void
+mat4_array_mul_avx2(const struct Mat4* a, const struct Mat4Array* b, struct Mat4Array* out) {
+    __m256 splats[16];
+    for (uint32_t i = 0; i < 16; i++) {
+        splats[i] = _mm256_set1_ps(a->columns[i / 4][i % 4]);
+    }
+
+    for (uint32_t i = 0; i < b->count; i += 8) {
+        for (uint32_t column = 0; column < 4; column++) {
+            __m256 b0 = _mm256_load_ps(b->elements[column * 4 + 0] + i);
+            __m256 b1 = _mm256_load_ps(b->elements[column * 4 + 1] + i);
+            __m256 b2 = _mm256_load_ps(b->elements[column * 4 + 2] + i);
+            __m256 b3 = _mm256_load_ps(b->elements[column * 4 + 3] + i);
+            for (uint32_t row = 0; row < 4; row++) {
+                __m256 value = _mm256_mul_ps(splats[0 * 4 + row], b0);
+                value = _mm256_fmadd_ps(splats[1 * 4 + row], b1, value);
+                value = _mm256_fmadd_ps(splats[2 * 4 + row], b2, value);
+                value = _mm256_fmadd_ps(splats[3 * 4 + row], b3, value);
+                _mm256_store_ps(out->elements[column * 4 + row] + i, value);
+            }
+        }
+    }
+    _mm256_zeroupper();
+}
+
+static void
+mat4_mul_vec4_array_avx2(const struct Mat4* m, const struct Vec4Array* v, struct Vec4Array* out) {
+    __m256 splats[16];
+    for (uint32_t i = 0; i < 16; i++) {
+        splats[i] = _mm256_set1_ps(m->columns[i / 4][i % 4]);
+    }
+
+    for (uint32_t i = 0; i < v->count; i += 8) {
+        __m256 x = _mm256_load_ps(v->components[0] + i);
+        __m256 y = _mm256_load_ps(v->components[1] + i);
+        __m256 z = _mm256_load_ps(v->components[2] + i);
+        __m256 w = _mm256_load_ps(v->components[3] + i);
+        for (uint32_t row = 0; row < 4; row++) {
+            __m256 value = _mm256_mul_ps(splats[0 * 4 + row], x);
+            value = _mm256_fmadd_ps(splats[1 * 4 + row], y, value);
+            value = _mm256_fmadd_ps(splats[2 * 4 + row], z, value);
+            value = _mm256_fmadd_ps(splats[3 * 4 + row], w, value);
+            _mm256_store_ps(out->components[row] + i, value);
+        }
+    }
+    _mm256_zeroupper();
+}
+#endif
+
+// NOTE: out[i] = a * b[i], e.g. view projection times every model matrix
+static void
+mat4_array_mul(const struct Mat4* a, const struct Mat4Array* b, struct Mat4Array* out) {
+    ASSERT(out->count == b->count);
+#if defined(_M_X64)
+    if (cpu_features.avx2) {
+        mat4_array_mul_avx2(a, b, out);
+        return;
+    }
+#endif
+    mat4_array_mul_f32x4(a, b, out);
+}
+
+// NOTE: out[i] = m * v[i]
+static void
+mat4_mul_vec4_array(const struct Mat4* m, const struct Vec4Array* v, struct Vec4Array* out) {
+    ASSERT(out->count == v->count);
+#if defined(_M_X64)
+    if (cpu_features.avx2) {
+        mat4_mul_vec4_array_avx2(m, v, out);
+        return;
+    }
+#endif
+    mat4_mul_vec4_array_f32x4(m, v, out);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// frustum culling
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// axis aligned bounding boxes are kept as structure of arrays and tested 8 at a time against the 6
+// frustum planes with AVX2 (one at a time otherwise). for each plane only the box corner farthest along
+// its normal matters and which corner that is only depends on the signs of the normal, so it's picked
+// once per plane and every box costs 3 multiplies and adds per plane (not fused, so both paths round the
+// same way and find the same boxes). the indices of the boxes that aren't fully outside any plane are
+// written to a compact list
+
+struct AabbArray {
+    float* min[3];
+    float* max[3];
+    uint32_t count;
+};
+
+static struct AabbArray
+aabb_array_alloc(struct LinearArena* arena, uint32_t count) {
+    struct AabbArray array = {.count = count};
+    size_t capacity = math_array_capacity(count);
+    float* components = linear_arena_alloc(arena, 6 * capacity * sizeof(float), 32);
+    for (uint32_t i = 0; i < 3; i++) {
+        array.min[i] = components + i * capacity;
+        array.max[i] = components + (3 + i) * capacity;
+    }
+    return array;
+}
+
+static bool
+aabb_in_frustum(const float planes[6][4], const struct AabbArray* boxes, uint32_t index) {
+    for (uint32_t i = 0; i < 6; i++) {
+        float distance = planes[i][3];
+        for (uint32_t j = 0; j < 3; j++) {
+            float corner = planes[i][j] >= 0.0f ? boxes->max[j][index] : boxes->min[j][index];
+            distance += planes[i][j] * corner;
+        }
+        if (distance < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static uint32_t
+frustum_cull_aabbs_scalar(const float planes[6][4], const struct AabbArray* boxes, uint32_t* visible_indices) {
+    uint32_t visible_count = 0;
+    for (uint32_t i = 0; i < boxes->count; i++) {
+        if (aabb_in_frustum(planes, boxes, i)) {
+            visible_indices[visible_count] = i;
+            visible_count += 1;
+        }
+    }
+    return visible_count;
+}
+
+#if defined(_M_X64)
+static uint32_t
+frustum_cull_aabbs_avx2(const float planes[6][4], const struct AabbArray* boxes, uint32_t* visible_indices) {
+    const float* corners[6][3];
+    __m256 normals[6][3];
+    __m256 distances[6];
+    for (uint32_t i = 0; i < 6; i++) {
+        for (uint32_t j = 0; j < 3; j++) {
+            corners[i][j] = planes[i][j] >= 0.0f ? boxes->max[j] : boxes->min[j];
+            normals[i][j] = _mm256_set1_ps(planes[i][j]);
+        }
+        distances[i] = _mm256_set1_ps(planes[i][3]);
+    }
+
+    uint32_t visible_count = 0;
+    for (uint32_t i = 0; i < boxes->count; i += 8) {
+        // NOTE: separate multiplies and adds in the same order as `aabb_in_frustum` and the same `< 0` test
+        // (-0 is inside) so both paths find exactly the same boxes
+        __m256 outside = _mm256_setzero_ps();
+        for (uint32_t plane = 0; plane < 6; plane++) {
+            __m256 distance = distances[plane];
+            for (uint32_t j = 0; j < 3; j++) {
+                distance = _mm256_add_ps(distance, _mm256_mul_ps(normals[plane][j], _mm256_load_ps(corners[plane][j] + i)));
+            }
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_LT_OQ));
+        }
+        uint32_t visible_mask = ~(uint32_t)_mm256_movemask_ps(outside) & 0xff;
+        if (boxes->count - i < 8) {
+            visible_mask &= (1u << (boxes->count - i)) - 1;
+        }
+
+        // NOTE: branchless compaction, every lane is written and only the visible ones advance
+        if (visible_mask != 0) {
+            for (uint32_t lane = 0; lane < 8; lane++) {
+                visible_indices[visible_count] = i + lane;
+                visible_count += (visible_mask >> lane) & 1;
+            }
+        }
+    }
+    _mm256_zeroupper();
+    return visible_count;
+}
+#endif
+
+// NOTE: writes the indices of the boxes inside (or intersecting) the frustum in increasing order and
+// returns their count. `visible_indices` needs room for `math_array_capacity(boxes->count)` indices
+static uint32_t
+frustum_cull_aabbs(const float planes[6][4], const struct AabbArray* boxes, uint32_t* visible_indices) {
+#if defined(_M_X64)
+    if (cpu_features.avx2) {
+        return frustum_cull_aabbs_avx2(planes, boxes, visible_indices);
+    }
+#endif
+    return frustum_cull_aabbs_scalar(planes, boxes, visible_indices);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// bounding volume hierarchy
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// a binary tree of boxes over the object boxes so culling and picking cost about the log of the object
+// count instead of the object count. it's built top down, splitting every node where the surface area
+// heuristic (SAH) is the cheapest, evaluated on a few bins per axis instead of at every object, and the
+// objects are partitioned in place so every subtree owns a contiguous range of the object indices.
+// when objects move their leaf and the nodes above it are refit (up to the first one that doesn't change),
+// the tree stays valid but gets worse so it's rebuilt once its SAH cost has grown too much. the cost is a
+// sum over the nodes, refitting updates it with the nodes it changes so checking it doesn't visit the tree.
+// frustum culling drops the planes a node is fully inside of, so a subtree fully inside the frustum is
+// appended as a whole, and rays visit the nearer child first and skip whatever is past the nearest hit.
+// see "on fast construction of sah-based bounding volume hierarchies" (wald)
+
+#define BVH_BIN_COUNT 16
+#define BVH_MAX_LEAF_OBJECTS 4
+// NOTE: past half of it nodes are split in half so the depth stays below it for any object count
+#define BVH_MAX_DEPTH 64
+#define BVH_REBUILD_COST_RATIO 1.5f
+
+struct BvhNode {
+    float min[3];
+    float max[3];
+    uint32_t first_child; // NOTE: the second child follows the first one, zero for leaves (the root is nobody's child)
+    uint32_t first_object; // NOTE: the range in `Bvh.objects` of the whole subtree
+    uint32_t object_count;
+};
+
+struct Bvh {
+    struct BvhNode* nodes;
+    uint32_t* parents; // NOTE: per node, `UINT32_MAX` for the root
+    uint32_t node_count;
+    uint32_t* objects; // NOTE: object indices in subtree order
+    uint32_t* object_leaves; // NOTE: per object, the leaf it's in
+    uint32_t object_count;
+    uint32_t depth;
+    double area_cost; // NOTE: the SAH cost before dividing by the root area, kept up to date by refitting
+    float built_cost; // NOTE: the SAH cost right after building
+};
+
+// NOTE: the objects are copied in here while building and partitioned as a whole so the passes over them
+// stay sequential in memory instead of gathering boxes through the indices
+struct BvhBuildObject {
+    float min[3];
+    float max[3];
+    float centroid[3];
+    uint32_t index;
+};
+
+// NOTE: a node waiting to be split, with the bounds of the centroids of its objects
+struct BvhBuildTask {
+    uint32_t node;
+    uint32_t depth;
+    float centroid_min[3];
+    float centroid_max[3];
+};
+
+static uint32_t
+bvh_node_capacity(uint32_t object_count) {
+    return 2 * (object_count > 0 ? object_count : 1);
+}
+
+static size_t
+bvh_memory_size(uint32_t object_count) {
+    return bvh_node_capacity(object_count) * (sizeof(struct BvhNode) + sizeof(uint32_t)) + 2 * (size_t)object_count * sizeof(uint32_t) + 64;
+}
+
+// NOTE: the scratch memory `bvh_build` takes and gives back
+static size_t
+bvh_build_scratch_size(uint32_t object_count) {
+    return (size_t)object_count * (sizeof(struct BvhBuildObject) + sizeof(struct BvhBuildTask)) + 64;
+}
+
+// NOTE: the arrays live in `arena` for as long as the tree does, the tree is empty until it's built
+static void
+bvh_init(struct Bvh* bvh, struct LinearArena* arena, uint32_t object_count) {
+    memset(bvh, 0, sizeof(*bvh));
+    bvh->nodes = LINEAR_ALLOC(arena, struct BvhNode, bvh_node_capacity(object_count));
+    bvh->parents = LINEAR_ALLOC(arena, uint32_t, bvh_node_capacity(object_count));
+    bvh->objects = LINEAR_ALLOC(arena, uint32_t, object_count);
+    bvh->object_leaves = LINEAR_ALLOC(arena, uint32_t, object_count);
+    bvh->object_count = object_count;
+}
+
+// NOTE: half the surface area, only ever compared
+static float
+bvh_box_area(const float min[3], const float max[3]) {
+    float x = max[0] - min[0];
+    float y = max[1] - min[1];
+    float z = max[2] - min[2];
+    return x * y + y * z + z * x;
+}
+
+static void
+bvh_node_fit_objects(struct BvhNode* node, const uint32_t* objects, const struct AabbArray* bounds) {
+    for (uint32_t j = 0; j < 3; j++) {
+        node->min[j] = FLT_MAX;
+        node->max[j] = -FLT_MAX;
+    }
+    for (uint32_t i = node->first_object; i < node->first_object + node->object_count; i++) {
+        for (uint32_t j = 0; j < 3; j++) {
+            node->min[j] = fminf(node->min[j], bounds->min[j][objects[i]]);
+            node->max[j] = fmaxf(node->max[j], bounds->max[j][objects[i]]);
+        }
+    }
+}
+
+static void
+bvh_node_fit_children(struct BvhNode* node, const struct BvhNode* children) {
+    for (uint32_t j = 0; j < 3; j++) {
+        node->min[j] = fminf(children[0].min[j], children[1].min[j]);
+        node->max[j] = fmaxf(children[0].max[j], children[1].max[j]);
+    }
+}
+
+// NOTE: intersecting an object costs the same as visiting a node
+static double
+bvh_node_cost(const struct BvhNode* node) {
+    float area = bvh_box_area(node->min, node->max);
+    return node->first_child != 0 ? area : (double)area * node->object_count;
+}
+
+// NOTE: relative to the root area
+static float
+bvh_sah_cost(const struct Bvh* bvh) {
+    if (bvh->node_count == 0) {
+        return 0.0f;
+    }
+    float root_area = bvh_box_area(bvh->nodes[0].min, bvh->nodes[0].max);
+    if (root_area <= 0.0f) {
+        return 0.0f;
+    }
+    return (float)(bvh->area_cost / root_area);
+}
+
+static uint32_t
+bvh_bin_index(float centroid, float centroid_min, float bin_scale) {
+    uint32_t bin = (uint32_t)((centroid - centroid_min) * bin_scale);
+    return bin < BVH_BIN_COUNT ? bin : BVH_BIN_COUNT - 1;
+}
+
+static void
+bvh_build_fit(struct BvhNode* node, struct BvhBuildTask* task, const struct BvhBuildObject* objects) {
+    for (uint32_t j = 0; j < 3; j++) {
+        node->min[j] = FLT_MAX;
+        node->max[j] = -FLT_MAX;
+        task->centroid_min[j] = FLT_MAX;
+        task->centroid_max[j] = -FLT_MAX;
+    }
+    for (uint32_t i = node->first_object; i < node->first_object + node->object_count; i++) {
+        for (uint32_t j = 0; j < 3; j++) {
+            node->min[j] = fminf(node->min[j], objects[i].min[j]);
+            node->max[j] = fmaxf(node->max[j], objects[i].max[j]);
+            task->centroid_min[j] = fminf(task->centroid_min[j], objects[i].centroid[j]);
+            task->centroid_max[j] = fmaxf(task->centroid_max[j], objects[i].centroid[j]);
+        }
+    }
+}
+
+// NOTE: bins the objects on every axis in a single pass over them, partitions them at the cheapest split and
+// returns how many go to the first child, whose boxes and centroid bounds come out of the binning and the
+// partitioning. zero when the centroids can't be told apart
+static uint32_t
+bvh_split_binned(
+    const struct BvhNode* node,
+    const struct BvhBuildTask* task,
+    struct BvhBuildObject* build_objects,
+    struct BvhNode children[2],
+    struct BvhBuildTask child_tasks[2]
+) {
+    struct BvhBuildObject* objects = build_objects + node->first_object;
+
+    float bin_scales[3];
+    for (uint32_t axis = 0; axis < 3; axis++) {
+        float extent = task->centroid_max[axis] - task->centroid_min[axis];
+        bin_scales[axis] = extent > 0.0f ? (float)BVH_BIN_COUNT / extent : 0.0f;
+    }
+
+    uint32_t bin_counts[3][BVH_BIN_COUNT] = {0};
+    float bin_min[3][BVH_BIN_COUNT][3];
+    float bin_max[3][BVH_BIN_COUNT][3];
+    for (uint32_t axis = 0; axis < 3; axis++) {
+        for (uint32_t i = 0; i < BVH_BIN_COUNT; i++) {
+            for (uint32_t j = 0; j < 3; j++) {
+                bin_min[axis][i][j] = FLT_MAX;
+                bin_max[axis][i][j] = -FLT_MAX;
+            }
+        }
+    }
+    for (uint32_t i = 0; i < node->object_count; i++) {
+        const struct BvhBuildObject* object = &objects[i];
+        for (uint32_t axis = 0; axis < 3; axis++) {
+            uint32_t bin = bvh_bin_index(object->centroid[axis], task->centroid_min[axis], bin_scales[axis]);
+            bin_counts[axis][bin] += 1;
+            for (uint32_t j = 0; j < 3; j++) {
+                bin_min[axis][bin][j] = fminf(bin_min[axis][bin][j], object->min[j]);
+                bin_max[axis][bin][j] = fmaxf(bin_max[axis][bin][j], object->max[j]);
+            }
+        }
+    }
+
+    float best_cost = FLT_MAX;
+    uint32_t best_axis = 0;
+    uint32_t best_split = 0; // NOTE: the bins below it go to the first child
+    for (uint32_t axis = 0; axis < 3; axis++) {
+        if (bin_scales[axis] == 0.0f) {
+            continue;
+        }
+
+        // NOTE: sweeps from the right for the box and count above every split, then from the left
+        float right_min[BVH_BIN_COUNT][3];
+        float right_max[BVH_BIN_COUNT][3];
+        uint32_t right_counts[BVH_BIN_COUNT];
+        float box_min[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+        float box_max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+        uint32_t count = 0;
+        for (uint32_t split = BVH_BIN_COUNT - 1; split > 0; split--) {
+            for (uint32_t j = 0; j < 3; j++) {
+                box_min[j] = fminf(box_min[j], bin_min[axis][split][j]);
+                box_max[j] = fmaxf(box_max[j], bin_max[axis][split][j]);
+                right_min[split][j] = box_min[j];
+                right_max[split][j] = box_max[j];
+            }
+            count += bin_counts[axis][split];
+            right_counts[split] = count;
+        }
+        for (uint32_t j = 0; j < 3; j++) {
+            box_min[j] = FLT_MAX;
+            box_max[j] = -FLT_MAX;
+        }
+        count = 0;
+        for (uint32_t split = 1; split < BVH_BIN_COUNT; split++) {
+            for (uint32_t j = 0; j < 3; j++) {
+                box_min[j] = fminf(box_min[j], bin_min[axis][split - 1][j]);
+                box_max[j] = fmaxf(box_max[j], bin_max[axis][split - 1][j]);
+            }
+            count += bin_counts[axis][split - 1];
+            if (count == 0 || right_counts[split] == 0) {
+                continue;
+            }
+            float cost =
+                bvh_box_area(box_min, box_max) * (float)count +
+                bvh_box_area(right_min[split], right_max[split]) * (float)right_counts[split];
+            if (cost < best_cost) {
+                best_cost = cost;
+                best_axis = axis;
+                best_split = split;
+                memcpy(children[0].min, box_min, sizeof(box_min));
+                memcpy(children[0].max, box_max, sizeof(box_max));
+                memcpy(children[1].min, right_min[split], sizeof(box_min));
+                memcpy(children[1].max, right_max[split], sizeof(box_max));
+            }
+        }
+    }
+    if (best_cost == FLT_MAX) {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < 2; i++) {
+        for (uint32_t j = 0; j < 3; j++) {
+            child_tasks[i].centroid_min[j] = FLT_MAX;
+            child_tasks[i].centroid_max[j] = -FLT_MAX;
+        }
+    }
+    uint32_t first_count = 0;
+    uint32_t end = node->object_count;
+    while (first_count < end) {
+        struct BvhBuildObject object = objects[first_count];
+        uint32_t child = bvh_bin_index(object.centroid[best_axis], task->centroid_min[best_axis], bin_scales[best_axis]) < best_split ? 0 : 1;
+        for (uint32_t j = 0; j < 3; j++) {
+            child_tasks[child].centroid_min[j] = fminf(child_tasks[child].centroid_min[j], object.centroid[j]);
+            child_tasks[child].centroid_max[j] = fmaxf(child_tasks[child].centroid_max[j], object.centroid[j]);
+        }
+        if (child == 0) {
+            first_count += 1;
+        } else {
+            end -= 1;
+            objects[first_count] = objects[end];
+            objects[end] = object;
+        }
+    }
+    return first_count;
+}
+
+// NOTE: (re)builds the whole tree over `bounds` (one box per object), scratch memory comes from `arena`
+// and is given back when done
+static void
+bvh_build(struct Bvh* bvh, const struct AabbArray* bounds, struct LinearArena* arena) {
+    ASSERT(bounds->count == bvh->object_count);
+    bvh->node_count = 0;
+    bvh->depth = 0;
+    bvh->area_cost = 0.0;
+    bvh->built_cost = 0.0f;
+    if (bvh->object_count == 0) {
+        return;
+    }
+
+    size_t scratch_mark = arena->used;
+    struct BvhBuildObject* build_objects = LINEAR_ALLOC(arena, struct BvhBuildObject, bvh->object_count);
+    for (uint32_t i = 0; i < bvh->object_count; i++) {
+        for (uint32_t j = 0; j < 3; j++) {
+            build_objects[i].min[j] = bounds->min[j][i];
+            build_objects[i].max[j] = bounds->max[j][i];
+            build_objects[i].centroid[j] = (bounds->min[j][i] + bounds->max[j][i]) * 0.5f;
+        }
+        build_objects[i].index = i;
+    }
+
+    // NOTE: depth first, there are never more nodes waiting than leaves in the end
+    struct BvhBuildTask* stack = LINEAR_ALLOC(arena, struct BvhBuildTask, bvh->object_count);
+    struct BvhNode* root = &bvh->nodes[0];
+    root->first_child = 0;
+    root->first_object = 0;
+    root->object_count = bvh->object_count;
+    bvh_build_fit(root, &stack[0], build_objects);
+    bvh->parents[0] = UINT32_MAX;
+    bvh->node_count = 1;
+    stack[0].node = 0;
+    stack[0].depth = 1;
+    uint32_t stack_count = 1;
+    while (stack_count > 0) {
+        stack_count -= 1;
+        struct BvhBuildTask task = stack[stack_count];
+        struct BvhNode* node = &bvh->nodes[task.node];
+        bvh->depth = task.depth > bvh->depth ? task.depth : bvh->depth;
+        if (node->object_count <= BVH_MAX_LEAF_OBJECTS) {
+            for (uint32_t i = node->first_object; i < node->first_object + node->object_count; i++) {
+                bvh->objects[i] = build_objects[i].index;
+                bvh->object_leaves[build_objects[i].index] = task.node;
+            }
+            continue;
+        }
+
+        struct BvhNode children[2];
+        struct BvhBuildTask child_tasks[2];
+        uint32_t first_count = task.depth < BVH_MAX_DEPTH / 2 ? bvh_split_binned(node, &task, build_objects, children, child_tasks) : 0;
+        bool split_in_half = first_count == 0;
+        if (split_in_half) {
+            first_count = node->object_count / 2;
+        }
+
+        uint32_t first_child = bvh->node_count;
+        bvh->node_count += 2;
+        children[0].first_object = node->first_object;
+        children[0].object_count = first_count;
+        children[1].first_object = node->first_object + first_count;
+        children[1].object_count = node->object_count - first_count;
+        for (uint32_t i = 0; i < 2; i++) {
+            children[i].first_child = 0;
+            if (split_in_half) {
+                bvh_build_fit(&children[i], &child_tasks[i], build_objects);
+            }
+            bvh->nodes[first_child + i] = children[i];
+            bvh->parents[first_child + i] = task.node;
+            child_tasks[i].node = first_child + i;
+            child_tasks[i].depth = task.depth + 1;
+            stack[stack_count] = child_tasks[i];
+            stack_count += 1;
+        }
+        node->first_child = first_child;
+    }
+    ASSERT(bvh->depth <= BVH_MAX_DEPTH);
+
+    for (uint32_t i = 0; i < bvh->node_count; i++) {
+        bvh->area_cost += bvh_node_cost(&bvh->nodes[i]);
+    }
+    bvh->built_cost = bvh_sah_cost(bvh);
+    arena->used = scratch_mark;
+}
+
+static bool
+bvh_node_bounds_equal(const struct BvhNode* a, const struct BvhNode* b) {
+    for (uint32_t j = 0; j < 3; j++) {
+        if (a->min[j] != b->min[j] || a->max[j] != b->max[j]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// NOTE: call after the boxes of `moved_objects` changed in `bounds`. returns whether the tree got bad enough
+// that it should be rebuilt, which only costs the nodes that were refit
+static bool
+bvh_refit(struct Bvh* bvh, const struct AabbArray* bounds, const uint32_t* moved_objects, uint32_t moved_count) {
+    for (uint32_t i = 0; i < moved_count; i++) {
+        uint32_t node_index = bvh->object_leaves[moved_objects[i]];
+        struct BvhNode before = bvh->nodes[node_index];
+        bvh_node_fit_objects(&bvh->nodes[node_index], bvh->objects, bounds);
+        bvh->area_cost += bvh_node_cost(&bvh->nodes[node_index]) - bvh_node_cost(&before);
+        while (!bvh_node_bounds_equal(&before, &bvh->nodes[node_index]) && bvh->parents[node_index] != UINT32_MAX) {
+            node_index = bvh->parents[node_index];
+            before = bvh->nodes[node_index];
+            bvh_node_fit_children(&bvh->nodes[node_index], &bvh->nodes[bvh->nodes[node_index].first_child]);
+            bvh->area_cost += bvh_node_cost(&bvh->nodes[node_index]) - bvh_node_cost(&before);
+        }
+    }
+    return moved_count > 0 && bvh_sah_cost(bvh) > bvh->built_cost * BVH_REBUILD_COST_RATIO;
+}
+
+// NOTE: writes the objects of every leaf touching the frustum (their own boxes aren't tested, they're few)
+// and returns their count. `visible_objects` needs room for every object
+static uint32_t
+bvh_cull_frustum(const struct Bvh* bvh, const float planes[6][4], uint32_t* visible_objects) {
+    if (bvh->node_count == 0) {
+        return 0;
+    }
+
+    // NOTE: a node only tests the planes its parent wasn't fully inside of
+    uint32_t stack[BVH_MAX_DEPTH + 1];
+    uint32_t stack_plane_masks[BVH_MAX_DEPTH + 1];
+    uint32_t stack_count = 1;
+    stack[0] = 0;
+    stack_plane_masks[0] = (1u << 6) - 1;
+
+    uint32_t visible_count = 0;
+    while (stack_count > 0) {
+        stack_count -= 1;
+        const struct BvhNode* node = &bvh->nodes[stack[stack_count]];
+        uint32_t plane_mask = stack_plane_masks[stack_count];
+
+        bool outside = false;
+        for (uint32_t i = 0; i < 6 && !outside; i++) {
+            if ((plane_mask & (1u << i)) == 0) {
+                continue;
+            }
+            float farthest = planes[i][3];
+            float nearest = planes[i][3];
+            for (uint32_t j = 0; j < 3; j++) {
+                bool positive = planes[i][j] >= 0.0f;
+                farthest += planes[i][j] * (positive ? node->max[j] : node->min[j]);
+                nearest += planes[i][j] * (positive ? node->min[j] : node->max[j]);
+            }
+            outside = farthest < 0.0f;
+            if (nearest >= 0.0f) {
+                plane_mask &= ~(1u << i);
+            }
+        }
+        if (outside) {
+            continue;
+        }
+
+        if (plane_mask == 0 || node->first_child == 0) {
+            memcpy(visible_objects + visible_count, bvh->objects + node->first_object, node->object_count * sizeof(uint32_t));
+            visible_count += node->object_count;
+            continue;
+        }
+        for (uint32_t i = 0; i < 2; i++) {
+            stack[stack_count] = node->first_child + i;
+            stack_plane_masks[stack_count] = plane_mask;
+            stack_count += 1;
+        }
+    }
+    return visible_count;
+}
+
+// NOTE: the distance along the ray to where it enters the box (zero when it starts inside), `FLT_MAX` on a miss
+static float
+ray_box_distance(const float min[3], const float max[3], const float origin[3], const float inverse_direction[3]) {
+    float enter = 0.0f;
+    float exit = FLT_MAX;
+    for (uint32_t j = 0; j < 3; j++) {
+        float t0 = (min[j] - origin[j]) * inverse_direction[j];
+        float t1 = (max[j] - origin[j]) * inverse_direction[j];
+        enter = fmaxf(enter, fminf(t0, t1));
+        exit = fminf(exit, fmaxf(t0, t1));
+    }
+    return enter <= exit ? enter : FLT_MAX;
+}
+
+// NOTE: returns the object whose box the ray hits first (`UINT32_MAX` if none) and writes the distance to it
+// in units of `direction`
+static uint32_t
+bvh_raycast(const struct Bvh* bvh, const struct AabbArray* bounds, struct Vec3 origin, struct Vec3 direction, float* hit_distance) {
+    *hit_distance = FLT_MAX;
+    if (bvh->node_count == 0) {
+        return UINT32_MAX;
+    }
+
+    float ray_origin[3] = {origin.x, origin.y, origin.z};
+    float inverse_direction[3] = {1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z};
+    uint32_t hit_object = UINT32_MAX;
+
+    uint32_t stack[BVH_MAX_DEPTH + 1];
+    float stack_distances[BVH_MAX_DEPTH + 1];
+    uint32_t stack_count = 0;
+    float root_distance = ray_box_distance(bvh->nodes[0].min, bvh->nodes[0].max, ray_origin, inverse_direction);
+    if (root_distance < FLT_MAX) {
+        stack[0] = 0;
+        stack_distances[0] = root_distance;
+        stack_count = 1;
+    }
+    while (stack_count > 0) {
+        stack_count -= 1;
+        if (stack_distances[stack_count] >= *hit_distance) {
+            continue;
+        }
+        const struct BvhNode* node = &bvh->nodes[stack[stack_count]];
+
+        if (node->first_child == 0) {
+            for (uint32_t i = node->first_object; i < node->first_object + node->object_count; i++) {
+                uint32_t object = bvh->objects[i];
+                float min[3] = {bounds->min[0][object], bounds->min[1][object], bounds->min[2][object]};
+                float max[3] = {bounds->max[0][object], bounds->max[1][object], bounds->max[2][object]};
+                float distance = ray_box_distance(min, max, ray_origin, inverse_direction);
+                if (distance < *hit_distance) {
+                    *hit_distance = distance;
+                    hit_object = object;
+                }
+            }
+            continue;
+        }
+
+        // NOTE: the nearer child is pushed last so it's visited first
+        const struct BvhNode* children = &bvh->nodes[node->first_child];
+        float distances[2] = {
+            ray_box_distance(children[0].min, children[0].max, ray_origin, inverse_direction),
+            ray_box_distance(children[1].min, children[1].max, ray_origin, inverse_direction),
+        };
+        uint32_t nearer = distances[1] < distances[0] ? 1 : 0;
+        for (uint32_t i = 0; i < 2; i++) {
+            uint32_t child = i == 0 ? 1 - nearer : nearer;
+            if (distances[child] < *hit_distance) {
+                stack[stack_count] = node->first_child + child;
+                stack_distances[stack_count] = distances[child];
+                stack_count += 1;
+            }
+        }
+    }
+    return hit_object;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// scene
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// a grid of copies of one mesh that spin in place while the whole grid orbits around the view axis.
+// the grid can be stacked in layers going away from the camera so objects hide each other (overdraw).
+// the grid only moves as a whole so a bounding volume hierarchy is built over the grid space boxes around
+// the objects bounding spheres, and the frustum is brought to grid space to find the candidates with it.
+// every frame each candidate is moved and frustum culled on its own (see the frustum culling section), and
+// only the visible ones get transformed, their uniform block packed (with their material index) and a draw
+// item with a sort key. how big they are on screen is also kept for each material, for texture streaming.
+// the update runs in batches of candidates on the job system
+
+#define SCENE_BATCH_SIZE 32 // NOTE: must be a multiple of `MATH_BATCH_WIDTH`
+
+struct UniformData {
+    struct Mat4 transform;
+    uint32_t material_index;
+    uint32_t reserved[3]; // NOTE: std140 rounds the block size up to a vec4
+};
+
+struct DrawItem {
+    uint64_t sort_key;
+    uint32_t object_index;
+    uint32_t reserved;
+};
+
+struct Scene {
+    uint32_t object_count;
+    struct Vec4Array grid_positions;
+    struct AabbArray grid_bounds; // NOTE: the boxes around the bounding spheres
+    struct Bvh bvh;
+    uint32_t* materials; // NOTE: material index of every object, all zeros until set
+    float object_scale;
+    float object_radius; // NOTE: bounding sphere radius after scaling
+};
+
+// NOTE: per frame inputs and outputs of the scene update jobs
+struct SceneUpdate {
+    const struct Scene* scene;
+    struct FrameArena* frame_arena;
+    struct Mat4 view_projection;
+    struct Mat4 orbit;
+    float frustum_planes[6][4];
+    struct Vec3 camera_position;
+    float time;
+    uint32_t batch_size;
+    uint32_t uniform_stride;
+    unsigned char* uniform_data; // NOTE: one block per object, only written for visible ones
+    uint32_t* candidates; // NOTE: room for one per object, the objects the bvh finds in the frustum
+    uint32_t candidate_count;
+    struct DrawItem* draw_items; // NOTE: every batch packs its visible objects at the start of its own range
+    uint32_t* batch_draw_counts;
+    float screen_scale; // NOTE: pixels per unit one unit away from the camera
+    uint32_t material_count;
+    float* material_screen_sizes; // NOTE: a row of `material_count` per worker, the max diameter in pixels. optional
+};
+
+static size_t
+scene_memory_size(uint32_t object_count) {
+    return
+        (4 + 6) * (size_t)math_array_capacity(object_count) * sizeof(float) +
+        object_count * sizeof(uint32_t) +
+        bvh_memory_size(object_count) +
+        bvh_build_scratch_size(object_count) + 256;
+}
+
+// NOTE: fits the mesh bounds inside a grid cell, the grid and its bvh live in `arena` for as long as the scene
+// (it needs `scene_memory_size`)
+static void
+scene_init(
+    struct Scene* scene,
+    struct LinearArena* arena,
+    uint32_t grid_size,
+    uint32_t layer_count,
+    float spacing,
+    const float bounds_min[3],
+    const float bounds_max[3]
+) {
+    memset(scene, 0, sizeof(*scene));
+    uint32_t layer_object_count = grid_size * grid_size;
+    scene->object_count = layer_object_count * layer_count;
+    scene->grid_positions = vec4_array_alloc(arena, scene->object_count);
+
+    float grid_center = (float)(grid_size - 1) * 0.5f;
+    for (uint32_t i = 0; i < scene->object_count; i++) {
+        uint32_t layer_index = i % layer_object_count;
+        scene->grid_positions.components[0][i] = ((float)(layer_index % grid_size) - grid_center) * spacing;
+        scene->grid_positions.components[1][i] = ((float)(layer_index / grid_size) - grid_center) * spacing;
+        scene->grid_positions.components[2][i] = -(float)(i / layer_object_count) * spacing;
+        scene->grid_positions.components[3][i] = 1.0f;
+    }
+    scene->materials = LINEAR_ALLOC(arena, uint32_t, scene->object_count);
+    memset(scene->materials, 0, scene->object_count * sizeof(uint32_t));
+
+    float extent = 0.0f;
+    float radius_squared = 0.0f;
+    for (uint32_t i = 0; i < 3; i++) {
+        extent = fmaxf(extent, bounds_max[i] - bounds_min[i]);
+        // NOTE: objects rotate around their origin so the sphere is centered there
+        float farthest = fmaxf(fabsf(bounds_min[i]), fabsf(bounds_max[i]));
+        radius_squared += farthest * farthest;
+    }
+    scene->object_scale = extent > 0.0f ? spacing * 0.9f / extent : 1.0f;
+    scene->object_radius = sqrtf(radius_squared) * scene->object_scale;
+
+    scene->grid_bounds = aabb_array_alloc(arena, scene->object_count);
+    for (uint32_t j = 0; j < 3; j++) {
+        for (uint32_t i = 0; i < scene->object_count; i++) {
+            scene->grid_bounds.min[j][i] = scene->grid_positions.components[j][i] - scene->object_radius;
+            scene->grid_bounds.max[j][i] = scene->grid_positions.components[j][i] + scene->object_radius;
+        }
+    }
+    bvh_init(&scene->bvh, arena, scene->object_count);
+    bvh_build(&scene->bvh, &scene->grid_bounds, arena);
+}
+
+// NOTE: moves objects to new grid positions and refits the bvh (rebuilt using scratch memory from `arena`
+// when it got too bad), must not run while the scene is being updated
+static void
+scene_move_objects(struct Scene* scene, const uint32_t* objects, const struct Vec3* positions, uint32_t count, struct LinearArena* arena) {
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t object = objects[i];
+        float position[3] = {positions[i].x, positions[i].y, positions[i].z};
+        for (uint32_t j = 0; j < 3; j++) {
+            scene->grid_positions.components[j][object] = position[j];
+            scene->grid_bounds.min[j][object] = position[j] - scene->object_radius;
+            scene->grid_bounds.max[j][object] = position[j] + scene->object_radius;
+        }
+    }
+    if (bvh_refit(&scene->bvh, &scene->grid_bounds, objects, count)) {
+        bvh_build(&scene->bvh, &scene->grid_bounds, arena);
+    }
+}
+
+static void
+scene_update_job(void* data, uint32_t first, uint32_t count, uint32_t worker_index) {
+    struct SceneUpdate* update = data;
+    const struct Scene* scene = update->scene;
+    struct Vec3 spin_axis = {0.0f, 0.0f, 1.0f};
+
+    // NOTE: batch scratch memory is given back when the job is done
+    struct LinearArena* arena = frame_arena_thread(update->frame_arena, worker_index);
+    size_t scratch_mark = arena->used;
+
+    const uint32_t* candidates = update->candidates + first;
+    struct Vec4Array grid_positions = vec4_array_alloc(arena, count);
+    for (uint32_t j = 0; j < 4; j++) {
+        for (uint32_t i = 0; i < count; i++) {
+            grid_positions.components[j][i] = scene->grid_positions.components[j][candidates[i]];
+        }
+    }
+    struct Vec4Array positions = vec4_array_alloc(arena, count);
+    mat4_mul_vec4_array(&update->orbit, &grid_positions, &positions);
+
+    // NOTE: the culling loads whole vectors but masks off the padding lanes so only the objects need bounds
+    struct AabbArray bounds = aabb_array_alloc(arena, count);
+    for (uint32_t j = 0; j < 3; j++) {
+        for (uint32_t i = 0; i < count; i++) {
+            bounds.min[j][i] = positions.components[j][i] - scene->object_radius;
+            bounds.max[j][i] = positions.components[j][i] + scene->object_radius;
+        }
+    }
+    uint32_t* visible_indices = LINEAR_ALLOC(arena, uint32_t, math_array_capacity(count));
+    uint32_t visible_count = frustum_cull_aabbs(update->frustum_planes, &bounds, visible_indices);
+
+    struct Mat4Array models = mat4_array_alloc(arena, visible_count);
+    for (uint32_t i = 0; i < visible_count; i++) {
+        uint32_t index = visible_indices[i];
+        struct Vec3 position = {positions.components[0][index], positions.components[1][index], positions.components[2][index]};
+        struct Mat4 model = mat4_transform(position, spin_axis, update->time + (float)candidates[index] * 0.1f, scene->object_scale);
+        mat4_array_set(&models, i, &model);
+    }
+    struct Mat4Array transforms = mat4_array_alloc(arena, visible_count);
+    mat4_array_mul(&update->view_projection, &models, &transforms);
+
+    struct DrawItem* draw_items = update->draw_items + first;
+    uint32_t draw_count = 0;
+    for (uint32_t i = 0; i < visible_count; i++) {
+        uint32_t index = visible_indices[i];
+        struct Vec3 position = {positions.components[0][index], positions.components[1][index], positions.components[2][index]};
+
+        uint32_t object_index = candidates[index];
+        struct UniformData* uniform_data = (struct UniformData*)(update->uniform_data + (size_t)object_index * update->uniform_stride);
+        mat4_array_get(&transforms, i, &uniform_data->transform);
+        uniform_data->material_index = scene->materials[object_index];
+
+        // NOTE: front to back, positive floats sort the same as their bits
+        struct Vec3 offset = vec3_sub(position, update->camera_position);
+        float distance_squared = vec3_dot(offset, offset);
+        if (update->material_screen_sizes) {
+            float* screen_size = &update->material_screen_sizes[worker_index * update->material_count + uniform_data->material_index];
+            float distance = fmaxf(sqrtf(distance_squared), scene->object_radius);
+            *screen_size = fmaxf(*screen_size, 2.0f * scene->object_radius * update->screen_scale / distance);
+        }
+        uint32_t depth_bits = 0;
+        memcpy(&depth_bits, &distance_squared, sizeof(depth_bits));
+        draw_items[draw_count].sort_key = ((uint64_t)depth_bits << 32) | object_index;
+        draw_items[draw_count].object_index = object_index;
+        draw_items[draw_count].reserved = 0;
+        draw_count += 1;
+    }
+    update->batch_draw_counts[first / update->batch_size] = draw_count;
+
+    arena->used = scratch_mark;
+}
+
+// NOTE: the squared distance to the camera the sort key was made of
+static float
+draw_item_distance_squared(const struct DrawItem* draw_item) {
+    uint32_t depth_bits = (uint32_t)(draw_item->sort_key >> 32);
+    float distance_squared = 0.0f;
+    memcpy(&distance_squared, &depth_bits, sizeof(distance_squared));
+    return distance_squared;
+}
+
+// NOTE: packs the visible draw items of every batch at the start of the draw item array, returns their count
+static uint32_t
+scene_gather_draw_items(struct SceneUpdate* update) {
+    uint32_t draw_count = 0;
+    for (uint32_t first = 0; first < update->candidate_count; first += update->batch_size) {
+        uint32_t batch_draw_count = update->batch_draw_counts[first / update->batch_size];
+        memmove(update->draw_items + draw_count, update->draw_items + first, batch_draw_count * sizeof(struct DrawItem));
+        draw_count += batch_draw_count;
+    }
+    return draw_count;
+}
+
+// NOTE: stable lsd radix sort by sort key (front to back), a byte at a time skipping the bytes every key
+// shares. the scratch copy comes from `arena` and is given back when done
+static void
+draw_items_sort(struct DrawItem* draw_items, uint32_t count, struct LinearArena* arena) {
+    size_t scratch_mark = arena->used;
+    struct DrawItem* scratch = LINEAR_ALLOC(arena, struct DrawItem, count);
+
+    struct DrawItem* source = draw_items;
+    struct DrawItem* destination = scratch;
+    for (uint32_t shift = 0; shift < 64; shift += 8) {
+        uint32_t offsets[256] = {0};
+        for (uint32_t i = 0; i < count; i++) {
+            offsets[(source[i].sort_key >> shift) & 0xff] += 1;
+        }
+        if (count == 0 || offsets[(source[0].sort_key >> shift) & 0xff] == count) {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t i = 0; i < LEN(offsets); i++) {
+            uint32_t bucket_count = offsets[i];
+            offsets[i] = offset;
+            offset += bucket_count;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            destination[offsets[(source[i].sort_key >> shift) & 0xff]++] = source[i];
+        }
+
+        struct DrawItem* swap = source;
+        source = destination;
+        destination = swap;
+    }
+    if (source != draw_items) {
+        memcpy(draw_items, source, count * sizeof(struct DrawItem));
+    }
+
+    arena->used = scratch_mark;
+}
+
+// NOTE: fans the update out to the job system and helps until it's done, must be called from the main thread
+static void
+scene_update(struct SceneUpdate* update, struct JobSystem* job_system) {
+    ASSERT(update->batch_size % MATH_BATCH_WIDTH == 0);
+
+    // NOTE: the frustum in grid space is the one of the orbit transformed grid
+    struct Mat4 grid_view_projection = mat4_mul(&update->view_projection, &update->orbit);
+    float grid_frustum_planes[6][4];
+    frustum_planes_from_matrix(&grid_view_projection, grid_frustum_planes);
+    update->candidate_count = bvh_cull_frustum(&update->scene->bvh, grid_frustum_planes, update->candidates);
+
+    volatile LONG counter = 0;
+    job_system_parallel_for(job_system, /* worker_index */ 0, &scene_update_job, update, update->candidate_count, update->batch_size, &counter);
+    job_system_wait(job_system, /* worker_index */ 0, &counter);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// gpu buffer arena
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// carves vertex, index and uniform ranges out of one big immutable storage buffer using a two level
+// segregated fit (TLSF) allocator. all bookkeeping lives on the cpu so the gpu memory is never touched.
+// free blocks are kept in lists segregated by a first level (power of two) and a second level (linear
+// subdivision of that power of two) size class and two levels of bitmaps find a non empty list in O(1).
+
+#define GPU_ARENA_GRANULARITY 4
+#define GPU_ARENA_SL_LOG2 5
+#define GPU_ARENA_SL_COUNT (1u << GPU_ARENA_SL_LOG2)
+#define GPU_ARENA_FL_COUNT (32 - GPU_ARENA_SL_LOG2 + 1)
+#define GPU_ARENA_NULL_BLOCK UINT32_MAX
+
+struct GpuArenaBlock {
+    uint32_t offset;
+    uint32_t size;
+    uint32_t prev_physical;
+    uint32_t next_physical;
+    uint32_t prev_free;
+    uint32_t next_free; // NOTE: also links unused block nodes
+    uint32_t is_free;
+    uint32_t reserved;
+};
+
+struct GpuAllocation {
+    uint32_t offset;
+    uint32_t size;
+    uint32_t block;
+};
+
+struct GpuArenaStats {
+    uint32_t allocation_count;
+    uint32_t free_block_count;
+    uint64_t allocated_bytes;
+    uint64_t free_bytes;
+    uint64_t total_allocations;
+    uint64_t failed_allocations;
+    int64_t allocation_ticks;
+    int64_t max_allocation_ticks;
+};
+
+struct GpuArena {
+    GLuint buffer;
+    uint32_t size;
+
+    struct GpuArenaBlock* blocks;
+    uint32_t block_capacity;
+    uint32_t first_unused_block;
+
+    uint32_t fl_bitmap;
+    uint32_t sl_bitmaps[GPU_ARENA_FL_COUNT];
+    uint32_t free_lists[GPU_ARENA_FL_COUNT][GPU_ARENA_SL_COUNT];
+
+    struct GpuArenaStats stats;
+};
+
+enum GpuBufferUsage {
+    GPU_BUFFER_USAGE_VERTEX,
+    GPU_BUFFER_USAGE_INDEX,
+    GPU_BUFFER_USAGE_UNIFORM,
+};
+
+// NOTE: queried once the context exists (GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT)
+static uint32_t gpu_uniform_buffer_offset_alignment = 256;
+
+// NOTE: vertex ranges are aligned to their stride so they can be drawn with a base vertex,
+// index ranges to their index size so they can be drawn with a first index
+// and uniform ranges to what `glBindBufferRange` requires
+static uint32_t
+gpu_buffer_usage_alignment(enum GpuBufferUsage usage, uint32_t element_size) {
+    switch (usage) {
+        case GPU_BUFFER_USAGE_VERTEX: return element_size;
+        case GPU_BUFFER_USAGE_INDEX: return element_size;
+        case GPU_BUFFER_USAGE_UNIFORM: return gpu_uniform_buffer_offset_alignment;
+        default: return GPU_ARENA_GRANULARITY;
+    }
+}
+
+static void
+gpu_arena_mapping(uint32_t size, uint32_t* fl, uint32_t* sl) {
+    if (size < GPU_ARENA_SL_COUNT) {
+        *fl = 0;
+        *sl = size;
+    } else {
+        uint32_t msb = bit_scan_reverse(size);
+        *sl = (size >> (msb - GPU_ARENA_SL_LOG2)) - GPU_ARENA_SL_COUNT;
+        *fl = msb - GPU_ARENA_SL_LOG2 + 1;
+    }
+}
+
+static uint32_t
+gpu_arena_new_block(struct GpuArena* arena) {
+    uint32_t block = arena->first_unused_block;
+    if (block != GPU_ARENA_NULL_BLOCK) {
+        arena->first_unused_block = arena->blocks[block].next_free;
+    }
+    return block;
+}
+
+static void
+gpu_arena_release_block(struct GpuArena* arena, uint32_t block) {
+    arena->blocks[block].next_free = arena->first_unused_block;
+    arena->first_unused_block = block;
+}
+
+static void
+gpu_arena_insert_free(struct GpuArena* arena, uint32_t block) {
+    struct GpuArenaBlock* b = &arena->blocks[block];
+    uint32_t fl = 0;
+    uint32_t sl = 0;
+    gpu_arena_mapping(b->size, &fl, &sl);
+
+    uint32_t head = arena->free_lists[fl][sl];
+    b->is_free = true;
+    b->prev_free = GPU_ARENA_NULL_BLOCK;
+    b->next_free = head;
+    if (head != GPU_ARENA_NULL_BLOCK) {
+        arena->blocks[head].prev_free = block;
+    }
+    arena->free_lists[fl][sl] = block;
+    arena->fl_bitmap |= 1u << fl;
+    arena->sl_bitmaps[fl] |= 1u << sl;
+
+    arena->stats.free_block_count += 1;
+    arena->stats.free_bytes += b->size;
+}
+
+static void
+gpu_arena_remove_free(struct GpuArena* arena, uint32_t block) {
+    struct GpuArenaBlock* b = &arena->blocks[block];
+    uint32_t fl = 0;
+    uint32_t sl = 0;
+    gpu_arena_mapping(b->size, &fl, &sl);
+
+    if (b->prev_free != GPU_ARENA_NULL_BLOCK) {
+        arena->blocks[b->prev_free].next_free = b->next_free;
+    } else {
+        arena->free_lists[fl][sl] = b->next_free;
+        if (b->next_free == GPU_ARENA_NULL_BLOCK) {
+            arena->sl_bitmaps[fl] &= ~(1u << sl);
+            if (arena->sl_bitmaps[fl] == 0) {
+                arena->fl_bitmap &= ~(1u << fl);
+            }
+        }
+    }
+    if (b->next_free != GPU_ARENA_NULL_BLOCK) {
+        arena->blocks[b->next_free].prev_free = b->prev_free;
+    }
+    b->is_free = false;
+    b->prev_free = GPU_ARENA_NULL_BLOCK;
+    b->next_free = GPU_ARENA_NULL_BLOCK;
+
+    arena->stats.free_block_count -= 1;
+    arena->stats.free_bytes -= b->size;
+}
+
+// NOTE: splits `block` at `size` bytes, the remainder becomes a new block right after it
+static uint32_t
+gpu_arena_split(struct GpuArena* arena, uint32_t block, uint32_t size) {
+    uint32_t remainder = gpu_arena_new_block(arena);
+    if (remainder == GPU_ARENA_NULL_BLOCK) {
+        return GPU_ARENA_NULL_BLOCK;
+    }
+
+    struct GpuArenaBlock* b = &arena->blocks[block];
+    struct GpuArenaBlock* r = &arena->blocks[remainder];
+    r->offset = b->offset + size;
+    r->size = b->size - size;
+    r->prev_physical = block;
+    r->next_physical = b->next_physical;
+    r->is_free = false;
+    if (b->next_physical != GPU_ARENA_NULL_BLOCK) {
+        arena->blocks[b->next_physical].prev_physical = remainder;
+    }
+    b->size = size;
+    b->next_physical = remainder;
+    return remainder;
+}
+
+// NOTE: merges `next` into `block` (`next` must be the physical successor of `block`)
+static void
+gpu_arena_merge(struct GpuArena* arena, uint32_t block, uint32_t next) {
+    struct GpuArenaBlock* b = &arena->blocks[block];
+    struct GpuArenaBlock* n = &arena->blocks[next];
+    b->size += n->size;
+    b->next_physical = n->next_physical;
+    if (n->next_physical != GPU_ARENA_NULL_BLOCK) {
+        arena->blocks[n->next_physical].prev_physical = block;
+    }
+    gpu_arena_release_block(arena, next);
+}
+
+static void
+gpu_arena_init(struct GpuArena* arena, uint32_t size, GLbitfield storage_flags, uint32_t block_capacity) {
+    ASSERT(size % GPU_ARENA_GRANULARITY == 0);
+    ASSERT(block_capacity > 0);
+
+    memset(arena, 0, sizeof(*arena));
+    arena->size = size;
+    arena->blocks = os_alloc(block_capacity * sizeof(struct GpuArenaBlock));
+    arena->block_capacity = block_capacity;
+    for (uint32_t i = 0; i < GPU_ARENA_FL_COUNT; i++) {
+        for (uint32_t j = 0; j < GPU_ARENA_SL_COUNT; j++) {
+            arena->free_lists[i][j] = GPU_ARENA_NULL_BLOCK;
+        }
+    }
+
+    arena->first_unused_block = GPU_ARENA_NULL_BLOCK;
+    for (uint32_t i = block_capacity; i > 0; i--) {
+        gpu_arena_release_block(arena, i - 1);
+    }
+
+    uint32_t block = gpu_arena_new_block(arena);
+    arena->blocks[block] = (struct GpuArenaBlock){
+        .offset = 0,
+        .size = size,
+        .prev_physical = GPU_ARENA_NULL_BLOCK,
+        .next_physical = GPU_ARENA_NULL_BLOCK,
+    };
+    gpu_arena_insert_free(arena, block);
+
+    glCreateBuffers(1, &arena->buffer);
+    glNamedBufferStorage(arena->buffer, size, /* data */ NULL, storage_flags);
+}
+
+static void
+gpu_arena_deinit(struct GpuArena* arena) {
+    glDeleteBuffers(1, &arena->buffer);
+    os_free(arena->blocks);
+    memset(arena, 0, sizeof(*arena));
+}
+
+// NOTE: `alignment` doesn't need to be a power of two (eg. a vertex stride)
+static bool
+gpu_arena_alloc(struct GpuArena* arena, uint32_t size, uint32_t alignment, struct GpuAllocation* allocation) {
+    int64_t start_ticks = timer_now();
+    memset(allocation, 0, sizeof(*allocation));
+    allocation->block = GPU_ARENA_NULL_BLOCK;
+
+    // NOTE: block offsets are always multiples of the granularity so the alignment has to be too
+    alignment = alignment < 1 ? 1 : alignment;
+    alignment = alignment / greatest_common_divisor(alignment, GPU_ARENA_GRANULARITY) * GPU_ARENA_GRANULARITY;
+    size = ALIGN_UP(size < 1 ? 1 : size, GPU_ARENA_GRANULARITY);
+
+    // NOTE: look for a size class whose blocks are all big enough to fit an aligned allocation
+    uint64_t needed_size = (uint64_t)size + alignment - GPU_ARENA_GRANULARITY;
+    uint64_t search_size = needed_size;
+    if (search_size >= GPU_ARENA_SL_COUNT && search_size <= arena->size) {
+        search_size += (1u << (bit_scan_reverse((uint32_t)search_size) - GPU_ARENA_SL_LOG2)) - 1;
+    }
+
+    uint32_t block = GPU_ARENA_NULL_BLOCK;
+    if (search_size <= arena->size) {
+        uint32_t fl = 0;
+        uint32_t sl = 0;
+        gpu_arena_mapping((uint32_t)search_size, &fl, &sl);
+
+        uint32_t sl_bitmap = arena->sl_bitmaps[fl] & (~0u << sl);
+        if (sl_bitmap == 0) {
+            uint32_t fl_bitmap = fl + 1 < 32 ? arena->fl_bitmap & (~0u << (fl + 1)) : 0;
+            if (fl_bitmap != 0) {
+                fl = bit_scan_forward(fl_bitmap);
+                sl_bitmap = arena->sl_bitmaps[fl];
+            }
+        }
+        if (sl_bitmap != 0) {
+            block = arena->free_lists[fl][bit_scan_forward(sl_bitmap)];
+        }
+    }
+    if (block == GPU_ARENA_NULL_BLOCK && needed_size <= arena->size) {
+        // NOTE: rounding up may skip the only class that could fit it (eg. allocating the whole arena)
+        // so fall back to scanning the exact class list
+        uint32_t fl = 0;
+        uint32_t sl = 0;
+        gpu_arena_mapping((uint32_t)needed_size, &fl, &sl);
+        for (uint32_t b = arena->free_lists[fl][sl]; b != GPU_ARENA_NULL_BLOCK; b = arena->blocks[b].next_free) {
+            if (arena->blocks[b].size >= needed_size) {
+                block = b;
+                break;
+            }
+        }
+    }
+
+    // NOTE: the worst case needs two extra block nodes (front padding and remainder)
+    bool has_block_nodes =
+        arena->first_unused_block != GPU_ARENA_NULL_BLOCK &&
+        arena->blocks[arena->first_unused_block].next_free != GPU_ARENA_NULL_BLOCK;
+    if (block == GPU_ARENA_NULL_BLOCK || !has_block_nodes) {
+        arena->stats.failed_allocations += 1;
+        return false;
+    }
+
+    gpu_arena_remove_free(arena, block);
+
+    uint32_t padding = ALIGN_UP(arena->blocks[block].offset, alignment) - arena->blocks[block].offset;
+    if (padding > 0) {
+        // NOTE: the previous physical block can't be free (it would have been merged) so the padding
+        // becomes a free block of its own
+        uint32_t aligned_block = gpu_arena_split(arena, block, padding);
+        gpu_arena_insert_free(arena, block);
+        block = aligned_block;
+    }
+    if (arena->blocks[block].size > size) {
+        uint32_t remainder = gpu_arena_split(arena, block, size);
+        uint32_t next = arena->blocks[remainder].next_physical;
+        if (next != GPU_ARENA_NULL_BLOCK && arena->blocks[next].is_free) {
+            gpu_arena_remove_free(arena, next);
+            gpu_arena_merge(arena, remainder, next);
+        }
+        gpu_arena_insert_free(arena, remainder);
+    }
+
+    allocation->offset = arena->blocks[block].offset;
+    allocation->size = arena->blocks[block].size;
+    allocation->block = block;
+
+    int64_t ticks = timer_now() - start_ticks;
+    arena->stats.allocation_count += 1;
+    arena->stats.allocated_bytes += allocation->size;
+    arena->stats.total_allocations += 1;
+    arena->stats.allocation_ticks += ticks;
+    arena->stats.max_allocation_ticks = ticks > arena->stats.max_allocation_ticks ? ticks : arena->stats.max_allocation_ticks;
+    return true;
+}
+
+static bool
+gpu_arena_alloc_for_usage(
+    struct GpuArena* arena,
+    enum GpuBufferUsage usage,
+    uint32_t size,
+    uint32_t element_size,
+    struct GpuAllocation* allocation
+) {
+    return gpu_arena_alloc(arena, size, gpu_buffer_usage_alignment(usage, element_size), allocation);
+}
+
+static void
+gpu_arena_free(struct GpuArena* arena, struct GpuAllocation* allocation) {
+    uint32_t block = allocation->block;
+    if (block == GPU_ARENA_NULL_BLOCK) {
+        return;
+    }
+    ASSERT(block < arena->block_capacity && !arena->blocks[block].is_free);
+
+    arena->stats.allocation_count -= 1;
+    arena->stats.allocated_bytes -= arena->blocks[block].size;
+
+    uint32_t prev = arena->blocks[block].prev_physical;
+    if (prev != GPU_ARENA_NULL_BLOCK && arena->blocks[prev].is_free) {
+        gpu_arena_remove_free(arena, prev);
+        gpu_arena_merge(arena, prev, block);
+        block = prev;
+    }
+    uint32_t next = arena->blocks[block].next_physical;
+    if (next != GPU_ARENA_NULL_BLOCK && arena->blocks[next].is_free) {
+        gpu_arena_remove_free(arena, next);
+        gpu_arena_merge(arena, block, next);
+    }
+    gpu_arena_insert_free(arena, block);
+
+    allocation->block = GPU_ARENA_NULL_BLOCK;
+}
+
+static uint32_t
+gpu_arena_largest_free_block(const struct GpuArena* arena) {
+    if (arena->fl_bitmap == 0) {
+        return 0;
+    }
+    uint32_t fl = bit_scan_reverse(arena->fl_bitmap);
+    uint32_t sl = bit_scan_reverse(arena->sl_bitmaps[fl]);
+    uint32_t largest = 0;
+    for (uint32_t block = arena->free_lists[fl][sl]; block != GPU_ARENA_NULL_BLOCK; block = arena->blocks[block].next_free) {
+        largest = arena->blocks[block].size > largest ? arena->blocks[block].size : largest;
+    }
+    return largest;
+}
+
+// NOTE: 0 means all free memory is contiguous, close to 1 means it's scattered in tiny blocks
+static float
+gpu_arena_fragmentation(const struct GpuArena* arena) {
+    if (arena->stats.free_bytes == 0) {
+        return 0.0f;
+    }
+    return 1.0f - (float)gpu_arena_largest_free_block(arena) / (float)arena->stats.free_bytes;
+}
+
+static void
+gpu_arena_print_stats(const char* name, const struct GpuArena* arena) {
+    const struct GpuArenaStats* stats = &arena->stats;
+    double average_us = stats->total_allocations > 0 ?
+        timer_seconds(stats->allocation_ticks) * 1000000.0 / (double)stats->total_allocations :
+        0.0;
+    printf(
+        "%s arena: %u allocations (%llu bytes), %u free blocks (%llu bytes), fragmentation %.3f, "
+        "allocation latency avg %.3fus max %.3fus, %llu failed\n",
+        name,
+        stats->allocation_count,
+        (unsigned long long)stats->allocated_bytes,
+        stats->free_block_count,
+        (unsigned long long)stats->free_bytes,
+        (double)gpu_arena_fragmentation(arena),
+        average_us,
+        timer_seconds(stats->max_allocation_ticks) * 1000000.0,
+        (unsigned long long)stats->failed_allocations
+    );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// meshes
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// a mesh is just a vertex range and an index range inside the shared geometry arena.
+// vertex ranges are stride aligned so every mesh with the same vertex layout can share one vertex
+// array object and be drawn with `glDrawElementsBaseVertex` (or batched with multi draw indirect).
+// the positions are also copied into a tightly packed position only vertex range so depth only passes
+// fetch just what they need, its vertices are in the same order so the submesh base vertices still apply
+
+struct Mesh {
+    struct GpuAllocation vertices;
+    struct GpuAllocation indices;
+    struct GpuAllocation positions;
+    uint32_t vertex_stride;
+    uint32_t position_component_count; // NOTE: positions are floats (attribute location 0)
+    GLenum index_type;
+    GLint base_vertex;
+    GLint position_base_vertex;
+    uint32_t first_index; // NOTE: in indices from the start of the arena
+    uint32_t lod_count;
+    struct MeshFileLod lods[MESH_FILE_MAX_LODS];
+    uint32_t submesh_count;
+    struct MeshFileSubmesh submeshes[MESH_FILE_MAX_SUBMESHES];
+    float bounds_min[3];
+    float bounds_max[3];
+};
+
+static void
+mesh_free(struct Mesh* mesh, struct GpuArena* arena) {
+    gpu_arena_free(arena, &mesh->vertices);
+    gpu_arena_free(arena, &mesh->indices);
+    gpu_arena_free(arena, &mesh->positions);
+}
+
+// NOTE: the blobs go from the (memory mapped) mesh file to the driver without intermediate copies
+// compressed indices are decoded straight into the mapped index range
+static bool
+mesh_upload(struct Mesh* mesh, struct GpuArena* arena, const struct MeshFile* mesh_file) {
+    const struct MeshFileHeader* header = mesh_file->header;
+    memset(mesh, 0, sizeof(*mesh));
+    mesh->vertices.block = GPU_ARENA_NULL_BLOCK;
+    mesh->indices.block = GPU_ARENA_NULL_BLOCK;
+    mesh->positions.block = GPU_ARENA_NULL_BLOCK;
+
+    const struct MeshFileAttribute* position_attribute = NULL;
+    for (uint32_t i = 0; i < header->attribute_count; i++) {
+        if (header->attributes[i].location == 0) {
+            position_attribute = &header->attributes[i];
+        }
+    }
+    if (!position_attribute || position_attribute->component_type != GL_FLOAT) {
+        return false;
+    }
+
+    uint32_t vertex_count = (uint32_t)(header->vertex_data_size / header->vertex_stride);
+    uint32_t position_stride = position_attribute->component_count * (uint32_t)sizeof(float);
+    uint32_t index_size = index_type_size(header->index_type);
+    size_t index_data_size = (size_t)header->index_count * index_size;
+    size_t position_data_size = (size_t)vertex_count * position_stride;
+    // NOTE: arena blocks are addressed with 32 bits
+    if (header->vertex_data_size > UINT32_MAX || index_data_size > UINT32_MAX || position_data_size > UINT32_MAX) {
+        return false;
+    }
+    bool allocated =
+        gpu_arena_alloc_for_usage(arena, GPU_BUFFER_USAGE_VERTEX, (uint32_t)header->vertex_data_size, header->vertex_stride, &mesh->vertices) &&
+        gpu_arena_alloc_for_usage(arena, GPU_BUFFER_USAGE_INDEX, (uint32_t)index_data_size, index_size, &mesh->indices) &&
+        gpu_arena_alloc_for_usage(arena, GPU_BUFFER_USAGE_VERTEX, (uint32_t)position_data_size, position_stride, &mesh->positions);
+    if (!allocated) {
+        mesh_free(mesh, arena);
+        return false;
+    }
+
+    glNamedBufferSubData(arena->buffer, mesh->vertices.offset, (GLsizeiptr)header->vertex_data_size, mesh_file->vertex_data);
+    if (vertex_count > 0) {
+        // NOTE: requires the arena to be created with `GL_MAP_WRITE_BIT`
+        unsigned char* mapped_positions = glMapNamedBufferRange(
+            arena->buffer,
+            mesh->positions.offset,
+            (GLsizeiptr)position_data_size,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT
+        );
+        ASSERT(mapped_positions);
+        const unsigned char* vertex_data = (const unsigned char*)mesh_file->vertex_data + position_attribute->relative_offset;
+        for (uint32_t i = 0; i < vertex_count; i++) {
+            memcpy(mapped_positions + (size_t)i * position_stride, vertex_data + (size_t)i * header->vertex_stride, position_stride);
+        }
+        ASSERT(glUnmapNamedBuffer(arena->buffer));
+    }
+    if (header->index_encoding == MESH_FILE_INDEX_ENCODING_NONE) {
+        glNamedBufferSubData(arena->buffer, mesh->indices.offset, (GLsizeiptr)index_data_size, mesh_file->index_data);
+    } else if (index_data_size > 0) {
+        // NOTE: requires the arena to be created with `GL_MAP_WRITE_BIT`
+        void* mapped_indices = glMapNamedBufferRange(
+            arena->buffer,
+            mesh->indices.offset,
+            (GLsizeiptr)index_data_size,
+            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT
+        );
+        ASSERT(mapped_indices);
+        bool decoded = index_codec_decode(mesh_file->index_data, (size_t)header->index_data_size, header->index_count, mapped_indices, index_size);
+        ASSERT(glUnmapNamedBuffer(arena->buffer));
+        if (!decoded) {
+            mesh_free(mesh, arena);
+            return false;
+        }
+    }
+
+    mesh->vertex_stride = header->vertex_stride;
+    mesh->position_component_count = position_attribute->component_count;
+    mesh->index_type = header->index_type;
+    mesh->base_vertex = (GLint)(mesh->vertices.offset / header->vertex_stride);
+    mesh->position_base_vertex = (GLint)(mesh->positions.offset / position_stride);
+    mesh->first_index = mesh->indices.offset / index_size;
+    mesh->lod_count = header->lod_count;
+    memcpy(mesh->lods, mesh_file->lods, header->lod_count * sizeof(struct MeshFileLod));
+    mesh->submesh_count = header->submesh_count;
+    memcpy(mesh->submeshes, mesh_file->submeshes, header->submesh_count * sizeof(struct MeshFileSubmesh));
+    memcpy(mesh->bounds_min, header->bounds_min, sizeof(mesh->bounds_min));
+    memcpy(mesh->bounds_max, header->bounds_max, sizeof(mesh->bounds_max));
+    return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// command buffers
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// gl calls have to come from the thread owning the context but deciding what to draw doesn't.
+// workers record draws into compact binary command buffers (fixed size commands tagged by their type)
+// allocated from their frame arena and the context thread then executes the buffers in order,
+// skipping binds that wouldn't change anything
+
+enum CommandType {
+    COMMAND_TYPE_BIND_PROGRAM,
+    COMMAND_TYPE_BIND_TEXTURE,
+    COMMAND_TYPE_BIND_VERTEX_ARRAY,
+    COMMAND_TYPE_BIND_UNIFORM_RANGE,
+    COMMAND_TYPE_DRAW_INDEXED,
+    COMMAND_TYPE_SET_RASTER_STATE,
+    COMMAND_TYPE_BEGIN_QUERY,
+    COMMAND_TYPE_END_QUERY,
+    COMMAND_TYPE_BEGIN_CONDITIONAL_RENDER,
+    COMMAND_TYPE_END_CONDITIONAL_RENDER,
+};
+
+struct CommandBindProgram {
+    uint32_t type;
+    GLuint program;
+};
+
+// NOTE: a texture and the sampler it's read with
+struct CommandBindTexture {
+    uint32_t type;
+    uint32_t unit;
+    GLuint texture;
+    GLuint sampler;
+};
+
+struct CommandBindVertexArray {
+    uint32_t type;
+    GLuint vertex_array;
+};
+
+struct CommandBindUniformRange {
+    uint32_t type;
+    uint32_t binding;
+    GLuint buffer;
+    uint32_t offset;
+    uint32_t size;
+};
+
+// NOTE: `glDrawElementsBaseVertex` arguments
+struct CommandDrawIndexed {
+    uint32_t type;
+    GLenum index_type;
+    uint32_t index_count;
+    uint32_t index_offset; // NOTE: in bytes
+    GLint base_vertex;
+};
+
+// NOTE: the write masks, depth test and face culling (for occlusion query proxies)
+struct CommandSetRasterState {
+    uint32_t type;
+    uint32_t color_write;
+    uint32_t depth_write;
+    GLenum depth_func;
+    uint32_t cull_face;
+};
+
+struct CommandBeginQuery {
+    uint32_t type;
+    GLenum target;
+    GLuint query;
+};
+
+struct CommandEndQuery {
+    uint32_t type;
+    GLenum target;
+};
+
+struct CommandBeginConditionalRender {
+    uint32_t type;
+    GLuint query;
+    GLenum mode;
+};
+
+struct CommandEndConditionalRender {
+    uint32_t type;
+};
+
+#define COMMAND_MAX_TEXTURE_UNITS 16
+#define COMMAND_MAX_UNIFORM_BINDINGS 16
+#define DRAW_LIST_BATCH_SIZE 256
+#define DRAW_LIST_QUERY_GROUP_SIZE 32
+
+struct CommandBuffer {
+    unsigned char* data;
+    uint32_t size;
+    uint32_t capacity;
+};
+
+struct CommandExecutionStats {
+    uint32_t command_count;
+    uint32_t draw_count;
+    uint32_t redundant_count;
+};
+
+// NOTE: gl state as last set by the executed commands, so redundant binds can be skipped
+struct CommandExecutionState {
+    GLuint program;
+    GLuint vertex_array;
+    GLuint textures[COMMAND_MAX_TEXTURE_UNITS];
+    GLuint samplers[COMMAND_MAX_TEXTURE_UNITS];
+    struct CommandExecutionStats stats;
+};
+
+static void
+command_buffer_init(struct CommandBuffer* buffer, struct LinearArena* arena, uint32_t capacity) {
+    buffer->data = linear_arena_alloc(arena, capacity, sizeof(uint32_t));
+    buffer->size = 0;
+    buffer->capacity = capacity;
+}
+
+static void*
+command_buffer_push(struct CommandBuffer* buffer, enum CommandType type, uint32_t size) {
+    ASSERT(buffer->capacity - buffer->size >= size);
+    void* command = buffer->data + buffer->size;
+    buffer->size += size;
+    *(uint32_t*)command = type;
+    return command;
+}
+
+static void
+command_bind_program(struct CommandBuffer* buffer, GLuint program) {
+    struct CommandBindProgram* command = command_buffer_push(buffer, COMMAND_TYPE_BIND_PROGRAM, sizeof(*command));
+    command->program = program;
+}
+
+static void
+command_bind_texture(struct CommandBuffer* buffer, uint32_t unit, GLuint texture, GLuint sampler) {
+    ASSERT(unit < COMMAND_MAX_TEXTURE_UNITS);
+    struct CommandBindTexture* command = command_buffer_push(buffer, COMMAND_TYPE_BIND_TEXTURE, sizeof(*command));
+    command->unit = unit;
+    command->texture = texture;
+    command->sampler = sampler;
+}
+
+static void
+command_bind_vertex_array(struct CommandBuffer* buffer, GLuint vertex_array) {
+    struct CommandBindVertexArray* command = command_buffer_push(buffer, COMMAND_TYPE_BIND_VERTEX_ARRAY, sizeof(*command));
+    command->vertex_array = vertex_array;
+}
+
+static void
+command_bind_uniform_range(struct CommandBuffer* buffer, uint32_t binding, GLuint uniform_buffer, uint32_t offset, uint32_t size) {
+    struct CommandBindUniformRange* command = command_buffer_push(buffer, COMMAND_TYPE_BIND_UNIFORM_RANGE, sizeof(*command));
+    command->binding = binding;
+    command->buffer = uniform_buffer;
+    command->offset = offset;
+    command->size = size;
+}
+
+static void
+command_set_raster_state(struct CommandBuffer* buffer, bool color_write, bool depth_write, GLenum depth_func, bool cull_face) {
+    struct CommandSetRasterState* command = command_buffer_push(buffer, COMMAND_TYPE_SET_RASTER_STATE, sizeof(*command));
+    command->color_write = color_write ? 1 : 0;
+    command->depth_write = depth_write ? 1 : 0;
+    command->depth_func = depth_func;
+    command->cull_face = cull_face ? 1 : 0;
+}
+
+static void
+command_begin_query(struct CommandBuffer* buffer, GLenum target, GLuint query) {
+    struct CommandBeginQuery* command = command_buffer_push(buffer, COMMAND_TYPE_BEGIN_QUERY, sizeof(*command));
+    command->target = target;
+    command->query = query;
+}
+
+static void
+command_end_query(struct CommandBuffer* buffer, GLenum target) {
+    struct CommandEndQuery* command = command_buffer_push(buffer, COMMAND_TYPE_END_QUERY, sizeof(*command));
+    command->target = target;
+}
+
+static void
+command_begin_conditional_render(struct CommandBuffer* buffer, GLuint query, GLenum mode) {
+    struct CommandBeginConditionalRender* command = command_buffer_push(buffer, COMMAND_TYPE_BEGIN_CONDITIONAL_RENDER, sizeof(*command));
+    command->query = query;
+    command->mode = mode;
+}
+
+static void
+command_end_conditional_render(struct CommandBuffer* buffer) {
+    command_buffer_push(buffer, COMMAND_TYPE_END_CONDITIONAL_RENDER, sizeof(struct CommandEndConditionalRender));
+}
+
+// NOTE: records one indexed draw per submesh of the mesh lod, expects the geometry arena vertex array to be bound
+// (or the position only one to draw from the mesh position stream)
+static void
+command_draw_mesh(struct CommandBuffer* buffer, const struct Mesh* mesh, uint32_t lod, bool positions_only) {
+    GLint base_vertex = positions_only ? mesh->position_base_vertex : mesh->base_vertex;
+    const struct MeshFileLod* mesh_lod = &mesh->lods[lod < mesh->lod_count ? lod : mesh->lod_count - 1];
+    for (uint32_t i = 0; i < mesh_lod->submesh_count; i++) {
+        const struct MeshFileSubmesh* submesh = &mesh->submeshes[mesh_lod->first_submesh + i];
+        struct CommandDrawIndexed* command = command_buffer_push(buffer, COMMAND_TYPE_DRAW_INDEXED, sizeof(*command));
+        command->index_type = mesh->index_type;
+        command->index_count = submesh->index_count;
+        command->index_offset = (mesh->first_index + submesh->first_index) * index_type_size(mesh->index_type);
+        command->base_vertex = base_vertex + (GLint)submesh->base_vertex;
+    }
+}
+
+// NOTE: must be called from the context thread
+static void
+command_buffer_execute(const struct CommandBuffer* buffer, struct CommandExecutionState* state) {
+    uint32_t offset = 0;
+    while (offset < buffer->size) {
+        const void* command = buffer->data + offset;
+        state->stats.command_count += 1;
+        switch (*(const uint32_t*)command) {
+            case COMMAND_TYPE_BIND_PROGRAM: {
+                const struct CommandBindProgram* bind = command;
+                if (bind->program != state->program) {
+                    glUseProgram(bind->program);
+                    state->program = bind->program;
+                } else {
+                    state->stats.redundant_count += 1;
+                }
+                offset += sizeof(*bind);
+                break;
+            }
+            case COMMAND_TYPE_BIND_TEXTURE: {
+                const struct CommandBindTexture* bind = command;
+                bool texture_changed = bind->texture != state->textures[bind->unit];
+                bool sampler_changed = bind->sampler != state->samplers[bind->unit];
+                if (texture_changed) {
+                    glBindTextureUnit(bind->unit, bind->texture);
+                    state->textures[bind->unit] = bind->texture;
+                }
+                if (sampler_changed) {
+                    glBindSampler(bind->unit, bind->sampler);
+                    state->samplers[bind->unit] = bind->sampler;
+                }
+                if (!texture_changed && !sampler_changed) {
+                    state->stats.redundant_count += 1;
+                }
+                offset += sizeof(*bind);
+                break;
+            }
+            case COMMAND_TYPE_BIND_VERTEX_ARRAY: {
+                const struct CommandBindVertexArray* bind = command;
+                if (bind->vertex_array != state->vertex_array) {
+                    glBindVertexArray(bind->vertex_array);
+                    state->vertex_array = bind->vertex_array;
+                } else {
+                    state->stats.redundant_count += 1;
+                }
+                offset += sizeof(*bind);
+                break;
+            }
+            case COMMAND_TYPE_BIND_UNIFORM_RANGE: {
+                const struct CommandBindUniformRange* bind = command;
+                glBindBufferRange(GL_UNIFORM_BUFFER, bind->binding, bind->buffer, bind->offset, bind->size);
+                offset += sizeof(*bind);
+                break;
+            }
+            case COMMAND_TYPE_DRAW_INDEXED: {
+                const struct CommandDrawIndexed* draw = command;
+                glDrawElementsBaseVertex(
+                    GL_TRIANGLES,
+                    (GLsizei)draw->index_count,
+                    draw->index_type,
+                    /* offset in bytes */ (const void*)(size_t)draw->index_offset,
+                    draw->base_vertex
+                );
+                state->stats.draw_count += 1;
+                offset += sizeof(*draw);
+                break;
+            }
+            case COMMAND_TYPE_SET_RASTER_STATE: {
+                const struct CommandSetRasterState* set = command;
+                GLboolean color_write = set->color_write ? GL_TRUE : GL_FALSE;
+                glColorMask(color_write, color_write, color_write, color_write);
+                glDepthMask(set->depth_write ? GL_TRUE : GL_FALSE);
+                glDepthFunc(set->depth_func);
+                if (set->cull_face) {
+                    glEnable(GL_CULL_FACE);
+                } else {
+                    glDisable(GL_CULL_FACE);
+                }
+                offset += sizeof(*set);
+                break;
+            }
+            case COMMAND_TYPE_BEGIN_QUERY: {
+                const struct CommandBeginQuery* begin = command;
+                glBeginQuery(begin->target, begin->query);
+                offset += sizeof(*begin);
+                break;
+            }
+            case COMMAND_TYPE_END_QUERY: {
+                const struct CommandEndQuery* end = command;
+                glEndQuery(end->target);
+                offset += sizeof(*end);
+                break;
+            }
+            case COMMAND_TYPE_BEGIN_CONDITIONAL_RENDER: {
+                const struct CommandBeginConditionalRender* begin = command;
+                glBeginConditionalRender(begin->query, begin->mode);
+                offset += sizeof(*begin);
+                break;
+            }
+            case COMMAND_TYPE_END_CONDITIONAL_RENDER: {
+                glEndConditionalRender();
+                offset += sizeof(struct CommandEndConditionalRender);
+                break;
+            }
+            default:
+                UNREACHABLE;
+                return;
+        }
+    }
+}
+
+// NOTE: everything needed to turn a list of draw items into command buffers, one per batch of draws
+struct DrawListRecording {
+    const struct DrawItem* draw_items;
+    uint32_t draw_count;
+    uint32_t batch_size;
+    struct FrameArena* frame_arena;
+    const struct Mesh* mesh;
+    GLuint program;
+    GLuint texture;
+    GLuint sampler;
+    GLuint vertex_array;
+    bool positions_only; // NOTE: draws from the mesh position stream (`vertex_array` has to read only that)
+    GLuint uniform_buffer;
+    uint32_t uniform_offset;
+    uint32_t uniform_stride;
+    uint32_t uniform_size;
+
+    // NOTE: occlusion queried draws, see `draw_list_record_queried`. null queries to draw everything as is
+    const GLuint* occlusion_queries; // NOTE: one per object
+    const struct Mesh* proxy_mesh; // NOTE: drawn from its position stream
+    GLuint proxy_program;
+    GLuint proxy_vertex_array;
+    float proxy_min_distance_squared; // NOTE: closer objects could have the camera inside their proxy
+    GLenum depth_func; // NOTE: the depth state of the pass, restored after the proxies
+    bool depth_write;
+
+    struct CommandBuffer* command_buffers;
+};
+
+// NOTE: front to back groups of draws first draw their bounding box proxies (no writes, no face culling)
+// inside occlusion queries and then draw conditionally on them without waiting, so the gpu skips the ones
+// with no proxy sample passing if it has the result by then and the cpu never waits on anything.
+// every group is tested against the depth of the groups in front of it
+static void
+draw_list_record_queried(const struct DrawListRecording* recording, struct CommandBuffer* buffer, uint32_t first, uint32_t count) {
+    for (uint32_t group = first; group < first + count; group += DRAW_LIST_QUERY_GROUP_SIZE) {
+        uint32_t group_end = group + DRAW_LIST_QUERY_GROUP_SIZE < first + count ? group + DRAW_LIST_QUERY_GROUP_SIZE : first + count;
+
+        command_set_raster_state(buffer, /* color_write */ false, /* depth_write */ false, GL_LEQUAL, /* cull_face */ false);
+        command_bind_program(buffer, recording->proxy_program);
+        command_bind_vertex_array(buffer, recording->proxy_vertex_array);
+        for (uint32_t i = group; i < group_end; i++) {
+            const struct DrawItem* draw_item = &recording->draw_items[i];
+            if (draw_item_distance_squared(draw_item) < recording->proxy_min_distance_squared) {
+                continue;
+            }
+            uint32_t uniform_offset = recording->uniform_offset + draw_item->object_index * recording->uniform_stride;
+            command_bind_uniform_range(buffer, /* binding */ 0, recording->uniform_buffer, uniform_offset, recording->uniform_size);
+            command_begin_query(buffer, GL_ANY_SAMPLES_PASSED_CONSERVATIVE, recording->occlusion_queries[draw_item->object_index]);
+            command_draw_mesh(buffer, recording->proxy_mesh, /* lod */ 0, /* positions_only */ true);
+            command_end_query(buffer, GL_ANY_SAMPLES_PASSED_CONSERVATIVE);
+        }
+
+        command_set_raster_state(buffer, /* color_write */ true, recording->depth_write, recording->depth_func, /* cull_face */ true);
+        command_bind_program(buffer, recording->program);
+        command_bind_texture(buffer, /* unit */ 0, recording->texture, recording->sampler);
+        command_bind_vertex_array(buffer, recording->vertex_array);
+        for (uint32_t i = group; i < group_end; i++) {
+            const struct DrawItem* draw_item = &recording->draw_items[i];
+            bool queried = draw_item_distance_squared(draw_item) >= recording->proxy_min_distance_squared;
+            uint32_t uniform_offset = recording->uniform_offset + draw_item->object_index * recording->uniform_stride;
+            command_bind_uniform_range(buffer, /* binding */ 0, recording->uniform_buffer, uniform_offset, recording->uniform_size);
+            if (queried) {
+                command_begin_conditional_render(buffer, recording->occlusion_queries[draw_item->object_index], GL_QUERY_NO_WAIT);
+            }
+            command_draw_mesh(buffer, recording->mesh, /* lod */ 0, recording->positions_only);
+            if (queried) {
+                command_end_conditional_render(buffer);
+            }
+        }
+    }
+}
+
+static void
+draw_list_record_job(void* data, uint32_t first, uint32_t count, uint32_t worker_index) {
+    const struct DrawListRecording* recording = data;
+    const struct Mesh* mesh = recording->mesh;
+
+    // NOTE: every buffer sets up all its state so buffers don't depend on each other,
+    // the executor drops the binds that end up being redundant
+    uint32_t draw_size = (uint32_t)(
+        sizeof(struct CommandBindUniformRange) +
+        mesh->lods[0].submesh_count * sizeof(struct CommandDrawIndexed)
+    );
+    uint32_t capacity =
+        sizeof(struct CommandBindProgram) +
+        sizeof(struct CommandBindTexture) +
+        sizeof(struct CommandBindVertexArray) +
+        count * draw_size;
+    if (recording->occlusion_queries) {
+        uint32_t group_count = (count + DRAW_LIST_QUERY_GROUP_SIZE - 1) / DRAW_LIST_QUERY_GROUP_SIZE;
+        uint32_t query_size = (uint32_t)(
+            sizeof(struct CommandBindUniformRange) +
+            sizeof(struct CommandBeginQuery) +
+            recording->proxy_mesh->lods[0].submesh_count * sizeof(struct CommandDrawIndexed) +
+            sizeof(struct CommandEndQuery) +
+            sizeof(struct CommandBeginConditionalRender) +
+            sizeof(struct CommandEndConditionalRender)
+        );
+        uint32_t group_state_size = (uint32_t)(
+            2 * sizeof(struct CommandSetRasterState) +
+            2 * sizeof(struct CommandBindProgram) +
+            sizeof(struct CommandBindTexture) +
+            2 * sizeof(struct CommandBindVertexArray)
+        );
+        capacity += group_count * group_state_size + count * query_size;
+    }
+
+    struct CommandBuffer* buffer = &recording->command_buffers[first / recording->batch_size];
+    command_buffer_init(buffer, frame_arena_thread(recording->frame_arena, worker_index), capacity);
+    if (recording->occlusion_queries) {
+        draw_list_record_queried(recording, buffer, first, count);
+        return;
+    }
+    command_bind_program(buffer, recording->program);
+    command_bind_texture(buffer, /* unit */ 0, recording->texture, recording->sampler);
+    command_bind_vertex_array(buffer, recording->vertex_array);
+
+    for (uint32_t i = first; i < first + count; i++) {
+        const struct DrawItem* draw_item = &recording->draw_items[i];
+        uint32_t uniform_offset = recording->uniform_offset + draw_item->object_index * recording->uniform_stride;
+        command_bind_uniform_range(buffer, /* binding */ 0, recording->uniform_buffer, uniform_offset, recording->uniform_size);
+        command_draw_mesh(buffer, mesh, /* lod */ 0, recording->positions_only);
+    }
+}
+
+static uint32_t
+draw_list_batch_count(const struct DrawListRecording* recording) {
+    return (recording->draw_count + recording->batch_size - 1) / recording->batch_size;
+}
+
+// NOTE: records the command buffers in parallel, must be called from the main thread
+static void
+draw_list_record(struct DrawListRecording* recording, struct JobSystem* job_system, struct LinearArena* arena) {
+    recording->command_buffers = LINEAR_ALLOC(arena, struct CommandBuffer, draw_list_batch_count(recording) + 1);
+    volatile LONG counter = 0;
+    job_system_parallel_for(job_system, /* worker_index */ 0, &draw_list_record_job, recording, recording->draw_count, recording->batch_size, &counter);
+    job_system_wait(job_system, /* worker_index */ 0, &counter);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// baked command lists
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// static draws issue the exact same binds and draws every frame, only the contents of their uniform
+// ranges change. baking decodes their command buffers once into state blocks (the program, vertex
+// array and texture changes) each followed by a flat run of draws with the uniform ranges they bind,
+// dropping every redundant bind on the way, so replaying is a tight loop of gl calls with no decoding.
+// when GL_NV_command_list is there the draws are also baked into a token buffer that binds gpu
+// addresses instead of names and a whole run of state blocks is submitted with a single call
+
+#define BAKED_CHANGED_TEXTURES ((1u << COMMAND_MAX_TEXTURE_UNITS) - 1)
+#define BAKED_CHANGED_PROGRAM (1u << COMMAND_MAX_TEXTURE_UNITS)
+#define BAKED_CHANGED_VERTEX_ARRAY (1u << (COMMAND_MAX_TEXTURE_UNITS + 1))
+
+#define NV_COMMAND_LIST_MAX_VERTEX_BINDINGS 16
+
+struct BakedUniformRange {
+    uint32_t binding;
+    GLuint buffer;
+    uint32_t offset;
+    uint32_t size;
+};
+
+struct BakedDraw {
+    GLenum index_type;
+    GLsizei index_count;
+    uint32_t index_offset; // NOTE: in bytes
+    GLint base_vertex;
+    uint32_t first_uniform_range; // NOTE: ranges bound right before the draw
+    uint32_t uniform_range_count;
+};
+
+struct BakedStateBlock {
+    GLuint program;
+    GLuint vertex_array;
+    GLuint textures[COMMAND_MAX_TEXTURE_UNITS];
+    GLuint samplers[COMMAND_MAX_TEXTURE_UNITS];
+    uint32_t changed; // NOTE: `BAKED_CHANGED_*` bits (one per texture unit) of what the block binds
+    uint32_t first_draw;
+    uint32_t draw_count;
+};
+
+struct BakedCommandList {
+    struct BakedStateBlock* state_blocks;
+    uint32_t state_block_count;
+    struct BakedDraw* draws;
+    uint32_t draw_count;
+    struct BakedUniformRange* uniform_ranges;
+    uint32_t uniform_range_count;
+    uint32_t dropped_bind_count;
+
+    // NOTE: only when baked for GL_NV_command_list, one state object and token range per state block
+    GLuint nv_token_buffer;
+    GLuint* nv_states;
+    GLintptr* nv_token_offsets;
+    GLsizei* nv_token_sizes;
+    GLuint* nv_framebuffers;
+};
+
+// NOTE: token layouts from the GL_NV_command_list spec, they're all 16 bytes
+struct NvElementAddressCommand {
+    GLuint header;
+    GLuint address_lo;
+    GLuint address_hi;
+    GLuint type_size_in_bytes;
+};
+
+struct NvAttributeAddressCommand {
+    GLuint header;
+    GLuint index; // NOTE: vertex buffer binding index
+    GLuint address_lo;
+    GLuint address_hi;
+};
+
+struct NvUniformAddressCommand {
+    GLuint header;
+    GLushort index;
+    GLushort stage;
+    GLuint address_lo;
+    GLuint address_hi;
+};
+
+struct NvDrawElementsCommand {
+    GLuint header;
+    GLuint count;
+    GLuint first_index;
+    GLuint base_vertex;
+};
+
+struct NvCommandList {
+    bool supported;
+    GLuint element_address_header;
+    GLuint attribute_address_header;
+    GLuint uniform_address_header;
+    GLuint draw_elements_header;
+    GLushort vertex_stage;
+    GLushort fragment_stage;
+};
+
+static struct NvCommandList nv_command_list;
+
+static bool
+gl_has_extension(const char* name) {
+    GLint extension_count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count);
+    for (GLint i = 0; i < extension_count; i++) {
+        if (strcmp((const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i), name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// NOTE: the token stream binds buffers by gpu address which needs the bindless buffer extensions too
+static void
+nv_command_list_init(void) {
+    memset(&nv_command_list, 0, sizeof(nv_command_list));
+    bool supported =
+        gl_has_extension("GL_NV_command_list") &&
+        gl_has_extension("GL_NV_shader_buffer_load") &&
+        gl_has_extension("GL_NV_vertex_buffer_unified_memory") &&
+        gl_has_extension("GL_NV_uniform_buffer_unified_memory");
+    #define X(type, name) supported = supported && LOAD_OPTIONAL_PROC(type, name);
+    GL_NV_COMMAND_LIST_PROCS
+    #undef X
+    if (!supported) {
+        return;
+    }
+
+    nv_command_list.supported = true;
+    nv_command_list.element_address_header = glGetCommandHeaderNV(GL_ELEMENT_ADDRESS_COMMAND_NV, sizeof(struct NvElementAddressCommand));
+    nv_command_list.attribute_address_header = glGetCommandHeaderNV(GL_ATTRIBUTE_ADDRESS_COMMAND_NV, sizeof(struct NvAttributeAddressCommand));
+    nv_command_list.uniform_address_header = glGetCommandHeaderNV(GL_UNIFORM_ADDRESS_COMMAND_NV, sizeof(struct NvUniformAddressCommand));
+    nv_command_list.draw_elements_header = glGetCommandHeaderNV(GL_DRAW_ELEMENTS_COMMAND_NV, sizeof(struct NvDrawElementsCommand));
+    nv_command_list.vertex_stage = glGetStageIndexNV(GL_VERTEX_SHADER);
+    nv_command_list.fragment_stage = glGetStageIndexNV(GL_FRAGMENT_SHADER);
+}
+
+// NOTE: buffers are left resident, deleting a buffer makes it non resident
+static GLuint64
+nv_buffer_address(GLuint buffer) {
+    ASSERT(buffer != 0);
+    if (!glIsNamedBufferResidentNV(buffer)) {
+        glMakeNamedBufferResidentNV(buffer, GL_READ_ONLY);
+    }
+    GLuint64EXT address = 0;
+    glGetNamedBufferParameterui64vNV(buffer, GL_BUFFER_GPU_ADDRESS_NV, &address);
+    return address;
+}
+
+static void
+nv_unified_memory_enable(bool enable) {
+    if (enable) {
+        glEnableClientState(GL_VERTEX_ATTRIB_ARRAY_UNIFIED_NV);
+        glEnableClientState(GL_ELEMENT_ARRAY_UNIFIED_NV);
+        glEnableClientState(GL_UNIFORM_BUFFER_UNIFIED_NV);
+    } else {
+        glDisableClientState(GL_VERTEX_ATTRIB_ARRAY_UNIFIED_NV);
+        glDisableClientState(GL_ELEMENT_ARRAY_UNIFIED_NV);
+        glDisableClientState(GL_UNIFORM_BUFFER_UNIFIED_NV);
+    }
+}
+
+static void*
+nv_token_push(unsigned char* tokens, uint32_t* size, uint32_t capacity, uint32_t token_size) {
+    ASSERT(capacity - *size >= token_size);
+    void* token = tokens + *size;
+    *size += token_size;
+    return token;
+}
+
+static uint32_t
+command_size(uint32_t type) {
+    switch (type) {
+        case COMMAND_TYPE_BIND_PROGRAM: return (uint32_t)sizeof(struct CommandBindProgram);
+        case COMMAND_TYPE_BIND_TEXTURE: return (uint32_t)sizeof(struct CommandBindTexture);
+        case COMMAND_TYPE_BIND_VERTEX_ARRAY: return (uint32_t)sizeof(struct CommandBindVertexArray);
+        case COMMAND_TYPE_BIND_UNIFORM_RANGE: return (uint32_t)sizeof(struct CommandBindUniformRange);
+        case COMMAND_TYPE_DRAW_INDEXED: return (uint32_t)sizeof(struct CommandDrawIndexed);
+        case COMMAND_TYPE_SET_RASTER_STATE: return (uint32_t)sizeof(struct CommandSetRasterState);
+        case COMMAND_TYPE_BEGIN_QUERY: return (uint32_t)sizeof(struct CommandBeginQuery);
+        case COMMAND_TYPE_END_QUERY: return (uint32_t)sizeof(struct CommandEndQuery);
+        case COMMAND_TYPE_BEGIN_CONDITIONAL_RENDER: return (uint32_t)sizeof(struct CommandBeginConditionalRender);
+        case COMMAND_TYPE_END_CONDITIONAL_RENDER: return (uint32_t)sizeof(struct CommandEndConditionalRender);
+        default:
+            UNREACHABLE;
+            return 0;
+    }
+}
+
+// NOTE: captures a state object per state block and writes their draws as tokens into an immutable buffer
+static void
+baked_command_list_bake_nv(struct BakedCommandList* list, struct LinearArena* arena) {
+    uint32_t count = list->state_block_count;
+    if (count == 0) {
+        return;
+    }
+    list->nv_states = LINEAR_ALLOC(arena, GLuint, count);
+    list->nv_token_offsets = LINEAR_ALLOC(arena, GLintptr, count);
+    list->nv_token_sizes = LINEAR_ALLOC(arena, GLsizei, count);
+    list->nv_framebuffers = LINEAR_ALLOC(arena, GLuint, count);
+    memset(list->nv_framebuffers, 0, count * sizeof(GLuint));
+    glCreateStatesNV((GLsizei)count, list->nv_states);
+
+    // NOTE: worst case is an element address token before every draw
+    uint32_t token_capacity = (uint32_t)(
+        count * NV_COMMAND_LIST_MAX_VERTEX_BINDINGS * sizeof(struct NvAttributeAddressCommand) +
+        list->draw_count * (sizeof(struct NvElementAddressCommand) + sizeof(struct NvDrawElementsCommand)) +
+        list->uniform_range_count * 2 * sizeof(struct NvUniformAddressCommand)
+    );
+    unsigned char* tokens = os_alloc(token_capacity);
+    uint32_t token_size = 0;
+
+    nv_unified_memory_enable(true);
+    for (uint32_t i = 0; i < count; i++) {
+        const struct BakedStateBlock* block = &list->state_blocks[i];
+        glUseProgram(block->program);
+        glBindVertexArray(block->vertex_array);
+        glStateCaptureNV(list->nv_states[i], GL_TRIANGLES);
+        list->nv_token_offsets[i] = (GLintptr)token_size;
+
+        // NOTE: the vertex formats are part of the state object, the buffers they read from are tokens
+        for (uint32_t binding = 0; binding < NV_COMMAND_LIST_MAX_VERTEX_BINDINGS; binding++) {
+            GLint vertex_buffer = 0;
+            glGetVertexArrayIndexediv(block->vertex_array, binding, GL_VERTEX_BINDING_BUFFER, &vertex_buffer);
+            if (vertex_buffer == 0) {
+                continue;
+            }
+            GLint64 vertex_buffer_offset = 0;
+            glGetVertexArrayIndexed64iv(block->vertex_array, binding, GL_VERTEX_BINDING_OFFSET, &vertex_buffer_offset);
+            GLuint64 address = nv_buffer_address((GLuint)vertex_buffer) + (GLuint64)vertex_buffer_offset;
+
+            struct NvAttributeAddressCommand* token = nv_token_push(tokens, &token_size, token_capacity, sizeof(*token));
+            token->header = nv_command_list.attribute_address_header;
+            token->index = binding;
+            token->address_lo = (GLuint)(address & 0xffffffff);
+            token->address_hi = (GLuint)(address >> 32);
+        }
+
+        GLint element_buffer = 0;
+        glGetVertexArrayiv(block->vertex_array, GL_ELEMENT_ARRAY_BUFFER_BINDING, &element_buffer);
+        GLuint64 element_address = nv_buffer_address((GLuint)element_buffer);
+
+        GLenum index_type = GL_NONE;
+        for (uint32_t j = block->first_draw; j < block->first_draw + block->draw_count; j++) {
+            const struct BakedDraw* draw = &list->draws[j];
+            uint32_t index_size = index_type_size(draw->index_type);
+            if (draw->index_type != index_type) {
+                struct NvElementAddressCommand* token = nv_token_push(tokens, &token_size, token_capacity, sizeof(*token));
+                token->header = nv_command_list.element_address_header;
+                token->address_lo = (GLuint)(element_address & 0xffffffff);
+                token->address_hi = (GLuint)(element_address >> 32);
+                token->type_size_in_bytes = index_size;
+                index_type = draw->index_type;
+            }
+
+            for (uint32_t k = draw->first_uniform_range; k < draw->first_uniform_range + draw->uniform_range_count; k++) {
+                const struct BakedUniformRange* range = &list->uniform_ranges[k];
+                GLuint64 address = nv_buffer_address(range->buffer) + range->offset;
+                GLushort stages[] = {nv_command_list.vertex_stage, nv_command_list.fragment_stage};
+                for (uint32_t stage = 0; stage < LEN(stages); stage++) {
+                    struct NvUniformAddressCommand* token = nv_token_push(tokens, &token_size, token_capacity, sizeof(*token));
+                    token->header = nv_command_list.uniform_address_header;
+                    token->index = (GLushort)(range->binding & 0xffff);
+                    token->stage = stages[stage];
+                    token->address_lo = (GLuint)(address & 0xffffffff);
+                    token->address_hi = (GLuint)(address >> 32);
+                }
+            }
+
+            struct NvDrawElementsCommand* token = nv_token_push(tokens, &token_size, token_capacity, sizeof(*token));
+            token->header = nv_command_list.draw_elements_header;
+            token->count = (GLuint)draw->index_count;
+            token->first_index = draw->index_offset / index_size;
+            token->base_vertex = (GLuint)draw->base_vertex;
+        }
+        list->nv_token_sizes[i] = (GLsizei)(token_size - (uint32_t)list->nv_token_offsets[i]);
+    }
+    nv_unified_memory_enable(false);
+    glUseProgram(0);
+    glBindVertexArray(0);
+
+    glCreateBuffers(1, &list->nv_token_buffer);
+    glNamedBufferStorage(list->nv_token_buffer, token_size, tokens, /* flags */ 0);
+    os_free(tokens);
+}
+
+// NOTE: must be called from the context thread. the arrays live in `arena` for as long as the list does.
+// like `command_buffer_execute` the list expects to start from all zeros gl state, except for the bound
+// framebuffer which GL_NV_command_list state objects capture the attachment formats of.
+// only binds and draws can be baked, so no queried draw lists
+static void
+baked_command_list_bake(
+    struct BakedCommandList* list,
+    const struct CommandBuffer* buffers,
+    uint32_t buffer_count,
+    struct LinearArena* arena
+) {
+    memset(list, 0, sizeof(*list));
+
+    // NOTE: the first pass only counts, every bind could start a new state block
+    uint32_t max_state_block_count = 1;
+    uint32_t max_draw_count = 0;
+    uint32_t max_uniform_range_count = 0;
+    for (uint32_t i = 0; i < buffer_count; i++) {
+        for (uint32_t offset = 0; offset < buffers[i].size;) {
+            uint32_t type = *(const uint32_t*)(buffers[i].data + offset);
+            if (type == COMMAND_TYPE_DRAW_INDEXED) {
+                max_draw_count += 1;
+            } else if (type == COMMAND_TYPE_BIND_UNIFORM_RANGE) {
+                max_uniform_range_count += 1;
+            } else {
+                max_state_block_count += 1;
+            }
+            offset += command_size(type);
+        }
+    }
+    list->state_blocks = LINEAR_ALLOC(arena, struct BakedStateBlock, max_state_block_count);
+    list->draws = LINEAR_ALLOC(arena, struct BakedDraw, max_draw_count);
+    list->uniform_ranges = LINEAR_ALLOC(arena, struct BakedUniformRange, max_uniform_range_count);
+
+    struct CommandExecutionState state = {0};
+    struct BakedUniformRange bound_uniform_ranges[COMMAND_MAX_UNIFORM_BINDINGS] = {0};
+    struct BakedStateBlock* block = NULL;
+    uint32_t changed = 0;
+    uint32_t pending_uniform_range_count = 0;
+    for (uint32_t i = 0; i < buffer_count; i++) {
+        for (uint32_t offset = 0; offset < buffers[i].size;) {
+            const void* command = buffers[i].data + offset;
+            uint32_t type = *(const uint32_t*)command;
+            offset += command_size(type);
+            switch (type) {
+                case COMMAND_TYPE_BIND_PROGRAM: {
+                    const struct CommandBindProgram* bind = command;
+                    if (bind->program != state.program) {
+                        state.program = bind->program;
+                        changed |= BAKED_CHANGED_PROGRAM;
+                    } else {
+                        list->dropped_bind_count += 1;
+                    }
+                    break;
+                }
+                case COMMAND_TYPE_BIND_TEXTURE: {
+                    const struct CommandBindTexture* bind = command;
+                    if (bind->texture != state.textures[bind->unit] || bind->sampler != state.samplers[bind->unit]) {
+                        state.textures[bind->unit] = bind->texture;
+                        state.samplers[bind->unit] = bind->sampler;
+                        changed |= 1u << bind->unit;
+                    } else {
+                        list->dropped_bind_count += 1;
+                    }
+                    break;
+                }
+                case COMMAND_TYPE_BIND_VERTEX_ARRAY: {
+                    const struct CommandBindVertexArray* bind = command;
+                    if (bind->vertex_array != state.vertex_array) {
+                        state.vertex_array = bind->vertex_array;
+                        changed |= BAKED_CHANGED_VERTEX_ARRAY;
+                    } else {
+                        list->dropped_bind_count += 1;
+                    }
+                    break;
+                }
+                case COMMAND_TYPE_BIND_UNIFORM_RANGE: {
+                    const struct CommandBindUniformRange* bind = command;
+                    ASSERT(bind->binding < COMMAND_MAX_UNIFORM_BINDINGS);
+                    struct BakedUniformRange* bound = &bound_uniform_ranges[bind->binding];
+                    if (bind->buffer != bound->buffer || bind->offset != bound->offset || bind->size != bound->size) {
+                        bound->binding = bind->binding;
+                        bound->buffer = bind->buffer;
+                        bound->offset = bind->offset;
+                        bound->size = bind->size;
+                        list->uniform_ranges[list->uniform_range_count] = *bound;
+                        list->uniform_range_count += 1;
+                        pending_uniform_range_count += 1;
+                    } else {
+                        list->dropped_bind_count += 1;
+                    }
+                    break;
+                }
+                case COMMAND_TYPE_DRAW_INDEXED: {
+                    const struct CommandDrawIndexed* draw = command;
+                    if (!block || changed != 0) {
+                        block = &list->state_blocks[list->state_block_count];
+                        list->state_block_count += 1;
+                        block->program = state.program;
+                        block->vertex_array = state.vertex_array;
+                        memcpy(block->textures, state.textures, sizeof(block->textures));
+                        memcpy(block->samplers, state.samplers, sizeof(block->samplers));
+                        block->changed = changed;
+                        block->first_draw = list->draw_count;
+                        block->draw_count = 0;
+                        changed = 0;
+                    }
+
+                    struct BakedDraw* baked = &list->draws[list->draw_count];
+                    list->draw_count += 1;
+                    baked->index_type = draw->index_type;
+                    baked->index_count = (GLsizei)draw->index_count;
+                    baked->index_offset = draw->index_offset;
+                    baked->base_vertex = draw->base_vertex;
+                    baked->first_uniform_range = list->uniform_range_count - pending_uniform_range_count;
+                    baked->uniform_range_count = pending_uniform_range_count;
+                    pending_uniform_range_count = 0;
+                    block->draw_count += 1;
+                    break;
+                }
+                default:
+                    UNREACHABLE;
+                    return;
+            }
+        }
+    }
+    // NOTE: binds after the last draw don't affect anything and are dropped as well
+    list->uniform_range_count -= pending_uniform_range_count;
+
+    if (nv_command_list.supported) {
+        baked_command_list_bake_nv(list, arena);
+    }
+}
+
+static void
+baked_command_list_deinit(struct BakedCommandList* list) {
+    if (list->nv_token_buffer != 0) {
+        glDeleteStatesNV((GLsizei)list->state_block_count, list->nv_states);
+        glDeleteBuffers(1, &list->nv_token_buffer);
+    }
+    memset(list, 0, sizeof(*list));
+}
+
+// NOTE: the block has the textures and samplers of every unit so the units in between the changed ones
+// are bound again as they are, the whole range is one call for the textures and one for the samplers
+static void
+baked_state_block_bind_textures(const struct BakedStateBlock* block, struct CommandExecutionStats* stats) {
+    uint32_t mask = block->changed & BAKED_CHANGED_TEXTURES;
+    if (mask != 0) {
+        uint32_t first = bit_scan_forward(mask);
+        GLsizei count = (GLsizei)(bit_scan_reverse(mask) - first + 1);
+        glBindTextures(first, count, block->textures + first);
+        glBindSamplers(first, count, block->samplers + first);
+        stats->command_count += 2;
+    }
+}
+
+// NOTE: must be called from the context thread
+static void
+baked_command_list_replay(const struct BakedCommandList* list, struct CommandExecutionStats* stats) {
+    for (uint32_t i = 0; i < list->state_block_count; i++) {
+        const struct BakedStateBlock* block = &list->state_blocks[i];
+        if (block->changed & BAKED_CHANGED_PROGRAM) {
+            glUseProgram(block->program);
+            stats->command_count += 1;
+        }
+        if (block->changed & BAKED_CHANGED_VERTEX_ARRAY) {
+            glBindVertexArray(block->vertex_array);
+            stats->command_count += 1;
+        }
+        baked_state_block_bind_textures(block, stats);
+
+        const struct BakedDraw* draws = list->draws + block->first_draw;
+        for (uint32_t j = 0; j < block->draw_count; j++) {
+            const struct BakedDraw* draw = &draws[j];
+            const struct BakedUniformRange* ranges = list->uniform_ranges + draw->first_uniform_range;
+            for (uint32_t k = 0; k < draw->uniform_range_count; k++) {
+                glBindBufferRange(GL_UNIFORM_BUFFER, ranges[k].binding, ranges[k].buffer, ranges[k].offset, ranges[k].size);
+            }
+            glDrawElementsBaseVertex(
+                GL_TRIANGLES,
+                draw->index_count,
+                draw->index_type,
+                /* offset in bytes */ (const void*)(size_t)draw->index_offset,
+                draw->base_vertex
+            );
+            stats->command_count += draw->uniform_range_count + 1;
+        }
+        stats->draw_count += block->draw_count;
+    }
+}
+
+// NOTE: must be called from the context thread. texture units aren't covered by tokens or state objects
+// so they're bound on the context and every run of state blocks that don't change them is one call.
+// `framebuffer` must have the same attachment formats as the one bound when the list was baked, it's
+// written into the list's per state block framebuffers which is why the list isn't const
+static void
+baked_command_list_replay_nv(struct BakedCommandList* list, GLuint framebuffer, struct CommandExecutionStats* stats) {
+    ASSERT(list->nv_token_buffer != 0);
+    for (uint32_t i = 0; i < list->state_block_count; i++) {
+        list->nv_framebuffers[i] = framebuffer;
+    }
+    nv_unified_memory_enable(true);
+    for (uint32_t first = 0; first < list->state_block_count;) {
+        baked_state_block_bind_textures(&list->state_blocks[first], stats);
+        uint32_t end = first + 1;
+        while (end < list->state_block_count && (list->state_blocks[end].changed & BAKED_CHANGED_TEXTURES) == 0) {
+            end += 1;
+        }
+        glDrawCommandsStatesNV(
+            list->nv_token_buffer,
+            list->nv_token_offsets + first,
+            list->nv_token_sizes + first,
+            list->nv_states + first,
+            list->nv_framebuffers + first,
+            end - first
+        );
+        stats->command_count += 1;
+        first = end;
+    }
+    stats->draw_count += list->draw_count;
+    nv_unified_memory_enable(false);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// mip chains
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// textures get every level down to 1x1 so minified sampling reads texels close to each other instead
+// of skipping all over the top level. the levels are made on the cpu with a 2x2 box filter that averages
+// the colors as light (decoded from srgb and encoded back, alpha as is) so checkers and edges don't get
+// darker further down the chain. decoding is a table lookup and encoding one into a table of linear
+// steps fine enough to round to the right byte; AVX2 does two output texels at a time with gathers.
+// `glGenerateTextureMipmap` (with `GPU_MIP_CHAINS` defined) averages the bytes as they are instead
+
+#define MIP_CHAIN_MAX_LEVELS 16
+#define MIP_CHAIN_LINEAR_STEPS 16384
+
+// NOTE: the first 256 entries decode srgb bytes to linear, the last 256 turn alpha bytes into 0 to 1
+static float mip_chain_decode_table[512];
+static uint32_t mip_chain_encode_table[MIP_CHAIN_LINEAR_STEPS]; // NOTE: srgb byte of every linear step
+
+static void
+mip_chain_tables_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        float value = (float)i / 255.0f;
+        mip_chain_decode_table[i] = value <= 0.04045f ? value / 12.92f : powf((value + 0.055f) / 1.055f, 2.4f);
+        mip_chain_decode_table[256 + i] = value;
+    }
+    for (uint32_t i = 0; i < MIP_CHAIN_LINEAR_STEPS; i++) {
+        float value = (float)i / (float)(MIP_CHAIN_LINEAR_STEPS - 1);
+        float encoded = value <= 0.0031308f ? value * 12.92f : 1.055f * powf(value, 1.0f / 2.4f) - 0.055f;
+        mip_chain_encode_table[i] = (uint32_t)(encoded * 255.0f + 0.5f);
+    }
+}
+
+static uint32_t
+mip_level_count(uint32_t width, uint32_t height) {
+    return bit_scan_reverse(width > height ? width : height) + 1;
+}
+
+static uint32_t
+mip_level_extent(uint32_t extent, uint32_t level) {
+    return extent >> level > 0 ? extent >> level : 1;
+}
+
+// NOTE: in bytes, rgba8 levels one after the other
+static size_t
+mip_chain_size(uint32_t width, uint32_t height, uint32_t level_count) {
+    size_t size = 0;
+    for (uint32_t level = 0; level < level_count; level++) {
+        size += (size_t)mip_level_extent(width, level) * mip_level_extent(height, level) * 4;
+    }
+    return size;
+}
+
+// NOTE: odd sizes drop their last row or column (clamped reads)
+static void
+mip_downsample_texel(const unsigned char* source, uint32_t source_width, uint32_t source_height, uint32_t x, uint32_t y, unsigned char* destination) {
+    uint32_t x0 = 2 * x < source_width ? 2 * x : source_width - 1;
+    uint32_t x1 = 2 * x + 1 < source_width ? 2 * x + 1 : source_width - 1;
+    const unsigned char* row0 = source + (size_t)(2 * y < source_height ? 2 * y : source_height - 1) * source_width * 4;
+    const unsigned char* row1 = source + (size_t)(2 * y + 1 < source_height ? 2 * y + 1 : source_height - 1) * source_width * 4;
+    for (uint32_t c = 0; c < 4; c++) {
+        const float* table = c == 3 ? mip_chain_decode_table + 256 : mip_chain_decode_table;
+        float sum = (table[row0[x0 * 4 + c]] + table[row0[x1 * 4 + c]]) + (table[row1[x0 * 4 + c]] + table[row1[x1 * 4 + c]]);
+        float average = sum * 0.25f;
+        destination[c] = c == 3 ?
+            (unsigned char)(average * 255.0f + 0.5f) :
+            (unsigned char)mip_chain_encode_table[(uint32_t)(average * (float)(MIP_CHAIN_LINEAR_STEPS - 1) + 0.5f)];
+    }
+}
+
+static void
+mip_downsample_scalar(const unsigned char* source, uint32_t source_width, uint32_t source_height, unsigned char* destination) {
+    uint32_t width = mip_level_extent(source_width, 1);
+    uint32_t height = mip_level_extent(source_height, 1);
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            mip_downsample_texel(source, source_width, source_height, x, y, destination + ((size_t)y * width + x) * 4);
+        }
+    }
+}
+
+#if defined(_M_X64)
+// NOTE: the same math as `mip_downsample_texel` in the same order so both give the same bytes
+static void
+mip_downsample_avx2(const unsigned char* source, uint32_t source_width, uint32_t source_height, unsigned char* destination) {
+    uint32_t width = mip_level_extent(source_width, 1);
+    uint32_t height = mip_level_extent(source_height, 1);
+    __m256i alpha_offsets = _mm256_setr_epi32(0, 0, 0, 256, 0, 0, 0, 256);
+    __m256 quarter = _mm256_set1_ps(0.25f);
+    __m256 linear_steps = _mm256_set1_ps((float)(MIP_CHAIN_LINEAR_STEPS - 1));
+    __m256 alpha_scale = _mm256_set1_ps(255.0f);
+    __m256 half = _mm256_set1_ps(0.5f);
+    for (uint32_t y = 0; y < height; y++) {
+        if (2 * y + 1 >= source_height) {
+            for (uint32_t x = 0; x < width; x++) {
+                mip_downsample_texel(source, source_width, source_height, x, y, destination + ((size_t)y * width + x) * 4);
+            }
+            continue;
+        }
+
+        const unsigned char* rows[2] = {
+            source + (size_t)(2 * y) * source_width * 4,
+            source + (size_t)(2 * y + 1) * source_width * 4,
+        };
+        unsigned char* destination_row = destination + (size_t)y * width * 4;
+        uint32_t x = 0;
+        // NOTE: four source texels (two output texels) per row at a time
+        for (; x + 2 <= width && 2 * x + 4 <= source_width; x += 2) {
+            __m256 row_sums[2];
+            for (uint32_t row = 0; row < 2; row++) {
+                const unsigned char* texels = rows[row] + x * 8;
+                __m256i first = _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)texels)), alpha_offsets);
+                __m256i second = _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(texels + 8))), alpha_offsets);
+                __m256 first_linear = _mm256_i32gather_ps(mip_chain_decode_table, first, 4);
+                __m256 second_linear = _mm256_i32gather_ps(mip_chain_decode_table, second, 4);
+                // NOTE: texels 0 and 2 plus texels 1 and 3
+                row_sums[row] = _mm256_add_ps(
+                    _mm256_permute2f128_ps(first_linear, second_linear, 0x20),
+                    _mm256_permute2f128_ps(first_linear, second_linear, 0x31)
+                );
+            }
+            __m256 average = _mm256_mul_ps(_mm256_add_ps(row_sums[0], row_sums[1]), quarter);
+
+            __m256i steps = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(average, linear_steps), half));
+            __m256i colors = _mm256_i32gather_epi32((const int*)mip_chain_encode_table, steps, 4);
+            __m256i alphas = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(average, alpha_scale), half));
+            __m256i bytes = _mm256_blend_epi32(colors, alphas, 0x88);
+            __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(bytes), _mm256_extracti128_si256(bytes, 1));
+            _mm_storel_epi64((__m128i*)(destination_row + x * 4), _mm_packus_epi16(words, words));
+        }
+        for (; x < width; x++) {
+            mip_downsample_texel(source, source_width, source_height, x, y, destination_row + x * 4);
+        }
+    }
+}
+#endif
+
+// NOTE: writes the next level of an rgba8 image (half its size rounded down, at least 1)
+static void
+mip_downsample(const unsigned char* source, uint32_t source_width, uint32_t source_height, unsigned char* destination) {
+#if defined(_M_X64)
+    if (cpu_features.avx2) {
+        mip_downsample_avx2(source, source_width, source_height, destination);
+        return;
+    }
+#endif
+    mip_downsample_scalar(source, source_width, source_height, destination);
+}
+
+// NOTE: `chain` starts with the top level and has room for `mip_chain_size` bytes, fills the levels after it
+static void
+mip_chain_generate(unsigned char* chain, uint32_t width, uint32_t height, uint32_t level_count) {
+    unsigned char* level = chain;
+    for (uint32_t i = 1; i < level_count; i++) {
+        uint32_t level_width = mip_level_extent(width, i - 1);
+        uint32_t level_height = mip_level_extent(height, i - 1);
+        unsigned char* next_level = level + (size_t)level_width * level_height * 4;
+        mip_downsample(level, level_width, level_height, next_level);
+        level = next_level;
+    }
+}
+
+// NOTE: uploads the levels of a chain to a 2d texture, or to a layer of a 2d array texture when `layer`
+// isn't negative
+static void
+mip_chain_upload(GLuint texture, int32_t layer, const unsigned char* chain, uint32_t width, uint32_t height, uint32_t level_count) {
+    const unsigned char* level = chain;
+    for (uint32_t i = 0; i < level_count; i++) {
+        GLsizei level_width = (GLsizei)mip_level_extent(width, i);
+        GLsizei level_height = (GLsizei)mip_level_extent(height, i);
+        if (layer < 0) {
+            glTextureSubImage2D(texture, (GLint)i, /* xoffset */ 0, /* yoffset */ 0, level_width, level_height, GL_RGBA, GL_UNSIGNED_BYTE, level);
+        } else {
+            glTextureSubImage3D(
+                texture,
+                (GLint)i,
+                /* xoffset */ 0,
+                /* yoffset */ 0,
+                /* zoffset */ layer,
+                level_width,
+                level_height,
+                /* depth */ 1,
+                GL_RGBA,
+                GL_UNSIGNED_BYTE,
+                level
+            );
+        }
+        level += (size_t)level_width * (size_t)level_height * 4;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// samplers
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// filtering and wrapping live in sampler objects bound next to the textures instead of on the
+// textures themselves, so a texture is only storage and can be sampled in different ways at the same
+// time. samplers are made on first use and shared by every lookup with the same description, there's
+// only a handful of them so finding one is a linear search
+
+#define SAMPLER_CACHE_CAPACITY 64
+#define SAMPLER_MAX_ANISOTROPY 16.0f
+
+enum SamplerPreset {
+    SAMPLER_PRESET_NEAREST, // NOTE: top level only
+    SAMPLER_PRESET_BILINEAR, // NOTE: top level only
+    SAMPLER_PRESET_TRILINEAR,
+    SAMPLER_PRESET_ANISOTROPIC, // NOTE: trilinear when anisotropic filtering isn't supported
+    SAMPLER_PRESET_COUNT,
+};
+
+static const char* sampler_preset_names[SAMPLER_PRESET_COUNT] = {"nearest", "bilinear", "trilinear", "anisotropic"};
+
+// NOTE: compared as bytes so it must not have padding
+struct SamplerDesc {
+    GLenum min_filter;
+    GLenum mag_filter;
+    GLenum wrap; // NOTE: for all of s, t and r
+    float anisotropy; // NOTE: 1 is off, clamped to what's supported
+    float lod_bias;
+};
+
+struct SamplerCache {
+    struct SamplerDesc descs[SAMPLER_CACHE_CAPACITY];
+    GLuint samplers[SAMPLER_CACHE_CAPACITY];
+    uint32_t count;
+    float max_anisotropy; // NOTE: 1 when anisotropic filtering isn't supported
+};
+
+// NOTE: anisotropic filtering is core since 4.6, an extension before that
+static void
+sampler_cache_init(struct SamplerCache* cache) {
+    memset(cache, 0, sizeof(*cache));
+    cache->max_anisotropy = 1.0f;
+    GLint major_version = 0;
+    GLint minor_version = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major_version);
+    glGetIntegerv(GL_MINOR_VERSION, &minor_version);
+    bool supported =
+        major_version > 4 || (major_version == 4 && minor_version >= 6) ||
+        gl_has_extension("GL_ARB_texture_filter_anisotropic") ||
+        gl_has_extension("GL_EXT_texture_filter_anisotropic");
+    if (supported) {
+        glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY, &cache->max_anisotropy);
+    }
+}
+
+static void
+sampler_cache_deinit(struct SamplerCache* cache) {
+    glDeleteSamplers((GLsizei)cache->count, cache->samplers);
+    memset(cache, 0, sizeof(*cache));
+}
+
+static GLuint
+sampler_cache_get(struct SamplerCache* cache, const struct SamplerDesc* desc) {
+    struct SamplerDesc key = *desc;
+    key.anisotropy = key.anisotropy < 1.0f ? 1.0f : key.anisotropy > cache->max_anisotropy ? cache->max_anisotropy : key.anisotropy;
+    for (uint32_t i = 0; i < cache->count; i++) {
+        if (memcmp(&cache->descs[i], &key, sizeof(key)) == 0) {
+            return cache->samplers[i];
+        }
+    }
+
+    ASSERT(cache->count < SAMPLER_CACHE_CAPACITY);
+    GLuint sampler = 0;
+    glCreateSamplers(1, &sampler);
+    glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, (GLint)key.min_filter);
+    glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, (GLint)key.mag_filter);
+    glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, (GLint)key.wrap);
+    glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, (GLint)key.wrap);
+    glSamplerParameteri(sampler, GL_TEXTURE_WRAP_R, (GLint)key.wrap);
+    glSamplerParameterf(sampler, GL_TEXTURE_LOD_BIAS, key.lod_bias);
+    if (cache->max_anisotropy > 1.0f) {
+        glSamplerParameterf(sampler, GL_TEXTURE_MAX_ANISOTROPY, key.anisotropy);
+    }
+    cache->descs[cache->count] = key;
+    cache->samplers[cache->count] = sampler;
+    cache->count += 1;
+    return sampler;
+}
+
+static GLuint
+sampler_cache_preset(struct SamplerCache* cache, enum SamplerPreset preset, GLenum wrap) {
+    static const GLenum min_filters[SAMPLER_PRESET_COUNT] = {GL_NEAREST, GL_LINEAR, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR_MIPMAP_LINEAR};
+    static const GLenum mag_filters[SAMPLER_PRESET_COUNT] = {GL_NEAREST, GL_LINEAR, GL_LINEAR, GL_LINEAR};
+    struct SamplerDesc desc = {
+        .min_filter = min_filters[preset],
+        .mag_filter = mag_filters[preset],
+        .wrap = wrap,
+        .anisotropy = preset == SAMPLER_PRESET_ANISOTROPIC ? SAMPLER_MAX_ANISOTROPY : 1.0f,
+        .lod_bias = 0.0f,
+    };
+    return sampler_cache_get(cache, &desc);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// compressed textures
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// textures stored block compressed in DDS or KTX2 files (mip levels included) are uploaded as is,
+// 4 to 8 times smaller than rgba8 on the gpu. like mesh files they're memory mapped and only their
+// headers are validated. the formats the context can't sample are decoded on the cpu and encoded to BC7
+// (see the texture encoding section) so they stay block compressed: BC1 and BC3 (an extension, software
+// drivers may not have it), ASTC without its extension (most desktop drivers) and ETC2, which is core but
+// which desktop drivers decompress to rgba8 when it's uploaded. BC4, BC5 and BC7 are core and uploaded as
+// is. the atlas takes decoded rgba8 of every format but BC7, which has no decoder
+// https://registry.khronos.org/DataFormat/specs/1.3/dataformat.1.3.html#ETC2
+// https://registry.khronos.org/DataFormat/specs/1.3/dataformat.1.3.html#ASTC
+// https://github.com/KhronosGroup/KTX-Specification
+// https://learn.microsoft.com/en-us/windows/win32/direct3ddds/dx-graphics-dds-pguide
+
+enum TextureFormat {
+    TEXTURE_FORMAT_RGBA8,
+    TEXTURE_FORMAT_BC1,
+    TEXTURE_FORMAT_BC3,
+    TEXTURE_FORMAT_BC4,
+    TEXTURE_FORMAT_BC5,
+    TEXTURE_FORMAT_BC7,
+    TEXTURE_FORMAT_ETC2_RGB8,
+    TEXTURE_FORMAT_ETC2_RGBA8,
+    TEXTURE_FORMAT_ASTC_4X4,
+    TEXTURE_FORMAT_ASTC_6X6,
+    TEXTURE_FORMAT_ASTC_8X8,
+    TEXTURE_FORMAT_COUNT,
+};
+
+struct TextureFormatInfo {
+    const char* name;
+    GLenum internal_format;
+    uint32_t block_width;
+    uint32_t block_height;
+    uint32_t block_size; // NOTE: in bytes
+    const char* extension; // NOTE: null when it's core
+    bool decodable; // NOTE: on the cpu, see `texture_file_decode_level`
+};
+
+static const struct TextureFormatInfo texture_format_infos[TEXTURE_FORMAT_COUNT] = {
+    [TEXTURE_FORMAT_RGBA8] = {"rgba8", GL_RGBA8, 1, 1, 4, NULL, true},
+    [TEXTURE_FORMAT_BC1] = {"bc1", GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, 4, 4, 8, "GL_EXT_texture_compression_s3tc", true},
+    [TEXTURE_FORMAT_BC3] = {"bc3", GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, 4, 4, 16, "GL_EXT_texture_compression_s3tc", true},
+    [TEXTURE_FORMAT_BC4] = {"bc4", GL_COMPRESSED_RED_RGTC1, 4, 4, 8, NULL, true},
+    [TEXTURE_FORMAT_BC5] = {"bc5", GL_COMPRESSED_RG_RGTC2, 4, 4, 16, NULL, true},
+    [TEXTURE_FORMAT_BC7] = {"bc7", GL_COMPRESSED_RGBA_BPTC_UNORM, 4, 4, 16, NULL, false},
+    [TEXTURE_FORMAT_ETC2_RGB8] = {"etc2 rgb8", GL_COMPRESSED_RGB8_ETC2, 4, 4, 8, NULL, true},
+    [TEXTURE_FORMAT_ETC2_RGBA8] = {"etc2 rgba8", GL_COMPRESSED_RGBA8_ETC2_EAC, 4, 4, 16, NULL, true},
+    [TEXTURE_FORMAT_ASTC_4X4] = {"astc 4x4", GL_COMPRESSED_RGBA_ASTC_4x4_KHR, 4, 4, 16, "GL_KHR_texture_compression_astc_ldr", true},
+    [TEXTURE_FORMAT_ASTC_6X6] = {"astc 6x6", GL_COMPRESSED_RGBA_ASTC_6x6_KHR, 6, 6, 16, "GL_KHR_texture_compression_astc_ldr", true},
+    [TEXTURE_FORMAT_ASTC_8X8] = {"astc 8x8", GL_COMPRESSED_RGBA_ASTC_8x8_KHR, 8, 8, 16, "GL_KHR_texture_compression_astc_ldr", true},
+};
+
+// NOTE: which formats can be uploaded as is, see `texture_formats_detect`
+static bool texture_format_supported[TEXTURE_FORMAT_COUNT] = {0};
+
+// NOTE: levels are tightly packed rows of blocks. srgb files are uploaded with the plain unorm formats
+// like the builtin textures, the scene renders to a non srgb target so the encoded values go straight out
+struct TextureFile {
+    enum TextureFormat format;
+    bool srgb;
+    uint32_t width;
+    uint32_t height;
+    uint32_t level_count;
+    const unsigned char* levels[MIP_CHAIN_MAX_LEVELS];
+    size_t level_sizes[MIP_CHAIN_MAX_LEVELS];
+};
+
+#define DDS_MAGIC 0x20534444 // NOTE: "DDS "
+#define DDS_FOURCC(a, b, c, d) ((uint32_t)(a) | (uint32_t)(b) << 8 | (uint32_t)(c) << 16 | (uint32_t)(d) << 24)
+#define DDS_PIXEL_FORMAT_FOURCC 0x4
+#define DDS_PIXEL_FORMAT_RGB 0x40
+#define DDS_CAPS2_CUBEMAP 0x200
+#define DDS_CAPS2_VOLUME 0x200000
+#define DDS_RESOURCE_DIMENSION_TEXTURE2D 3
+
+struct DdsPixelFormat {
+    uint32_t size;
+    uint32_t flags;
+    uint32_t four_cc;
+    uint32_t rgb_bit_count;
+    uint32_t masks[4];
+};
+
+struct DdsHeader {
+    uint32_t magic;
+    uint32_t size;
+    uint32_t flags;
+    uint32_t height;
+    uint32_t width;
+    uint32_t pitch_or_linear_size;
+    uint32_t depth;
+    uint32_t mip_map_count;
+    uint32_t reserved1[11];
+    struct DdsPixelFormat pixel_format;
+    uint32_t caps;
+    uint32_t caps2;
+    uint32_t caps3;
+    uint32_t caps4;
+    uint32_t reserved2;
+};
+
+// NOTE: follows the header when the pixel format fourcc is "DX10"
+struct DdsHeaderDx10 {
+    uint32_t dxgi_format;
+    uint32_t resource_dimension;
+    uint32_t misc_flag;
+    uint32_t array_size;
+    uint32_t misc_flags2;
+};
+
+static const unsigned char ktx2_identifier[12] = {0xab, 'K', 'T', 'X', ' ', '2', '0', 0xbb, '\r', '\n', 0x1a, '\n'};
+
+struct Ktx2Header {
+    unsigned char identifier[12];
+    uint32_t vk_format;
+    uint32_t type_size;
+    uint32_t pixel_width;
+    uint32_t pixel_height;
+    uint32_t pixel_depth;
+    uint32_t layer_count;
+    uint32_t face_count;
+    uint32_t level_count; // NOTE: 0 means the levels are meant to be generated, only the top one is there
+    uint32_t supercompression_scheme;
+    uint32_t dfd_byte_offset;
+    uint32_t dfd_byte_length;
+    uint32_t kvd_byte_offset;
+    uint32_t kvd_byte_length;
+    uint64_t sgd_byte_offset;
+    uint64_t sgd_byte_length;
+};
+
+// NOTE: one per level right after the header, the top level first
+struct Ktx2Level {
+    uint64_t byte_offset;
+    uint64_t byte_length;
+    uint64_t uncompressed_byte_length;
+};
+
+static void
+texture_formats_detect(void) {
+    for (uint32_t i = 0; i < TEXTURE_FORMAT_COUNT; i++) {
+        const char* extension = texture_format_infos[i].extension;
+        texture_format_supported[i] = !extension || gl_has_extension(extension);
+    }
+    // NOTE: core since 4.3 for ES compatibility, but only mobile gpus sample it. desktop drivers store it
+    // as rgba8 behind our back, transcoding it to BC7 takes a quarter of that
+    texture_format_supported[TEXTURE_FORMAT_ETC2_RGB8] = false;
+    texture_format_supported[TEXTURE_FORMAT_ETC2_RGBA8] = false;
+}
+
+static size_t
+texture_level_size(enum TextureFormat format, uint32_t width, uint32_t height) {
+    const struct TextureFormatInfo* info = &texture_format_infos[format];
+    size_t blocks_x = (width + info->block_width - 1) / info->block_width;
+    size_t blocks_y = (height + info->block_height - 1) / info->block_height;
+    return blocks_x * blocks_y * info->block_size;
+}
+
+static bool
+texture_file_set_levels(struct TextureFile* file, const unsigned char* first_level, size_t available_size) {
+    if (file->width == 0 || file->height == 0 || file->level_count == 0) {
+        return false;
+    }
+    if (file->level_count > mip_level_count(file->width, file->height)) {
+        return false;
+    }
+    const unsigned char* level = first_level;
+    for (uint32_t i = 0; i < file->level_count; i++) {
+        size_t level_size = texture_level_size(file->format, mip_level_extent(file->width, i), mip_level_extent(file->height, i));
+        if (level_size > available_size) {
+            return false;
+        }
+        file->levels[i] = level;
+        file->level_sizes[i] = level_size;
+        level += level_size;
+        available_size -= level_size;
+    }
+    return true;
+}
+
+// NOTE: single 2d textures only, no arrays, cube maps or volumes
+static bool
+texture_file_parse_dds(struct TextureFile* file, const void* data, size_t size) {
+    if (size < sizeof(struct DdsHeader)) {
+        return false;
+    }
+    const struct DdsHeader* header = data;
+    const struct DdsPixelFormat* pixel_format = &header->pixel_format;
+    if (header->size != sizeof(struct DdsHeader) - sizeof(header->magic) || pixel_format->size != sizeof(struct DdsPixelFormat)) {
+        return false;
+    }
+    if (header->caps2 & (DDS_CAPS2_CUBEMAP | DDS_CAPS2_VOLUME)) {
+        return false;
+    }
+
+    size_t data_offset = sizeof(struct DdsHeader);
+    bool known_format = true;
+    if ((pixel_format->flags & DDS_PIXEL_FORMAT_FOURCC) && pixel_format->four_cc == DDS_FOURCC('D', 'X', '1', '0')) {
+        if (size < sizeof(struct DdsHeader) + sizeof(struct DdsHeaderDx10)) {
+            return false;
+        }
+        const struct DdsHeaderDx10* header_dx10 = (const struct DdsHeaderDx10*)(header + 1);
+        if (header_dx10->resource_dimension != DDS_RESOURCE_DIMENSION_TEXTURE2D || header_dx10->array_size > 1) {
+            return false;
+        }
+        data_offset += sizeof(struct DdsHeaderDx10);
+        // NOTE: `DXGI_FORMAT` values
+        switch (header_dx10->dxgi_format) {
+            case 28: file->format = TEXTURE_FORMAT_RGBA8; break;
+            case 29: file->format = TEXTURE_FORMAT_RGBA8; file->srgb = true; break;
+            case 71: file->format = TEXTURE_FORMAT_BC1; break;
+            case 72: file->format = TEXTURE_FORMAT_BC1; file->srgb = true; break;
+            case 77: file->format = TEXTURE_FORMAT_BC3; break;
+            case 78: file->format = TEXTURE_FORMAT_BC3; file->srgb = true; break;
+            case 80: file->format = TEXTURE_FORMAT_BC4; break;
+            case 83: file->format = TEXTURE_FORMAT_BC5; break;
+            case 98: file->format = TEXTURE_FORMAT_BC7; break;
+            case 99: file->format = TEXTURE_FORMAT_BC7; file->srgb = true; break;
+            default: known_format = false; break;
+        }
+    } else if (pixel_format->flags & DDS_PIXEL_FORMAT_FOURCC) {
+        switch (pixel_format->four_cc) {
+            case DDS_FOURCC('D', 'X', 'T', '1'): file->format = TEXTURE_FORMAT_BC1; break;
+            case DDS_FOURCC('D', 'X', 'T', '5'): file->format = TEXTURE_FORMAT_BC3; break;
+            case DDS_FOURCC('A', 'T', 'I', '1'):
+            case DDS_FOURCC('B', 'C', '4', 'U'): file->format = TEXTURE_FORMAT_BC4; break;
+            case DDS_FOURCC('A', 'T', 'I', '2'):
+            case DDS_FOURCC('B', 'C', '5', 'U'): file->format = TEXTURE_FORMAT_BC5; break;
+            default: known_format = false; break;
+        }
+    } else {
+        known_format =
+            (pixel_format->flags & DDS_PIXEL_FORMAT_RGB) &&
+            pixel_format->rgb_bit_count == 32 &&
+            pixel_format->masks[0] == 0x000000ff &&
+            pixel_format->masks[1] == 0x0000ff00 &&
+            pixel_format->masks[2] == 0x00ff0000 &&
+            pixel_format->masks[3] == 0xff000000;
+        file->format = TEXTURE_FORMAT_RGBA8;
+    }
+    if (!known_format) {
+        return false;
+    }
+
+    file->width = header->width;
+    file->height = header->height;
+    file->level_count = header->mip_map_count > 0 ? header->mip_map_count : 1;
+    return texture_file_set_levels(file, (const unsigned char*)data + data_offset, size - data_offset);
+}
+
+// NOTE: single 2d textures only and no supercompression (basis universal or zstd)
+static bool
+texture_file_parse_ktx2(struct TextureFile* file, const void* data, size_t size) {
+    if (size < sizeof(struct Ktx2Header)) {
+        return false;
+    }
+    const struct Ktx2Header* header = data;
+    bool valid_header =
+        header->pixel_depth == 0 &&
+        header->layer_count == 0 &&
+        header->face_count == 1 &&
+        header->supercompression_scheme == 0;
+    if (!valid_header) {
+        return false;
+    }
+
+    // NOTE: `VkFormat` values
+    bool known_format = true;
+    switch (header->vk_format) {
+        case 37: file->format = TEXTURE_FORMAT_RGBA8; break;
+        case 43: file->format = TEXTURE_FORMAT_RGBA8; file->srgb = true; break;
+        case 131: // NOTE: bc1 rgb
+        case 133: file->format = TEXTURE_FORMAT_BC1; break;
+        case 132:
+        case 134: file->format = TEXTURE_FORMAT_BC1; file->srgb = true; break;
+        case 137: file->format = TEXTURE_FORMAT_BC3; break;
+        case 138: file->format = TEXTURE_FORMAT_BC3; file->srgb = true; break;
+        case 139: file->format = TEXTURE_FORMAT_BC4; break;
+        case 141: file->format = TEXTURE_FORMAT_BC5; break;
+        case 145: file->format = TEXTURE_FORMAT_BC7; break;
+        case 146: file->format = TEXTURE_FORMAT_BC7; file->srgb = true; break;
+        case 147: file->format = TEXTURE_FORMAT_ETC2_RGB8; break;
+        case 148: file->format = TEXTURE_FORMAT_ETC2_RGB8; file->srgb = true; break;
+        case 151: file->format = TEXTURE_FORMAT_ETC2_RGBA8; break;
+        case 152: file->format = TEXTURE_FORMAT_ETC2_RGBA8; file->srgb = true; break;
+        case 157: file->format = TEXTURE_FORMAT_ASTC_4X4; break;
+        case 158: file->format = TEXTURE_FORMAT_ASTC_4X4; file->srgb = true; break;
+        case 165: file->format = TEXTURE_FORMAT_ASTC_6X6; break;
+        case 166: file->format = TEXTURE_FORMAT_ASTC_6X6; file->srgb = true; break;
+        case 171: file->format = TEXTURE_FORMAT_ASTC_8X8; break;
+        case 172: file->format = TEXTURE_FORMAT_ASTC_8X8; file->srgb = true; break;
+        default: known_format = false; break;
+    }
+    if (!known_format) {
+        return false;
+    }
+
+    file->width = header->pixel_width;
+    file->height = header->pixel_height;
+    file->level_count = header->level_count > 0 ? header->level_count : 1;
+    if (file->width == 0 || file->height == 0 || file->level_count > mip_level_count(file->width, file->height)) {
+        return false;
+    }
+    if (size - sizeof(struct Ktx2Header) < file->level_count * sizeof(struct Ktx2Level)) {
+        return false;
+    }
+    const struct Ktx2Level* levels = (const struct Ktx2Level*)(header + 1);
+    for (uint32_t i = 0; i < file->level_count; i++) {
+        size_t level_size = texture_level_size(file->format, mip_level_extent(file->width, i), mip_level_extent(file->height, i));
+        if (levels[i].byte_length != level_size || !mesh_file_range_is_valid(levels[i].byte_offset, levels[i].byte_length, 1, size)) {
+            return false;
+        }
+        file->levels[i] = (const unsigned char*)data + levels[i].byte_offset;
+        file->level_sizes[i] = level_size;
+    }
+    return true;
+}
+
+// NOTE: tells the container apart by its magic
+static bool
+texture_file_parse(struct TextureFile* file, const void* data, size_t size) {
+    memset(file, 0, sizeof(*file));
+    if (size >= sizeof(ktx2_identifier) && memcmp(data, ktx2_identifier, sizeof(ktx2_identifier)) == 0) {
+        return texture_file_parse_ktx2(file, data, size);
+    }
+    if (size >= sizeof(uint32_t) && *(const uint32_t*)data == DDS_MAGIC) {
+        return texture_file_parse_dds(file, data, size);
+    }
+    return false;
+}
+
+// NOTE: 16 rgba8 texels in rows of 4. bc3 color blocks are always in four color mode
+static void
+bc1_decode_block(const unsigned char* block, unsigned char* texels, bool four_colors) {
+    uint32_t endpoints[2] = {
+        (uint32_t)block[0] | (uint32_t)block[1] << 8,
+        (uint32_t)block[2] | (uint32_t)block[3] << 8,
+    };
+    unsigned char palette[4][4];
+    for (uint32_t i = 0; i < 2; i++) {
+        uint32_t r = endpoints[i] >> 11 & 31;
+        uint32_t g = endpoints[i] >> 5 & 63;
+        uint32_t b = endpoints[i] & 31;
+        palette[i][0] = (unsigned char)(r << 3 | r >> 2);
+        palette[i][1] = (unsigned char)(g << 2 | g >> 4);
+        palette[i][2] = (unsigned char)(b << 3 | b >> 2);
+        palette[i][3] = 255;
+    }
+    for (uint32_t c = 0; c < 4; c++) {
+        if (four_colors || endpoints[0] > endpoints[1]) {
+            palette[2][c] = (unsigned char)((2 * palette[0][c] + palette[1][c] + 1) / 3);
+            palette[3][c] = (unsigned char)((palette[0][c] + 2 * palette[1][c] + 1) / 3);
+        } else {
+            // NOTE: three colors and transparent black
+            palette[2][c] = (unsigned char)((palette[0][c] + palette[1][c] + 1) / 2);
+            palette[3][c] = 0;
+        }
+    }
+    uint32_t indices = (uint32_t)block[4] | (uint32_t)block[5] << 8 | (uint32_t)block[6] << 16 | (uint32_t)block[7] << 24;
+    for (uint32_t i = 0; i < 16; i++) {
+        memcpy(texels + i * 4, palette[indices >> (2 * i) & 3], 4);
+    }
+}
+
+// NOTE: writes one channel of 16 rgba8 texels, the alpha of bc3 and the channels of bc4 and bc5
+static void
+bc4_decode_block(const unsigned char* block, unsigned char* texels, uint32_t channel) {
+    uint32_t values[8] = {block[0], block[1]};
+    if (values[0] > values[1]) {
+        for (uint32_t i = 1; i < 7; i++) {
+            values[i + 1] = ((7 - i) * values[0] + i * values[1] + 3) / 7;
+        }
+    } else {
+        for (uint32_t i = 1; i < 5; i++) {
+            values[i + 1] = ((5 - i) * values[0] + i * values[1] + 2) / 5;
+        }
+        values[6] = 0;
+        values[7] = 255;
+    }
+    uint64_t indices = 0;
+    for (uint32_t i = 0; i < 6; i++) {
+        indices |= (uint64_t)block[2 + i] << (8 * i);
+    }
+    for (uint32_t i = 0; i < 16; i++) {
+        texels[i * 4 + channel] = (unsigned char)values[indices >> (3 * i) & 7];
+    }
+}
+
+static unsigned char
+texture_clamp_byte(int32_t value) {
+    return (unsigned char)(value < 0 ? 0 : value > 255 ? 255 : value);
+}
+
+static const int32_t etc1_modifiers[8][2] = {{2, 8}, {5, 17}, {9, 29}, {13, 42}, {18, 60}, {24, 80}, {33, 106}, {47, 183}};
+static const int32_t etc2_distances[8] = {3, 6, 11, 16, 23, 32, 41, 64};
+static const int32_t eac_modifiers[16][8] = {
+    {-3, -6, -9, -15, 2, 5, 8, 14}, {-3, -7, -10, -13, 2, 6, 9, 12}, {-2, -5, -8, -13, 1, 4, 7, 12}, {-2, -4, -6, -13, 1, 3, 5, 12},
+    {-3, -6, -8, -12, 2, 5, 7, 11}, {-3, -7, -9, -11, 2, 6, 8, 10}, {-4, -7, -8, -11, 3, 6, 7, 10}, {-3, -5, -8, -11, 2, 4, 7, 10},
+    {-2, -6, -8, -10, 1, 5, 7, 9}, {-2, -5, -8, -10, 1, 4, 7, 9}, {-2, -4, -8, -10, 1, 3, 7, 9}, {-2, -5, -7, -10, 1, 4, 6, 9},
+    {-3, -4, -7, -10, 2, 3, 6, 9}, {-1, -2, -3, -10, 0, 1, 2, 9}, {-4, -6, -8, -9, 3, 5, 7, 8}, {-3, -5, -7, -9, 2, 4, 6, 8},
+};
+
+static int32_t
+etc2_extend4(uint32_t value) {
+    return (int32_t)(value << 4 | value);
+}
+
+static int32_t
+etc2_extend5(uint32_t value) {
+    return (int32_t)(value << 3 | value >> 2);
+}
+
+// NOTE: 16 rgba8 texels in rows of 4 with an alpha of 255. the block is big endian and the indices of its
+// texels go down the columns. the differential mode bases that overflow are the T, H and planar modes
+static void
+etc2_decode_block(const unsigned char* block, unsigned char* texels) {
+    uint32_t high = (uint32_t)block[0] << 24 | (uint32_t)block[1] << 16 | (uint32_t)block[2] << 8 | block[3];
+    uint32_t low = (uint32_t)block[4] << 24 | (uint32_t)block[5] << 16 | (uint32_t)block[6] << 8 | block[7];
+    int32_t bases[2][3];
+    int32_t paints[4][3];
+    bool paint_mode = false;
+    if ((high >> 1 & 1) == 0) {
+        for (uint32_t c = 0; c < 3; c++) {
+            bases[0][c] = etc2_extend4(high >> (28 - 8 * c) & 15);
+            bases[1][c] = etc2_extend4(high >> (24 - 8 * c) & 15);
+        }
+    } else {
+        int32_t values[3];
+        int32_t deltas[3];
+        for (uint32_t c = 0; c < 3; c++) {
+            values[c] = (int32_t)(high >> (27 - 8 * c) & 31);
+            deltas[c] = (int32_t)(high >> (24 - 8 * c) & 7);
+            deltas[c] -= deltas[c] >= 4 ? 8 : 0;
+        }
+        if (values[0] + deltas[0] < 0 || values[0] + deltas[0] > 31) {
+            // NOTE: T mode, one color and three around another
+            uint32_t colors[2][3] = {
+                {(high >> 27 & 3) << 2 | (high >> 24 & 3), high >> 20 & 15, high >> 16 & 15},
+                {high >> 12 & 15, high >> 8 & 15, high >> 4 & 15},
+            };
+            int32_t distance = etc2_distances[(high >> 2 & 3) << 1 | (high & 1)];
+            for (uint32_t c = 0; c < 3; c++) {
+                paints[0][c] = etc2_extend4(colors[0][c]);
+                paints[1][c] = etc2_extend4(colors[1][c]) + distance;
+                paints[2][c] = etc2_extend4(colors[1][c]);
+                paints[3][c] = etc2_extend4(colors[1][c]) - distance;
+            }
+            paint_mode = true;
+        } else if (values[1] + deltas[1] < 0 || values[1] + deltas[1] > 31) {
+            // NOTE: H mode, two colors with two around each. the lowest distance bit is their order
+            uint32_t colors[2][3] = {
+                {high >> 27 & 15, (high >> 24 & 7) << 1 | (high >> 20 & 1), (high >> 19 & 1) << 3 | (high >> 15 & 7)},
+                {high >> 11 & 15, high >> 7 & 15, high >> 3 & 15},
+            };
+            uint32_t values0 = colors[0][0] << 8 | colors[0][1] << 4 | colors[0][2];
+            uint32_t values1 = colors[1][0] << 8 | colors[1][1] << 4 | colors[1][2];
+            int32_t distance = etc2_distances[(high >> 2 & 1) << 2 | (high & 1) << 1 | (values0 >= values1 ? 1 : 0)];
+            for (uint32_t c = 0; c < 3; c++) {
+                paints[0][c] = etc2_extend4(colors[0][c]) + distance;
+                paints[1][c] = etc2_extend4(colors[0][c]) - distance;
+                paints[2][c] = etc2_extend4(colors[1][c]) + distance;
+                paints[3][c] = etc2_extend4(colors[1][c]) - distance;
+            }
+            paint_mode = true;
+        } else if (values[2] + deltas[2] < 0 || values[2] + deltas[2] > 31) {
+            // NOTE: planar mode, a color at the origin and at the ends of both axes
+            uint32_t origin[3] = {
+                high >> 25 & 63,
+                (high >> 24 & 1) << 6 | (high >> 17 & 63),
+                (high >> 16 & 1) << 5 | (high >> 11 & 3) << 3 | (high >> 7 & 7),
+            };
+            uint32_t horizontal[3] = {(high >> 2 & 31) << 1 | (high & 1), low >> 25 & 127, low >> 19 & 63};
+            uint32_t vertical[3] = {low >> 13 & 63, low >> 6 & 127, low & 63};
+            for (uint32_t c = 0; c < 3; c++) {
+                uint32_t bit_count = c == 1 ? 7 : 6;
+                int32_t o = (int32_t)(origin[c] << (8 - bit_count) | origin[c] >> (2 * bit_count - 8));
+                int32_t h = (int32_t)(horizontal[c] << (8 - bit_count) | horizontal[c] >> (2 * bit_count - 8));
+                int32_t v = (int32_t)(vertical[c] << (8 - bit_count) | vertical[c] >> (2 * bit_count - 8));
+                for (uint32_t y = 0; y < 4; y++) {
+                    for (uint32_t x = 0; x < 4; x++) {
+                        int32_t value = (int32_t)x * (h - o) + (int32_t)y * (v - o) + 4 * o + 2;
+                        texels[(y * 4 + x) * 4 + c] = texture_clamp_byte(value >> 2);
+                    }
+                }
+            }
+            for (uint32_t i = 0; i < 16; i++) {
+                texels[i * 4 + 3] = 255;
+            }
+            return;
+        } else {
+            for (uint32_t c = 0; c < 3; c++) {
+                bases[0][c] = etc2_extend5((uint32_t)values[c]);
+                bases[1][c] = etc2_extend5((uint32_t)(values[c] + deltas[c]));
+            }
+        }
+    }
+
+    // NOTE: the two sub blocks are side by side, or on top of each other when flipped
+    bool flip = (high & 1) != 0;
+    for (uint32_t i = 0; i < 16; i++) {
+        uint32_t x = i / 4;
+        uint32_t y = i % 4;
+        uint32_t index = (low >> (16 + i) & 1) << 1 | (low >> i & 1);
+        unsigned char* texel = texels + (y * 4 + x) * 4;
+        for (uint32_t c = 0; c < 3; c++) {
+            if (paint_mode) {
+                texel[c] = texture_clamp_byte(paints[index][c]);
+            } else {
+                uint32_t sub_block = flip ? y / 2 : x / 2;
+                int32_t modifier = etc1_modifiers[high >> (5 - 3 * sub_block) & 7][index & 1];
+                texel[c] = texture_clamp_byte(bases[sub_block][c] + (index & 2 ? -modifier : modifier));
+            }
+        }
+        texel[3] = 255;
+    }
+}
+
+// NOTE: the alpha of ETC2 rgba8 blocks, 3 bit indices big endian and down the columns like the colors
+static void
+eac_alpha_decode_block(const unsigned char* block, unsigned char* texels) {
+    int32_t base = block[0];
+    int32_t multiplier = block[1] >> 4;
+    const int32_t* modifiers = eac_modifiers[block[1] & 15];
+    uint64_t indices = 0;
+    for (uint32_t i = 2; i < 8; i++) {
+        indices = indices << 8 | block[i];
+    }
+    for (uint32_t i = 0; i < 16; i++) {
+        uint32_t x = i / 4;
+        uint32_t y = i % 4;
+        texels[(y * 4 + x) * 4 + 3] = texture_clamp_byte(base + modifiers[indices >> (45 - 3 * i) & 7] * multiplier);
+    }
+}
+
+// NOTE: the 21 ranges of ASTC integer sequences, in increasing order from 0..1 to 0..255: the bits of a
+// value and whether a trit or a quint goes on top of them. sequences pack the trits of 5 values into
+// 8 bits and the quints of 3 into 7
+static const uint8_t astc_ranges[21][3] = {
+    {1, 0, 0}, {0, 1, 0}, {2, 0, 0}, {0, 0, 1}, {1, 1, 0}, {3, 0, 0}, {1, 0, 1}, {2, 1, 0}, {4, 0, 0}, {2, 0, 1}, {3, 1, 0},
+    {5, 0, 0}, {3, 0, 1}, {4, 1, 0}, {6, 0, 0}, {4, 0, 1}, {5, 1, 0}, {7, 0, 0}, {5, 0, 1}, {6, 1, 0}, {8, 0, 0},
+};
+
+#define ASTC_MAX_BLOCK_TEXELS 64 // NOTE: 8x8, the biggest blocks of the formats
+#define ASTC_MAX_WEIGHTS 64
+#define ASTC_MAX_COLOR_VALUES 18
+#define ASTC_MIN_COLOR_RANGE 4 // NOTE: 0..5
+
+static uint32_t
+astc_sequence_bit_count(uint32_t count, uint32_t range) {
+    const uint8_t* info = astc_ranges[range];
+    return count * info[0] + (info[1] ? (8 * count + 4) / 5 : 0) + (info[2] ? (7 * count + 2) / 3 : 0);
+}
+
+// NOTE: `count` bits (at most 32) from `position`, zeros past the end of the block
+static uint32_t
+astc_bits(const uint64_t words[2], uint32_t position, uint32_t count) {
+    if (count == 0 || position >= 128) {
+        return 0;
+    }
+    uint64_t value = position >= 64 ? words[1] >> (position - 64) : position == 0 ? words[0] : words[0] >> position | words[1] << (64 - position);
+    return (uint32_t)(value & ((1ull << count) - 1));
+}
+
+// NOTE: the `bit_count` bits from `position` moved down to bit 0, with everything above them cleared
+static void
+astc_bit_range(const uint64_t words[2], uint32_t position, uint32_t bit_count, uint64_t* range) {
+    range[0] = 0;
+    range[1] = 0;
+    for (uint32_t i = 0; i < bit_count; i += 32) {
+        uint32_t count = bit_count - i < 32 ? bit_count - i : 32;
+        range[i / 64] |= (uint64_t)astc_bits(words, position + i, count) << (i % 64);
+    }
+}
+
+static void
+astc_decode_trits(uint32_t t, uint32_t* trits) {
+    uint32_t c;
+    if ((t >> 2 & 7) == 7) {
+        c = (t >> 5 & 7) << 2 | (t & 3);
+        trits[4] = 2;
+        trits[3] = 2;
+    } else {
+        c = t & 31;
+        if ((t >> 5 & 3) == 3) {
+            trits[4] = 2;
+            trits[3] = t >> 7 & 1;
+        } else {
+            trits[4] = t >> 7 & 1;
+            trits[3] = t >> 5 & 3;
+        }
+    }
+    if ((c & 3) == 3) {
+        trits[2] = 2;
+        trits[1] = c >> 4 & 1;
+        trits[0] = (c >> 3 & 1) << 1 | (c >> 2 & ~c >> 3 & 1);
+    } else if ((c >> 2 & 3) == 3) {
+        trits[2] = 2;
+        trits[1] = 2;
+        trits[0] = c & 3;
+    } else {
+        trits[2] = c >> 4 & 1;
+        trits[1] = c >> 2 & 3;
+        trits[0] = (c >> 1 & 1) << 1 | (c & ~c >> 1 & 1);
+    }
+}
+
+static void
+astc_decode_quints(uint32_t q, uint32_t* quints) {
+    if ((q >> 1 & 3) == 3 && (q >> 5 & 3) == 0) {
+        quints[2] = (q & 1) << 2 | (q >> 4 & ~q & 1) << 1 | (q >> 3 & ~q & 1);
+        quints[1] = 4;
+        quints[0] = 4;
+        return;
+    }
+    uint32_t c;
+    if ((q >> 1 & 3) == 3) {
+        quints[2] = 4;
+        c = (q >> 3 & 3) << 3 | (~q >> 5 & 3) << 1 | (q & 1);
+    } else {
+        quints[2] = q >> 5 & 3;
+        c = q & 31;
+    }
+    if ((c & 7) == 5) {
+        quints[1] = 4;
+        quints[0] = c >> 3 & 3;
+    } else {
+        quints[1] = c >> 3 & 3;
+        quints[0] = c & 7;
+    }
+}
+
+// NOTE: `count` values of `range` from bit 0 of `words`, the trit or quint of a value goes above its bits
+static void
+astc_decode_sequence(const uint64_t words[2], uint32_t count, uint32_t range, uint32_t* values) {
+    uint32_t bit_count = astc_ranges[range][0];
+    uint32_t group_size = astc_ranges[range][1] ? 5 : astc_ranges[range][2] ? 3 : 1;
+    // NOTE: the bits of the trits or quints that go after each value of a group
+    static const uint8_t trit_bits[5] = {2, 2, 1, 2, 1};
+    static const uint8_t quint_bits[3] = {3, 2, 2};
+    uint32_t position = 0;
+    for (uint32_t first = 0; first < count; first += group_size) {
+        uint32_t packed = 0;
+        uint32_t packed_bit_count = 0;
+        for (uint32_t i = 0; i < group_size; i++) {
+            if (first + i < count) {
+                values[first + i] = astc_bits(words, position, bit_count);
+            }
+            position += bit_count;
+            if (group_size > 1) {
+                uint32_t extra = group_size == 5 ? trit_bits[i] : quint_bits[i];
+                packed |= astc_bits(words, position, extra) << packed_bit_count;
+                packed_bit_count += extra;
+                position += extra;
+            }
+        }
+        if (group_size > 1) {
+            uint32_t digits[5];
+            if (group_size == 5) {
+                astc_decode_trits(packed, digits);
+            } else {
+                astc_decode_quints(packed, digits);
+            }
+            for (uint32_t i = 0; i < group_size && first + i < count; i++) {
+                values[first + i] |= digits[i] << bit_count;
+            }
+        }
+    }
+}
+
+// NOTE: the low bits of a value are replicated, trits and quints are scaled and have the low bits mixed in
+static uint32_t
+astc_unquantize_color(uint32_t value, uint32_t range) {
+    uint32_t bit_count = astc_ranges[range][0];
+    if (!astc_ranges[range][1] && !astc_ranges[range][2]) {
+        uint32_t result = value << (8 - bit_count);
+        for (uint32_t filled = bit_count; filled < 8; filled += bit_count) {
+            result |= result >> bit_count;
+        }
+        return result;
+    }
+    uint32_t bits = value & ((1u << bit_count) - 1);
+    uint32_t digit = value >> bit_count;
+    uint32_t high = bits >> 1; // NOTE: the bits above the lowest one
+    uint32_t scale = 0;
+    uint32_t b = 0;
+    if (astc_ranges[range][1]) {
+        static const uint32_t scales[7] = {0, 204, 93, 44, 22, 11, 5};
+        scale = scales[bit_count];
+        b =
+            bit_count == 2 ? high << 8 | high << 4 | high << 2 | high << 1 :
+            bit_count == 3 ? high << 7 | high << 2 | high :
+            bit_count == 4 ? high << 6 | high :
+            bit_count == 5 ? high << 5 | high >> 2 :
+            bit_count == 6 ? high << 4 | high >> 4 :
+            0;
+    } else {
+        static const uint32_t scales[6] = {0, 113, 54, 26, 13, 6};
+        scale = scales[bit_count];
+        b =
+            bit_count == 2 ? high << 8 | high << 3 | high << 2 :
+            bit_count == 3 ? high << 7 | high << 1 | high >> 1 :
+            bit_count == 4 ? high << 6 | high >> 1 :
+            bit_count == 5 ? high << 5 | high >> 3 :
+            0;
+    }
+    uint32_t a = bits & 1 ? 0x1ff : 0;
+    return ((digit * scale + b) ^ a) >> 2 | (a & 0x80);
+}
+
+// NOTE: to 0..64
+static uint32_t
+astc_unquantize_weight(uint32_t value, uint32_t range) {
+    uint32_t bit_count = astc_ranges[range][0];
+    uint32_t result;
+    if (!astc_ranges[range][1] && !astc_ranges[range][2]) {
+        result = value << (6 - bit_count);
+        for (uint32_t filled = bit_count; filled < 6; filled += bit_count) {
+            result |= result >> bit_count;
+        }
+    } else if (bit_count == 0) {
+        static const uint32_t trits[3] = {0, 32, 63};
+        static const uint32_t quints[5] = {0, 16, 32, 47, 63};
+        result = astc_ranges[range][1] ? trits[value] : quints[value];
+    } else {
+        uint32_t bits = value & ((1u << bit_count) - 1);
+        uint32_t digit = value >> bit_count;
+        uint32_t high = bits >> 1;
+        uint32_t scale;
+        uint32_t b;
+        if (astc_ranges[range][1]) {
+            scale = bit_count == 1 ? 50 : bit_count == 2 ? 23 : 11;
+            b = bit_count == 2 ? high << 6 | high << 2 | high : bit_count == 3 ? high << 5 | high : 0;
+        } else {
+            scale = bit_count == 1 ? 28 : 13;
+            b = bit_count == 2 ? high << 6 | high << 1 : 0;
+        }
+        uint32_t a = bits & 1 ? 0x7f : 0;
+        result = ((digit * scale + b) ^ a) >> 2 | (a & 0x20);
+    }
+    return result > 32 ? result + 1 : result;
+}
+
+// NOTE: the size of the weight grid, whether there are two planes of weights and their range. false for
+// the reserved modes
+static bool
+astc_decode_block_mode(uint32_t mode, uint32_t* grid_width, uint32_t* grid_height, bool* dual_plane, uint32_t* weight_range) {
+    uint32_t a = mode >> 5 & 3;
+    uint32_t precision = mode >> 9 & 1;
+    *dual_plane = (mode >> 10 & 1) != 0;
+    uint32_t range;
+    if ((mode & 3) != 0) {
+        range = (mode >> 4 & 1) | (mode & 3) << 1;
+        uint32_t b = mode >> 7 & 3;
+        switch (mode >> 2 & 3) {
+            case 0: *grid_width = b + 4; *grid_height = a + 2; break;
+            case 1: *grid_width = b + 8; *grid_height = a + 2; break;
+            case 2: *grid_width = a + 2; *grid_height = b + 8; break;
+            default:
+                if ((mode >> 8 & 1) == 0) {
+                    *grid_width = a + 2;
+                    *grid_height = (b & 1) + 6;
+                } else {
+                    *grid_width = (b & 1) + 2;
+                    *grid_height = a + 2;
+                }
+                break;
+        }
+    } else {
+        range = (mode >> 4 & 1) | (mode >> 2 & 3) << 1;
+        uint32_t b = mode >> 9 & 3;
+        switch (mode >> 7 & 3) {
+            case 0: *grid_width = 12; *grid_height = a + 2; break;
+            case 1: *grid_width = a + 2; *grid_height = 12; break;
+            case 2:
+                *grid_width = a + 6;
+                *grid_height = b + 6;
+                *dual_plane = false;
+                precision = 0;
+                break;
+            default:
+                if (a > 1) {
+                    return false;
+                }
+                *grid_width = a == 0 ? 6 : 10;
+                *grid_height = a == 0 ? 10 : 6;
+                break;
+        }
+    }
+    if (range < 2) {
+        return false;
+    }
+    *weight_range = precision * 6 + range - 2;
+    return true;
+}
+
+static uint32_t
+astc_hash52(uint32_t p) {
+    p ^= p >> 15;
+    p -= p << 17;
+    p += p << 7;
+    p += p << 4;
+    p ^= p >> 5;
+    p += p << 16;
+    p ^= p >> 7;
+    p ^= p >> 3;
+    p ^= p << 6;
+    p ^= p >> 17;
+    return p;
+}
+
+// NOTE: the partition of a texel is picked by a hash of the seed and its position, blocks of less than 31
+// texels use twice their coordinates
+static uint32_t
+astc_select_partition(uint32_t seed, uint32_t x, uint32_t y, uint32_t partition_count, bool small_block) {
+    if (small_block) {
+        x <<= 1;
+        y <<= 1;
+    }
+    seed += (partition_count - 1) * 1024;
+    uint32_t random = astc_hash52(seed);
+    uint32_t seeds[8];
+    for (uint32_t i = 0; i < 8; i++) {
+        seeds[i] = random >> (4 * i) & 15;
+        seeds[i] *= seeds[i];
+    }
+    uint32_t shift1;
+    uint32_t shift2;
+    if (seed & 1) {
+        shift1 = seed & 2 ? 4 : 5;
+        shift2 = partition_count == 3 ? 6 : 5;
+    } else {
+        shift1 = partition_count == 3 ? 6 : 5;
+        shift2 = seed & 2 ? 4 : 5;
+    }
+    uint32_t sums[4] = {
+        ((seeds[0] >> shift1) * x + (seeds[1] >> shift2) * y + (random >> 14)) & 63,
+        ((seeds[2] >> shift1) * x + (seeds[3] >> shift2) * y + (random >> 10)) & 63,
+        ((seeds[4] >> shift1) * x + (seeds[5] >> shift2) * y + (random >> 6)) & 63,
+        ((seeds[6] >> shift1) * x + (seeds[7] >> shift2) * y + (random >> 2)) & 63,
+    };
+    if (partition_count < 4) {
+        sums[3] = 0;
+    }
+    if (partition_count < 3) {
+        sums[2] = 0;
+    }
+    if (sums[0] >= sums[1] && sums[0] >= sums[2] && sums[0] >= sums[3]) {
+        return 0;
+    }
+    if (sums[1] >= sums[2] && sums[1] >= sums[3]) {
+        return 1;
+    }
+    return sums[2] >= sums[3] ? 2 : 3;
+}
+
+// NOTE: moves the top bit of `b` into `a` and makes `b` a signed 6 bit offset
+static void
+astc_bit_transfer_signed(int32_t* a, int32_t* b) {
+    *a = *a >> 1 | (*b & 0x80);
+    *b = *b >> 1 & 0x3f;
+    *b -= *b & 0x20 ? 0x40 : 0;
+}
+
+// NOTE: averages red and green towards blue, for endpoints whose order was swapped to say so
+static void
+astc_blue_contract(int32_t* color) {
+    color[0] = (color[0] + color[2]) >> 1;
+    color[1] = (color[1] + color[2]) >> 1;
+}
+
+// NOTE: the two rgba endpoints of a partition from its values (0..255). false for the HDR modes
+static bool
+astc_decode_endpoints(uint32_t mode, const uint32_t* values, int32_t endpoints[2][4]) {
+    int32_t v[8];
+    for (uint32_t i = 0; i < 2 * (mode / 4 + 1); i++) {
+        v[i] = (int32_t)values[i];
+    }
+    bool contract = false;
+    switch (mode) {
+        case 0: // NOTE: luminance
+            for (uint32_t i = 0; i < 2; i++) {
+                endpoints[i][0] = endpoints[i][1] = endpoints[i][2] = v[i];
+                endpoints[i][3] = 255;
+            }
+            break;
+        case 1: { // NOTE: luminance, base and offset
+            int32_t l0 = v[0] >> 2 | (v[1] & 0xc0);
+            int32_t l1 = l0 + (v[1] & 0x3f);
+            l1 = l1 > 255 ? 255 : l1;
+            endpoints[0][0] = endpoints[0][1] = endpoints[0][2] = l0;
+            endpoints[1][0] = endpoints[1][1] = endpoints[1][2] = l1;
+            endpoints[0][3] = endpoints[1][3] = 255;
+        } break;
+        case 4: // NOTE: luminance and alpha
+            for (uint32_t i = 0; i < 2; i++) {
+                endpoints[i][0] = endpoints[i][1] = endpoints[i][2] = v[i];
+                endpoints[i][3] = v[2 + i];
+            }
+            break;
+        case 5: // NOTE: luminance and alpha, base and offset
+            astc_bit_transfer_signed(&v[0], &v[1]);
+            astc_bit_transfer_signed(&v[2], &v[3]);
+            endpoints[0][0] = endpoints[0][1] = endpoints[0][2] = v[0];
+            endpoints[0][3] = v[2];
+            endpoints[1][0] = endpoints[1][1] = endpoints[1][2] = v[0] + v[1];
+            endpoints[1][3] = v[2] + v[3];
+            break;
+        case 6: // NOTE: rgb and a scale for the first endpoint
+            for (uint32_t c = 0; c < 3; c++) {
+                endpoints[0][c] = v[c] * v[3] >> 8;
+                endpoints[1][c] = v[c];
+            }
+            endpoints[0][3] = endpoints[1][3] = 255;
+            break;
+        case 8: // NOTE: rgb
+        case 12: { // NOTE: rgba
+            contract = v[1] + v[3] + v[5] < v[0] + v[2] + v[4];
+            for (uint32_t i = 0; i < 2; i++) {
+                uint32_t source = contract ? 1 - i : i;
+                for (uint32_t c = 0; c < 3; c++) {
+                    endpoints[i][c] = v[2 * c + source];
+                }
+                endpoints[i][3] = mode == 12 ? v[6 + source] : 255;
+            }
+        } break;
+        case 9: // NOTE: rgb, base and offset
+        case 13: { // NOTE: rgba, base and offset
+            uint32_t channel_count = mode == 13 ? 4 : 3;
+            for (uint32_t c = 0; c < channel_count; c++) {
+                astc_bit_transfer_signed(&v[2 * c], &v[2 * c + 1]);
+            }
+            contract = v[1] + v[3] + v[5] < 0;
+            for (uint32_t c = 0; c < 4; c++) {
+                int32_t base = c < channel_count ? v[2 * c] : 255;
+                int32_t offset = c < channel_count ? v[2 * c + 1] : 0;
+                endpoints[contract ? 1 : 0][c] = base;
+                endpoints[contract ? 0 : 1][c] = base + offset;
+            }
+        } break;
+        case 10: // NOTE: rgb and a scale for the first endpoint, and two alphas
+            for (uint32_t c = 0; c < 3; c++) {
+                endpoints[0][c] = v[c] * v[3] >> 8;
+                endpoints[1][c] = v[c];
+            }
+            endpoints[0][3] = v[4];
+            endpoints[1][3] = v[5];
+            break;
+        default:
+            return false;
+    }
+    for (uint32_t i = 0; i < 2; i++) {
+        if (contract) {
+            astc_blue_contract(endpoints[i]);
+        }
+        for (uint32_t c = 0; c < 4; c++) {
+            endpoints[i][c] = texture_clamp_byte(endpoints[i][c]);
+        }
+    }
+    return true;
+}
+
+// NOTE: a block whose extent the texture is constant over, only its color is used
+static bool
+astc_decode_void_extent(const uint64_t words[2], uint32_t texel_count, unsigned char* texels) {
+    if (astc_bits(words, 9, 1) != 0 || astc_bits(words, 10, 2) != 3) {
+        return false; // NOTE: HDR, reserved bits
+    }
+    uint32_t s_low = astc_bits(words, 12, 13);
+    uint32_t s_high = astc_bits(words, 25, 13);
+    uint32_t t_low = astc_bits(words, 38, 13);
+    uint32_t t_high = astc_bits(words, 51, 13);
+    bool all_ones = s_low == 0x1fff && s_high == 0x1fff && t_low == 0x1fff && t_high == 0x1fff;
+    if (!all_ones && (s_low >= s_high || t_low >= t_high)) {
+        return false;
+    }
+    unsigned char color[4];
+    for (uint32_t c = 0; c < 4; c++) {
+        color[c] = (unsigned char)(astc_bits(words, 64 + 16 * c, 16) >> 8);
+    }
+    for (uint32_t i = 0; i < texel_count; i++) {
+        memcpy(texels + i * 4, color, 4);
+    }
+    return true;
+}
+
+// NOTE: see `astc_decode_block`, false for the blocks that decode to the error color
+static bool
+astc_decode_block_rgba(const uint64_t words[2], uint32_t block_width, uint32_t block_height, unsigned char* texels) {
+    uint32_t mode = astc_bits(words, 0, 11);
+    if ((mode & 0x1ff) == 0x1fc) {
+        return astc_decode_void_extent(words, block_width * block_height, texels);
+    }
+    uint32_t grid_width;
+    uint32_t grid_height;
+    bool dual_plane;
+    uint32_t weight_range;
+    if (!astc_decode_block_mode(mode, &grid_width, &grid_height, &dual_plane, &weight_range)) {
+        return false;
+    }
+    uint32_t plane_count = dual_plane ? 2 : 1;
+    uint32_t weight_count = grid_width * grid_height * plane_count;
+    if (grid_width > block_width || grid_height > block_height || weight_count > ASTC_MAX_WEIGHTS) {
+        return false;
+    }
+    uint32_t weight_bit_count = astc_sequence_bit_count(weight_count, weight_range);
+    if (weight_bit_count < 24 || weight_bit_count > 96) {
+        return false;
+    }
+    uint32_t partition_count = astc_bits(words, 11, 2) + 1;
+    if (dual_plane && partition_count == 4) {
+        return false;
+    }
+
+    // NOTE: with several partitions their endpoint modes are either all the same or of two neighbouring
+    // classes, with the bits that don't fit the header right below the weights
+    uint32_t endpoint_modes[4];
+    uint32_t seed = 0;
+    uint32_t color_start = 17;
+    uint32_t color_end = 128 - weight_bit_count;
+    if (partition_count == 1) {
+        endpoint_modes[0] = astc_bits(words, 13, 4);
+    } else {
+        seed = astc_bits(words, 13, 10);
+        color_start = 29;
+        uint32_t encoded = astc_bits(words, 23, 6);
+        if ((encoded & 3) == 0) {
+            for (uint32_t i = 0; i < partition_count; i++) {
+                endpoint_modes[i] = encoded >> 2 & 15;
+            }
+        } else {
+            uint32_t extra_bit_count = 3 * partition_count - 4;
+            color_end -= extra_bit_count;
+            encoded |= astc_bits(words, color_end, extra_bit_count) << 6;
+            uint32_t base_class = (encoded & 3) - 1;
+            for (uint32_t i = 0; i < partition_count; i++) {
+                uint32_t class = base_class + (encoded >> (2 + i) & 1);
+                endpoint_modes[i] = class << 2 | (encoded >> (2 + partition_count + 2 * i) & 3);
+            }
+        }
+    }
+    uint32_t plane_channel = 0;
+    if (dual_plane) {
+        color_end -= 2;
+        plane_channel = astc_bits(words, color_end, 2);
+    }
+    uint32_t color_value_count = 0;
+    for (uint32_t i = 0; i < partition_count; i++) {
+        color_value_count += 2 * (endpoint_modes[i] / 4 + 1);
+    }
+    if (color_value_count > ASTC_MAX_COLOR_VALUES || color_end <= color_start) {
+        return false;
+    }
+    // NOTE: the endpoints get the largest range that fits the bits left
+    uint32_t color_range = LEN(astc_ranges) - 1;
+    while (color_range >= ASTC_MIN_COLOR_RANGE && astc_sequence_bit_count(color_value_count, color_range) > color_end - color_start) {
+        color_range -= 1;
+    }
+    if (color_range < ASTC_MIN_COLOR_RANGE) {
+        return false;
+    }
+
+    uint64_t sequence[2];
+    uint32_t color_values[ASTC_MAX_COLOR_VALUES];
+    astc_bit_range(words, color_start, astc_sequence_bit_count(color_value_count, color_range), sequence);
+    astc_decode_sequence(sequence, color_value_count, color_range, color_values);
+    for (uint32_t i = 0; i < color_value_count; i++) {
+        color_values[i] = astc_unquantize_color(color_values[i], color_range);
+    }
+    int32_t endpoints[4][2][4];
+    const uint32_t* partition_values = color_values;
+    for (uint32_t i = 0; i < partition_count; i++) {
+        if (!astc_decode_endpoints(endpoint_modes[i], partition_values, endpoints[i])) {
+            return false;
+        }
+        partition_values += 2 * (endpoint_modes[i] / 4 + 1);
+    }
+
+    // NOTE: the weights are read backwards from the end of the block, interleaved between the planes
+    uint64_t reversed[2];
+    for (uint32_t i = 0; i < 2; i++) {
+        uint64_t word = words[1 - i];
+        word = (word >> 1 & 0x5555555555555555ull) | (word & 0x5555555555555555ull) << 1;
+        word = (word >> 2 & 0x3333333333333333ull) | (word & 0x3333333333333333ull) << 2;
+        word = (word >> 4 & 0x0f0f0f0f0f0f0f0full) | (word & 0x0f0f0f0f0f0f0f0full) << 4;
+        word = (word >> 8 & 0x00ff00ff00ff00ffull) | (word & 0x00ff00ff00ff00ffull) << 8;
+        word = (word >> 16 & 0x0000ffff0000ffffull) | (word & 0x0000ffff0000ffffull) << 16;
+        reversed[i] = word >> 32 | word << 32;
+    }
+    astc_bit_range(reversed, 0, weight_bit_count, sequence);
+    uint32_t weight_values[ASTC_MAX_WEIGHTS];
+    astc_decode_sequence(sequence, weight_count, weight_range, weight_values);
+    // NOTE: padded for the texels at the last row and column of the grid, whose next weights count for 0
+    uint32_t weights[2][ASTC_MAX_WEIGHTS + 16] = {0};
+    for (uint32_t i = 0; i < weight_count; i++) {
+        weights[i % plane_count][i / plane_count] = astc_unquantize_weight(weight_values[i], weight_range);
+    }
+
+    // NOTE: grids smaller than the block are interpolated bilinearly in 1/16ths
+    uint32_t scale_x = (1024 + block_width / 2) / (block_width - 1);
+    uint32_t scale_y = (1024 + block_height / 2) / (block_height - 1);
+    for (uint32_t y = 0; y < block_height; y++) {
+        for (uint32_t x = 0; x < block_width; x++) {
+            uint32_t grid_x = (scale_x * x * (grid_width - 1) + 32) >> 6;
+            uint32_t grid_y = (scale_y * y * (grid_height - 1) + 32) >> 6;
+            uint32_t fraction_x = grid_x & 15;
+            uint32_t fraction_y = grid_y & 15;
+            uint32_t w11 = (fraction_x * fraction_y + 8) >> 4;
+            uint32_t w10 = fraction_y - w11;
+            uint32_t w01 = fraction_x - w11;
+            uint32_t w00 = 16 - fraction_x - fraction_y + w11;
+            uint32_t index = (grid_y >> 4) * grid_width + (grid_x >> 4);
+            uint32_t texel_weights[2];
+            for (uint32_t plane = 0; plane < plane_count; plane++) {
+                const uint32_t* w = weights[plane];
+                texel_weights[plane] = (w[index] * w00 + w[index + 1] * w01 + w[index + grid_width] * w10 + w[index + grid_width + 1] * w11 + 8) >> 4;
+            }
+            uint32_t partition = partition_count > 1 ? astc_select_partition(seed, x, y, partition_count, block_width * block_height < 31) : 0;
+            unsigned char* texel = texels + (y * block_width + x) * 4;
+            for (uint32_t c = 0; c < 4; c++) {
+                uint32_t weight = texel_weights[dual_plane && c == plane_channel ? 1 : 0];
+                uint32_t e0 = (uint32_t)endpoints[partition][0][c] * 257;
+                uint32_t e1 = (uint32_t)endpoints[partition][1][c] * 257;
+                uint32_t value = (e0 * (64 - weight) + e1 * weight + 32) >> 6;
+                texel[c] = (unsigned char)(value >> 8);
+            }
+        }
+    }
+    return true;
+}
+
+// NOTE: LDR blocks into rgba8 texels in rows of `block_width`. blocks the format calls errors (and the HDR
+// ones, which the LDR profile doesn't have) decode to magenta
+static void
+astc_decode_block(const unsigned char* block, uint32_t block_width, uint32_t block_height, unsigned char* texels) {
+    uint64_t words[2];
+    memcpy(words, block, sizeof(words));
+    if (!astc_decode_block_rgba(words, block_width, block_height, texels)) {
+        for (uint32_t i = 0; i < block_width * block_height; i++) {
+            memcpy(texels + i * 4, (unsigned char[]){255, 0, 255, 255}, 4);
+        }
+    }
+}
+
+// NOTE: into rgba8 texels, missing channels are 0 and missing alpha is 255 (like sampling them would give)
+static void
+texture_file_decode_level(const struct TextureFile* file, uint32_t level, unsigned char* rgba) {
+    ASSERT(texture_format_infos[file->format].decodable && level < file->level_count);
+    uint32_t width = mip_level_extent(file->width, level);
+    uint32_t height = mip_level_extent(file->height, level);
+    if (file->format == TEXTURE_FORMAT_RGBA8) {
+        memcpy(rgba, file->levels[level], (size_t)width * height * 4);
+        return;
+    }
+
+    const struct TextureFormatInfo* info = &texture_format_infos[file->format];
+    const unsigned char* block = file->levels[level];
+    for (uint32_t block_y = 0; block_y < height; block_y += info->block_height) {
+        for (uint32_t block_x = 0; block_x < width; block_x += info->block_width) {
+            unsigned char texels[ASTC_MAX_BLOCK_TEXELS * 4];
+            if (file->format == TEXTURE_FORMAT_BC1) {
+                bc1_decode_block(block, texels, /* four_colors */ false);
+            } else if (file->format == TEXTURE_FORMAT_BC3) {
+                bc1_decode_block(block + 8, texels, /* four_colors */ true);
+                bc4_decode_block(block, texels, /* channel */ 3);
+            } else if (file->format == TEXTURE_FORMAT_ETC2_RGB8) {
+                etc2_decode_block(block, texels);
+            } else if (file->format == TEXTURE_FORMAT_ETC2_RGBA8) {
+                etc2_decode_block(block + 8, texels);
+                eac_alpha_decode_block(block, texels);
+            } else if (file->format == TEXTURE_FORMAT_ASTC_4X4 || file->format == TEXTURE_FORMAT_ASTC_6X6 || file->format == TEXTURE_FORMAT_ASTC_8X8) {
+                astc_decode_block(block, info->block_width, info->block_height, texels);
+            } else {
+                memset(texels, 0, sizeof(texels));
+                for (uint32_t i = 0; i < 16; i++) {
+                    texels[i * 4 + 3] = 255;
+                }
+                bc4_decode_block(block, texels, /* channel */ 0);
+                if (file->format == TEXTURE_FORMAT_BC5) {
+                    bc4_decode_block(block + 8, texels, /* channel */ 1);
+                }
+            }
+            block += info->block_size;
+
+            // NOTE: blocks at the right and bottom edges can stick out
+            uint32_t copy_width = width - block_x < info->block_width ? width - block_x : info->block_width;
+            uint32_t copy_height = height - block_y < info->block_height ? height - block_y : info->block_height;
+            for (uint32_t y = 0; y < copy_height; y++) {
+                memcpy(rgba + ((size_t)(block_y + y) * width + block_x) * 4, texels + y * info->block_width * 4, copy_width * 4);
+            }
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// texture encoding
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// compresses rgba8 images made at runtime (procedural textures, baked lighting) into BC1, BC3 or BC7
+// blocks before they're uploaded. every block is fit the same way: the endpoints start as the extremes
+// of the texels along their principal axis (range fit), are rounded to what the format can store and
+// every texel picks its closest palette entry. the high quality tier then refits the endpoints with
+// least squares against the picked indices and, for BC7, searches modes 6 (one rgba line), 5 (color and
+// alpha lines of their own, with any channel swapped into alpha) and for opaque blocks 1 (two color
+// lines in one of 64 partitions). picking indices is where the time goes, AVX2 does 8 texels against a
+// palette entry at a time. rows of blocks are split across the job system. the palettes are built the
+// way decoders build them, so the squared errors of the picks add up to the error of the whole image
+// https://learn.microsoft.com/en-us/windows/win32/direct3d11/bc7-format
+// https://fgiesen.wordpress.com/2022/11/08/whats-that-magic-computation-in-stb__refineblock/
+
+enum TextureEncodeQuality {
+    TEXTURE_ENCODE_QUALITY_FAST, // NOTE: range fit, BC7 mode 6 only
+    TEXTURE_ENCODE_QUALITY_HIGH, // NOTE: least squares refit, BC7 mode search
+    TEXTURE_ENCODE_QUALITY_COUNT,
+};
+
+static const char* texture_encode_quality_names[TEXTURE_ENCODE_QUALITY_COUNT] = {"fast", "high"};
+
+static const int32_t bc7_weights2[4] = {0, 21, 43, 64};
+static const int32_t bc7_weights3[8] = {0, 9, 18, 27, 37, 46, 55, 64};
+static const int32_t bc7_weights4[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// NOTE: bit n set when texel n is in the second subset, and the anchor texel of the second subset
+static const uint16_t bc7_partitions2[64] = {
+    0xcccc, 0x8888, 0xeeee, 0xecc8, 0xc880, 0xfeec, 0xfec8, 0xec80, 0xc800, 0xffec, 0xfe80, 0xe800, 0xffe8, 0xff00, 0xfff0, 0xf000,
+    0xf710, 0x008e, 0x7100, 0x08ce, 0x008c, 0x7310, 0x3100, 0x8cce, 0x088c, 0x3110, 0x6666, 0x366c, 0x17e8, 0x0ff0, 0x718e, 0x399c,
+    0xaaaa, 0xf0f0, 0x5a5a, 0x33cc, 0x3c3c, 0x55aa, 0x9696, 0xa55a, 0x73ce, 0x13c8, 0x324c, 0x3bdc, 0x6996, 0xc33c, 0x9966, 0x0660,
+    0x0272, 0x04e4, 0x4e40, 0x2720, 0xc936, 0x936c, 0x39c6, 0x639c, 0x9336, 0x9cc6, 0x817e, 0xe718, 0xccf0, 0x0fcc, 0x7744, 0xee22,
+};
+static const uint8_t bc7_partition2_anchors[64] = {
+    15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15,
+    15, 2, 8, 2, 2, 8, 8, 15, 2, 8, 2, 2, 8, 8, 2, 2,
+    15, 15, 6, 8, 2, 8, 15, 15, 2, 8, 2, 2, 2, 15, 15, 6,
+    6, 2, 6, 8, 15, 15, 2, 2, 15, 15, 15, 15, 15, 2, 2, 15,
+};
+
+// NOTE: the 16 texels of a block as structure of arrays in rows of 4, blocks sticking out of the image
+// repeat its last row and column
+struct BcBlock {
+    int32_t channels[4][16];
+    uint32_t mask; // NOTE: the texels inside the image, the only ones fit and counted in errors
+    bool opaque;
+};
+
+// NOTE: decoded palette entries, also as structure of arrays
+struct BcPalette {
+    int32_t channels[4][16];
+    uint32_t count;
+};
+
+// NOTE: least significant bits first
+struct BcBitWriter {
+    unsigned char* bytes;
+    uint32_t position;
+};
+
+static void
+bc_write_bits(struct BcBitWriter* writer, uint32_t value, uint32_t bit_count) {
+    for (uint32_t i = 0; i < bit_count; i++) {
+        uint32_t position = writer->position + i;
+        writer->bytes[position / 8] |= (unsigned char)(((value >> i) & 1) << (position % 8));
+    }
+    writer->position += bit_count;
+}
+
+static void
+bc_block_load(struct BcBlock* block, const unsigned char* rgba, uint32_t width, uint32_t height, uint32_t block_x, uint32_t block_y) {
+    block->mask = 0;
+    block->opaque = true;
+    for (uint32_t y = 0; y < 4; y++) {
+        uint32_t image_y = block_y * 4 + y < height ? block_y * 4 + y : height - 1;
+        for (uint32_t x = 0; x < 4; x++) {
+            uint32_t image_x = block_x * 4 + x < width ? block_x * 4 + x : width - 1;
+            const unsigned char* texel = rgba + ((size_t)image_y * width + image_x) * 4;
+            for (uint32_t c = 0; c < 4; c++) {
+                block->channels[c][y * 4 + x] = texel[c];
+            }
+            block->mask |= (block_x * 4 + x < width && block_y * 4 + y < height ? 1u : 0u) << (y * 4 + x);
+            block->opaque = block->opaque && texel[3] == 255;
+        }
+    }
+}
+
+// NOTE: every texel gets the palette entry closest to it over `channel_count` channels from `first_channel`
+// (the first one on ties), `errors` gets the squared error of every texel
+static void
+bc_select_indices_scalar(
+    const struct BcBlock* block,
+    const struct BcPalette* palette,
+    uint32_t first_channel,
+    uint32_t channel_count,
+    uint8_t* indices,
+    uint32_t* errors
+) {
+    for (uint32_t i = 0; i < 16; i++) {
+        int32_t best_error = INT32_MAX;
+        uint32_t best = 0;
+        for (uint32_t entry = 0; entry < palette->count; entry++) {
+            int32_t error = 0;
+            for (uint32_t c = first_channel; c < first_channel + channel_count; c++) {
+                int32_t difference = block->channels[c][i] - palette->channels[c][entry];
+                error += difference * difference;
+            }
+            if (error < best_error) {
+                best_error = error;
+                best = entry;
+            }
+        }
+        indices[i] = (uint8_t)best;
+        errors[i] = (uint32_t)best_error;
+    }
+}
+
+#if defined(_M_X64)
+static void
+bc_select_indices_avx2(
+    const struct BcBlock* block,
+    const struct BcPalette* palette,
+    uint32_t first_channel,
+    uint32_t channel_count,
+    uint8_t* indices,
+    uint32_t* errors
+) {
+    for (uint32_t half = 0; half < 2; half++) {
+        __m256i texels[4];
+        for (uint32_t c = first_channel; c < first_channel + channel_count; c++) {
+            texels[c] = _mm256_loadu_si256((const __m256i*)(block->channels[c] + half * 8));
+        }
+        __m256i best_errors = _mm256_set1_epi32(INT32_MAX);
+        __m256i best = _mm256_setzero_si256();
+        for (uint32_t entry = 0; entry < palette->count; entry++) {
+            __m256i error = _mm256_setzero_si256();
+            for (uint32_t c = first_channel; c < first_channel + channel_count; c++) {
+                __m256i difference = _mm256_sub_epi32(texels[c], _mm256_set1_epi32(palette->channels[c][entry]));
+                error = _mm256_add_epi32(error, _mm256_mullo_epi32(difference, difference));
+            }
+            __m256i closer = _mm256_cmpgt_epi32(best_errors, error);
+            best_errors = _mm256_min_epi32(best_errors, error);
+            best = _mm256_blendv_epi8(best, _mm256_set1_epi32((int)entry), closer);
+        }
+        int32_t lane_errors[8];
+        int32_t lane_best[8];
+        _mm256_storeu_si256((__m256i*)lane_errors, best_errors);
+        _mm256_storeu_si256((__m256i*)lane_best, best);
+        for (uint32_t i = 0; i < 8; i++) {
+            indices[half * 8 + i] = (uint8_t)lane_best[i];
+            errors[half * 8 + i] = (uint32_t)lane_errors[i];
+        }
+    }
+}
+#endif
+
+static void
+bc_select_indices(
+    const struct BcBlock* block,
+    const struct BcPalette* palette,
+    uint32_t first_channel,
+    uint32_t channel_count,
+    uint8_t* indices,
+    uint32_t* errors
+) {
+#if defined(_M_X64)
+    if (cpu_features.avx2) {
+        bc_select_indices_avx2(block, palette, first_channel, channel_count, indices, errors);
+        return;
+    }
+#endif
+    bc_select_indices_scalar(block, palette, first_channel, channel_count, indices, errors);
+}
+
+static uint32_t
+bc_masked_error(const uint32_t* errors, uint32_t mask) {
+    uint32_t error = 0;
+    for (uint32_t i = 0; i < 16; i++) {
+        error += (mask >> i & 1) ? errors[i] : 0;
+    }
+    return error;
+}
+
+// NOTE: the extremes of the texels in `mask` along their principal axis over the first `channel_count`
+// channels (power iterations on their covariance)
+static void
+bc_fit_range(const struct BcBlock* block, uint32_t mask, uint32_t channel_count, float endpoints[2][4]) {
+    mask &= block->mask;
+    if (mask == 0) {
+        memset(endpoints, 0, 2 * sizeof(endpoints[0]));
+        return;
+    }
+    float mean[4] = {0};
+    float texel_count = 0.0f;
+    for (uint32_t i = 0; i < 16; i++) {
+        if (mask >> i & 1) {
+            for (uint32_t c = 0; c < channel_count; c++) {
+                mean[c] += (float)block->channels[c][i];
+            }
+            texel_count += 1.0f;
+        }
+    }
+    for (uint32_t c = 0; c < channel_count; c++) {
+        mean[c] /= texel_count;
+    }
+
+    float covariance[4][4] = {0};
+    for (uint32_t i = 0; i < 16; i++) {
+        if (mask >> i & 1) {
+            for (uint32_t a = 0; a < channel_count; a++) {
+                for (uint32_t b = a; b < channel_count; b++) {
+                    covariance[a][b] += ((float)block->channels[a][i] - mean[a]) * ((float)block->channels[b][i] - mean[b]);
+                }
+            }
+        }
+    }
+    float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+    for (uint32_t iteration = 0; iteration < 8; iteration++) {
+        float next[4] = {0};
+        float length = 0.0f;
+        for (uint32_t a = 0; a < channel_count; a++) {
+            for (uint32_t b = 0; b < channel_count; b++) {
+                next[a] += (a <= b ? covariance[a][b] : covariance[b][a]) * axis[b];
+            }
+            length = fabsf(next[a]) > length ? fabsf(next[a]) : length;
+        }
+        if (length < 1e-6f) {
+            break;
+        }
+        for (uint32_t c = 0; c < channel_count; c++) {
+            axis[c] = next[c] / length;
+        }
+    }
+
+    float min_t = FLT_MAX;
+    float max_t = -FLT_MAX;
+    for (uint32_t i = 0; i < 16; i++) {
+        if (mask >> i & 1) {
+            float t = 0.0f;
+            for (uint32_t c = 0; c < channel_count; c++) {
+                t += ((float)block->channels[c][i] - mean[c]) * axis[c];
+            }
+            min_t = t < min_t ? t : min_t;
+            max_t = t > max_t ? t : max_t;
+        }
+    }
+    float axis_length_squared = 0.0f;
+    for (uint32_t c = 0; c < channel_count; c++) {
+        axis_length_squared += axis[c] * axis[c];
+    }
+    for (uint32_t c = 0; c < channel_count; c++) {
+        float scale = axis[c] / axis_length_squared;
+        endpoints[0][c] = mean[c] + min_t * scale;
+        endpoints[1][c] = mean[c] + max_t * scale;
+    }
+}
+
+// NOTE: the endpoints that minimize the squared error of the texels in `mask` with their indices fixed, where
+// index i interpolates `weights[i] / 64` of the way. false when they all use the same weight
+static bool
+bc_fit_least_squares(
+    const struct BcBlock* block,
+    uint32_t mask,
+    uint32_t first_channel,
+    uint32_t channel_count,
+    const uint8_t* indices,
+    const int32_t* weights,
+    float endpoints[2][4]
+) {
+    mask &= block->mask;
+    float aa = 0.0f;
+    float ab = 0.0f;
+    float bb = 0.0f;
+    float ax[4] = {0};
+    float bx[4] = {0};
+    for (uint32_t i = 0; i < 16; i++) {
+        if (mask >> i & 1) {
+            float b = (float)weights[indices[i]] / 64.0f;
+            float a = 1.0f - b;
+            aa += a * a;
+            ab += a * b;
+            bb += b * b;
+            for (uint32_t c = first_channel; c < first_channel + channel_count; c++) {
+                ax[c] += a * (float)block->channels[c][i];
+                bx[c] += b * (float)block->channels[c][i];
+            }
+        }
+    }
+    float determinant = aa * bb - ab * ab;
+    if (fabsf(determinant) < 1e-6f) {
+        return false;
+    }
+    for (uint32_t c = first_channel; c < first_channel + channel_count; c++) {
+        endpoints[0][c] = (bb * ax[c] - ab * bx[c]) / determinant;
+        endpoints[1][c] = (aa * bx[c] - ab * ax[c]) / determinant;
+    }
+    return true;
+}
+
+static int32_t
+bc_clamp_byte(float value) {
+    return value < 0.0f ? 0 : value > 255.0f ? 255 : (int32_t)(value + 0.5f);
+}
+
+// NOTE: the value of `bits` stored bits (expanded like decoders do by repeating the high bits) closest to `value`
+static uint32_t
+bc_quantize(float value, uint32_t bits) {
+    int32_t max = (1 << bits) - 1;
+    int32_t byte = bc_clamp_byte(value);
+    int32_t best = 0;
+    int32_t best_error = INT32_MAX;
+    int32_t guess = (byte * max + 127) / 255;
+    for (int32_t q = guess - 1; q <= guess + 1; q++) {
+        if (q >= 0 && q <= max) {
+            int32_t expanded = q << (8 - bits) | q >> (2 * bits - 8);
+            int32_t error = (expanded - byte) * (expanded - byte);
+            if (error < best_error) {
+                best_error = error;
+                best = q;
+            }
+        }
+    }
+    return (uint32_t)best;
+}
+
+// NOTE: BC7 endpoints with a p bit, `bits` color bits then the p bit as the low bit of `bits + 1` which are
+// then expanded to 8. picks the p bit shared by the `endpoint_count` endpoints with the least error
+static uint32_t
+bc7_quantize_with_p_bit(float endpoints[][4], uint32_t endpoint_count, uint32_t channel_count, uint32_t bits, uint32_t quantized[][4]) {
+    int32_t best_error = INT32_MAX;
+    uint32_t best_p_bit = 0;
+    for (uint32_t p_bit = 0; p_bit < 2; p_bit++) {
+        int32_t error = 0;
+        uint32_t candidate[2][4] = {0};
+        for (uint32_t e = 0; e < endpoint_count; e++) {
+            for (uint32_t c = 0; c < channel_count; c++) {
+                int32_t byte = bc_clamp_byte(endpoints[e][c]);
+                int32_t max = (1 << bits) - 1;
+                int32_t best_q = 0;
+                int32_t best_q_error = INT32_MAX;
+                int32_t guess = ((byte >> (8 - bits - 1)) - (int32_t)p_bit) / 2;
+                for (int32_t q = guess - 1; q <= guess + 1; q++) {
+                    if (q >= 0 && q <= max) {
+                        int32_t stored = q << 1 | (int32_t)p_bit;
+                        int32_t expanded = stored << (7 - bits) | stored >> (2 * bits - 6);
+                        int32_t q_error = (expanded - byte) * (expanded - byte);
+                        if (q_error < best_q_error) {
+                            best_q_error = q_error;
+                            best_q = q;
+                        }
+                    }
+                }
+                candidate[e][c] = (uint32_t)best_q;
+                error += best_q_error;
+            }
+        }
+        if (error < best_error) {
+            best_error = error;
+            best_p_bit = p_bit;
+            memcpy(quantized, candidate, endpoint_count * sizeof(candidate[0]));
+        }
+    }
+    return best_p_bit;
+}
+
+static int32_t
+bc7_expand(uint32_t stored, uint32_t bits) {
+    return (int32_t)(stored << (8 - bits) | stored >> (2 * bits - 8));
+}
+
+static void
+bc7_palette(struct BcPalette* palette, const int32_t endpoints[2][4], uint32_t first_channel, uint32_t channel_count, const int32_t* weights, uint32_t count) {
+    palette->count = count;
+    for (uint32_t i = 0; i < count; i++) {
+        for (uint32_t c = first_channel; c < first_channel + channel_count; c++) {
+            palette->channels[c][i] = ((64 - weights[i]) * endpoints[0][c] + weights[i] * endpoints[1][c] + 32) >> 6;
+        }
+    }
+}
+
+struct Bc1Fit {
+    uint32_t endpoints[2]; // NOTE: 565
+    uint8_t indices[16];
+    uint32_t error;
+};
+
+static void
+bc1_palette(struct BcPalette* palette, const uint32_t endpoints[2]) {
+    int32_t colors[2][3];
+    for (uint32_t i = 0; i < 2; i++) {
+        int32_t r = (int32_t)(endpoints[i] >> 11 & 31);
+        int32_t g = (int32_t)(endpoints[i] >> 5 & 63);
+        int32_t b = (int32_t)(endpoints[i] & 31);
+        colors[i][0] = r << 3 | r >> 2;
+        colors[i][1] = g << 2 | g >> 4;
+        colors[i][2] = b << 3 | b >> 2;
+    }
+    palette->count = 4;
+    for (uint32_t c = 0; c < 3; c++) {
+        palette->channels[c][0] = colors[0][c];
+        palette->channels[c][1] = colors[1][c];
+        palette->channels[c][2] = (2 * colors[0][c] + colors[1][c] + 1) / 3;
+        palette->channels[c][3] = (colors[0][c] + 2 * colors[1][c] + 1) / 3;
+    }
+}
+
+static void
+bc1_fit_endpoints(const struct BcBlock* block, float endpoints[2][4], struct Bc1Fit* fit) {
+    for (uint32_t e = 0; e < 2; e++) {
+        fit->endpoints[e] = bc_quantize(endpoints[e][0], 5) << 11 | bc_quantize(endpoints[e][1], 6) << 5 | bc_quantize(endpoints[e][2], 5);
+    }
+    struct BcPalette palette;
+    bc1_palette(&palette, fit->endpoints);
+    uint32_t errors[16];
+    bc_select_indices(block, &palette, /* first_channel */ 0, /* channel_count */ 3, fit->indices, errors);
+    fit->error = bc_masked_error(errors, block->mask);
+}
+
+// NOTE: always in four color mode, BC3 color blocks don't have the other one
+static uint32_t
+bc1_encode_block(const struct BcBlock* block, enum TextureEncodeQuality quality, unsigned char* output) {
+    // NOTE: index i of the four color palette interpolates this much from the first endpoint, in 64ths
+    static const int32_t weights[4] = {0, 64, 21, 43};
+    float endpoints[2][4];
+    bc_fit_range(block, 0xffff, /* channel_count */ 3, endpoints);
+    struct Bc1Fit fit;
+    bc1_fit_endpoints(block, endpoints, &fit);
+    if (quality == TEXTURE_ENCODE_QUALITY_HIGH) {
+        for (uint32_t iteration = 0; iteration < 2 && fit.error > 0; iteration++) {
+            if (!bc_fit_least_squares(block, 0xffff, /* first_channel */ 0, /* channel_count */ 3, fit.indices, weights, endpoints)) {
+                break;
+            }
+            struct Bc1Fit refit;
+            bc1_fit_endpoints(block, endpoints, &refit);
+            if (refit.error >= fit.error) {
+                break;
+            }
+            fit = refit;
+        }
+    }
+
+    // NOTE: the first endpoint has to be the bigger one for four color mode, equal ones only use index 0
+    uint32_t index_swap = 0;
+    if (fit.endpoints[0] < fit.endpoints[1]) {
+        uint32_t endpoint = fit.endpoints[0];
+        fit.endpoints[0] = fit.endpoints[1];
+        fit.endpoints[1] = endpoint;
+        index_swap = 1;
+    }
+    uint32_t packed_indices = 0;
+    for (uint32_t i = 0; i < 16; i++) {
+        uint32_t index = fit.endpoints[0] == fit.endpoints[1] ? 0 : fit.indices[i] ^ index_swap;
+        packed_indices |= index << (2 * i);
+    }
+    output[0] = (unsigned char)(fit.endpoints[0] & 0xff);
+    output[1] = (unsigned char)(fit.endpoints[0] >> 8);
+    output[2] = (unsigned char)(fit.endpoints[1] & 0xff);
+    output[3] = (unsigned char)(fit.endpoints[1] >> 8);
+    memcpy(output + 4, &packed_indices, 4);
+    return fit.error;
+}
+
+// NOTE: the alpha of BC3 with the eight value mode, plus the six value one (with exact 0 and 255) when high quality
+static uint32_t
+bc3_alpha_encode_block(const struct BcBlock* block, enum TextureEncodeQuality quality, unsigned char* output) {
+    int32_t min = 255;
+    int32_t max = 0;
+    int32_t inner_min = 255;
+    int32_t inner_max = 0;
+    for (uint32_t i = 0; i < 16; i++) {
+        int32_t alpha = block->channels[3][i];
+        min = alpha < min ? alpha : min;
+        max = alpha > max ? alpha : max;
+        if (alpha != 0 && alpha != 255) {
+            inner_min = alpha < inner_min ? alpha : inner_min;
+            inner_max = alpha > inner_max ? alpha : inner_max;
+        }
+    }
+
+    uint32_t best_error = UINT32_MAX;
+    uint32_t mode_count = quality == TEXTURE_ENCODE_QUALITY_HIGH ? 2 : 1;
+    for (uint32_t mode = 0; mode < mode_count; mode++) {
+        // NOTE: the eight value mode needs the first value bigger, the six value mode not bigger
+        int32_t values[2] = {max, min};
+        if (mode == 1) {
+            values[0] = inner_min <= inner_max ? inner_min : 0;
+            values[1] = inner_min <= inner_max ? inner_max : 0;
+        } else if (max == min) {
+            continue;
+        }
+        struct BcPalette palette;
+        palette.count = 8;
+        palette.channels[3][0] = values[0];
+        palette.channels[3][1] = values[1];
+        for (uint32_t i = 1; i < (mode == 0 ? 7u : 5u); i++) {
+            int32_t steps = mode == 0 ? 7 : 5;
+            palette.channels[3][i + 1] = ((steps - (int32_t)i) * values[0] + (int32_t)i * values[1] + steps / 2) / steps;
+        }
+        if (mode == 1) {
+            palette.channels[3][6] = 0;
+            palette.channels[3][7] = 255;
+        }
+        uint8_t indices[16];
+        uint32_t errors[16];
+        bc_select_indices(block, &palette, /* first_channel */ 3, /* channel_count */ 1, indices, errors);
+        uint32_t error = bc_masked_error(errors, block->mask);
+        if (error < best_error) {
+            best_error = error;
+            output[0] = (unsigned char)values[0];
+            output[1] = (unsigned char)values[1];
+            uint64_t packed_indices = 0;
+            for (uint32_t i = 0; i < 16; i++) {
+                packed_indices |= (uint64_t)indices[i] << (3 * i);
+            }
+            for (uint32_t i = 0; i < 6; i++) {
+                output[2 + i] = (unsigned char)(packed_indices >> (8 * i));
+            }
+        }
+    }
+    if (best_error == UINT32_MAX) {
+        // NOTE: constant alpha
+        memset(output, 0, 8);
+        output[0] = (unsigned char)max;
+        output[1] = (unsigned char)max;
+        best_error = 0;
+    }
+    return best_error;
+}
+
+// NOTE: one subset of interpolated endpoints stored with `bits` bits (plus a p bit when `p_bits`)
+struct Bc7Fit {
+    uint32_t quantized[2][4];
+    uint32_t p_bits[2];
+    int32_t endpoints[2][4]; // NOTE: expanded to 8 bits
+    uint8_t indices[16];
+    uint32_t errors[16];
+    uint32_t error; // NOTE: of the texels in the mask
+};
+
+// NOTE: `p_bit_mode` 0 for none, 1 for one per endpoint and 2 for one shared by both
+static void
+bc7_fit_endpoints(
+    const struct BcBlock* block,
+    uint32_t mask,
+    float endpoints[2][4],
+    uint32_t first_channel,
+    uint32_t channel_count,
+    uint32_t bits,
+    uint32_t p_bit_mode,
+    const int32_t* weights,
+    uint32_t weight_count,
+    struct Bc7Fit* fit
+) {
+    if (p_bit_mode == 0) {
+        for (uint32_t e = 0; e < 2; e++) {
+            for (uint32_t c = first_channel; c < first_channel + channel_count; c++) {
+                fit->quantized[e][c] = bc_quantize(endpoints[e][c], bits);
+                fit->endpoints[e][c] = bc7_expand(fit->quantized[e][c], bits);
+            }
+        }
+    } else {
+        ASSERT(first_channel == 0);
+        uint32_t endpoint_count = p_bit_mode == 1 ? 1 : 2;
+        for (uint32_t e = 0; e < 2; e += endpoint_count) {
+            uint32_t p_bit = bc7_quantize_with_p_bit(endpoints + e, endpoint_count, channel_count, bits, fit->quantized + e);
+            for (uint32_t k = e; k < e + endpoint_count; k++) {
+                fit->p_bits[k] = p_bit;
+                for (uint32_t c = 0; c < channel_count; c++) {
+                    fit->endpoints[k][c] = bc7_expand(fit->quantized[k][c] << 1 | p_bit, bits + 1);
+                }
+            }
+        }
+    }
+    struct BcPalette palette;
+    bc7_palette(&palette, fit->endpoints, first_channel, channel_count, weights, weight_count);
+    bc_select_indices(block, &palette, first_channel, channel_count, fit->indices, fit->errors);
+    fit->error = bc_masked_error(fit->errors, mask & block->mask);
+}
+
+static void
+bc7_fit(
+    const struct BcBlock* block,
+    uint32_t mask,
+    uint32_t first_channel,
+    uint32_t channel_count,
+    uint32_t bits,
+    uint32_t p_bit_mode,
+    const int32_t* weights,
+    uint32_t weight_count,
+    uint32_t refine_count,
+    struct Bc7Fit* fit
+) {
+    float endpoints[2][4];
+    if (first_channel == 3) {
+        // NOTE: a single channel line is just its range
+        endpoints[0][3] = 255.0f;
+        endpoints[1][3] = 0.0f;
+        for (uint32_t i = 0; i < 16; i++) {
+            if ((mask & block->mask) >> i & 1) {
+                float value = (float)block->channels[3][i];
+                endpoints[0][3] = value < endpoints[0][3] ? value : endpoints[0][3];
+                endpoints[1][3] = value > endpoints[1][3] ? value : endpoints[1][3];
+            }
+        }
+    } else {
+        bc_fit_range(block, mask, channel_count, endpoints);
+    }
+    bc7_fit_endpoints(block, mask, endpoints, first_channel, channel_count, bits, p_bit_mode, weights, weight_count, fit);
+    for (uint32_t iteration = 0; iteration < refine_count && fit->error > 0; iteration++) {
+        if (!bc_fit_least_squares(block, mask, first_channel, channel_count, fit->indices, weights, endpoints)) {
+            break;
+        }
+        struct Bc7Fit refit;
+        bc7_fit_endpoints(block, mask, endpoints, first_channel, channel_count, bits, p_bit_mode, weights, weight_count, &refit);
+        if (refit.error >= fit->error) {
+            break;
+        }
+        *fit = refit;
+    }
+}
+
+// NOTE: the anchor texel of a subset stores its index without the high bit so it has to be in the low half,
+// otherwise the endpoints are swapped and the indices of the subset flipped
+static void
+bc7_fix_anchor(struct Bc7Fit* fit, uint32_t mask, uint32_t anchor, uint32_t weight_count, uint32_t first_channel, uint32_t channel_count) {
+    if (fit->indices[anchor] < weight_count / 2) {
+        return;
+    }
+    for (uint32_t c = first_channel; c < first_channel + channel_count; c++) {
+        uint32_t quantized = fit->quantized[0][c];
+        fit->quantized[0][c] = fit->quantized[1][c];
+        fit->quantized[1][c] = quantized;
+    }
+    uint32_t p_bit = fit->p_bits[0];
+    fit->p_bits[0] = fit->p_bits[1];
+    fit->p_bits[1] = p_bit;
+    for (uint32_t i = 0; i < 16; i++) {
+        if (mask >> i & 1) {
+            fit->indices[i] = (uint8_t)(weight_count - 1 - fit->indices[i]);
+        }
+    }
+}
+
+static void
+bc7_write_indices(struct BcBitWriter* writer, const uint8_t* indices, uint32_t bits, uint32_t anchor_mask) {
+    for (uint32_t i = 0; i < 16; i++) {
+        bc_write_bits(writer, indices[i], (anchor_mask >> i & 1) ? bits - 1 : bits);
+    }
+}
+
+// NOTE: one rgba line, 7 bit endpoints with a p bit each and 4 bit indices
+static uint32_t
+bc7_encode_mode6(const struct BcBlock* block, uint32_t refine_count, unsigned char* output) {
+    struct Bc7Fit fit = {0};
+    bc7_fit(block, 0xffff, /* first_channel */ 0, /* channel_count */ 4, /* bits */ 7, /* p_bit_mode */ 1, bc7_weights4, 16, refine_count, &fit);
+    bc7_fix_anchor(&fit, 0xffff, /* anchor */ 0, 16, /* first_channel */ 0, /* channel_count */ 4);
+
+    memset(output, 0, 16);
+    struct BcBitWriter writer = {output, 0};
+    bc_write_bits(&writer, 1 << 6, 7);
+    for (uint32_t c = 0; c < 4; c++) {
+        bc_write_bits(&writer, fit.quantized[0][c], 7);
+        bc_write_bits(&writer, fit.quantized[1][c], 7);
+    }
+    bc_write_bits(&writer, fit.p_bits[0], 1);
+    bc_write_bits(&writer, fit.p_bits[1], 1);
+    bc7_write_indices(&writer, fit.indices, 4, /* anchor_mask */ 1);
+    return fit.error;
+}
+
+// NOTE: a color line with 7 bit endpoints and an alpha line with 8 bit ones, 2 bit indices each. rotation
+// 1 to 3 swaps alpha with red, green or blue so that channel gets its own indices
+static uint32_t
+bc7_encode_mode5(const struct BcBlock* block, uint32_t rotation, uint32_t refine_count, unsigned char* output) {
+    struct BcBlock rotated = *block;
+    if (rotation > 0) {
+        memcpy(rotated.channels[rotation - 1], block->channels[3], sizeof(block->channels[3]));
+        memcpy(rotated.channels[3], block->channels[rotation - 1], sizeof(block->channels[3]));
+    }
+    struct Bc7Fit color = {0};
+    struct Bc7Fit alpha = {0};
+    bc7_fit(&rotated, 0xffff, /* first_channel */ 0, /* channel_count */ 3, /* bits */ 7, /* p_bit_mode */ 0, bc7_weights2, 4, refine_count, &color);
+    bc7_fit(&rotated, 0xffff, /* first_channel */ 3, /* channel_count */ 1, /* bits */ 8, /* p_bit_mode */ 0, bc7_weights2, 4, refine_count, &alpha);
+    bc7_fix_anchor(&color, 0xffff, /* anchor */ 0, 4, /* first_channel */ 0, /* channel_count */ 3);
+    bc7_fix_anchor(&alpha, 0xffff, /* anchor */ 0, 4, /* first_channel */ 3, /* channel_count */ 1);
+
+    memset(output, 0, 16);
+    struct BcBitWriter writer = {output, 0};
+    bc_write_bits(&writer, 1 << 5, 6);
+    bc_write_bits(&writer, rotation, 2);
+    for (uint32_t c = 0; c < 3; c++) {
+        bc_write_bits(&writer, color.quantized[0][c], 7);
+        bc_write_bits(&writer, color.quantized[1][c], 7);
+    }
+    bc_write_bits(&writer, alpha.quantized[0][3], 8);
+    bc_write_bits(&writer, alpha.quantized[1][3], 8);
+    bc7_write_indices(&writer, color.indices, 2, /* anchor_mask */ 1);
+    bc7_write_indices(&writer, alpha.indices, 2, /* anchor_mask */ 1);
+    return color.error + alpha.error;
+}
+
+// NOTE: two color lines (opaque blocks only) with 6 bit endpoints, a p bit per line and 3 bit indices.
+// every partition is tried with range fits and the best one refit
+static uint32_t
+bc7_encode_mode1(const struct BcBlock* block, uint32_t refine_count, unsigned char* output) {
+    uint32_t best_partition = 0;
+    uint32_t best_error = UINT32_MAX;
+    for (uint32_t partition = 0; partition < 64; partition++) {
+        uint32_t error = 0;
+        for (uint32_t subset = 0; subset < 2 && error < best_error; subset++) {
+            uint32_t mask = subset == 0 ? ~(uint32_t)bc7_partitions2[partition] & 0xffff : bc7_partitions2[partition];
+            struct Bc7Fit fit;
+            bc7_fit(block, mask, /* first_channel */ 0, /* channel_count */ 3, /* bits */ 6, /* p_bit_mode */ 2, bc7_weights3, 8, /* refine_count */ 0, &fit);
+            error += fit.error;
+        }
+        if (error < best_error) {
+            best_error = error;
+            best_partition = partition;
+        }
+    }
+
+    struct Bc7Fit fits[2];
+    uint8_t indices[16];
+    uint32_t masks[2] = {~(uint32_t)bc7_partitions2[best_partition] & 0xffff, bc7_partitions2[best_partition]};
+    uint32_t anchors[2] = {0, bc7_partition2_anchors[best_partition]};
+    for (uint32_t subset = 0; subset < 2; subset++) {
+        bc7_fit(block, masks[subset], /* first_channel */ 0, /* channel_count */ 3, /* bits */ 6, /* p_bit_mode */ 2, bc7_weights3, 8, refine_count, &fits[subset]);
+        bc7_fix_anchor(&fits[subset], masks[subset], anchors[subset], 8, /* first_channel */ 0, /* channel_count */ 3);
+        for (uint32_t i = 0; i < 16; i++) {
+            if (masks[subset] >> i & 1) {
+                indices[i] = fits[subset].indices[i];
+            }
+        }
+    }
+
+    memset(output, 0, 16);
+    struct BcBitWriter writer = {output, 0};
+    bc_write_bits(&writer, 1 << 1, 2);
+    bc_write_bits(&writer, best_partition, 6);
+    for (uint32_t c = 0; c < 3; c++) {
+        for (uint32_t subset = 0; subset < 2; subset++) {
+            bc_write_bits(&writer, fits[subset].quantized[0][c], 6);
+            bc_write_bits(&writer, fits[subset].quantized[1][c], 6);
+        }
+    }
+    bc_write_bits(&writer, fits[0].p_bits[0], 1);
+    bc_write_bits(&writer, fits[1].p_bits[0], 1);
+    bc7_write_indices(&writer, indices, 3, /* anchor_mask */ 1u | 1u << anchors[1]);
+    return fits[0].error + fits[1].error;
+}
+
+static uint32_t
+bc7_encode_block(const struct BcBlock* block, enum TextureEncodeQuality quality, unsigned char* output) {
+    if (quality == TEXTURE_ENCODE_QUALITY_FAST) {
+        return bc7_encode_mode6(block, /* refine_count */ 0, output);
+    }
+    uint32_t best_error = bc7_encode_mode6(block, /* refine_count */ 2, output);
+    unsigned char candidate[16];
+    for (uint32_t rotation = 0; rotation < 4 && best_error > 0; rotation++) {
+        uint32_t error = bc7_encode_mode5(block, rotation, /* refine_count */ 2, candidate);
+        if (error < best_error) {
+            best_error = error;
+            memcpy(output, candidate, sizeof(candidate));
+        }
+    }
+    if (block->opaque && best_error > 0) {
+        uint32_t error = bc7_encode_mode1(block, /* refine_count */ 2, candidate);
+        if (error < best_error) {
+            best_error = error;
+            memcpy(output, candidate, sizeof(candidate));
+        }
+    }
+    return best_error;
+}
+
+struct TextureEncoding {
+    enum TextureFormat format;
+    enum TextureEncodeQuality quality;
+    const unsigned char* rgba;
+    uint32_t width;
+    uint32_t height;
+    unsigned char* blocks;
+    volatile LONG64 error;
+};
+
+// NOTE: the items are rows of blocks
+static void
+texture_encode_job(void* data, uint32_t first, uint32_t count, uint32_t worker_index) {
+    (void)worker_index;
+    struct TextureEncoding* encoding = data;
+    uint32_t block_size = texture_format_infos[encoding->format].block_size;
+    uint32_t blocks_x = (encoding->width + 3) / 4;
+    uint64_t error = 0;
+    for (uint32_t block_y = first; block_y < first + count; block_y++) {
+        for (uint32_t block_x = 0; block_x < blocks_x; block_x++) {
+            struct BcBlock block;
+            bc_block_load(&block, encoding->rgba, encoding->width, encoding->height, block_x, block_y);
+            unsigned char* output = encoding->blocks + ((size_t)block_y * blocks_x + block_x) * block_size;
+            if (encoding->format == TEXTURE_FORMAT_BC1) {
+                error += bc1_encode_block(&block, encoding->quality, output);
+            } else if (encoding->format == TEXTURE_FORMAT_BC3) {
+                error += bc3_alpha_encode_block(&block, encoding->quality, output);
+                error += bc1_encode_block(&block, encoding->quality, output + 8);
+            } else {
+                error += bc7_encode_block(&block, encoding->quality, output);
+            }
+        }
+    }
+    InterlockedExchangeAdd64(&encoding->error, (LONG64)error);
+}
+
+// NOTE: BC1, BC3 or BC7 into `blocks` (`texture_level_size` bytes). split across the workers of `job_system`
+// when there's one, called from worker 0. returns the summed squared error of the channels the format has
+// (BC1 blocks are opaque, alpha isn't counted)
+static uint64_t
+texture_encode(
+    enum TextureFormat format,
+    enum TextureEncodeQuality quality,
+    const unsigned char* rgba,
+    uint32_t width,
+    uint32_t height,
+    unsigned char* blocks,
+    struct JobSystem* job_system
+) {
+    ASSERT(format == TEXTURE_FORMAT_BC1 || format == TEXTURE_FORMAT_BC3 || format == TEXTURE_FORMAT_BC7);
+    struct TextureEncoding encoding = {
+        .format = format,
+        .quality = quality,
+        .rgba = rgba,
+        .width = width,
+        .height = height,
+        .blocks = blocks,
+        .error = 0,
+    };
+    uint32_t blocks_y = (height + 3) / 4;
+    if (job_system) {
+        volatile LONG counter = 0;
+        job_system_parallel_for(job_system, /* worker_index */ 0, &texture_encode_job, &encoding, blocks_y, /* batch_size */ 1, &counter);
+        job_system_wait(job_system, /* worker_index */ 0, &counter);
+    } else {
+        texture_encode_job(&encoding, /* first */ 0, blocks_y, /* worker_index */ 0);
+    }
+    return (uint64_t)encoding.error;
+}
+
+// NOTE: of a summed squared error over `value_count` channel values
+static double
+texture_encode_psnr(uint64_t error, uint64_t value_count) {
+    if (error == 0) {
+        return INFINITY;
+    }
+    double mean_error = (double)error / (double)value_count;
+    return 10.0 * log10(255.0 * 255.0 / mean_error);
+}
+
+// NOTE: `mip_chain_upload` for textures made with a block compressed format, every level is encoded
+// before it's uploaded. adds the squared error of the levels to `error`, returns their size on the gpu
+static size_t
+mip_chain_upload_encoded(
+    GLuint texture,
+    int32_t layer,
+    const unsigned char* chain,
+    uint32_t width,
+    uint32_t height,
+    uint32_t level_count,
+    enum TextureFormat format,
+    enum TextureEncodeQuality quality,
+    struct JobSystem* job_system,
+    uint64_t* error
+) {
+    GLenum internal_format = texture_format_infos[format].internal_format;
+    unsigned char* blocks = os_alloc(texture_level_size(format, width, height));
+    size_t size = 0;
+    const unsigned char* level = chain;
+    for (uint32_t i = 0; i < level_count; i++) {
+        uint32_t level_width = mip_level_extent(width, i);
+        uint32_t level_height = mip_level_extent(height, i);
+        size_t level_size = texture_level_size(format, level_width, level_height);
+        *error += texture_encode(format, quality, level, level_width, level_height, blocks, job_system);
+        if (layer < 0) {
+            glCompressedTextureSubImage2D(
+                texture,
+                (GLint)i,
+                /* xoffset */ 0,
+                /* yoffset */ 0,
+                (GLsizei)level_width,
+                (GLsizei)level_height,
+                internal_format,
+                (GLsizei)level_size,
+                blocks
+            );
+        } else {
+            glCompressedTextureSubImage3D(
+                texture,
+                (GLint)i,
+                /* xoffset */ 0,
+                /* yoffset */ 0,
+                /* zoffset */ layer,
+                (GLsizei)level_width,
+                (GLsizei)level_height,
+                /* depth */ 1,
+                internal_format,
+                (GLsizei)level_size,
+                blocks
+            );
+        }
+        size += level_size;
+        level += (size_t)level_width * level_height * 4;
+    }
+    os_free(blocks);
+    return size;
+}
+
+#define TEXTURE_TRANSCODE_FORMAT TEXTURE_FORMAT_BC7 // NOTE: for the files whose format isn't supported
+#define TEXTURE_TRANSCODE_QUALITY TEXTURE_ENCODE_QUALITY_HIGH
+
+// NOTE: what `texture_file_sampleable_levels` needs for the file: its top level decoded and every level
+// encoded, nothing when it's uploaded as is
+static size_t
+texture_file_transcode_size(const struct TextureFile* file) {
+    if (texture_format_supported[file->format]) {
+        return 0;
+    }
+    size_t size = (size_t)file->width * file->height * 4;
+    for (uint32_t level = 0; level < file->level_count; level++) {
+        size += texture_level_size(TEXTURE_TRANSCODE_FORMAT, mip_level_extent(file->width, level), mip_level_extent(file->height, level));
+    }
+    return size;
+}
+
+// NOTE: the levels of the file in a format the context can sample, as they are when the format is supported.
+// otherwise every level is decoded and encoded to `TEXTURE_TRANSCODE_FORMAT` into `scratch`
+// (`texture_file_transcode_size` bytes), the file stays block compressed on the gpu. returns the squared
+// error of the encoded levels against the decoded ones
+static uint64_t
+texture_file_sampleable_levels(
+    const struct TextureFile* file,
+    unsigned char* scratch,
+    struct JobSystem* job_system,
+    enum TextureFormat* format,
+    const unsigned char** levels,
+    size_t* level_sizes
+) {
+    if (texture_format_supported[file->format]) {
+        *format = file->format;
+        for (uint32_t level = 0; level < file->level_count; level++) {
+            levels[level] = file->levels[level];
+            level_sizes[level] = file->level_sizes[level];
+        }
+        return 0;
+    }
+
+    ASSERT(texture_format_infos[file->format].decodable && texture_format_supported[TEXTURE_TRANSCODE_FORMAT]);
+    *format = TEXTURE_TRANSCODE_FORMAT;
+    unsigned char* rgba = scratch;
+    unsigned char* blocks = scratch + (size_t)file->width * file->height * 4;
+    uint64_t error = 0;
+    for (uint32_t level = 0; level < file->level_count; level++) {
+        uint32_t level_width = mip_level_extent(file->width, level);
+        uint32_t level_height = mip_level_extent(file->height, level);
+        texture_file_decode_level(file, level, rgba);
+        error += texture_encode(TEXTURE_TRANSCODE_FORMAT, TEXTURE_TRANSCODE_QUALITY, rgba, level_width, level_height, blocks, job_system);
+        levels[level] = blocks;
+        level_sizes[level] = texture_level_size(TEXTURE_TRANSCODE_FORMAT, level_width, level_height);
+        blocks += level_sizes[level];
+    }
+    return error;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// image decoding
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// PNG, JPEG and QOI files decoded to rgba8 for the materials. the formats are sequential streams so an
+// image is decoded whole by one worker, a directory of them is what's split across the job system. every
+// worker has scratch memory for the inflated PNG scanlines or the JPEG component planes, and rows are
+// converted to rgba8 right after they're decoded, while they're still in the cache: rgb rows are expanded
+// 16 texels at a time with byte shuffles and images with alpha can be premultiplied, so filtering and the
+// mip chains don't bleed the color of transparent texels into their neighbours. srgb colors are multiplied
+// in linear light, decoded and encoded back with the mip chain tables 2 texels at a time with AVX2 gathers,
+// linear data (normal maps, masks) as bytes 4 texels at a time with SSE2. PNG covers every color type and
+// bit depth (16 bit samples are rounded to 8), interlaced too. JPEG covers baseline huffman files, gray or
+// YCbCr (RGB with an Adobe marker saying so), with the chroma upsampled by repeating samples; progressive
+// and arithmetic coded files are rejected. checksums (the zlib adler and the PNG chunk crcs) aren't checked
+// https://www.w3.org/TR/png/
+// https://www.rfc-editor.org/rfc/rfc1951
+// https://www.w3.org/Graphics/JPEG/itu-t81.pdf
+// https://qoiformat.org/qoi-specification.pdf
+
+#define IMAGE_MAX_EXTENT 16384
+#define IMAGE_DECODE_PREMULTIPLY 0x1 // NOTE: color channels multiplied by alpha
+#define IMAGE_DECODE_LINEAR 0x2 // NOTE: the color channels aren't srgb and are premultiplied as they are
+
+#define INFLATE_FAST_BITS 10
+#define JPEG_FAST_BITS 9
+#define JPEG_MAX_COMPONENTS 3
+
+enum ImageFormat {
+    IMAGE_FORMAT_PNG,
+    IMAGE_FORMAT_JPEG,
+    IMAGE_FORMAT_QOI,
+    IMAGE_FORMAT_COUNT,
+};
+
+struct ImageInfo {
+    enum ImageFormat format;
+    uint32_t width;
+    uint32_t height;
+    bool alpha; // NOTE: can have texels that aren't opaque, the others are never premultiplied
+    size_t scratch_size; // NOTE: what `image_decode` needs besides the `width * height * 4` bytes it writes
+};
+
+static uint32_t
+image_read_be16(const unsigned char* bytes) {
+    return (uint32_t)bytes[0] << 8 | bytes[1];
+}
+
+static uint32_t
+image_read_be32(const unsigned char* bytes) {
+    return (uint32_t)bytes[0] << 24 | (uint32_t)bytes[1] << 16 | (uint32_t)bytes[2] << 8 | bytes[3];
+}
+
+static void
+image_expand_rgb_scalar(const unsigned char* rgb, unsigned char* rgba, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        rgba[i * 4 + 0] = rgb[i * 3 + 0];
+        rgba[i * 4 + 1] = rgb[i * 3 + 1];
+        rgba[i * 4 + 2] = rgb[i * 3 + 2];
+        rgba[i * 4 + 3] = 255;
+    }
+}
+
+static void
+image_premultiply_scalar(unsigned char* rgba, uint32_t count, bool linear) {
+    for (uint32_t i = 0; i < count; i++) {
+        unsigned char* texel = rgba + (size_t)i * 4;
+        uint32_t alpha = texel[3];
+        if (alpha == 255) {
+            continue;
+        }
+        for (uint32_t c = 0; c < 3; c++) {
+            if (linear) {
+                // NOTE: rounded `texel * alpha / 255`
+                uint32_t product = texel[c] * alpha + 128;
+                texel[c] = (unsigned char)((product + (product >> 8)) >> 8);
+            } else {
+                float value = mip_chain_decode_table[texel[c]] * mip_chain_decode_table[256 + alpha];
+                texel[c] = (unsigned char)mip_chain_encode_table[(uint32_t)(value * (float)(MIP_CHAIN_LINEAR_STEPS - 1) + 0.5f)];
+            }
+        }
+    }
+}
+
+#if defined(_M_X64)
+// NOTE: 16 texels (48 bytes in, 64 out) at a time. the shuffles are SSSE3, which every AVX2 cpu has
+static void
+image_expand_rgb_ssse3(const unsigned char* rgb, unsigned char* rgba, uint32_t count) {
+    __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    __m128i alpha = _mm_set1_epi32((int)0xff000000);
+    uint32_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        const unsigned char* source = rgb + (size_t)i * 3;
+        __m128i first = _mm_loadu_si128((const __m128i*)source);
+        __m128i second = _mm_loadu_si128((const __m128i*)(source + 16));
+        __m128i third = _mm_loadu_si128((const __m128i*)(source + 32));
+        __m128i* destination = (__m128i*)(rgba + (size_t)i * 4);
+        _mm_storeu_si128(destination + 0, _mm_or_si128(_mm_shuffle_epi8(first, shuffle), alpha));
+        _mm_storeu_si128(destination + 1, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(second, first, 12), shuffle), alpha));
+        _mm_storeu_si128(destination + 2, _mm_or_si128(_mm_shuffle_epi8(_mm_alignr_epi8(third, second, 8), shuffle), alpha));
+        _mm_storeu_si128(destination + 3, _mm_or_si128(_mm_shuffle_epi8(_mm_srli_si128(third, 4), shuffle), alpha));
+    }
+    image_expand_rgb_scalar(rgb + (size_t)i * 3, rgba + (size_t)i * 4, count - i);
+}
+
+// NOTE: the same rounding as `image_premultiply_scalar`, 4 texels at a time as 16 bit lanes
+static void
+image_premultiply_linear_sse2(unsigned char* rgba, uint32_t count) {
+    __m128i zero = _mm_setzero_si128();
+    __m128i rounding = _mm_set1_epi16(128);
+    __m128i alpha_mask = _mm_set1_epi32((int)0xff000000);
+    uint32_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128i* texels = (__m128i*)(rgba + (size_t)i * 4);
+        __m128i value = _mm_loadu_si128(texels);
+        __m128i alphas = _mm_and_si128(value, alpha_mask);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(alphas, alpha_mask)) == 0xffff) {
+            continue;
+        }
+        __m128i low = _mm_unpacklo_epi8(value, zero);
+        __m128i high = _mm_unpackhi_epi8(value, zero);
+        __m128i low_alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(low, 0xff), 0xff);
+        __m128i high_alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(high, 0xff), 0xff);
+        low = _mm_add_epi16(_mm_mullo_epi16(low, low_alpha), rounding);
+        high = _mm_add_epi16(_mm_mullo_epi16(high, high_alpha), rounding);
+        low = _mm_srli_epi16(_mm_add_epi16(low, _mm_srli_epi16(low, 8)), 8);
+        high = _mm_srli_epi16(_mm_add_epi16(high, _mm_srli_epi16(high, 8)), 8);
+        _mm_storeu_si128(texels, _mm_or_si128(_mm_andnot_si128(alpha_mask, _mm_packus_epi16(low, high)), alphas));
+    }
+    image_premultiply_scalar(rgba + (size_t)i * 4, count - i, /* linear */ true);
+}
+
+// NOTE: the same math as `image_premultiply_scalar` in the same order so both give the same bytes
+static void
+image_premultiply_srgb_avx2(unsigned char* rgba, uint32_t count) {
+    __m256i alpha_offsets = _mm256_setr_epi32(0, 0, 0, 256, 0, 0, 0, 256);
+    __m256i opaque = _mm256_set1_epi32(255);
+    __m256 linear_steps = _mm256_set1_ps((float)(MIP_CHAIN_LINEAR_STEPS - 1));
+    __m256 half = _mm256_set1_ps(0.5f);
+    uint32_t i = 0;
+    for (; i + 2 <= count; i += 2) {
+        unsigned char* texels = rgba + (size_t)i * 4;
+        uint64_t pair = 0;
+        memcpy(&pair, texels, sizeof(pair));
+        if ((pair & 0xff000000ff000000ull) == 0xff000000ff000000ull) {
+            continue;
+        }
+        __m256i bytes = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)texels));
+        __m256 values = _mm256_i32gather_ps(mip_chain_decode_table, _mm256_add_epi32(bytes, alpha_offsets), 4);
+        __m256 products = _mm256_mul_ps(values, _mm256_shuffle_ps(values, values, _MM_SHUFFLE(3, 3, 3, 3)));
+        __m256i steps = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(products, linear_steps), half));
+        __m256i colors = _mm256_i32gather_epi32((const int*)mip_chain_encode_table, steps, 4);
+        // NOTE: alpha is kept and so is all of an opaque texel
+        __m256i opaque_texels = _mm256_cmpeq_epi32(_mm256_shuffle_epi32(bytes, _MM_SHUFFLE(3, 3, 3, 3)), opaque);
+        __m256i result = _mm256_blendv_epi8(_mm256_blend_epi32(colors, bytes, 0x88), bytes, opaque_texels);
+        __m128i words = _mm_packus_epi32(_mm256_castsi256_si128(result), _mm256_extracti128_si256(result, 1));
+        _mm_storel_epi64((__m128i*)texels, _mm_packus_epi16(words, words));
+    }
+    image_premultiply_scalar(rgba + (size_t)i * 4, count - i, /* linear */ false);
+}
+#endif
+
+static void
+image_expand_rgb(const unsigned char* rgb, unsigned char* rgba, uint32_t count) {
+#if defined(_M_X64)
+    if (cpu_features.avx2) {
+        image_expand_rgb_ssse3(rgb, rgba, count);
+        return;
+    }
+#endif
+    image_expand_rgb_scalar(rgb, rgba, count);
+}
+
+// NOTE: a row of rgba8 texels, linear ones when `flags` has `IMAGE_DECODE_LINEAR`
+static void
+image_premultiply(unsigned char* rgba, uint32_t count, uint32_t flags) {
+    bool linear = (flags & IMAGE_DECODE_LINEAR) != 0;
+#if defined(_M_X64)
+    if (linear) {
+        image_premultiply_linear_sse2(rgba, count);
+        return;
+    }
+    if (cpu_features.avx2) {
+        image_premultiply_srgb_avx2(rgba, count);
+        return;
+    }
+#endif
+    image_premultiply_scalar(rgba, count, linear);
+}
+
+// NOTE: canonical huffman codes. the codes up to `INFLATE_FAST_BITS` long are looked up with the next bits
+// of the stream, the longer ones are walked a bit at a time
+struct InflateHuffman {
+    uint16_t fast[1 << INFLATE_FAST_BITS]; // NOTE: `symbol | length << 9`, zero for the longer codes
+    uint16_t counts[16]; // NOTE: of the codes of every length
+    uint16_t symbols[288]; // NOTE: sorted by code
+};
+
+// NOTE: deflate streams are read from the least significant bit of every byte. PNG streams are split into
+// IDAT chunks, `chunks_end` is set for them so reading goes on with the next chunk
+struct InflateBits {
+    const unsigned char* data;
+    const unsigned char* end;
+    const unsigned char* chunks_end;
+    uint64_t bits;
+    uint32_t bit_count;
+    uint32_t overrun; // NOTE: zero bytes read past the end of the stream
+};
+
+static const uint16_t inflate_length_bases[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258,
+};
+static const uint8_t inflate_length_extra_bits[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0,
+};
+static const uint16_t inflate_distance_bases[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193,
+    12289, 16385, 24577,
+};
+static const uint8_t inflate_distance_extra_bits[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13,
+};
+static const uint8_t inflate_code_length_order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// NOTE: tops the bit buffer up to at least 57 bits, 8 bytes at once away from the end of a chunk
+static void
+inflate_refill(struct InflateBits* reader) {
+    while (reader->bit_count <= 56) {
+        if (reader->end - reader->data >= 8) {
+            uint64_t bytes = 0;
+            memcpy(&bytes, reader->data, sizeof(bytes));
+            reader->bits |= bytes << reader->bit_count;
+            reader->data += (63 - reader->bit_count) >> 3;
+            reader->bit_count |= 56;
+            return;
+        }
+        // NOTE: the crc of the chunk is between its data and the next one
+        while (reader->data == reader->end && reader->chunks_end) {
+            const unsigned char* chunk = reader->end + 4;
+            if (reader->chunks_end - chunk < 12 || memcmp(chunk + 4, "IDAT", 4) != 0 || image_read_be32(chunk) > (size_t)(reader->chunks_end - chunk) - 12) {
+                reader->chunks_end = NULL;
+                break;
+            }
+            reader->data = chunk + 8;
+            reader->end = reader->data + image_read_be32(chunk);
+        }
+        uint64_t byte = 0;
+        if (reader->data < reader->end) {
+            byte = *reader->data++;
+        } else {
+            reader->overrun += 1;
+        }
+        reader->bits |= byte << reader->bit_count;
+        reader->bit_count += 8;
+    }
+}
+
+// NOTE: the buffer has to hold `count` bits already
+static uint32_t
+inflate_bits(struct InflateBits* reader, uint32_t count) {
+    uint32_t value = (uint32_t)(reader->bits & ((1ull << count) - 1));
+    reader->bits >>= count;
+    reader->bit_count -= count;
+    return value;
+}
+
+// NOTE: false when the lengths ask for more codes than there are (incomplete codes are fine)
+static bool
+inflate_huffman_build(struct InflateHuffman* huffman, const uint8_t* lengths, uint32_t count) {
+    memset(huffman, 0, sizeof(*huffman));
+    for (uint32_t i = 0; i < count; i++) {
+        huffman->counts[lengths[i]] += 1;
+    }
+    huffman->counts[0] = 0;
+    int32_t left = 1;
+    for (uint32_t length = 1; length < 16; length++) {
+        left = left * 2 - huffman->counts[length];
+        if (left < 0) {
+            return false;
+        }
+    }
+
+    uint32_t offsets[16] = {0};
+    uint32_t next_codes[16] = {0};
+    uint32_t code = 0;
+    for (uint32_t length = 1; length < 16; length++) {
+        offsets[length] = length > 1 ? offsets[length - 1] + huffman->counts[length - 1] : 0;
+        code = (code + huffman->counts[length - 1]) << 1;
+        next_codes[length] = code;
+    }
+    for (uint32_t symbol = 0; symbol < count; symbol++) {
+        uint32_t length = lengths[symbol];
+        if (length == 0) {
+            continue;
+        }
+        huffman->symbols[offsets[length]++] = (uint16_t)symbol;
+        uint32_t symbol_code = next_codes[length]++;
+        if (length <= INFLATE_FAST_BITS) {
+            // NOTE: codes are stored from their most significant bit, the lookup goes the other way
+            uint32_t reversed = 0;
+            for (uint32_t bit = 0; bit < length; bit++) {
+                reversed |= ((symbol_code >> bit) & 1) << (length - 1 - bit);
+            }
+            for (uint32_t index = reversed; index < (1u << INFLATE_FAST_BITS); index += 1u << length) {
+                huffman->fast[index] = (uint16_t)(symbol | length << 9);
+            }
+        }
+    }
+    return true;
+}
+
+// NOTE: the buffer has to hold 15 bits already, -1 for a code that isn't in the table
+static int32_t
+inflate_decode_symbol(struct InflateBits* reader, const struct InflateHuffman* huffman) {
+    uint32_t entry = huffman->fast[reader->bits & ((1u << INFLATE_FAST_BITS) - 1)];
+    if (entry) {
+        inflate_bits(reader, entry >> 9);
+        return (int32_t)(entry & 511);
+    }
+    int32_t code = 0;
+    int32_t first = 0;
+    int32_t index = 0;
+    for (uint32_t length = 1; length < 16; length++) {
+        code |= (int32_t)((reader->bits >> (length - 1)) & 1);
+        int32_t count = huffman->counts[length];
+        if (code - first < count) {
+            inflate_bits(reader, length);
+            return huffman->symbols[index + code - first];
+        }
+        index += count;
+        first = (first + count) << 1;
+        code <<= 1;
+    }
+    return -1;
+}
+
+// NOTE: a zlib stream into exactly `size` bytes, false if it's malformed or doesn't fill them
+static bool
+inflate_zlib(struct InflateBits* reader, unsigned char* output, size_t size) {
+    inflate_refill(reader);
+    uint32_t method = inflate_bits(reader, 8);
+    uint32_t flags = inflate_bits(reader, 8);
+    if ((method & 15) != 8 || (method >> 4) > 7 || (method << 8 | flags) % 31 != 0 || (flags & 32)) {
+        return false;
+    }
+
+    struct InflateHuffman literals;
+    struct InflateHuffman distances;
+    size_t written = 0;
+    bool final = false;
+    while (!final) {
+        inflate_refill(reader);
+        if (reader->overrun > 8) {
+            return false;
+        }
+        final = inflate_bits(reader, 1) != 0;
+        uint32_t type = inflate_bits(reader, 2);
+        if (type == 0) {
+            inflate_bits(reader, reader->bit_count & 7);
+            uint32_t length = inflate_bits(reader, 16);
+            uint32_t inverted_length = inflate_bits(reader, 16);
+            if (length != (~inverted_length & 0xffff) || length > size - written) {
+                return false;
+            }
+            for (uint32_t i = 0; i < length; i++) {
+                if (reader->bit_count < 8) {
+                    inflate_refill(reader);
+                }
+                output[written++] = (unsigned char)inflate_bits(reader, 8);
+            }
+            continue;
+        }
+
+        uint8_t lengths[288 + 32];
+        if (type == 1) {
+            memset(lengths, 8, 144);
+            memset(lengths + 144, 9, 112);
+            memset(lengths + 256, 7, 24);
+            memset(lengths + 280, 8, 8);
+            memset(lengths + 288, 5, 30);
+            inflate_huffman_build(&literals, lengths, 288);
+            inflate_huffman_build(&distances, lengths + 288, 30);
+        } else if (type == 2) {
+            uint32_t literal_count = inflate_bits(reader, 5) + 257;
+            uint32_t distance_count = inflate_bits(reader, 5) + 1;
+            uint32_t code_length_count = inflate_bits(reader, 4) + 4;
+            uint8_t code_lengths[19] = {0};
+            for (uint32_t i = 0; i < code_length_count; i++) {
+                inflate_refill(reader);
+                code_lengths[inflate_code_length_order[i]] = (uint8_t)inflate_bits(reader, 3);
+            }
+            // NOTE: the code length codes go in `distances` until the lengths are read
+            if (literal_count > 286 || distance_count > 30 || !inflate_huffman_build(&distances, code_lengths, 19)) {
+                return false;
+            }
+            uint32_t count = 0;
+            while (count < literal_count + distance_count) {
+                inflate_refill(reader);
+                int32_t symbol = inflate_decode_symbol(reader, &distances);
+                if (symbol < 0) {
+                    return false;
+                }
+                if (symbol < 16) {
+                    lengths[count++] = (uint8_t)symbol;
+                    continue;
+                }
+                uint8_t repeated = 0;
+                uint32_t repeat = 0;
+                if (symbol == 16) {
+                    if (count == 0) {
+                        return false;
+                    }
+                    repeated = lengths[count - 1];
+                    repeat = 3 + inflate_bits(reader, 2);
+                } else if (symbol == 17) {
+                    repeat = 3 + inflate_bits(reader, 3);
+                } else {
+                    repeat = 11 + inflate_bits(reader, 7);
+                }
+                if (count + repeat > literal_count + distance_count) {
+                    return false;
+                }
+                memset(lengths + count, repeated, repeat);
+                count += repeat;
+            }
+            if (lengths[256] == 0) {
+                return false;
+            }
+            if (!inflate_huffman_build(&literals, lengths, literal_count) || !inflate_huffman_build(&distances, lengths + literal_count, distance_count)) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+
+        // NOTE: a refill is enough for a length and a distance code with their extra bits (48 bits at most)
+        for (;;) {
+            inflate_refill(reader);
+            if (reader->overrun > 8) {
+                return false;
+            }
+            int32_t symbol = inflate_decode_symbol(reader, &literals);
+            if (symbol < 256) {
+                if (symbol < 0 || written == size) {
+                    return false;
+                }
+                output[written++] = (unsigned char)symbol;
+                continue;
+            }
+            if (symbol == 256) {
+                break;
+            }
+            uint32_t length_index = (uint32_t)symbol - 257;
+            if (length_index >= 29) {
+                return false;
+            }
+            size_t length = inflate_length_bases[length_index] + inflate_bits(reader, inflate_length_extra_bits[length_index]);
+            int32_t distance_index = inflate_decode_symbol(reader, &distances);
+            if (distance_index < 0 || distance_index >= 30) {
+                return false;
+            }
+            size_t distance = inflate_distance_bases[distance_index] + inflate_bits(reader, inflate_distance_extra_bits[distance_index]);
+            if (distance > written || length > size - written) {
+                return false;
+            }
+            unsigned char* destination = output + written;
+            const unsigned char* source = destination - distance;
+            if (distance >= length) {
+                memcpy(destination, source, length);
+            } else {
+                for (size_t i = 0; i < length; i++) {
+                    destination[i] = source[i];
+                }
+            }
+            written += length;
+        }
+    }
+    return written == size;
+}
+
+struct PngImage {
+    uint32_t width;
+    uint32_t height;
+    uint32_t bit_depth;
+    uint32_t color_type;
+    uint32_t channel_count;
+    bool interlaced;
+    bool alpha;
+    bool transparent_key; // NOTE: texels of the `key` color are transparent (gray and rgb images with a tRNS chunk)
+    uint32_t key[3];
+    unsigned char palette[256 * 4];
+    const unsigned char* first_chunk; // NOTE: the first IDAT chunk
+    const unsigned char* end;
+};
+
+// NOTE: the passes of Adam7 interlacing, where their first texel is and how far apart their texels are
+static const uint8_t png_pass_x[7] = {0, 4, 0, 2, 0, 1, 0};
+static const uint8_t png_pass_y[7] = {0, 0, 4, 0, 2, 0, 1};
+static const uint8_t png_pass_step_x[7] = {8, 8, 4, 4, 2, 2, 1};
+static const uint8_t png_pass_step_y[7] = {8, 8, 8, 4, 4, 2, 2};
+
+// NOTE: reads the chunks up to the first IDAT
+static bool
+png_parse(struct PngImage* png, const unsigned char* data, size_t size) {
+    static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    memset(png, 0, sizeof(*png));
+    if (size < 8 + 25 || memcmp(data, signature, sizeof(signature)) != 0) {
+        return false;
+    }
+    const unsigned char* end = data + size;
+    const unsigned char* chunk = data + 8;
+    if (image_read_be32(chunk) != 13 || memcmp(chunk + 4, "IHDR", 4) != 0) {
+        return false;
+    }
+    const unsigned char* header = chunk + 8;
+    png->width = image_read_be32(header);
+    png->height = image_read_be32(header + 4);
+    png->bit_depth = header[8];
+    png->color_type = header[9];
+    png->interlaced = header[12] == 1;
+    if (png->width == 0 || png->width > IMAGE_MAX_EXTENT || png->height == 0 || png->height > IMAGE_MAX_EXTENT) {
+        return false;
+    }
+    if (header[10] != 0 || header[11] != 0 || header[12] > 1) {
+        return false;
+    }
+    uint32_t depth = png->bit_depth;
+    bool valid_depth = false;
+    switch (png->color_type) {
+        case 0: png->channel_count = 1; valid_depth = depth == 1 || depth == 2 || depth == 4 || depth == 8 || depth == 16; break;
+        case 2: png->channel_count = 3; valid_depth = depth == 8 || depth == 16; break;
+        case 3: png->channel_count = 1; valid_depth = depth == 1 || depth == 2 || depth == 4 || depth == 8; break;
+        case 4: png->channel_count = 2; valid_depth = depth == 8 || depth == 16; break;
+        case 6: png->channel_count = 4; valid_depth = depth == 8 || depth == 16; break;
+        default: break;
+    }
+    if (!valid_depth) {
+        return false;
+    }
+    png->alpha = png->color_type == 4 || png->color_type == 6;
+    for (uint32_t i = 0; i < 256; i++) {
+        png->palette[i * 4 + 3] = 255;
+    }
+
+    uint32_t palette_count = 0;
+    for (;;) {
+        if (end - chunk < 12) {
+            return false;
+        }
+        uint32_t length = image_read_be32(chunk);
+        if (length > (size_t)(end - chunk) - 12) {
+            return false;
+        }
+        const unsigned char* chunk_data = chunk + 8;
+        if (memcmp(chunk + 4, "PLTE", 4) == 0) {
+            if (length % 3 != 0 || length > 256 * 3) {
+                return false;
+            }
+            palette_count = length / 3;
+            for (uint32_t i = 0; i < palette_count; i++) {
+                memcpy(png->palette + i * 4, chunk_data + i * 3, 3);
+            }
+        } else if (memcmp(chunk + 4, "tRNS", 4) == 0) {
+            if (png->color_type == 3) {
+                for (uint32_t i = 0; i < length && i < 256; i++) {
+                    png->palette[i * 4 + 3] = chunk_data[i];
+                }
+                png->alpha = true;
+            } else if (png->color_type == 0 && length >= 2) {
+                png->key[0] = image_read_be16(chunk_data);
+                png->transparent_key = true;
+            } else if (png->color_type == 2 && length >= 6) {
+                for (uint32_t c = 0; c < 3; c++) {
+                    png->key[c] = image_read_be16(chunk_data + c * 2);
+                }
+                png->transparent_key = true;
+            }
+        } else if (memcmp(chunk + 4, "IDAT", 4) == 0) {
+            png->first_chunk = chunk;
+            break;
+        } else if (memcmp(chunk + 4, "IEND", 4) == 0) {
+            return false;
+        }
+        chunk += 12 + length;
+    }
+    if (png->color_type == 3 && palette_count == 0) {
+        return false;
+    }
+    png->alpha = png->alpha || png->transparent_key;
+    png->end = end;
+    return true;
+}
+
+// NOTE: zero when the pass has no texels in that direction (small images)
+static uint32_t
+png_pass_extent(uint32_t extent, uint32_t first, uint32_t step) {
+    return extent > first ? (extent - first + step - 1) / step : 0;
+}
+
+// NOTE: of a scanline without its filter byte
+static size_t
+png_row_size(const struct PngImage* png, uint32_t width) {
+    return ((size_t)width * png->channel_count * png->bit_depth + 7) / 8;
+}
+
+// NOTE: of every pass with the filter bytes
+static size_t
+png_filtered_size(const struct PngImage* png) {
+    size_t size = 0;
+    for (uint32_t pass = 0; pass < (png->interlaced ? 7u : 1u); pass++) {
+        uint32_t width = png->interlaced ? png_pass_extent(png->width, png_pass_x[pass], png_pass_step_x[pass]) : png->width;
+        uint32_t height = png->interlaced ? png_pass_extent(png->height, png_pass_y[pass], png_pass_step_y[pass]) : png->height;
+        if (width > 0 && height > 0) {
+            size += (size_t)height * (1 + png_row_size(png, width));
+        }
+    }
+    return size;
+}
+
+// NOTE: in place, `previous` is the unfiltered scanline above or null for the first one of a pass.
+// `texel_size` is in bytes, rounded up to 1 for the bit depths under 8
+static bool
+png_unfilter(unsigned char* row, const unsigned char* previous, size_t size, uint32_t filter, uint32_t texel_size) {
+    switch (filter) {
+        case 0:
+            break;
+        case 1:
+            for (size_t i = texel_size; i < size; i++) {
+                row[i] = (unsigned char)(row[i] + row[i - texel_size]);
+            }
+            break;
+        case 2:
+            if (previous) {
+                for (size_t i = 0; i < size; i++) {
+                    row[i] = (unsigned char)(row[i] + previous[i]);
+                }
+            }
+            break;
+        case 3:
+            for (size_t i = 0; i < size; i++) {
+                uint32_t left = i >= texel_size ? row[i - texel_size] : 0;
+                uint32_t up = previous ? previous[i] : 0;
+                row[i] = (unsigned char)(row[i] + ((left + up) >> 1));
+            }
+            break;
+        case 4:
+            for (size_t i = 0; i < size; i++) {
+                int32_t left = i >= texel_size ? row[i - texel_size] : 0;
+                int32_t up = previous ? previous[i] : 0;
+                int32_t up_left = previous && i >= texel_size ? previous[i - texel_size] : 0;
+                int32_t estimate = left + up - up_left;
+                int32_t left_distance = estimate > left ? estimate - left : left - estimate;
+                int32_t up_distance = estimate > up ? estimate - up : up - estimate;
+                int32_t up_left_distance = estimate > up_left ? estimate - up_left : up_left - estimate;
+                int32_t predictor = left_distance <= up_distance && left_distance <= up_left_distance ? left :
+                    up_distance <= up_left_distance ? up : up_left;
+                row[i] = (unsigned char)(row[i] + predictor);
+            }
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+// NOTE: an unfiltered scanline of `width` texels to rgba8
+static void
+png_convert_row(const struct PngImage* png, const unsigned char* row, uint32_t width, unsigned char* rgba) {
+    if (png->bit_depth == 8) {
+        switch (png->color_type) {
+            case 0:
+                for (uint32_t x = 0; x < width; x++) {
+                    memset(rgba + x * 4, row[x], 3);
+                    rgba[x * 4 + 3] = png->transparent_key && row[x] == png->key[0] ? 0 : 255;
+                }
+                break;
+            case 2:
+                image_expand_rgb(row, rgba, width);
+                if (png->transparent_key) {
+                    for (uint32_t x = 0; x < width; x++) {
+                        const unsigned char* texel = row + x * 3;
+                        if (texel[0] == png->key[0] && texel[1] == png->key[1] && texel[2] == png->key[2]) {
+                            rgba[x * 4 + 3] = 0;
+                        }
+                    }
+                }
+                break;
+            case 3:
+                for (uint32_t x = 0; x < width; x++) {
+                    memcpy(rgba + x * 4, png->palette + row[x] * 4, 4);
+                }
+                break;
+            case 4:
+                for (uint32_t x = 0; x < width; x++) {
+                    memset(rgba + x * 4, row[x * 2], 3);
+                    rgba[x * 4 + 3] = row[x * 2 + 1];
+                }
+                break;
+            default:
+                memcpy(rgba, row, (size_t)width * 4);
+                break;
+        }
+    } else if (png->bit_depth == 16) {
+        for (uint32_t x = 0; x < width; x++) {
+            uint32_t samples[4] = {0, 0, 0, 65535};
+            for (uint32_t c = 0; c < png->channel_count; c++) {
+                samples[c] = image_read_be16(row + ((size_t)x * png->channel_count + c) * 2);
+            }
+            bool transparent = false;
+            if (png->color_type == 0 || png->color_type == 4) {
+                transparent = png->transparent_key && samples[0] == png->key[0];
+                samples[3] = png->color_type == 4 ? samples[1] : 65535;
+                samples[1] = samples[0];
+                samples[2] = samples[0];
+            } else if (png->color_type == 2) {
+                transparent = png->transparent_key && samples[0] == png->key[0] && samples[1] == png->key[1] && samples[2] == png->key[2];
+            }
+            for (uint32_t c = 0; c < 4; c++) {
+                rgba[x * 4 + c] = (unsigned char)((samples[c] * 255 + 32767) / 65535);
+            }
+            if (transparent) {
+                rgba[x * 4 + 3] = 0;
+            }
+        }
+    } else {
+        // NOTE: 1, 2 or 4 bits of gray or palette index, packed from the most significant bit
+        uint32_t depth = png->bit_depth;
+        uint32_t mask = (1u << depth) - 1;
+        for (uint32_t x = 0; x < width; x++) {
+            uint32_t bit = x * depth;
+            uint32_t value = (uint32_t)(row[bit >> 3] >> (8 - depth - (bit & 7))) & mask;
+            if (png->color_type == 3) {
+                memcpy(rgba + x * 4, png->palette + value * 4, 4);
+            } else {
+                memset(rgba + x * 4, (int)(value * (255 / mask)), 3);
+                rgba[x * 4 + 3] = png->transparent_key && value == png->key[0] ? 0 : 255;
+            }
+        }
+    }
+}
+
+static bool
+png_parse_info(struct ImageInfo* info, const unsigned char* data, size_t size) {
+    struct PngImage png;
+    if (!png_parse(&png, data, size)) {
+        return false;
+    }
+    info->format = IMAGE_FORMAT_PNG;
+    info->width = png.width;
+    info->height = png.height;
+    info->alpha = png.alpha;
+    info->scratch_size = png_filtered_size(&png) + (png.interlaced ? (size_t)png.width * 4 : 0);
+    return true;
+}
+
+// NOTE: inflates every scanline into `scratch` first, then unfilters and converts them one at a time
+static bool
+png_decode(const unsigned char* data, size_t size, uint32_t flags, unsigned char* rgba, unsigned char* scratch) {
+    struct PngImage png;
+    if (!png_parse(&png, data, size)) {
+        return false;
+    }
+    size_t filtered_size = png_filtered_size(&png);
+    struct InflateBits reader = {
+        .data = png.first_chunk + 8,
+        .end = png.first_chunk + 8 + image_read_be32(png.first_chunk),
+        .chunks_end = png.end,
+    };
+    if (!inflate_zlib(&reader, scratch, filtered_size)) {
+        return false;
+    }
+
+    bool premultiply = (flags & IMAGE_DECODE_PREMULTIPLY) && png.alpha;
+    uint32_t texel_size = (png.channel_count * png.bit_depth + 7) / 8;
+    unsigned char* pass_rgba = scratch + filtered_size;
+    unsigned char* filtered = scratch;
+    for (uint32_t pass = 0; pass < (png.interlaced ? 7u : 1u); pass++) {
+        uint32_t width = png.interlaced ? png_pass_extent(png.width, png_pass_x[pass], png_pass_step_x[pass]) : png.width;
+        uint32_t height = png.interlaced ? png_pass_extent(png.height, png_pass_y[pass], png_pass_step_y[pass]) : png.height;
+        if (width == 0 || height == 0) {
+            continue;
+        }
+        size_t row_size = png_row_size(&png, width);
+        const unsigned char* previous = NULL;
+        for (uint32_t y = 0; y < height; y++) {
+            unsigned char* row = filtered + 1;
+            if (!png_unfilter(row, previous, row_size, filtered[0], texel_size)) {
+                return false;
+            }
+            if (png.interlaced) {
+                png_convert_row(&png, row, width, pass_rgba);
+                uint32_t image_y = png_pass_y[pass] + y * png_pass_step_y[pass];
+                for (uint32_t x = 0; x < width; x++) {
+                    uint32_t image_x = png_pass_x[pass] + x * png_pass_step_x[pass];
+                    memcpy(rgba + ((size_t)image_y * png.width + image_x) * 4, pass_rgba + x * 4, 4);
+                }
+            } else {
+                unsigned char* output = rgba + (size_t)y * png.width * 4;
+                png_convert_row(&png, row, width, output);
+                if (premultiply) {
+                    image_premultiply(output, width, flags);
+                }
+            }
+            previous = row;
+            filtered += 1 + row_size;
+        }
+    }
+    if (png.interlaced && premultiply) {
+        for (uint32_t y = 0; y < png.height; y++) {
+            image_premultiply(rgba + (size_t)y * png.width * 4, png.width, flags);
+        }
+    }
+    return true;
+}
+
+// NOTE: `values` come in code order and `max_codes[length]` is the last `length` bit code (right aligned),
+// -1 when there are none. the codes up to `JPEG_FAST_BITS` long are looked up with the next bits of the stream
+struct JpegHuffman {
+    uint16_t fast[1 << JPEG_FAST_BITS]; // NOTE: `value | length << 8`, zero for the longer codes
+    int32_t max_codes[17];
+    int32_t value_offsets[17]; // NOTE: the index in `values` of a code minus the first code of its length
+    uint8_t values[256];
+};
+
+// NOTE: entropy coded data is read from the most significant bit of every byte, a zero byte after 0xff is
+// stuffing. once a marker is reached only zeros are read
+struct JpegBits {
+    const unsigned char* data;
+    const unsigned char* end;
+    uint64_t bits; // NOTE: left aligned
+    uint32_t bit_count;
+    bool marker;
+};
+
+struct JpegComponent {
+    uint32_t id;
+    uint32_t horizontal_sampling;
+    uint32_t vertical_sampling;
+    uint32_t quantization_table;
+    uint32_t dc_table;
+    uint32_t ac_table;
+    int32_t dc_prediction;
+    bool scanned;
+    unsigned char* plane;
+    uint32_t plane_width; // NOTE: whole mcus, also the stride
+    uint32_t plane_height;
+};
+
+struct JpegFrame {
+    uint32_t width;
+    uint32_t height;
+    uint32_t component_count;
+    struct JpegComponent components[JPEG_MAX_COMPONENTS];
+    uint32_t max_horizontal_sampling;
+    uint32_t max_vertical_sampling;
+    uint32_t mcus_x;
+    uint32_t mcus_y;
+};
+
+struct JpegDecoder {
+    struct JpegFrame frame;
+    bool has_frame;
+    uint32_t restart_interval;
+    int32_t adobe_transform; // NOTE: of an Adobe APP14 marker, -1 without one
+    uint16_t quantization_tables[4][64]; // NOTE: in zigzag order
+    struct JpegHuffman dc_tables[4];
+    struct JpegHuffman ac_tables[4];
+};
+
+// NOTE: where the coefficients (stored in zigzag order) go in the block
+static const uint8_t jpeg_zigzag[64] = {
+    0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5, 12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51, 58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+// NOTE: false when the code lengths don't fit a prefix code or don't add up to `value_count`, which is
+// checked before anything is written to the table
+static bool
+jpeg_huffman_build(struct JpegHuffman* huffman, const unsigned char* counts, const unsigned char* values, uint32_t value_count) {
+    int32_t code = 0;
+    uint32_t total = 0;
+    for (uint32_t length = 1; length <= 16; length++) {
+        code += counts[length - 1];
+        total += counts[length - 1];
+        if (code > 1 << length) {
+            return false;
+        }
+        code <<= 1;
+    }
+    if (total != value_count || value_count > 256) {
+        return false;
+    }
+
+    memset(huffman, 0, sizeof(*huffman));
+    memcpy(huffman->values, values, value_count);
+    code = 0;
+    int32_t index = 0;
+    for (uint32_t length = 1; length <= 16; length++) {
+        int32_t count = counts[length - 1];
+        huffman->value_offsets[length] = index - code;
+        for (int32_t i = 0; i < count; i++) {
+            if (length <= JPEG_FAST_BITS) {
+                uint32_t first = (uint32_t)code << (JPEG_FAST_BITS - length);
+                for (uint32_t entry = 0; entry < 1u << (JPEG_FAST_BITS - length); entry++) {
+                    huffman->fast[first + entry] = (uint16_t)(values[index] | length << 8);
+                }
+            }
+            code += 1;
+            index += 1;
+        }
+        huffman->max_codes[length] = count > 0 ? code - 1 : -1;
+        code <<= 1;
+    }
+    return true;
+}
+
+static void
+jpeg_refill(struct JpegBits* reader) {
+    while (reader->bit_count <= 56) {
+        uint64_t byte = 0;
+        if (!reader->marker && reader->data < reader->end) {
+            byte = reader->data[0];
+            if (byte != 0xff) {
+                reader->data += 1;
+            } else if (reader->end - reader->data >= 2 && reader->data[1] == 0) {
+                reader->data += 2;
+            } else {
+                reader->marker = true;
+                byte = 0;
+            }
+        }
+        reader->bits |= byte << (56 - reader->bit_count);
+        reader->bit_count += 8;
+    }
+}
+
+// NOTE: -1 for a code that isn't in the table
+static int32_t
+jpeg_decode_symbol(struct JpegBits* reader, const struct JpegHuffman* huffman) {
+    if (reader->bit_count < 16) {
+        jpeg_refill(reader);
+    }
+    uint32_t entry = huffman->fast[reader->bits >> (64 - JPEG_FAST_BITS)];
+    uint32_t length = entry >> 8;
+    int32_t value = (int32_t)(entry & 255);
+    if (entry == 0) {
+        int32_t code = (int32_t)(reader->bits >> 48);
+        for (length = JPEG_FAST_BITS + 1; length <= 16; length++) {
+            int32_t length_code = code >> (16 - length);
+            if (length_code <= huffman->max_codes[length]) {
+                int32_t index = huffman->value_offsets[length] + length_code;
+                if (index < 0 || index > 255) {
+                    return -1;
+                }
+                value = huffman->values[index];
+                break;
+            }
+        }
+        if (length > 16) {
+            return -1;
+        }
+    }
+    reader->bits <<= length;
+    reader->bit_count -= length;
+    return value;
+}
+
+// NOTE: `size` bits as a signed value in the range of that size category
+static int32_t
+jpeg_receive_extend(struct JpegBits* reader, uint32_t size) {
+    if (size == 0) {
+        return 0;
+    }
+    if (reader->bit_count < size) {
+        jpeg_refill(reader);
+    }
+    int32_t value = (int32_t)(reader->bits >> (64 - size));
+    reader->bits <<= size;
+    reader->bit_count -= size;
+    return value < 1 << (size - 1) ? value - (1 << size) + 1 : value;
+}
+
+// NOTE: clamped to the 16 bits libjpeg keeps coefficients in, which keeps the idct from overflowing
+static int32_t
+jpeg_dequantize(int32_t value, uint16_t quantization) {
+    int64_t dequantized = (int64_t)value * quantization;
+    return (int32_t)(dequantized < -32768 ? -32768 : dequantized > 32767 ? 32767 : dequantized);
+}
+
+// NOTE: dequantized coefficients in natural order
+static bool
+jpeg_decode_block(
+    struct JpegBits* reader,
+    const struct JpegHuffman* dc_table,
+    const struct JpegHuffman* ac_table,
+    const uint16_t* quantization_table,
+    int32_t* dc_prediction,
+    int32_t* coefficients
+) {
+    memset(coefficients, 0, 64 * sizeof(int32_t));
+    int32_t size = jpeg_decode_symbol(reader, dc_table);
+    if (size < 0 || size > 11) {
+        return false;
+    }
+    // NOTE: wraps instead of overflowing on malformed files, like the clamping below it never happens otherwise
+    *dc_prediction = (int32_t)((uint32_t)*dc_prediction + (uint32_t)jpeg_receive_extend(reader, (uint32_t)size));
+    coefficients[0] = jpeg_dequantize(*dc_prediction, quantization_table[0]);
+    for (uint32_t k = 1; k < 64;) {
+        int32_t symbol = jpeg_decode_symbol(reader, ac_table);
+        if (symbol < 0) {
+            return false;
+        }
+        uint32_t run = (uint32_t)symbol >> 4;
+        uint32_t value_size = (uint32_t)symbol & 15;
+        if (value_size == 0) {
+            if (run != 15) {
+                break;
+            }
+            k += 16;
+            continue;
+        }
+        k += run;
+        if (k > 63) {
+            return false;
+        }
+        coefficients[jpeg_zigzag[k]] = jpeg_dequantize(jpeg_receive_extend(reader, value_size), quantization_table[k]);
+        k += 1;
+    }
+    return true;
+}
+
+// NOTE: the islow integer idct of libjpeg, 13 bit fixed point constants
+#define JPEG_FIX(value) ((int32_t)((value) * 8192.0 + 0.5))
+#define JPEG_DESCALE(value, shift) (((value) + (1 << ((shift) - 1))) >> (shift))
+
+// NOTE: 8 inputs `stride` apart into the sums and differences of the even and odd parts, outputs 0 to 7
+// are `even[i] + odd[i]` and outputs 7 to 4 are `even[i] - odd[i]`. 64 bit so the clamped coefficients
+// of malformed files can't overflow
+static void
+jpeg_idct_1d(const int32_t* in, uint32_t stride, int64_t* even, int64_t* odd) {
+    int64_t z2 = in[2 * stride];
+    int64_t z3 = in[6 * stride];
+    int64_t z1 = (z2 + z3) * JPEG_FIX(0.541196100);
+    int64_t t2 = z1 - z3 * JPEG_FIX(1.847759065);
+    int64_t t3 = z1 + z2 * JPEG_FIX(0.765366865);
+    int64_t t0 = (in[0] + in[4 * stride]) * (1 << 13);
+    int64_t t1 = (in[0] - in[4 * stride]) * (1 << 13);
+    even[0] = t0 + t3;
+    even[1] = t1 + t2;
+    even[2] = t1 - t2;
+    even[3] = t0 - t3;
+
+    int64_t o0 = in[7 * stride];
+    int64_t o1 = in[5 * stride];
+    int64_t o2 = in[3 * stride];
+    int64_t o3 = in[1 * stride];
+    int64_t p1 = o0 + o3;
+    int64_t p2 = o1 + o2;
+    int64_t p3 = o0 + o2;
+    int64_t p4 = o1 + o3;
+    int64_t p5 = (p3 + p4) * JPEG_FIX(1.175875602);
+    p1 *= -JPEG_FIX(0.899976223);
+    p2 *= -JPEG_FIX(2.562915447);
+    p3 = p3 * -JPEG_FIX(1.961570560) + p5;
+    p4 = p4 * -JPEG_FIX(0.390180644) + p5;
+    odd[0] = o3 * JPEG_FIX(1.501321110) + p1 + p4;
+    odd[1] = o2 * JPEG_FIX(3.072711026) + p2 + p3;
+    odd[2] = o1 * JPEG_FIX(2.053119869) + p2 + p4;
+    odd[3] = o0 * JPEG_FIX(0.298631336) + p1 + p3;
+}
+
+// NOTE: columns then rows, 2 extra bits of precision are kept in between
+static void
+jpeg_idct_block(const int32_t* coefficients, unsigned char* output, size_t stride) {
+    int32_t workspace[64];
+    int64_t even[4];
+    int64_t odd[4];
+    for (uint32_t column = 0; column < 8; column++) {
+        const int32_t* in = coefficients + column;
+        int32_t* out = workspace + column;
+        // NOTE: most columns have no ac coefficients, their output is flat
+        if ((in[8] | in[16] | in[24] | in[32] | in[40] | in[48] | in[56]) == 0) {
+            for (uint32_t row = 0; row < 8; row++) {
+                out[row * 8] = in[0] * 4;
+            }
+            continue;
+        }
+        jpeg_idct_1d(in, 8, even, odd);
+        for (uint32_t i = 0; i < 4; i++) {
+            out[i * 8] = (int32_t)JPEG_DESCALE(even[i] + odd[i], 11);
+            out[(7 - i) * 8] = (int32_t)JPEG_DESCALE(even[i] - odd[i], 11);
+        }
+    }
+    for (uint32_t row = 0; row < 8; row++) {
+        jpeg_idct_1d(workspace + row * 8, 1, even, odd);
+        unsigned char* out = output + row * stride;
+        for (uint32_t i = 0; i < 4; i++) {
+            int64_t first = JPEG_DESCALE(even[i] + odd[i], 18) + 128;
+            int64_t second = JPEG_DESCALE(even[i] - odd[i], 18) + 128;
+            out[i] = (unsigned char)(first < 0 ? 0 : first > 255 ? 255 : first);
+            out[7 - i] = (unsigned char)(second < 0 ? 0 : second > 255 ? 255 : second);
+        }
+    }
+}
+
+// NOTE: the marker at or after `*position` (skipping fill bytes and entropy coded data), zero at the end
+static uint32_t
+jpeg_next_marker(const unsigned char** position, const unsigned char* end) {
+    for (const unsigned char* cursor = *position; end - cursor >= 2; cursor++) {
+        if (cursor[0] == 0xff && cursor[1] != 0 && cursor[1] != 0xff) {
+            *position = cursor + 2;
+            return cursor[1];
+        }
+    }
+    *position = end;
+    return 0;
+}
+
+// NOTE: the markers without a segment after them
+static bool
+jpeg_marker_standalone(uint32_t marker) {
+    return (marker >= 0xd0 && marker <= 0xd9) || marker == 0x01;
+}
+
+// NOTE: the frame markers of the other processes (progressive, lossless, arithmetic coding)
+static bool
+jpeg_marker_unsupported(uint32_t marker) {
+    return marker >= 0xc2 && marker <= 0xcf && marker != 0xc4;
+}
+
+// NOTE: the segment after a marker, without its length
+static bool
+jpeg_segment(const unsigned char** position, const unsigned char* end, const unsigned char** segment, size_t* size) {
+    if (end - *position < 2) {
+        return false;
+    }
+    size_t length = image_read_be16(*position);
+    if (length < 2 || length > (size_t)(end - *position)) {
+        return false;
+    }
+    *segment = *position + 2;
+    *size = length - 2;
+    *position += length;
+    return true;
+}
+
+// NOTE: SOF0 or SOF1, sizes the component planes
+static bool
+jpeg_parse_frame(struct JpegFrame* frame, const unsigned char* segment, size_t size) {
+    memset(frame, 0, sizeof(*frame));
+    if (size < 6 || segment[0] != 8) {
+        return false;
+    }
+    frame->height = image_read_be16(segment + 1);
+    frame->width = image_read_be16(segment + 3);
+    frame->component_count = segment[5];
+    if (frame->width == 0 || frame->width > IMAGE_MAX_EXTENT || frame->height == 0 || frame->height > IMAGE_MAX_EXTENT) {
+        return false;
+    }
+    if ((frame->component_count != 1 && frame->component_count != 3) || size < 6 + frame->component_count * 3) {
+        return false;
+    }
+    frame->max_horizontal_sampling = 1;
+    frame->max_vertical_sampling = 1;
+    for (uint32_t i = 0; i < frame->component_count; i++) {
+        struct JpegComponent* component = &frame->components[i];
+        const unsigned char* bytes = segment + 6 + i * 3;
+        component->id = bytes[0];
+        component->horizontal_sampling = bytes[1] >> 4;
+        component->vertical_sampling = bytes[1] & 15;
+        component->quantization_table = bytes[2];
+        bool valid_sampling =
+            component->horizontal_sampling >= 1 && component->horizontal_sampling <= 4 &&
+            component->vertical_sampling >= 1 && component->vertical_sampling <= 4;
+        if (!valid_sampling || component->quantization_table > 3) {
+            return false;
+        }
+        if (component->horizontal_sampling > frame->max_horizontal_sampling) {
+            frame->max_horizontal_sampling = component->horizontal_sampling;
+        }
+        if (component->vertical_sampling > frame->max_vertical_sampling) {
+            frame->max_vertical_sampling = component->vertical_sampling;
+        }
+    }
+    frame->mcus_x = (frame->width + frame->max_horizontal_sampling * 8 - 1) / (frame->max_horizontal_sampling * 8);
+    frame->mcus_y = (frame->height + frame->max_vertical_sampling * 8 - 1) / (frame->max_vertical_sampling * 8);
+    for (uint32_t i = 0; i < frame->component_count; i++) {
+        struct JpegComponent* component = &frame->components[i];
+        component->plane_width = frame->mcus_x * component->horizontal_sampling * 8;
+        component->plane_height = frame->mcus_y * component->vertical_sampling * 8;
+    }
+    return true;
+}
+
+// NOTE: the planes, then a row per component for the upsampled chroma
+static size_t
+jpeg_scratch_size(const struct JpegFrame* frame) {
+    size_t size = (size_t)frame->width * frame->component_count;
+    for (uint32_t i = 0; i < frame->component_count; i++) {
+        size += (size_t)frame->components[i].plane_width * frame->components[i].plane_height;
+    }
+    return size;
+}
+
+static bool
+jpeg_parse_info(struct ImageInfo* info, const unsigned char* data, size_t size) {
+    if (size < 4 || data[0] != 0xff || data[1] != 0xd8) {
+        return false;
+    }
+    const unsigned char* end = data + size;
+    const unsigned char* position = data + 2;
+    for (;;) {
+        uint32_t marker = jpeg_next_marker(&position, end);
+        if (marker == 0 || marker == 0xd9 || marker == 0xda || jpeg_marker_unsupported(marker)) {
+            return false;
+        }
+        if (jpeg_marker_standalone(marker)) {
+            continue;
+        }
+        const unsigned char* segment = NULL;
+        size_t segment_size = 0;
+        if (!jpeg_segment(&position, end, &segment, &segment_size)) {
+            return false;
+        }
+        if (marker == 0xc0 || marker == 0xc1) {
+            struct JpegFrame frame;
+            if (!jpeg_parse_frame(&frame, segment, segment_size)) {
+                return false;
+            }
+            info->format = IMAGE_FORMAT_JPEG;
+            info->width = frame.width;
+            info->height = frame.height;
+            info->alpha = false;
+            info->scratch_size = jpeg_scratch_size(&frame);
+            return true;
+        }
+    }
+}
+
+// NOTE: skips to after the next RST marker
+static bool
+jpeg_restart(struct JpegBits* reader) {
+    const unsigned char* cursor = reader->data;
+    while (reader->end - cursor >= 2 && !(cursor[0] == 0xff && cursor[1] >= 0xd0 && cursor[1] <= 0xd7)) {
+        cursor += 1;
+    }
+    if (reader->end - cursor < 2) {
+        return false;
+    }
+    reader->data = cursor + 2;
+    reader->bits = 0;
+    reader->bit_count = 0;
+    reader->marker = false;
+    return true;
+}
+
+// NOTE: the entropy coded data after a SOS header into the planes of its components. `*position` ends up
+// where the data ended, or close to it
+static bool
+jpeg_decode_scan(struct JpegDecoder* decoder, struct JpegComponent** components, uint32_t count, const unsigned char** position, const unsigned char* end) {
+    const struct JpegFrame* frame = &decoder->frame;
+    struct JpegBits reader = {.data = *position, .end = end};
+    uint32_t mcu_count = frame->mcus_x * frame->mcus_y;
+    uint32_t blocks_x = 0;
+    if (count == 1) {
+        // NOTE: a scan of a single component has its blocks in raster order instead of in mcus
+        const struct JpegComponent* component = components[0];
+        uint32_t width = (frame->width * component->horizontal_sampling + frame->max_horizontal_sampling - 1) / frame->max_horizontal_sampling;
+        uint32_t height = (frame->height * component->vertical_sampling + frame->max_vertical_sampling - 1) / frame->max_vertical_sampling;
+        blocks_x = (width + 7) / 8;
+        mcu_count = blocks_x * ((height + 7) / 8);
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        components[i]->dc_prediction = 0;
+        components[i]->scanned = true;
+    }
+
+    int32_t coefficients[64];
+    uint32_t restart_countdown = decoder->restart_interval;
+    for (uint32_t mcu = 0; mcu < mcu_count; mcu++) {
+        if (decoder->restart_interval > 0) {
+            if (restart_countdown == 0) {
+                if (!jpeg_restart(&reader)) {
+                    return false;
+                }
+                for (uint32_t i = 0; i < count; i++) {
+                    components[i]->dc_prediction = 0;
+                }
+                restart_countdown = decoder->restart_interval;
+            }
+            restart_countdown -= 1;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            struct JpegComponent* component = components[i];
+            uint32_t columns = count == 1 ? 1 : component->horizontal_sampling;
+            uint32_t rows = count == 1 ? 1 : component->vertical_sampling;
+            for (uint32_t row = 0; row < rows; row++) {
+                for (uint32_t column = 0; column < columns; column++) {
+                    uint32_t block_x = count == 1 ? mcu % blocks_x : mcu % frame->mcus_x * columns + column;
+                    uint32_t block_y = count == 1 ? mcu / blocks_x : mcu / frame->mcus_x * rows + row;
+                    bool decoded = jpeg_decode_block(
+                        &reader,
+                        &decoder->dc_tables[component->dc_table],
+                        &decoder->ac_tables[component->ac_table],
+                        decoder->quantization_tables[component->quantization_table],
+                        &component->dc_prediction,
+                        coefficients
+                    );
+                    if (!decoded) {
+                        return false;
+                    }
+                    unsigned char* output = component->plane + (size_t)block_y * 8 * component->plane_width + block_x * 8;
+                    jpeg_idct_block(coefficients, output, component->plane_width);
+                }
+            }
+        }
+    }
+    *position = reader.data;
+    return true;
+}
+
+// NOTE: the row of a component at image row `y`, upsampled to the image width by repeating samples
+static const unsigned char*
+jpeg_component_row(const struct JpegFrame* frame, const struct JpegComponent* component, uint32_t y, unsigned char* upsampled) {
+    const unsigned char* row = component->plane + (size_t)(y * component->vertical_sampling / frame->max_vertical_sampling) * component->plane_width;
+    if (component->horizontal_sampling == frame->max_horizontal_sampling) {
+        return row;
+    }
+    if (component->horizontal_sampling * 2 == frame->max_horizontal_sampling) {
+        for (uint32_t x = 0; x < frame->width; x++) {
+            upsampled[x] = row[x >> 1];
+        }
+    } else {
+        for (uint32_t x = 0; x < frame->width; x++) {
+            upsampled[x] = row[x * component->horizontal_sampling / frame->max_horizontal_sampling];
+        }
+    }
+    return upsampled;
+}
+
+static bool
+jpeg_decode(const unsigned char* data, size_t size, unsigned char* rgba, unsigned char* scratch) {
+    if (size < 4 || data[0] != 0xff || data[1] != 0xd8) {
+        return false;
+    }
+    struct JpegDecoder decoder;
+    memset(&decoder, 0, sizeof(decoder));
+    decoder.adobe_transform = -1;
+    struct JpegFrame* frame = &decoder.frame;
+    const unsigned char* end = data + size;
+    const unsigned char* position = data + 2;
+    for (;;) {
+        uint32_t marker = jpeg_next_marker(&position, end);
+        if (marker == 0 || jpeg_marker_unsupported(marker)) {
+            return false;
+        }
+        if (marker == 0xd9) {
+            break;
+        }
+        if (jpeg_marker_standalone(marker)) {
+            continue;
+        }
+        const unsigned char* segment = NULL;
+        size_t segment_size = 0;
+        if (!jpeg_segment(&position, end, &segment, &segment_size)) {
+            return false;
+        }
+        if (marker == 0xc0 || marker == 0xc1) {
+            if (decoder.has_frame || !jpeg_parse_frame(frame, segment, segment_size)) {
+                return false;
+            }
+            unsigned char* plane = scratch;
+            for (uint32_t i = 0; i < frame->component_count; i++) {
+                frame->components[i].plane = plane;
+                plane += (size_t)frame->components[i].plane_width * frame->components[i].plane_height;
+            }
+            decoder.has_frame = true;
+        } else if (marker == 0xc4) {
+            while (segment_size > 0) {
+                uint32_t value_count = 0;
+                for (uint32_t i = 1; i <= 16 && i < segment_size; i++) {
+                    value_count += segment[i];
+                }
+                uint32_t table_class = segment[0] >> 4;
+                uint32_t table = segment[0] & 15;
+                if (segment_size < 17 || value_count > 256 || segment_size < 17 + value_count || table_class > 1 || table > 3) {
+                    return false;
+                }
+                struct JpegHuffman* huffman = table_class == 0 ? &decoder.dc_tables[table] : &decoder.ac_tables[table];
+                if (!jpeg_huffman_build(huffman, segment + 1, segment + 17, value_count)) {
+                    return false;
+                }
+                segment += 17 + value_count;
+                segment_size -= 17 + value_count;
+            }
+        } else if (marker == 0xdb) {
+            while (segment_size > 0) {
+                uint32_t precision = segment[0] >> 4;
+                uint32_t table = segment[0] & 15;
+                size_t table_size = 1 + 64 * (1 + (size_t)precision);
+                if (precision > 1 || table > 3 || segment_size < table_size) {
+                    return false;
+                }
+                for (uint32_t k = 0; k < 64; k++) {
+                    decoder.quantization_tables[table][k] = (uint16_t)(precision ? image_read_be16(segment + 1 + k * 2) : segment[1 + k]);
+                }
+                segment += table_size;
+                segment_size -= table_size;
+            }
+        } else if (marker == 0xdd) {
+            if (segment_size < 2) {
+                return false;
+            }
+            decoder.restart_interval = image_read_be16(segment);
+        } else if (marker == 0xee) {
+            if (segment_size >= 12 && memcmp(segment, "Adobe", 5) == 0) {
+                decoder.adobe_transform = segment[11];
+            }
+        } else if (marker == 0xda) {
+            uint32_t count = segment_size > 0 ? segment[0] : 0;
+            if (!decoder.has_frame || count == 0 || count > frame->component_count || segment_size < 4 + count * 2) {
+                return false;
+            }
+            struct JpegComponent* components[JPEG_MAX_COMPONENTS] = {0};
+            for (uint32_t i = 0; i < count; i++) {
+                const unsigned char* bytes = segment + 1 + i * 2;
+                for (uint32_t j = 0; j < frame->component_count; j++) {
+                    if (frame->components[j].id == bytes[0]) {
+                        components[i] = &frame->components[j];
+                    }
+                }
+                if (!components[i] || (bytes[1] >> 4) > 3 || (bytes[1] & 15) > 3) {
+                    return false;
+                }
+                components[i]->dc_table = bytes[1] >> 4;
+                components[i]->ac_table = bytes[1] & 15u;
+            }
+            if (!jpeg_decode_scan(&decoder, components, count, &position, end)) {
+                return false;
+            }
+        }
+    }
+    if (!decoder.has_frame) {
+        return false;
+    }
+    for (uint32_t i = 0; i < frame->component_count; i++) {
+        if (!frame->components[i].scanned) {
+            return false;
+        }
+    }
+
+    // NOTE: the fixed point YCbCr to rgb conversion of libjpeg (16 bit constants)
+    const struct JpegComponent* components = frame->components;
+    unsigned char* upsampled = components[frame->component_count - 1].plane +
+        (size_t)components[frame->component_count - 1].plane_width * components[frame->component_count - 1].plane_height;
+    bool rgb = decoder.adobe_transform == 0 ||
+        (decoder.adobe_transform < 0 && frame->component_count == 3 && components[0].id == 'R' && components[1].id == 'G' && components[2].id == 'B');
+    for (uint32_t y = 0; y < frame->height; y++) {
+        unsigned char* output = rgba + (size_t)y * frame->width * 4;
+        if (frame->component_count == 1) {
+            const unsigned char* gray = jpeg_component_row(frame, &components[0], y, upsampled);
+            for (uint32_t x = 0; x < frame->width; x++) {
+                memset(output + x * 4, gray[x], 3);
+                output[x * 4 + 3] = 255;
+            }
+            continue;
+        }
+        const unsigned char* rows[3];
+        for (uint32_t c = 0; c < 3; c++) {
+            rows[c] = jpeg_component_row(frame, &components[c], y, upsampled + (size_t)c * frame->width);
+        }
+        for (uint32_t x = 0; x < frame->width; x++) {
+            int32_t values[3] = {rows[0][x], rows[1][x], rows[2][x]};
+            if (!rgb) {
+                int32_t luma = values[0];
+                int32_t blue = values[1] - 128;
+                int32_t red = values[2] - 128;
+                values[0] = luma + ((91881 * red + 32768) >> 16);
+                values[1] = luma + ((-22554 * blue - 46802 * red + 32768) >> 16);
+                values[2] = luma + ((116130 * blue + 32768) >> 16);
+            }
+            for (uint32_t c = 0; c < 3; c++) {
+                output[x * 4 + c] = (unsigned char)(values[c] < 0 ? 0 : values[c] > 255 ? 255 : values[c]);
+            }
+            output[x * 4 + 3] = 255;
+        }
+    }
+    return true;
+}
+
+static bool
+qoi_parse_info(struct ImageInfo* info, const unsigned char* data, size_t size) {
+    if (size < 14 + 8 || memcmp(data, "qoif", 4) != 0) {
+        return false;
+    }
+    uint32_t width = image_read_be32(data + 4);
+    uint32_t height = image_read_be32(data + 8);
+    uint32_t channel_count = data[12];
+    if (width == 0 || width > IMAGE_MAX_EXTENT || height == 0 || height > IMAGE_MAX_EXTENT || (channel_count != 3 && channel_count != 4) || data[13] > 1) {
+        return false;
+    }
+    info->format = IMAGE_FORMAT_QOI;
+    info->width = width;
+    info->height = height;
+    info->alpha = channel_count == 4;
+    info->scratch_size = 0;
+    return true;
+}
+
+static bool
+qoi_decode(const unsigned char* data, size_t size, const struct ImageInfo* info, uint32_t flags, unsigned char* rgba) {
+    const unsigned char* cursor = data + 14;
+    const unsigned char* end = data + size - 8; // NOTE: before the end marker
+    unsigned char seen[64 * 4] = {0}; // NOTE: the texels seen so far by their hash
+    unsigned char texel[4] = {0, 0, 0, 255};
+    uint32_t run = 0;
+    bool premultiply = (flags & IMAGE_DECODE_PREMULTIPLY) && info->alpha;
+    for (uint32_t y = 0; y < info->height; y++) {
+        unsigned char* row = rgba + (size_t)y * info->width * 4;
+        for (uint32_t x = 0; x < info->width; x++) {
+            if (run > 0) {
+                run -= 1;
+                memcpy(row + x * 4, texel, 4);
+                continue;
+            }
+            if (cursor >= end) {
+                return false;
+            }
+            uint32_t op = *cursor++;
+            if (op == 0xfe || op == 0xff) {
+                size_t channel_count = op == 0xfe ? 3 : 4;
+                if ((size_t)(end - cursor) < channel_count) {
+                    return false;
+                }
+                memcpy(texel, cursor, channel_count);
+                cursor += channel_count;
+            } else if (op >> 6 == 0) {
+                memcpy(texel, seen + (op & 63) * 4, 4);
+            } else if (op >> 6 == 1) {
+                texel[0] = (unsigned char)(texel[0] + ((op >> 4) & 3) - 2);
+                texel[1] = (unsigned char)(texel[1] + ((op >> 2) & 3) - 2);
+                texel[2] = (unsigned char)(texel[2] + (op & 3) - 2);
+            } else if (op >> 6 == 2) {
+                if (cursor >= end) {
+                    return false;
+                }
+                uint32_t second = *cursor++;
+                uint32_t green = (op & 63) - 32;
+                texel[0] = (unsigned char)(texel[0] + green - 8 + (second >> 4));
+                texel[1] = (unsigned char)(texel[1] + green);
+                texel[2] = (unsigned char)(texel[2] + green - 8 + (second & 15));
+            } else {
+                run = op & 63;
+            }
+            uint32_t hash = (texel[0] * 3u + texel[1] * 5u + texel[2] * 7u + texel[3] * 11u) % 64;
+            memcpy(seen + hash * 4, texel, 4);
+            memcpy(row + x * 4, texel, 4);
+        }
+        if (premultiply) {
+            image_premultiply(row, info->width, flags);
+        }
+    }
+    return true;
+}
+
+// NOTE: recognizes the format from the first bytes and reads the size without decoding anything
+static bool
+image_parse_info(struct ImageInfo* info, const void* data, size_t size) {
+    memset(info, 0, sizeof(*info));
+    return png_parse_info(info, data, size) || jpeg_parse_info(info, data, size) || qoi_parse_info(info, data, size);
+}
+
+// NOTE: into the `width * height * 4` bytes of `rgba` with the `scratch_size` bytes of `scratch`, false
+// when the file turns out to be malformed (`rgba` can be partly written then)
+static bool
+image_decode(const struct ImageInfo* info, const void* data, size_t size, uint32_t flags, unsigned char* rgba, unsigned char* scratch) {
+    if (info->format == IMAGE_FORMAT_PNG) {
+        return png_decode(data, size, flags, rgba, scratch);
+    }
+    if (info->format == IMAGE_FORMAT_JPEG) {
+        return jpeg_decode(data, size, rgba, scratch);
+    }
+    return qoi_decode(data, size, info, flags, rgba);
+}
+
+// NOTE: an encoded image (not owned) and where it's decoded to
+struct ImageDecode {
+    const void* data;
+    size_t size;
+    struct ImageInfo info;
+    unsigned char* rgba; // NOTE: `width * height * 4` bytes
+    bool decoded;
+};
+
+struct ImageDecodeBatch {
+    struct ImageDecode* images;
+    uint32_t flags;
+    unsigned char* scratch;
+    size_t scratch_size; // NOTE: per worker
+    volatile LONG decoded_count;
+};
+
+// NOTE: the items are images
+static void
+image_decode_job(void* data, uint32_t first, uint32_t count, uint32_t worker_index) {
+    struct ImageDecodeBatch* batch = data;
+    unsigned char* scratch = batch->scratch + (size_t)worker_index * batch->scratch_size;
+    for (uint32_t i = first; i < first + count; i++) {
+        struct ImageDecode* image = &batch->images[i];
+        image->decoded = image_decode(&image->info, image->data, image->size, batch->flags, image->rgba, scratch);
+        if (image->decoded) {
+            InterlockedIncrement(&batch->decoded_count);
+        }
+    }
+}
+
+// NOTE: the images (with their info parsed) into their `rgba`, an image per job on the workers of
+// `job_system` when there's one, called from worker 0. returns how many were decoded
+static uint32_t
+image_decode_all(struct ImageDecode* images, uint32_t count, uint32_t flags, struct JobSystem* job_system) {
+    size_t scratch_size = 64; // NOTE: qoi needs none
+    for (uint32_t i = 0; i < count; i++) {
+        scratch_size = images[i].info.scratch_size > scratch_size ? images[i].info.scratch_size : scratch_size;
+    }
+    // NOTE: on cache lines of their own
+    scratch_size = ALIGN_UP(scratch_size, 64);
+    uint32_t worker_count = job_system ? job_system->worker_count : 1;
+    struct ImageDecodeBatch batch = {
+        .images = images,
+        .flags = flags,
+        .scratch = os_alloc(scratch_size * worker_count),
+        .scratch_size = scratch_size,
+        .decoded_count = 0,
+    };
+    if (job_system) {
+        volatile LONG counter = 0;
+        job_system_parallel_for(job_system, /* worker_index */ 0, &image_decode_job, &batch, count, /* batch_size */ 1, &counter);
+        job_system_wait(job_system, /* worker_index */ 0, &counter);
+    } else {
+        image_decode_job(&batch, /* first */ 0, count, /* worker_index */ 0);
+    }
+    os_free(batch.scratch);
+    return (uint32_t)batch.decoded_count;
+}
+
+struct ImageDirectory {
+    uint32_t count;
+    struct MappedFile* files;
+    struct ImageDecode* images; // NOTE: their `rgba` is left to the caller
+    uint32_t format_counts[IMAGE_FORMAT_COUNT];
+    size_t encoded_size;
+    size_t rgba_size; // NOTE: of every image once decoded
+};
+
+// NOTE: maps the files of a directory that parse as images, up to `max_count` of them in the order the file
+// system lists them (by name on NTFS)
+static void
+image_directory_open(struct ImageDirectory* directory, const char* path, uint32_t max_count) {
+    memset(directory, 0, sizeof(*directory));
+    char pattern[MAX_PATH];
+    snprintf(pattern, sizeof(pattern), "%s\\*", path);
+    WIN32_FIND_DATAA find_data;
+    HANDLE find = FindFirstFileA(pattern, &find_data);
+    if (find == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    directory->files = os_alloc(max_count * sizeof(struct MappedFile));
+    directory->images = os_alloc(max_count * sizeof(struct ImageDecode));
+    do {
+        if (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            continue;
+        }
+        char file_path[MAX_PATH];
+        int length = snprintf(file_path, sizeof(file_path), "%s\\%s", path, find_data.cFileName);
+        if (length < 0 || (size_t)length >= sizeof(file_path)) {
+            continue;
+        }
+        struct MappedFile* file = &directory->files[directory->count];
+        struct ImageDecode* image = &directory->images[directory->count];
+        if (!mapped_file_open(file, file_path)) {
+            continue;
+        }
+        if (!image_parse_info(&image->info, file->data, file->size)) {
+            mapped_file_close(file);
+            continue;
+        }
+        image->data = file->data;
+        image->size = file->size;
+        directory->format_counts[image->info.format] += 1;
+        directory->encoded_size += file->size;
+        directory->rgba_size += (size_t)image->info.width * image->info.height * 4;
+        directory->count += 1;
+    } while (directory->count < max_count && FindNextFileA(find, &find_data));
+    FindClose(find);
+}
+
+static void
+image_directory_close(struct ImageDirectory* directory) {
+    for (uint32_t i = 0; i < directory->count; i++) {
+        mapped_file_close(&directory->files[i]);
+    }
+    os_free(directory->images);
+    os_free(directory->files);
+    memset(directory, 0, sizeof(*directory));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// texture atlas
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// packs many small images into a few big pages (the layers of a texture array) so they are all
+// sampled through one texture binding. pages are filled with a skyline: the top edge of what's
+// placed so far as a list of horizontal segments, and every image goes where its bottom ends up the
+// lowest, then where it leaves the least unusable space under it. images are sorted tallest first.
+// images are surrounded by a gutter of their own texels wrapped around so both filtering and repeating
+// uvs (wrapped in the shader) never read a neighbour. to stay that way down the mip chain the padded
+// footprints sit on a grid of 2^(levels - 1) texels, so no texel of a level mixes two images, and the
+// gutter is that wide so it's still a whole texel at the smallest level. block compressed pages make the
+// grid as many blocks wide (4 << (levels - 1) texels) so no block of a level straddles two images either.
+// see "a thousand ways to pack the bin" (jylanki)
+
+#define ATLAS_MAX_PAGES 16
+#define ATLAS_MAX_SKYLINE_NODES 256 // NOTE: per page, a page is full when it would need more
+
+struct AtlasSkylineNode {
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+};
+
+struct AtlasPage {
+    struct AtlasSkylineNode nodes[ATLAS_MAX_SKYLINE_NODES]; // NOTE: left to right, covering the whole width
+    uint32_t node_count;
+    uint64_t used_area; // NOTE: in texels, of the images themselves
+};
+
+struct AtlasPacker {
+    uint32_t page_width;
+    uint32_t page_height;
+    uint32_t alignment; // NOTE: positions and sizes of the footprints are multiples of it
+    uint32_t gutter;
+    uint32_t page_count;
+    uint32_t max_page_count;
+    struct AtlasPage pages[ATLAS_MAX_PAGES];
+};
+
+// NOTE: where an image went, `x` and `y` are its first texel (the gutter is around it)
+struct AtlasPlacement {
+    uint32_t page;
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+};
+
+// NOTE: `mip_count` is how many levels the pages will have and `block_extent` the block size of their format
+// (1 for rgba8), page sizes must be multiples of `block_extent` << (mip_count - 1)
+static void
+atlas_packer_init(
+    struct AtlasPacker* packer,
+    uint32_t page_width,
+    uint32_t page_height,
+    uint32_t max_page_count,
+    uint32_t mip_count,
+    uint32_t block_extent
+) {
+    memset(packer, 0, sizeof(*packer));
+    ASSERT(max_page_count > 0 && max_page_count <= ATLAS_MAX_PAGES);
+    ASSERT(mip_count > 0 && block_extent > 0);
+    packer->page_width = page_width;
+    packer->page_height = page_height;
+    packer->alignment = block_extent << (mip_count - 1);
+    packer->gutter = 1u << (mip_count - 1);
+    packer->max_page_count = max_page_count;
+    ASSERT(page_width % packer->alignment == 0 && page_height % packer->alignment == 0);
+}
+
+// NOTE: the lowest spot for a footprint on the page (less wasted space under it on ties), false when none
+static bool
+atlas_page_find(const struct AtlasPacker* packer, const struct AtlasPage* page, uint32_t width, uint32_t height, uint32_t* node_index, uint32_t* y) {
+    uint32_t best_y = UINT32_MAX;
+    uint64_t best_waste = UINT64_MAX;
+    for (uint32_t i = 0; i < page->node_count; i++) {
+        uint32_t x = page->nodes[i].x;
+        if (x + width > packer->page_width) {
+            break;
+        }
+
+        // NOTE: it rests on the highest of the segments it spans
+        uint32_t top = 0;
+        uint32_t remaining = width;
+        for (uint32_t j = i; remaining > 0; j++) {
+            top = page->nodes[j].y > top ? page->nodes[j].y : top;
+            remaining -= page->nodes[j].width < remaining ? page->nodes[j].width : remaining;
+        }
+        if (top + height > packer->page_height || top > best_y) {
+            continue;
+        }
+
+        uint64_t waste = 0;
+        remaining = width;
+        for (uint32_t j = i; remaining > 0; j++) {
+            uint32_t spanned = page->nodes[j].width < remaining ? page->nodes[j].width : remaining;
+            waste += (uint64_t)(top - page->nodes[j].y) * spanned;
+            remaining -= spanned;
+        }
+        if (top < best_y || waste < best_waste) {
+            best_y = top;
+            best_waste = waste;
+            *node_index = i;
+        }
+    }
+    *y = best_y;
+    return best_y != UINT32_MAX;
+}
+
+// NOTE: raises the skyline over the footprint placed at node `index`, false when the page has no room for the node
+static bool
+atlas_page_place(struct AtlasPage* page, uint32_t index, uint32_t y, uint32_t width, uint32_t height) {
+    struct AtlasSkylineNode placed = {.x = page->nodes[index].x, .y = y + height, .width = width};
+    uint32_t end = placed.x + width;
+
+    // NOTE: the nodes it covers completely go away, the last one it covers partly is shortened
+    uint32_t last = index;
+    while (last < page->node_count && page->nodes[last].x + page->nodes[last].width <= end) {
+        last += 1;
+    }
+    uint32_t removed_count = last - index;
+    if (removed_count == 0 && page->node_count == ATLAS_MAX_SKYLINE_NODES) {
+        return false;
+    }
+    if (last < page->node_count && page->nodes[last].x < end) {
+        page->nodes[last].width -= end - page->nodes[last].x;
+        page->nodes[last].x = end;
+    }
+    if (removed_count == 0) {
+        memmove(&page->nodes[index + 1], &page->nodes[index], (page->node_count - index) * sizeof(page->nodes[0]));
+        page->node_count += 1;
+    } else if (removed_count > 1) {
+        memmove(&page->nodes[index + 1], &page->nodes[last], (page->node_count - last) * sizeof(page->nodes[0]));
+        page->node_count -= removed_count - 1;
+    }
+    page->nodes[index] = placed;
+
+    // NOTE: neighbours at the same height become one segment
+    uint32_t merged_count = 1;
+    for (uint32_t i = 1; i < page->node_count; i++) {
+        struct AtlasSkylineNode* previous = &page->nodes[merged_count - 1];
+        if (page->nodes[i].y == previous->y) {
+            previous->width += page->nodes[i].width;
+        } else {
+            page->nodes[merged_count] = page->nodes[i];
+            merged_count += 1;
+        }
+    }
+    page->node_count = merged_count;
+    return true;
+}
+
+// NOTE: places one image in the first page with room for it, opening a new page when none has. false when
+// the image is bigger than a page or every page is taken
+static bool
+atlas_packer_add(struct AtlasPacker* packer, uint32_t width, uint32_t height, struct AtlasPlacement* placement) {
+    uint32_t footprint_width = ALIGN_UP(width + 2 * packer->gutter, packer->alignment);
+    uint32_t footprint_height = ALIGN_UP(height + 2 * packer->gutter, packer->alignment);
+    if (footprint_width > packer->page_width || footprint_height > packer->page_height) {
+        return false;
+    }
+
+    for (uint32_t page_index = 0; page_index < packer->max_page_count; page_index++) {
+        struct AtlasPage* page = &packer->pages[page_index];
+        if (page_index == packer->page_count) {
+            page->nodes[0].x = 0;
+            page->nodes[0].y = 0;
+            page->nodes[0].width = packer->page_width;
+            page->node_count = 1;
+            page->used_area = 0;
+            packer->page_count += 1;
+        }
+
+        uint32_t node_index = 0;
+        uint32_t y = 0;
+        if (!atlas_page_find(packer, page, footprint_width, footprint_height, &node_index, &y)) {
+            continue;
+        }
+        uint32_t x = page->nodes[node_index].x;
+        if (!atlas_page_place(page, node_index, y, footprint_width, footprint_height)) {
+            continue;
+        }
+        page->used_area += (uint64_t)width * height;
+        placement->page = page_index;
+        placement->x = x + packer->gutter;
+        placement->y = y + packer->gutter;
+        placement->width = width;
+        placement->height = height;
+        return true;
+    }
+    return false;
+}
+
+// NOTE: packs images tallest first (then widest) which keeps the skyline flat, `placements` are in the
+// order of the sizes. scratch memory comes from `arena` and is given back when done
+static bool
+atlas_packer_add_all(
+    struct AtlasPacker* packer,
+    const uint32_t* widths,
+    const uint32_t* heights,
+    uint32_t count,
+    struct AtlasPlacement* placements,
+    struct LinearArena* arena
+) {
+    size_t scratch_mark = arena->used;
+    uint64_t* order = LINEAR_ALLOC(arena, uint64_t, count);
+    for (uint32_t i = 0; i < count; i++) {
+        // NOTE: sorts descending by height, width and then ascending by index
+        uint64_t size_key = ((uint64_t)(0xffffu - (heights[i] & 0xffffu)) << 16) | (0xffffu - (widths[i] & 0xffffu));
+        order[i] = (size_key << 32) | i;
+    }
+    for (uint32_t i = 1; i < count; i++) {
+        uint64_t key = order[i];
+        uint32_t j = i;
+        for (; j > 0 && order[j - 1] > key; j--) {
+            order[j] = order[j - 1];
+        }
+        order[j] = key;
+    }
+
+    bool all_placed = true;
+    for (uint32_t i = 0; i < count && all_placed; i++) {
+        uint32_t index = (uint32_t)order[i];
+        all_placed = atlas_packer_add(packer, widths[index], heights[index], &placements[index]);
+    }
+    arena->used = scratch_mark;
+    return all_placed;
+}
+
+// NOTE: the uv offset (xy) and scale (zw) that map the unit square onto the image in its page
+static void
+atlas_placement_uv_rect(const struct AtlasPacker* packer, const struct AtlasPlacement* placement, float uv_rect[4]) {
+    uv_rect[0] = (float)placement->x / (float)packer->page_width;
+    uv_rect[1] = (float)placement->y / (float)packer->page_height;
+    uv_rect[2] = (float)placement->width / (float)packer->page_width;
+    uv_rect[3] = (float)placement->height / (float)packer->page_height;
+}
+
+// NOTE: copies an rgba8 image into its page (`page_width` texels wide) along with its gutter, the texels
+// of the image wrapped around as if it repeated
+static void
+atlas_blit(const struct AtlasPacker* packer, unsigned char* page_rgba, const struct AtlasPlacement* placement, const unsigned char* rgba) {
+    uint32_t footprint_width = ALIGN_UP(placement->width + 2 * packer->gutter, packer->alignment);
+    uint32_t footprint_height = ALIGN_UP(placement->height + 2 * packer->gutter, packer->alignment);
+    uint32_t footprint_x = placement->x - packer->gutter;
+    uint32_t footprint_y = placement->y - packer->gutter;
+    for (uint32_t y = 0; y < footprint_height; y++) {
+        // NOTE: the gutter is added so the offsets never go negative
+        uint32_t source_y = (y + placement->height * packer->gutter - packer->gutter) % placement->height;
+        unsigned char* row = page_rgba + ((size_t)(footprint_y + y) * packer->page_width + footprint_x) * 4;
+        for (uint32_t x = 0; x < footprint_width; x++) {
+            uint32_t source_x = (x + placement->width * packer->gutter - packer->gutter) % placement->width;
+            memcpy(row + x * 4, rgba + ((size_t)source_y * placement->width + source_x) * 4, 4);
+        }
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// texture streaming
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// textures only keep the mip levels the screen needs on the gpu. while culling, the scene update measures
+// how big the objects using a texture are on screen, which gives the finest level worth having (about a
+// texel per pixel). the coarsest levels are always resident and finer ones are loaded from the cpu copy
+// of the texture (what would be read from disk) within an upload budget per frame. the levels are read
+// into staging memory by the workers while the frame goes on and uploaded by the next update, so the
+// render thread only makes the gl calls. once the resident levels of every texture go over a memory
+// budget, the finest levels of the textures used the longest ago (or finer than what they're used at)
+// are dropped to make room.
+// bindless handles freeze the state of their texture, base level and min lod included, so a texture
+// can't be clamped to its resident levels after the fact. instead a texture only has its resident levels:
+// loading makes a texture with the wanted levels next to it, copies the levels it already has on the gpu
+// and uploads the finer ones over the next frames, then its handle replaces the old one. dropping levels
+// is the same without uploads so it happens right away. replaced textures (and their handles) are only
+// deleted once the frames that could still be using them are done
+
+#define TEXTURE_STREAMING_MAX_TEXTURES 256
+#define TEXTURE_STREAMING_BUDGET (128 * 1024) // NOTE: bytes, small enough that the sample materials don't all fit
+#define TEXTURE_STREAMING_UPLOAD_BUDGET (32 * 1024) // NOTE: bytes per frame, at least one level is always uploaded
+#define TEXTURE_STREAMING_PINNED_EXTENT 8 // NOTE: levels this big or smaller are always resident
+#define TEXTURE_STREAMING_MAX_LOADS 16
+#define TEXTURE_STREAMING_MAX_STAGED_LEVELS (TEXTURE_STREAMING_MAX_LOADS * MIP_CHAIN_MAX_LEVELS)
+#define TEXTURE_STREAMING_RETIRED_CAPACITY 128
+
+struct StreamedTexture {
+    enum TextureFormat format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t level_count;
+    unsigned char* levels[MIP_CHAIN_MAX_LEVELS]; // NOTE: the cpu copy of every level, in `format`
+    size_t level_sizes[MIP_CHAIN_MAX_LEVELS];
+    uint32_t pinned_level; // NOTE: the finest of the always resident levels
+    GLuint sampler; // NOTE: part of the handle
+    GLuint texture; // NOTE: its level 0 is level `first_level` of the full texture
+    GLuint64 handle;
+    uint32_t first_level;
+    GLuint load_texture; // NOTE: zero when nothing is loading
+    uint32_t load_first_level;
+    uint32_t load_level; // NOTE: the finest level uploaded to the load texture so far, uploads go from coarse to fine
+    uint32_t wanted_level; // NOTE: the finest asked for this frame, `level_count` when nothing did
+    uint64_t last_used; // NOTE: frame number
+    bool handle_changed;
+};
+
+// NOTE: replaced textures waiting on the frames in flight
+struct RetiredTexture {
+    GLuint texture;
+    GLuint64 handle;
+    uint64_t frame_number;
+};
+
+// NOTE: a level of a load read into the staging memory, uploaded by the next update
+struct StagedLevel {
+    uint32_t texture;
+    uint32_t level;
+    size_t offset; // NOTE: in the staging memory
+};
+
+struct TextureStreamingStats {
+    uint64_t load_count;
+    uint64_t eviction_count; // NOTE: levels dropped
+    uint64_t uploaded_size;
+    uint64_t copied_size; // NOTE: levels copied on the gpu into resized textures
+    uint32_t over_budget_count; // NOTE: loads of fewer levels than wanted (or none) as they didn't fit even after dropping levels
+    size_t max_resident_size;
+};
+
+struct TextureStreaming {
+    size_t budget;
+    size_t resident_size; // NOTE: of the textures in use and the ones loading
+    size_t full_size; // NOTE: with every level of every texture
+    struct StreamedTexture textures[TEXTURE_STREAMING_MAX_TEXTURES];
+    uint32_t count;
+    struct RetiredTexture retired[TEXTURE_STREAMING_RETIRED_CAPACITY];
+    uint32_t retired_count;
+    uint64_t frame_number;
+    unsigned char* staging; // NOTE: `staging_capacity` bytes, fits the upload budget or the largest level
+    size_t staging_capacity;
+    struct StagedLevel staged[TEXTURE_STREAMING_MAX_STAGED_LEVELS];
+    uint32_t staged_count;
+    volatile LONG read_counter; // NOTE: the read jobs of the staged levels still running
+    struct TextureStreamingStats stats;
+};
+
+static void
+texture_streaming_init(struct TextureStreaming* streaming, size_t budget) {
+    memset(streaming, 0, sizeof(*streaming));
+    streaming->budget = budget;
+}
+
+// NOTE: of the levels from `first_level` to the last
+static size_t
+streamed_texture_size(const struct StreamedTexture* texture, uint32_t first_level) {
+    size_t size = 0;
+    for (uint32_t level = first_level; level < texture->level_count; level++) {
+        size += texture->level_sizes[level];
+    }
+    return size;
+}
+
+// NOTE: storage for the levels from `first_level` to the last, none of them set
+static GLuint
+streamed_texture_create(const struct StreamedTexture* texture, uint32_t first_level) {
+    GLuint result = 0;
+    glCreateTextures(GL_TEXTURE_2D, 1, &result);
+    glTextureStorage2D(
+        result,
+        (GLsizei)(texture->level_count - first_level),
+        texture_format_infos[texture->format].internal_format,
+        (GLsizei)mip_level_extent(texture->width, first_level),
+        (GLsizei)mip_level_extent(texture->height, first_level)
+    );
+    return result;
+}
+
+// NOTE: `data` is the level in the cpu copy or in the staging memory
+static void
+streamed_texture_upload_level(
+    const struct StreamedTexture* texture,
+    GLuint destination,
+    uint32_t destination_first_level,
+    uint32_t level,
+    const unsigned char* data
+) {
+    GLint destination_level = (GLint)(level - destination_first_level);
+    GLsizei width = (GLsizei)mip_level_extent(texture->width, level);
+    GLsizei height = (GLsizei)mip_level_extent(texture->height, level);
+    if (texture->format == TEXTURE_FORMAT_RGBA8) {
+        glTextureSubImage2D(destination, destination_level, /* xoffset */ 0, /* yoffset */ 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, data);
+    } else {
+        glCompressedTextureSubImage2D(
+            destination,
+            destination_level,
+            /* xoffset */ 0,
+            /* yoffset */ 0,
+            width,
+            height,
+            texture_format_infos[texture->format].internal_format,
+            (GLsizei)texture->level_sizes[level],
+            data
+        );
+    }
+}
+
+// NOTE: the levels from `first_level` to the last that both textures have
+static void
+streamed_texture_copy_levels(
+    struct TextureStreaming* streaming,
+    const struct StreamedTexture* texture,
+    GLuint source,
+    uint32_t source_first_level,
+    GLuint destination,
+    uint32_t destination_first_level,
+    uint32_t first_level
+) {
+    for (uint32_t level = first_level; level < texture->level_count; level++) {
+        glCopyImageSubData(
+            source,
+            GL_TEXTURE_2D,
+            (GLint)(level - source_first_level),
+            /* src */ 0, 0, 0,
+            destination,
+            GL_TEXTURE_2D,
+            (GLint)(level - destination_first_level),
+            /* dst */ 0, 0, 0,
+            (GLsizei)mip_level_extent(texture->width, level),
+            (GLsizei)mip_level_extent(texture->height, level),
+            /* depth */ 1
+        );
+        streaming->stats.copied_size += texture->level_sizes[level];
+    }
+}
+
+// NOTE: makes `replacement` (with the levels from `first_level`) the texture in use, the one it replaces
+// is retired along with its handle. the caller makes sure there's room to retire it
+static void
+streamed_texture_replace(struct TextureStreaming* streaming, struct StreamedTexture* texture, GLuint replacement, uint32_t first_level) {
+    if (texture->texture) {
+        ASSERT(streaming->retired_count < TEXTURE_STREAMING_RETIRED_CAPACITY);
+        struct RetiredTexture* retired = &streaming->retired[streaming->retired_count];
+        streaming->retired_count += 1;
+        retired->texture = texture->texture;
+        retired->handle = texture->handle;
+        retired->frame_number = streaming->frame_number;
+        streaming->resident_size -= streamed_texture_size(texture, texture->first_level);
+    }
+    texture->texture = replacement;
+    texture->first_level = first_level;
+    texture->handle = glGetTextureSamplerHandleARB(replacement, texture->sampler);
+    glMakeTextureHandleResidentARB(texture->handle);
+    texture->handle_changed = true;
+}
+
+// NOTE: copies the levels (in a format the context can sample) and makes the texture with only the pinned
+// ones, those no bigger than `TEXTURE_STREAMING_PINNED_EXTENT` (or the last one). textures are added before
+// the first update, which can stage levels. returns its index
+static uint32_t
+texture_streaming_add(
+    struct TextureStreaming* streaming,
+    enum TextureFormat format,
+    uint32_t width,
+    uint32_t height,
+    uint32_t level_count,
+    const unsigned char* const* levels,
+    const size_t* level_sizes,
+    GLuint sampler
+) {
+    ASSERT(streaming->count < TEXTURE_STREAMING_MAX_TEXTURES);
+    ASSERT(level_count > 0 && level_count <= MIP_CHAIN_MAX_LEVELS);
+    uint32_t index = streaming->count;
+    streaming->count += 1;
+    struct StreamedTexture* texture = &streaming->textures[index];
+    memset(texture, 0, sizeof(*texture));
+    texture->format = format;
+    texture->width = width;
+    texture->height = height;
+    texture->level_count = level_count;
+    texture->sampler = sampler;
+
+    size_t size = 0;
+    for (uint32_t level = 0; level < level_count; level++) {
+        size += level_sizes[level];
+    }
+    unsigned char* memory = os_alloc(size);
+    for (uint32_t level = 0; level < level_count; level++) {
+        texture->levels[level] = memory;
+        texture->level_sizes[level] = level_sizes[level];
+        memcpy(memory, levels[level], level_sizes[level]);
+        memory += level_sizes[level];
+    }
+    streaming->full_size += size;
+
+    uint32_t pinned_level = 0;
+    while (
+        pinned_level + 1 < level_count &&
+        (mip_level_extent(width, pinned_level) > TEXTURE_STREAMING_PINNED_EXTENT || mip_level_extent(height, pinned_level) > TEXTURE_STREAMING_PINNED_EXTENT)
+    ) {
+        pinned_level += 1;
+    }
+    texture->pinned_level = pinned_level;
+    texture->wanted_level = level_count;
+    GLuint pinned_texture = streamed_texture_create(texture, pinned_level);
+    for (uint32_t level = pinned_level; level < level_count; level++) {
+        streamed_texture_upload_level(texture, pinned_texture, pinned_level, level, texture->levels[level]);
+    }
+
+    // NOTE: the staging memory fits one frame of uploads, or one level when it's bigger than that
+    ASSERT(streaming->staged_count == 0);
+    size_t staging_capacity = streaming->staging_capacity > TEXTURE_STREAMING_UPLOAD_BUDGET ? streaming->staging_capacity : TEXTURE_STREAMING_UPLOAD_BUDGET;
+    for (uint32_t level = 0; level < pinned_level; level++) {
+        staging_capacity = level_sizes[level] > staging_capacity ? level_sizes[level] : staging_capacity;
+    }
+    if (staging_capacity > streaming->staging_capacity) {
+        os_free(streaming->staging);
+        streaming->staging = os_alloc(staging_capacity);
+        streaming->staging_capacity = staging_capacity;
+    }
+    streamed_texture_replace(streaming, texture, pinned_texture, pinned_level);
+    streaming->resident_size += streamed_texture_size(texture, pinned_level);
+    if (streaming->resident_size > streaming->stats.max_resident_size) {
+        streaming->stats.max_resident_size = streaming->resident_size;
+    }
+    return index;
+}
+
+// NOTE: asks for the texture to be sharp where it takes `texels_per_pixel` texels of its top level per
+// pixel on screen, the finest request of a frame wins
+static void
+texture_streaming_request(struct TextureStreaming* streaming, uint32_t index, float texels_per_pixel) {
+    struct StreamedTexture* texture = &streaming->textures[index];
+    uint32_t level = texels_per_pixel > 1.0f ? (uint32_t)floorf(log2f(texels_per_pixel)) : 0;
+    level = level < texture->level_count - 1 ? level : texture->level_count - 1;
+    texture->wanted_level = level < texture->wanted_level ? level : texture->wanted_level;
+    texture->last_used = streaming->frame_number;
+}
+
+// NOTE: drops the finest level of the least recently used texture that has more levels than it needs
+// (nothing loading into it). false when there's none
+static bool
+texture_streaming_evict(struct TextureStreaming* streaming) {
+    struct StreamedTexture* victim = NULL;
+    uint64_t victim_last_used = UINT64_MAX;
+    for (uint32_t i = 0; i < streaming->count; i++) {
+        struct StreamedTexture* texture = &streaming->textures[i];
+        if (texture->load_texture || texture->first_level >= texture->pinned_level) {
+            continue;
+        }
+        // NOTE: used this frame but finer than it's used at counts as not used
+        uint64_t last_used = texture->first_level < texture->wanted_level && texture->last_used == streaming->frame_number ? 0 : texture->last_used;
+        if (last_used < streaming->frame_number && last_used < victim_last_used) {
+            victim = texture;
+            victim_last_used = last_used;
+        }
+    }
+    if (!victim) {
+        return false;
+    }
+
+    uint32_t first_level = victim->first_level + 1;
+    GLuint replacement = streamed_texture_create(victim, first_level);
+    streamed_texture_copy_levels(streaming, victim, victim->texture, victim->first_level, replacement, first_level, first_level);
+    streaming->resident_size += streamed_texture_size(victim, first_level);
+    streamed_texture_replace(streaming, victim, replacement, first_level);
+    streaming->stats.eviction_count += 1;
+    return true;
+}
+
+// NOTE: the items are the staged levels, copied from the cpu copy where a file would be read and decoded
+static void
+texture_streaming_read_job(void* data, uint32_t first, uint32_t count, uint32_t worker_index) {
+    (void)worker_index;
+    struct TextureStreaming* streaming = data;
+    for (uint32_t i = first; i < first + count; i++) {
+        const struct StagedLevel* staged = &streaming->staged[i];
+        const struct StreamedTexture* texture = &streaming->textures[staged->texture];
+        memcpy(streaming->staging + staged->offset, texture->levels[staged->level], texture->level_sizes[staged->level]);
+    }
+}
+
+// NOTE: called once per frame after the requests (from worker 0 of `job_system`). deletes the textures
+// retired `FRAME_ARENA_FRAME_COUNT` frames ago, uploads the levels read since the last update (replacing
+// the textures whose loads are done), starts loading what's wanted the most (the most levels missing)
+// while it fits in the budget and there's room to retire what it replaces, then has the workers read
+// the next levels of the loads within the upload budget
+static void
+texture_streaming_update(struct TextureStreaming* streaming, struct JobSystem* job_system) {
+    uint32_t kept_count = 0;
+    for (uint32_t i = 0; i < streaming->retired_count; i++) {
+        struct RetiredTexture* retired = &streaming->retired[i];
+        if (streaming->frame_number - retired->frame_number >= FRAME_ARENA_FRAME_COUNT) {
+            glMakeTextureHandleNonResidentARB(retired->handle);
+            glDeleteTextures(1, &retired->texture);
+        } else {
+            streaming->retired[kept_count] = *retired;
+            kept_count += 1;
+        }
+    }
+    streaming->retired_count = kept_count;
+
+    // NOTE: the reads had the whole frame, this only waits when there are no other workers to run them
+    job_system_wait(job_system, /* worker_index */ 0, &streaming->read_counter);
+    for (uint32_t i = 0; i < streaming->staged_count; i++) {
+        const struct StagedLevel* staged = &streaming->staged[i];
+        struct StreamedTexture* texture = &streaming->textures[staged->texture];
+        ASSERT(staged->level + 1 == texture->load_level);
+        streamed_texture_upload_level(texture, texture->load_texture, texture->load_first_level, staged->level, streaming->staging + staged->offset);
+        texture->load_level = staged->level;
+        streaming->stats.uploaded_size += texture->level_sizes[staged->level];
+    }
+    streaming->staged_count = 0;
+
+    uint32_t load_count = 0;
+    for (uint32_t i = 0; i < streaming->count; i++) {
+        struct StreamedTexture* texture = &streaming->textures[i];
+        if (!texture->load_texture) {
+            continue;
+        }
+        if (texture->load_level == texture->load_first_level && streaming->retired_count < TEXTURE_STREAMING_RETIRED_CAPACITY) {
+            streamed_texture_replace(streaming, texture, texture->load_texture, texture->load_first_level);
+            texture->load_texture = 0;
+            streaming->stats.load_count += 1;
+        } else {
+            load_count += 1;
+        }
+    }
+
+    while (load_count < TEXTURE_STREAMING_MAX_LOADS && streaming->retired_count < TEXTURE_STREAMING_RETIRED_CAPACITY) {
+        struct StreamedTexture* best = NULL;
+        uint32_t best_missing = 0;
+        for (uint32_t i = 0; i < streaming->count; i++) {
+            struct StreamedTexture* texture = &streaming->textures[i];
+            if (!texture->load_texture && texture->wanted_level < texture->first_level && texture->first_level - texture->wanted_level > best_missing) {
+                best = texture;
+                best_missing = texture->first_level - texture->wanted_level;
+            }
+        }
+        if (!best) {
+            break;
+        }
+
+        // NOTE: both textures are alive until the load is done. when the wanted levels don't fit even after
+        // dropping levels elsewhere the finest that fit are loaded, the rest is tried again next frame
+        size_t load_size = streamed_texture_size(best, best->wanted_level);
+        while (streaming->resident_size + load_size > streaming->budget && streaming->retired_count < TEXTURE_STREAMING_RETIRED_CAPACITY && texture_streaming_evict(streaming)) {
+        }
+        uint32_t load_first_level = best->wanted_level;
+        while (load_first_level < best->first_level && streaming->resident_size + streamed_texture_size(best, load_first_level) > streaming->budget) {
+            load_first_level += 1;
+        }
+        if (load_first_level != best->wanted_level) {
+            streaming->stats.over_budget_count += 1;
+        }
+        if (load_first_level == best->first_level) {
+            best->wanted_level = best->level_count;
+            continue;
+        }
+
+        load_size = streamed_texture_size(best, load_first_level);
+        best->load_texture = streamed_texture_create(best, load_first_level);
+        best->load_first_level = load_first_level;
+        best->load_level = best->first_level;
+        streamed_texture_copy_levels(streaming, best, best->texture, best->first_level, best->load_texture, best->load_first_level, best->first_level);
+        streaming->resident_size += load_size;
+        load_count += 1;
+    }
+    if (streaming->resident_size > streaming->stats.max_resident_size) {
+        streaming->stats.max_resident_size = streaming->resident_size;
+    }
+
+    // NOTE: coarse to fine for every load, at least one level even when it's bigger than the budget
+    size_t upload_budget = TEXTURE_STREAMING_UPLOAD_BUDGET;
+    size_t staging_offset = 0;
+    for (uint32_t i = 0; i < streaming->count; i++) {
+        const struct StreamedTexture* texture = &streaming->textures[i];
+        if (!texture->load_texture) {
+            continue;
+        }
+        uint32_t level = texture->load_level;
+        while (
+            level > texture->load_first_level &&
+            streaming->staged_count < TEXTURE_STREAMING_MAX_STAGED_LEVELS &&
+            (staging_offset == 0 || texture->level_sizes[level - 1] <= upload_budget)
+        ) {
+            level -= 1;
+            size_t level_size = texture->level_sizes[level];
+            streaming->staged[streaming->staged_count] = (struct StagedLevel){.texture = i, .level = level, .offset = staging_offset};
+            streaming->staged_count += 1;
+            staging_offset += level_size;
+            upload_budget = level_size < upload_budget ? upload_budget - level_size : 0;
+        }
+    }
+    ASSERT(staging_offset <= streaming->staging_capacity);
+    if (streaming->staged_count > 0) {
+        job_system_parallel_for(
+            job_system,
+            /* worker_index */ 0,
+            &texture_streaming_read_job,
+            streaming,
+            streaming->staged_count,
+            /* batch_size */ 1,
+            &streaming->read_counter
+        );
+    }
+
+    for (uint32_t i = 0; i < streaming->count; i++) {
+        streaming->textures[i].wanted_level = streaming->textures[i].level_count;
+    }
+    streaming->frame_number += 1;
+}
+
+// NOTE: waits for the reads still running on `job_system`
+static void
+texture_streaming_deinit(struct TextureStreaming* streaming, struct JobSystem* job_system) {
+    job_system_wait(job_system, /* worker_index */ 0, &streaming->read_counter);
+    for (uint32_t i = 0; i < streaming->count; i++) {
+        struct StreamedTexture* texture = &streaming->textures[i];
+        glMakeTextureHandleNonResidentARB(texture->handle);
+        glDeleteTextures(1, &texture->texture);
+        if (texture->load_texture) {
+            glDeleteTextures(1, &texture->load_texture);
+        }
+        os_free(texture->levels[0]);
+    }
+    for (uint32_t i = 0; i < streaming->retired_count; i++) {
+        glMakeTextureHandleNonResidentARB(streaming->retired[i].handle);
+        glDeleteTextures(1, &streaming->retired[i].texture);
+    }
+    os_free(streaming->staging);
+    memset(streaming, 0, sizeof(*streaming));
+}
+
+static void
+texture_streaming_print_stats(const struct TextureStreaming* streaming) {
+    const struct TextureStreamingStats* stats = &streaming->stats;
+    printf(
+        "texture memory = %.1f KiB resident (%.1f KiB at most) of %.1f KiB with every level, budget %.1f KiB\n",
+        (double)streaming->resident_size / 1024.0,
+        (double)stats->max_resident_size / 1024.0,
+        (double)streaming->full_size / 1024.0,
+        (double)streaming->budget / 1024.0
+    );
+    printf(
+        "loads = %llu (%.1f KiB uploaded, %.1f KiB copied on the gpu), levels dropped = %llu, loads cut short by the budget = %u\n",
+        (unsigned long long)stats->load_count,
+        (double)stats->uploaded_size / 1024.0,
+        (double)stats->copied_size / 1024.0,
+        (unsigned long long)stats->eviction_count,
+        stats->over_budget_count
+    );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// materials
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// every material is a row of a storage buffer indexed by the material index each object carries in its
+// uniform block (or next to its transform for the multi draw indirect draws), so nothing has to be bound
+// between draws with different textures and they can all be part of the same multi draw. with
+// GL_ARB_bindless_texture the row holds the resident handle of the texture of the material. without it
+// (llvmpipe for one) the textures are packed into the pages of a texture atlas, the layers of a single
+// texture array bound once, and the row holds the layer and the uv rectangle of the texture in it.
+// fragment shaders reading materials start with `materials_shader_header` which declares
+// `MATERIAL_TEXTURE(material, uv)` for whichever way the textures are sampled
+
+#define MATERIALS_MAX_COUNT 256
+#define MATERIALS_STORAGE_BINDING 1
+#define MATERIALS_ATLAS_PAGE_SIZE 256
+#define MATERIALS_ATLAS_MIP_COUNT 4 // NOTE: the atlas gutters are sized for this many levels
+#define MATERIALS_SAMPLER_PRESET SAMPLER_PRESET_ANISOTROPIC
+#define MATERIALS_ENCODE_FORMAT TEXTURE_FORMAT_BC7 // NOTE: for the rgba8 images (without `GPU_MIP_CHAINS`)
+#define MATERIALS_ENCODE_QUALITY TEXTURE_ENCODE_QUALITY_HIGH
+
+// NOTE: std430 layout of `Material` in the shaders
+struct MaterialData {
+    GLuint64 texture_handle; // NOTE: zero without bindless textures
+    uint32_t layer;
+    float uv_scale;
+    float uv_rect[4]; // NOTE: offset and scale of the texture in its atlas page
+};
+
+// NOTE: rgba8 texels. `file` is used instead when it's set and can be (uploaded with bindless textures, as is
+// or transcoded, decoded into the atlas otherwise)
+struct MaterialImage {
+    const unsigned char* rgba;
+    uint32_t width;
+    uint32_t height;
+    float uv_scale; // NOTE: how many times it repeats over the mesh uvs
+    const struct TextureFile* file;
+};
+
+struct Materials {
+    bool bindless;
+    uint32_t count;
+    struct TextureStreaming* streaming; // NOTE: has a texture per material with bindless textures
+    uint32_t streamed_textures[MATERIALS_MAX_COUNT];
+    float uv_scales[MATERIALS_MAX_COUNT];
+    GLuint texture_array; // NOTE: the atlas pages otherwise, draws bind it to unit 0
+    GLuint sampler; // NOTE: part of the bindless handles, or bound with the texture array
+    uint32_t atlas_page_count;
+    float atlas_usage; // NOTE: of the texels of every page, by the textures themselves
+    uint32_t file_count; // NOTE: images whose file was used
+    bool encoded; // NOTE: rgba8 images (and atlas pages) are compressed to `MATERIALS_ENCODE_FORMAT`
+    size_t texture_size; // NOTE: of every level of every texture on the gpu (when they're all resident)
+    size_t rgba8_texture_size; // NOTE: what they'd take as rgba8
+    uint64_t encode_error; // NOTE: squared error of the encoded levels
+    uint64_t encode_value_count;
+    GLuint buffer;
+};
+
+// NOTE: the first level of an image that fits in an atlas page with its gutters
+static uint32_t
+materials_atlas_level(uint32_t width, uint32_t height) {
+    uint32_t max_extent = MATERIALS_ATLAS_PAGE_SIZE - 2 * (1u << (MATERIALS_ATLAS_MIP_COUNT - 1));
+    uint32_t level = 0;
+    while (mip_level_extent(width, level) > max_extent || mip_level_extent(height, level) > max_extent) {
+        level += 1;
+    }
+    return level;
+}
+
+// NOTE: the level count of a file image when that level isn't in the file or it can't be decoded
+static uint32_t
+materials_atlas_file_level(const struct TextureFile* file) {
+    if (!texture_format_infos[file->format].decodable) {
+        return file->level_count;
+    }
+    uint32_t level = materials_atlas_level(file->width, file->height);
+    return level < file->level_count ? level : file->level_count;
+}
+
+// NOTE: packs the images into as few atlas pages as they fit and uploads them with their mip chains as
+// the layers of the texture array
+static void
+materials_init_atlas(struct Materials* materials, const struct MaterialImage* images, struct MaterialData* material_data, struct JobSystem* job_system) {
+    uint32_t count = materials->count;
+    size_t page_chain_size = mip_chain_size(MATERIALS_ATLAS_PAGE_SIZE, MATERIALS_ATLAS_PAGE_SIZE, MATERIALS_ATLAS_MIP_COUNT);
+    size_t decoded_size = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const struct TextureFile* file = images[i].file;
+        if (file && materials_atlas_file_level(file) < file->level_count) {
+            uint32_t level = materials_atlas_file_level(file);
+            decoded_size += (size_t)mip_level_extent(file->width, level) * mip_level_extent(file->height, level) * 4;
+        } else if (materials_atlas_level(images[i].width, images[i].height) > 0) {
+            decoded_size += mip_chain_size(images[i].width, images[i].height, materials_atlas_level(images[i].width, images[i].height) + 1);
+        }
+    }
+    size_t scratch_size =
+        sizeof(struct AtlasPacker) +
+        count * (sizeof(struct AtlasPlacement) + 2 * sizeof(uint32_t) + sizeof(uint64_t) + sizeof(unsigned char*)) +
+        page_chain_size + decoded_size + 256;
+    struct LinearArena scratch = {.base = os_alloc(scratch_size), .capacity = scratch_size};
+    struct AtlasPacker* packer = LINEAR_ALLOC(&scratch, struct AtlasPacker, 1);
+    struct AtlasPlacement* placements = LINEAR_ALLOC(&scratch, struct AtlasPlacement, count);
+    uint32_t* widths = LINEAR_ALLOC(&scratch, uint32_t, count);
+    uint32_t* heights = LINEAR_ALLOC(&scratch, uint32_t, count);
+    const unsigned char** rgbas = LINEAR_ALLOC(&scratch, const unsigned char*, count);
+    unsigned char* page_chain = LINEAR_ALLOC(&scratch, unsigned char, page_chain_size);
+    for (uint32_t i = 0; i < count; i++) {
+        const struct TextureFile* file = images[i].file;
+        uint32_t level = file ? materials_atlas_file_level(file) : 0;
+        if (file && level < file->level_count) {
+            widths[i] = mip_level_extent(file->width, level);
+            heights[i] = mip_level_extent(file->height, level);
+            unsigned char* decoded = LINEAR_ALLOC(&scratch, unsigned char, (size_t)widths[i] * heights[i] * 4);
+            texture_file_decode_level(file, level, decoded);
+            rgbas[i] = decoded;
+            materials->file_count += 1;
+        } else if (materials_atlas_level(images[i].width, images[i].height) > 0) {
+            // NOTE: rgba8 images too big for a page (decoded from image files) are mipped down until they fit
+            uint32_t width = images[i].width;
+            uint32_t height = images[i].height;
+            level = materials_atlas_level(width, height);
+            unsigned char* chain = LINEAR_ALLOC(&scratch, unsigned char, mip_chain_size(width, height, level + 1));
+            memcpy(chain, images[i].rgba, (size_t)width * height * 4);
+            mip_chain_generate(chain, width, height, level + 1);
+            widths[i] = mip_level_extent(width, level);
+            heights[i] = mip_level_extent(height, level);
+            rgbas[i] = chain + mip_chain_size(width, height, level);
+        } else {
+            widths[i] = images[i].width;
+            heights[i] = images[i].height;
+            rgbas[i] = images[i].rgba;
+        }
+    }
+    uint32_t block_extent = materials->encoded ? texture_format_infos[MATERIALS_ENCODE_FORMAT].block_width : 1;
+    atlas_packer_init(packer, MATERIALS_ATLAS_PAGE_SIZE, MATERIALS_ATLAS_PAGE_SIZE, ATLAS_MAX_PAGES, MATERIALS_ATLAS_MIP_COUNT, block_extent);
+    ASSERT(atlas_packer_add_all(packer, widths, heights, count, placements, &scratch));
+
+    glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &materials->texture_array);
+    glTextureStorage3D(
+        materials->texture_array,
+        MATERIALS_ATLAS_MIP_COUNT,
+        materials->encoded ? texture_format_infos[MATERIALS_ENCODE_FORMAT].internal_format : GL_RGBA8,
+        MATERIALS_ATLAS_PAGE_SIZE,
+        MATERIALS_ATLAS_PAGE_SIZE,
+        (GLsizei)packer->page_count
+    );
+    uint64_t used_area = 0;
+    for (uint32_t page = 0; page < packer->page_count; page++) {
+        memset(page_chain, 0, (size_t)MATERIALS_ATLAS_PAGE_SIZE * MATERIALS_ATLAS_PAGE_SIZE * 4);
+        for (uint32_t i = 0; i < count; i++) {
+            if (placements[i].page == page) {
+                atlas_blit(packer, page_chain, &placements[i], rgbas[i]);
+            }
+        }
+#if defined(GPU_MIP_CHAINS)
+        mip_chain_upload(materials->texture_array, (int32_t)page, page_chain, MATERIALS_ATLAS_PAGE_SIZE, MATERIALS_ATLAS_PAGE_SIZE, /* level_count */ 1);
+#else
+        mip_chain_generate(page_chain, MATERIALS_ATLAS_PAGE_SIZE, MATERIALS_ATLAS_PAGE_SIZE, MATERIALS_ATLAS_MIP_COUNT);
+        if (materials->encoded) {
+            materials->texture_size += mip_chain_upload_encoded(
+                materials->texture_array,
+                (int32_t)page,
+                page_chain,
+                MATERIALS_ATLAS_PAGE_SIZE,
+                MATERIALS_ATLAS_PAGE_SIZE,
+                MATERIALS_ATLAS_MIP_COUNT,
+                MATERIALS_ENCODE_FORMAT,
+                MATERIALS_ENCODE_QUALITY,
+                job_system,
+                &materials->encode_error
+            );
+            materials->encode_value_count += (uint64_t)page_chain_size;
+        } else {
+            mip_chain_upload(materials->texture_array, (int32_t)page, page_chain, MATERIALS_ATLAS_PAGE_SIZE, MATERIALS_ATLAS_PAGE_SIZE, MATERIALS_ATLAS_MIP_COUNT);
+            materials->texture_size += page_chain_size;
+        }
+#endif
+        materials->rgba8_texture_size += page_chain_size;
+        used_area += packer->pages[page].used_area;
+    }
+#if defined(GPU_MIP_CHAINS)
+    glGenerateTextureMipmap(materials->texture_array);
+    materials->texture_size = materials->rgba8_texture_size;
+#endif
+    for (uint32_t i = 0; i < count; i++) {
+        material_data[i].layer = placements[i].page;
+        atlas_placement_uv_rect(packer, &placements[i], material_data[i].uv_rect);
+    }
+    materials->atlas_page_count = packer->page_count;
+    materials->atlas_usage = (float)((double)used_area / ((double)packer->page_count * MATERIALS_ATLAS_PAGE_SIZE * MATERIALS_ATLAS_PAGE_SIZE));
+
+    os_free(scratch.base);
+}
+
+// NOTE: the uvs of atlas textures are wrapped in the shader so their sampler clamps at the page edges.
+// bindless textures are streamed by `streaming`. images are encoded with the workers of `job_system`,
+// called from worker 0
+static void
+materials_init(
+    struct Materials* materials,
+    const struct MaterialImage* images,
+    uint32_t count,
+    struct SamplerCache* samplers,
+    struct TextureStreaming* streaming,
+    struct JobSystem* job_system
+) {
+    memset(materials, 0, sizeof(*materials));
+    ASSERT(count > 0 && count <= MATERIALS_MAX_COUNT);
+    materials->count = count;
+#if !defined(GPU_MIP_CHAINS)
+    materials->encoded = texture_format_supported[MATERIALS_ENCODE_FORMAT];
+#endif
+
+    bool bindless = gl_has_extension("GL_ARB_bindless_texture");
+    #define X(type, name) bindless = bindless && LOAD_OPTIONAL_PROC(type, name);
+    GL_ARB_BINDLESS_TEXTURE_PROCS
+    #undef X
+    materials->bindless = bindless;
+    materials->sampler = sampler_cache_preset(samplers, MATERIALS_SAMPLER_PRESET, bindless ? GL_REPEAT : GL_CLAMP_TO_EDGE);
+
+    struct MaterialData material_data[MATERIALS_MAX_COUNT];
+    memset(material_data, 0, sizeof(material_data));
+    for (uint32_t i = 0; i < count; i++) {
+        material_data[i].uv_scale = images[i].uv_scale;
+        material_data[i].uv_rect[2] = 1.0f;
+        material_data[i].uv_rect[3] = 1.0f;
+        materials->uv_scales[i] = images[i].uv_scale;
+    }
+    if (bindless) {
+        size_t chain_capacity = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            const struct TextureFile* file = images[i].file;
+            size_t chain_size = file ?
+                texture_file_transcode_size(file) :
+                mip_chain_size(images[i].width, images[i].height, mip_level_count(images[i].width, images[i].height));
+            chain_capacity = chain_size > chain_capacity ? chain_size : chain_capacity;
+        }
+        unsigned char* chain = os_alloc(chain_capacity);
+        unsigned char* blocks = materials->encoded ? os_alloc(chain_capacity) : NULL;
+
+        // NOTE: the levels are handed to the streaming which only keeps the coarsest ones on the gpu until
+        // the material is seen up close. handles can change as levels come and go so the buffer is updated
+        materials->streaming = streaming;
+        for (uint32_t i = 0; i < count; i++) {
+            enum TextureFormat format = TEXTURE_FORMAT_RGBA8;
+            uint32_t width = images[i].width;
+            uint32_t height = images[i].height;
+            uint32_t level_count = mip_level_count(width, height);
+            const unsigned char* levels[MIP_CHAIN_MAX_LEVELS];
+            size_t level_sizes[MIP_CHAIN_MAX_LEVELS];
+            const struct TextureFile* file = images[i].file;
+            if (file) {
+                // NOTE: files in formats that aren't supported are transcoded, their error counts with the
+                // encoded images
+                materials->encode_error += texture_file_sampleable_levels(file, chain, job_system, &format, levels, level_sizes);
+                width = file->width;
+                height = file->height;
+                level_count = file->level_count;
+                if (format != file->format) {
+                    materials->encode_value_count += (uint64_t)mip_chain_size(width, height, level_count);
+                }
+                materials->file_count += 1;
+            } else {
+                memcpy(chain, images[i].rgba, (size_t)width * height * 4);
+#if defined(GPU_MIP_CHAINS)
+                // NOTE: the gpu made levels are read back as the cpu copy the streaming uploads from
+                GLuint scratch_texture = 0;
+                glCreateTextures(GL_TEXTURE_2D, 1, &scratch_texture);
+                glTextureStorage2D(scratch_texture, (GLsizei)level_count, GL_RGBA8, (GLsizei)width, (GLsizei)height);
+                mip_chain_upload(scratch_texture, /* layer */ -1, chain, width, height, /* level_count */ 1);
+                glGenerateTextureMipmap(scratch_texture);
+                unsigned char* chain_level = chain;
+                for (uint32_t level = 0; level < level_count; level++) {
+                    size_t level_size = (size_t)mip_level_extent(width, level) * mip_level_extent(height, level) * 4;
+                    glGetTextureImage(scratch_texture, (GLint)level, GL_RGBA, GL_UNSIGNED_BYTE, (GLsizei)level_size, chain_level);
+                    chain_level += level_size;
+                }
+                glDeleteTextures(1, &scratch_texture);
+#else
+                mip_chain_generate(chain, width, height, level_count);
+#endif
+                const unsigned char* level_texels = chain;
+                unsigned char* level_blocks = blocks;
+                for (uint32_t level = 0; level < level_count; level++) {
+                    uint32_t level_width = mip_level_extent(width, level);
+                    uint32_t level_height = mip_level_extent(height, level);
+                    if (materials->encoded) {
+                        level_sizes[level] = texture_level_size(MATERIALS_ENCODE_FORMAT, level_width, level_height);
+                        materials->encode_error += texture_encode(
+                            MATERIALS_ENCODE_FORMAT,
+                            MATERIALS_ENCODE_QUALITY,
+                            level_texels,
+                            level_width,
+                            level_height,
+                            level_blocks,
+                            job_system
+                        );
+                        levels[level] = level_blocks;
+                        level_blocks += level_sizes[level];
+                    } else {
+                        level_sizes[level] = (size_t)level_width * level_height * 4;
+                        levels[level] = level_texels;
+                    }
+                    level_texels += (size_t)level_width * level_height * 4;
+                }
+                if (materials->encoded) {
+                    format = MATERIALS_ENCODE_FORMAT;
+                    materials->encode_value_count += (uint64_t)mip_chain_size(width, height, level_count);
+                }
+            }
+            for (uint32_t level = 0; level < level_count; level++) {
+                materials->texture_size += level_sizes[level];
+            }
+            materials->rgba8_texture_size += mip_chain_size(width, height, level_count);
+
+            uint32_t streamed_texture = texture_streaming_add(streaming, format, width, height, level_count, levels, level_sizes, materials->sampler);
+            materials->streamed_textures[i] = streamed_texture;
+            material_data[i].texture_handle = streaming->textures[streamed_texture].handle;
+            streaming->textures[streamed_texture].handle_changed = false;
+        }
+        os_free(chain);
+        os_free(blocks);
+    } else {
+        materials_init_atlas(materials, images, material_data, job_system);
+    }
+
+    glCreateBuffers(1, &materials->buffer);
+    glNamedBufferStorage(materials->buffer, count * sizeof(struct MaterialData), material_data, bindless ? GL_DYNAMIC_STORAGE_BIT : 0);
+}
+
+static void
+materials_deinit(struct Materials* materials) {
+    glDeleteTextures(1, &materials->texture_array);
+    glDeleteBuffers(1, &materials->buffer);
+    memset(materials, 0, sizeof(*materials));
+}
+
+// NOTE: once per frame after the scene update. `screen_sizes` is what the scene update measured, the biggest
+// an object with each material is on screen (in pixels) for each of `row_count` workers. the mesh uvs are
+// taken to go once across the object so a material texture spans it `uv_scale` times. updates the handles of
+// the textures the streaming replaced. the levels are read by the workers of `job_system`, called from worker 0
+static void
+materials_stream(struct Materials* materials, const float* screen_sizes, uint32_t row_count, struct JobSystem* job_system) {
+    if (!materials->bindless) {
+        return;
+    }
+    struct TextureStreaming* streaming = materials->streaming;
+    for (uint32_t i = 0; i < materials->count; i++) {
+        float screen_size = 0.0f;
+        for (uint32_t row = 0; row < row_count; row++) {
+            screen_size = fmaxf(screen_size, screen_sizes[row * materials->count + i]);
+        }
+        if (screen_size > 0.0f) {
+            const struct StreamedTexture* texture = &streaming->textures[materials->streamed_textures[i]];
+            float texels = (float)(texture->width > texture->height ? texture->width : texture->height) * materials->uv_scales[i];
+            texture_streaming_request(streaming, materials->streamed_textures[i], texels / screen_size);
+        }
+    }
+    texture_streaming_update(streaming, job_system);
+
+    for (uint32_t i = 0; i < materials->count; i++) {
+        struct StreamedTexture* texture = &streaming->textures[materials->streamed_textures[i]];
+        if (texture->handle_changed) {
+            // NOTE: the handle is the first member of a row
+            glNamedBufferSubData(materials->buffer, (GLintptr)(i * sizeof(struct MaterialData)), sizeof(texture->handle), &texture->handle);
+            texture->handle_changed = false;
+        }
+    }
+}
+
+// NOTE: goes right after the `#version` line. the bindless handle comes from the material of the draw which
+// is the same for all of its invocations. atlas uvs are wrapped in the shader (the gutters hide the seams)
+// with the gradients of the unwrapped ones so the seams don't pick a smaller mip level either
+static const char*
+materials_shader_header(const struct Materials* materials) {
+    return materials->bindless ?
+        "#extension GL_ARB_bindless_texture : require\n"
+        "#define MATERIAL_TEXTURE(material, uv) texture(sampler2D(material.texture_handle), (uv))\n" :
+        "layout(binding = 0) uniform sampler2DArray material_textures;\n"
+        "#define MATERIAL_TEXTURE(material, uv) textureGrad(\\\n"
+        "    material_textures,\\\n"
+        "    vec3(fract(uv) * material.uv_rect.zw + material.uv_rect.xy, float(material.layer)),\\\n"
+        "    dFdx(uv) * material.uv_rect.zw,\\\n"
+        "    dFdy(uv) * material.uv_rect.zw\\\n"
+        ")\n";
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// render target pool
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// offscreen textures (and the framebuffers made of them) are pooled by format, samples and size so a
+// frame can ask for what it needs every frame without reallocating. new targets get some headroom and a
+// target keeps being handed out for requests that fit in it until they waste too much of it, so dragging
+// a window edge doesn't reallocate every frame. only the requested rectangle of a bigger target is
+// rendered to (passes sampling one have to scale their uvs by the requested over the allocated size).
+// targets and framebuffers unused for a while are released
+
+#define RENDER_TARGET_POOL_MAX_TARGETS 32
+#define RENDER_TARGET_POOL_MAX_FRAMEBUFFERS 32
+#define RENDER_TARGET_MAX_COLOR_ATTACHMENTS 8
+#define RENDER_TARGET_POOL_RELEASE_FRAMES 120 // NOTE: about two seconds at 60hz
+#define RENDER_TARGET_POOL_GRANULARITY 64
+#define RENDER_TARGET_POOL_HEADROOM_DIVISOR 8 // NOTE: new targets are 1/8 bigger in each dimension
+#define RENDER_TARGET_POOL_MAX_WASTE 2 // NOTE: targets are handed out down to requests of half their area
+#define RENDER_TARGET_POOL_NULL UINT32_MAX
+
+struct RenderTargetDesc {
+    GLenum format;
+    GLsizei width;
+    GLsizei height;
+    GLsizei samples; // NOTE: 0 or 1 for single sampled
+};
+
+struct RenderTarget {
+    GLuint texture;
+    struct RenderTargetDesc desc; // NOTE: allocated size, at least the size it was requested with
+    bool in_use;
+    uint64_t last_used_frame;
+};
+
+struct RenderTargetFramebuffer {
+    GLuint framebuffer;
+    GLuint color_textures[RENDER_TARGET_MAX_COLOR_ATTACHMENTS];
+    uint32_t color_count;
+    GLuint depth_texture;
+    uint64_t last_used_frame;
+};
+
+struct RenderTargetPoolStats {
+    uint32_t allocation_count;
+    uint32_t release_count;
+    uint32_t framebuffer_allocation_count;
+    uint32_t frame_allocation_count;
+    uint32_t frame_release_count;
+    uint32_t churn_frame_count; // NOTE: frames that allocated or released anything
+    uint64_t allocated_bytes;
+    uint64_t max_allocated_bytes;
+};
+
+struct RenderTargetPool {
+    struct RenderTarget targets[RENDER_TARGET_POOL_MAX_TARGETS];
+    uint32_t target_count;
+    struct RenderTargetFramebuffer framebuffers[RENDER_TARGET_POOL_MAX_FRAMEBUFFERS];
+    uint32_t framebuffer_count;
+    uint64_t frame_number;
+    struct RenderTargetPoolStats stats;
+};
+
+static uint32_t
+render_target_format_size(GLenum format) {
+    switch (format) {
+        case GL_R8: return 1;
+        case GL_RG8: return 2;
+        case GL_RGBA8: return 4;
+        case GL_SRGB8_ALPHA8: return 4;
+        case GL_R11F_G11F_B10F: return 4;
+        case GL_RGB10_A2: return 4;
+        case GL_R32F: return 4;
+        case GL_R32UI: return 4;
+        case GL_RG16F: return 4;
+        case GL_RGBA16F: return 8;
+        case GL_RGBA32F: return 16;
+        case GL_DEPTH_COMPONENT16: return 2;
+        case GL_DEPTH_COMPONENT24: return 4;
+        case GL_DEPTH_COMPONENT32F: return 4;
+        case GL_DEPTH24_STENCIL8: return 4;
+        case GL_DEPTH32F_STENCIL8: return 8;
+        default:
+            UNREACHABLE;
+            return 0;
+    }
+}
+
+static uint64_t
+render_target_size(const struct RenderTargetDesc* desc) {
+    uint64_t samples = desc->samples > 1 ? (uint64_t)desc->samples : 1;
+    return (uint64_t)desc->width * (uint64_t)desc->height * samples * render_target_format_size(desc->format);
+}
+
+static void
+render_target_pool_init(struct RenderTargetPool* pool) {
+    memset(pool, 0, sizeof(*pool));
+}
+
+static void
+render_target_pool_deinit(struct RenderTargetPool* pool) {
+    for (uint32_t i = 0; i < pool->framebuffer_count; i++) {
+        glDeleteFramebuffers(1, &pool->framebuffers[i].framebuffer);
+    }
+    for (uint32_t i = 0; i < pool->target_count; i++) {
+        glDeleteTextures(1, &pool->targets[i].texture);
+    }
+    memset(pool, 0, sizeof(*pool));
+}
+
+// NOTE: every target is free again at the start of a frame
+static void
+render_target_pool_begin_frame(struct RenderTargetPool* pool) {
+    pool->frame_number += 1;
+    pool->stats.frame_allocation_count = 0;
+    pool->stats.frame_release_count = 0;
+    for (uint32_t i = 0; i < pool->target_count; i++) {
+        pool->targets[i].in_use = false;
+    }
+}
+
+// NOTE: hands out the smallest free target the request fits in without wasting too much of it,
+// or allocates a new one with headroom. targets keep 1 sample for single sampled so 0 and 1 share them
+static uint32_t
+render_target_pool_acquire(struct RenderTargetPool* pool, const struct RenderTargetDesc* desc) {
+    ASSERT(desc->width > 0 && desc->height > 0);
+    GLsizei samples = desc->samples > 1 ? desc->samples : 1;
+    uint64_t requested_area = (uint64_t)desc->width * (uint64_t)desc->height;
+    uint32_t best = RENDER_TARGET_POOL_NULL;
+    uint64_t best_area = UINT64_MAX;
+    for (uint32_t i = 0; i < pool->target_count; i++) {
+        const struct RenderTarget* target = &pool->targets[i];
+        uint64_t area = (uint64_t)target->desc.width * (uint64_t)target->desc.height;
+        bool fits =
+            !target->in_use &&
+            target->desc.format == desc->format &&
+            target->desc.samples == samples &&
+            target->desc.width >= desc->width &&
+            target->desc.height >= desc->height &&
+            area <= requested_area * RENDER_TARGET_POOL_MAX_WASTE;
+        if (fits && area < best_area) {
+            best = i;
+            best_area = area;
+        }
+    }
+
+    if (best == RENDER_TARGET_POOL_NULL) {
+        ASSERT(pool->target_count < RENDER_TARGET_POOL_MAX_TARGETS);
+        best = pool->target_count;
+        pool->target_count += 1;
+
+        struct RenderTarget* target = &pool->targets[best];
+        target->desc = *desc;
+        target->desc.samples = samples;
+        target->desc.width = ALIGN_UP(desc->width + desc->width / RENDER_TARGET_POOL_HEADROOM_DIVISOR, RENDER_TARGET_POOL_GRANULARITY);
+        target->desc.height = ALIGN_UP(desc->height + desc->height / RENDER_TARGET_POOL_HEADROOM_DIVISOR, RENDER_TARGET_POOL_GRANULARITY);
+        if (samples > 1) {
+            glCreateTextures(GL_TEXTURE_2D_MULTISAMPLE, 1, &target->texture);
+            glTextureStorage2DMultisample(target->texture, samples, desc->format, target->desc.width, target->desc.height, /* fixedsamplelocations */ GL_TRUE);
+        } else {
+            glCreateTextures(GL_TEXTURE_2D, 1, &target->texture);
+            glTextureStorage2D(target->texture, /* levels */ 1, desc->format, target->desc.width, target->desc.height);
+        }
+
+        pool->stats.allocation_count += 1;
+        pool->stats.frame_allocation_count += 1;
+        pool->stats.allocated_bytes += render_target_size(&target->desc);
+        if (pool->stats.allocated_bytes > pool->stats.max_allocated_bytes) {
+            pool->stats.max_allocated_bytes = pool->stats.allocated_bytes;
+        }
+    }
+
+    struct RenderTarget* target = &pool->targets[best];
+    target->in_use = true;
+    target->last_used_frame = pool->frame_number;
+    return best;
+}
+
+// NOTE: gives the target back for the rest of the frame (eg. to alias it)
+static void
+render_target_pool_release(struct RenderTargetPool* pool, uint32_t target) {
+    ASSERT(pool->targets[target].in_use);
+    pool->targets[target].in_use = false;
+}
+
+// NOTE: a framebuffer with exactly these attachments, `depth_texture` can be 0
+static GLuint
+render_target_pool_framebuffer(struct RenderTargetPool* pool, const GLuint* color_textures, uint32_t color_count, GLuint depth_texture) {
+    ASSERT(color_count <= RENDER_TARGET_MAX_COLOR_ATTACHMENTS);
+    for (uint32_t i = 0; i < pool->framebuffer_count; i++) {
+        struct RenderTargetFramebuffer* framebuffer = &pool->framebuffers[i];
+        bool matches =
+            framebuffer->color_count == color_count &&
+            framebuffer->depth_texture == depth_texture &&
+            memcmp(framebuffer->color_textures, color_textures, color_count * sizeof(GLuint)) == 0;
+        if (matches) {
+            framebuffer->last_used_frame = pool->frame_number;
+            return framebuffer->framebuffer;
+        }
+    }
+
+    ASSERT(pool->framebuffer_count < RENDER_TARGET_POOL_MAX_FRAMEBUFFERS);
+    struct RenderTargetFramebuffer* framebuffer = &pool->framebuffers[pool->framebuffer_count];
+    pool->framebuffer_count += 1;
+    memset(framebuffer, 0, sizeof(*framebuffer));
+    glCreateFramebuffers(1, &framebuffer->framebuffer);
+
+    GLenum draw_buffers[RENDER_TARGET_MAX_COLOR_ATTACHMENTS];
+    for (uint32_t i = 0; i < color_count; i++) {
+        glNamedFramebufferTexture(framebuffer->framebuffer, GL_COLOR_ATTACHMENT0 + i, color_textures[i], /* level */ 0);
+        draw_buffers[i] = GL_COLOR_ATTACHMENT0 + i;
+        framebuffer->color_textures[i] = color_textures[i];
+    }
+    if (depth_texture != 0) {
+        glNamedFramebufferTexture(framebuffer->framebuffer, GL_DEPTH_ATTACHMENT, depth_texture, /* level */ 0);
+    }
+    glNamedFramebufferDrawBuffers(framebuffer->framebuffer, (GLsizei)color_count, draw_buffers);
+    glNamedFramebufferReadBuffer(framebuffer->framebuffer, color_count > 0 ? GL_COLOR_ATTACHMENT0 : GL_NONE);
+    ASSERT(glCheckNamedFramebufferStatus(framebuffer->framebuffer, GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+
+    framebuffer->color_count = color_count;
+    framebuffer->depth_texture = depth_texture;
+    framebuffer->last_used_frame = pool->frame_number;
+    pool->stats.framebuffer_allocation_count += 1;
+    return framebuffer->framebuffer;
+}
+
+static bool
+render_target_framebuffer_uses(const struct RenderTargetFramebuffer* framebuffer, GLuint texture) {
+    for (uint32_t i = 0; i < framebuffer->color_count; i++) {
+        if (framebuffer->color_textures[i] == texture) {
+            return true;
+        }
+    }
+    return framebuffer->depth_texture == texture;
+}
+
+// NOTE: releases what wasn't used for `RENDER_TARGET_POOL_RELEASE_FRAMES` frames (swap removed),
+// framebuffers go with any of their textures
+static void
+render_target_pool_end_frame(struct RenderTargetPool* pool) {
+    for (uint32_t i = 0; i < pool->target_count;) {
+        struct RenderTarget* target = &pool->targets[i];
+        if (pool->frame_number - target->last_used_frame < RENDER_TARGET_POOL_RELEASE_FRAMES) {
+            i += 1;
+            continue;
+        }
+        for (uint32_t j = 0; j < pool->framebuffer_count; j++) {
+            if (render_target_framebuffer_uses(&pool->framebuffers[j], target->texture)) {
+                // NOTE: makes it look unused so it's released below
+                pool->framebuffers[j].last_used_frame = 0;
+            }
+        }
+        glDeleteTextures(1, &target->texture);
+        pool->stats.allocated_bytes -= render_target_size(&target->desc);
+        pool->stats.release_count += 1;
+        pool->stats.frame_release_count += 1;
+        pool->target_count -= 1;
+        *target = pool->targets[pool->target_count];
+    }
+    for (uint32_t i = 0; i < pool->framebuffer_count;) {
+        struct RenderTargetFramebuffer* framebuffer = &pool->framebuffers[i];
+        if (framebuffer->last_used_frame != 0 && pool->frame_number - framebuffer->last_used_frame < RENDER_TARGET_POOL_RELEASE_FRAMES) {
+            i += 1;
+            continue;
+        }
+        glDeleteFramebuffers(1, &framebuffer->framebuffer);
+        pool->framebuffer_count -= 1;
+        *framebuffer = pool->framebuffers[pool->framebuffer_count];
+    }
+
+    // NOTE: reports churn as it happens, eg. while a window edge is dragged
+    struct RenderTargetPoolStats* stats = &pool->stats;
+    if (stats->frame_allocation_count > 0 || stats->frame_release_count > 0) {
+        stats->churn_frame_count += 1;
+        printf(
+            "render target pool: frame %llu allocated %u released %u, %u targets (%llu KB)\n",
+            (unsigned long long)pool->frame_number,
+            stats->frame_allocation_count,
+            stats->frame_release_count,
+            pool->target_count,
+            (unsigned long long)(stats->allocated_bytes / 1024)
+        );
+    }
+}
+
+static void
+render_target_pool_print_stats(const struct RenderTargetPool* pool) {
+    const struct RenderTargetPoolStats* stats = &pool->stats;
+    printf(
+        "render target pool: %u allocations, %u releases, %u framebuffers created, churn in %u of %llu frames, "
+        "%u targets (%llu KB), peak %llu KB\n",
+        stats->allocation_count,
+        stats->release_count,
+        stats->framebuffer_allocation_count,
+        stats->churn_frame_count,
+        (unsigned long long)pool->frame_number,
+        pool->target_count,
+        (unsigned long long)(stats->allocated_bytes / 1024),
+        (unsigned long long)(stats->max_allocated_bytes / 1024)
+    );
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// render graph
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// the frame is declared every frame as passes that read and write textures and buffers, then compiled:
+// passes whose results nobody reads are culled, transient textures get their lifetime (first to last
+// pass using them) and are aliased onto the same render target pool targets when lifetimes don't overlap.
+// gl keeps framebuffer writes, copies and draws coherent by itself, only shader image and storage buffer
+// writes need a `glMemoryBarrier` and only with the bits of how they're read next, so that's all the graph
+// inserts. finally the live passes are executed in declaration order
+
+#define RENDER_GRAPH_MAX_PASSES 32
+#define RENDER_GRAPH_MAX_RESOURCES 64
+#define RENDER_GRAPH_MAX_PASS_ACCESSES 16
+#define RENDER_GRAPH_NULL UINT32_MAX
+
+enum RenderGraphPassType {
+    RENDER_GRAPH_PASS_GRAPHICS,
+    RENDER_GRAPH_PASS_COMPUTE,
+};
+
+enum RenderGraphUsage {
+    RENDER_GRAPH_USAGE_COLOR_ATTACHMENT,
+    RENDER_GRAPH_USAGE_DEPTH_ATTACHMENT,
+    RENDER_GRAPH_USAGE_SAMPLED,
+    RENDER_GRAPH_USAGE_STORAGE_IMAGE,
+    RENDER_GRAPH_USAGE_STORAGE_BUFFER,
+    RENDER_GRAPH_USAGE_UNIFORM_BUFFER,
+    RENDER_GRAPH_USAGE_VERTEX_BUFFER,
+    RENDER_GRAPH_USAGE_INDEX_BUFFER,
+    RENDER_GRAPH_USAGE_INDIRECT_BUFFER,
+    RENDER_GRAPH_USAGE_TRANSFER, // NOTE: blits, copies and buffer or texture updates
+};
+
+struct RenderGraphResource {
+    const char* name;
+    bool is_texture;
+    bool imported;
+    struct RenderTargetDesc desc;
+    GLuint object; // NOTE: 0 with `imported` is the default framebuffer
+    uint32_t read_count;
+    uint32_t first_pass;
+    uint32_t last_pass;
+    uint32_t physical_texture;
+    bool incoherent_write_pending;
+    GLbitfield synchronized_barriers; // NOTE: barrier bits issued since the last incoherent write
+};
+
+struct RenderGraphAccess {
+    uint32_t resource;
+    enum RenderGraphUsage usage;
+    bool write;
+};
+
+struct RenderGraph;
+
+struct RenderGraphPass {
+    const char* name;
+    enum RenderGraphPassType type;
+    void (*execute)(void* data, const struct RenderGraph* graph, uint32_t pass);
+    void* data;
+    struct RenderGraphAccess accesses[RENDER_GRAPH_MAX_PASS_ACCESSES];
+    uint32_t access_count;
+    uint32_t ref_count;
+    bool side_effects;
+    bool culled;
+    GLbitfield barriers;
+    GLuint framebuffer;
+};
+
+struct RenderGraphStats {
+    uint32_t pass_count;
+    uint32_t culled_pass_count;
+    uint32_t transient_texture_count;
+    uint32_t physical_texture_count;
+    uint32_t barrier_count;
+};
+
+struct RenderGraph {
+    struct RenderGraphPass passes[RENDER_GRAPH_MAX_PASSES];
+    uint32_t pass_count;
+    struct RenderGraphResource resources[RENDER_GRAPH_MAX_RESOURCES];
+    uint32_t resource_count;
+    struct RenderTargetPool pool;
+    struct RenderGraphStats stats;
+};
+
+// NOTE: what has to be in `glMemoryBarrier` to see incoherent writes when accessing a resource this way
+static GLbitfield
+render_graph_usage_barrier(enum RenderGraphUsage usage, bool is_texture) {
+    switch (usage) {
+        case RENDER_GRAPH_USAGE_COLOR_ATTACHMENT: return GL_FRAMEBUFFER_BARRIER_BIT;
+        case RENDER_GRAPH_USAGE_DEPTH_ATTACHMENT: return GL_FRAMEBUFFER_BARRIER_BIT;
+        case RENDER_GRAPH_USAGE_SAMPLED: return GL_TEXTURE_FETCH_BARRIER_BIT;
+        case RENDER_GRAPH_USAGE_STORAGE_IMAGE: return GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+        case RENDER_GRAPH_USAGE_STORAGE_BUFFER: return GL_SHADER_STORAGE_BARRIER_BIT;
+        case RENDER_GRAPH_USAGE_UNIFORM_BUFFER: return GL_UNIFORM_BARRIER_BIT;
+        case RENDER_GRAPH_USAGE_VERTEX_BUFFER: return GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT;
+        case RENDER_GRAPH_USAGE_INDEX_BUFFER: return GL_ELEMENT_ARRAY_BARRIER_BIT;
+        case RENDER_GRAPH_USAGE_INDIRECT_BUFFER: return GL_COMMAND_BARRIER_BIT;
+        case RENDER_GRAPH_USAGE_TRANSFER: return is_texture ? GL_TEXTURE_UPDATE_BARRIER_BIT : GL_BUFFER_UPDATE_BARRIER_BIT;
+        default:
+            UNREACHABLE;
+            return 0;
+    }
+}
+
+// NOTE: writes through image stores and storage buffers are the only ones gl doesn't order by itself
+static bool
+render_graph_usage_is_incoherent(enum RenderGraphUsage usage) {
+    return usage == RENDER_GRAPH_USAGE_STORAGE_IMAGE || usage == RENDER_GRAPH_USAGE_STORAGE_BUFFER;
+}
+
+static void
+render_graph_init(struct RenderGraph* graph) {
+    memset(graph, 0, sizeof(*graph));
+    render_target_pool_init(&graph->pool);
+}
+
+static void
+render_graph_deinit(struct RenderGraph* graph) {
+    render_target_pool_deinit(&graph->pool);
+    memset(graph, 0, sizeof(*graph));
+}
+
+// NOTE: forgets the passes and resources of the previous frame, the pooled targets are kept
+static void
+render_graph_begin(struct RenderGraph* graph) {
+    graph->pass_count = 0;
+    graph->resource_count = 0;
+    render_target_pool_begin_frame(&graph->pool);
+}
+
+static uint32_t
+render_graph_add_resource(struct RenderGraph* graph, const char* name, bool is_texture, bool imported) {
+    ASSERT(graph->resource_count < RENDER_GRAPH_MAX_RESOURCES);
+    uint32_t index = graph->resource_count;
+    graph->resource_count += 1;
+    struct RenderGraphResource* resource = &graph->resources[index];
+    memset(resource, 0, sizeof(*resource));
+    resource->name = name;
+    resource->is_texture = is_texture;
+    resource->imported = imported;
+    resource->first_pass = RENDER_GRAPH_NULL;
+    resource->last_pass = RENDER_GRAPH_NULL;
+    resource->physical_texture = RENDER_GRAPH_NULL;
+    return index;
+}
+
+// NOTE: transient texture, only valid during the passes using it and aliased with others
+static uint32_t
+render_graph_create_texture(struct RenderGraph* graph, const char* name, struct RenderTargetDesc desc) {
+    uint32_t index = render_graph_add_resource(graph, name, /* is_texture */ true, /* imported */ false);
+    graph->resources[index].desc = desc;
+    return index;
+}
+
+static uint32_t
+render_graph_import_texture(struct RenderGraph* graph, const char* name, GLuint texture) {
+    uint32_t index = render_graph_add_resource(graph, name, /* is_texture */ true, /* imported */ true);
+    graph->resources[index].object = texture;
+    return index;
+}
+
+// NOTE: the default framebuffer, writing it is what keeps passes from being culled
+static uint32_t
+render_graph_import_backbuffer(struct RenderGraph* graph) {
+    return render_graph_import_texture(graph, "backbuffer", /* texture */ 0);
+}
+
+static uint32_t
+render_graph_import_buffer(struct RenderGraph* graph, const char* name, GLuint buffer) {
+    uint32_t index = render_graph_add_resource(graph, name, /* is_texture */ false, /* imported */ true);
+    graph->resources[index].object = buffer;
+    return index;
+}
+
+static uint32_t
+render_graph_add_pass(
+    struct RenderGraph* graph,
+    const char* name,
+    enum RenderGraphPassType type,
+    void (*execute)(void* data, const struct RenderGraph* graph, uint32_t pass),
+    void* data
+) {
+    ASSERT(graph->pass_count < RENDER_GRAPH_MAX_PASSES);
+    uint32_t index = graph->pass_count;
+    graph->pass_count += 1;
+    struct RenderGraphPass* pass = &graph->passes[index];
+    memset(pass, 0, sizeof(*pass));
+    pass->name = name;
+    pass->type = type;
+    pass->execute = execute;
+    pass->data = data;
+    return index;
+}
+
+static void
+render_graph_access(struct RenderGraph* graph, uint32_t pass_index, uint32_t resource, enum RenderGraphUsage usage, bool write) {
+    struct RenderGraphPass* pass = &graph->passes[pass_index];
+    ASSERT(resource < graph->resource_count);
+    ASSERT(pass->access_count < RENDER_GRAPH_MAX_PASS_ACCESSES);
+    struct RenderGraphAccess* access = &pass->accesses[pass->access_count];
+    pass->access_count += 1;
+    access->resource = resource;
+    access->usage = usage;
+    access->write = write;
+}
+
+static void
+render_graph_read(struct RenderGraph* graph, uint32_t pass, uint32_t resource, enum RenderGraphUsage usage) {
+    render_graph_access(graph, pass, resource, usage, /* write */ false);
+}
+
+static void
+render_graph_write(struct RenderGraph* graph, uint32_t pass, uint32_t resource, enum RenderGraphUsage usage) {
+    render_graph_access(graph, pass, resource, usage, /* write */ true);
+}
+
+static GLuint
+render_graph_pass_framebuffer(const struct RenderGraph* graph, uint32_t pass) {
+    return graph->passes[pass].framebuffer;
+}
+
+// NOTE: the texture or buffer behind a resource, transient textures only have one while compiled
+static GLuint
+render_graph_object(const struct RenderGraph* graph, uint32_t resource) {
+    return graph->resources[resource].object;
+}
+
+static void
+render_graph_cull(struct RenderGraph* graph) {
+    for (uint32_t i = 0; i < graph->pass_count; i++) {
+        struct RenderGraphPass* pass = &graph->passes[i];
+        for (uint32_t j = 0; j < pass->access_count; j++) {
+            const struct RenderGraphAccess* access = &pass->accesses[j];
+            if (access->write) {
+                pass->ref_count += 1;
+                pass->side_effects = pass->side_effects || graph->resources[access->resource].imported;
+            } else {
+                graph->resources[access->resource].read_count += 1;
+            }
+        }
+    }
+
+    // NOTE: resources nobody reads release their producers, which can make what those read unused too
+    uint32_t unused[RENDER_GRAPH_MAX_RESOURCES];
+    uint32_t unused_count = 0;
+    for (uint32_t i = 0; i < graph->resource_count; i++) {
+        if (graph->resources[i].read_count == 0) {
+            unused[unused_count] = i;
+            unused_count += 1;
+        }
+    }
+    while (unused_count > 0) {
+        unused_count -= 1;
+        uint32_t resource = unused[unused_count];
+        for (uint32_t i = 0; i < graph->pass_count; i++) {
+            struct RenderGraphPass* pass = &graph->passes[i];
+            for (uint32_t j = 0; j < pass->access_count; j++) {
+                if (!pass->accesses[j].write || pass->accesses[j].resource != resource || pass->ref_count == 0) {
+                    continue;
+                }
+                pass->ref_count -= 1;
+                if (pass->ref_count > 0 || pass->side_effects) {
+                    continue;
+                }
+                pass->culled = true;
+                for (uint32_t k = 0; k < pass->access_count; k++) {
+                    struct RenderGraphResource* read = &graph->resources[pass->accesses[k].resource];
+                    if (!pass->accesses[k].write && read->read_count > 0) {
+                        read->read_count -= 1;
+                        if (read->read_count == 0) {
+                            ASSERT(unused_count < RENDER_GRAPH_MAX_RESOURCES);
+                            unused[unused_count] = pass->accesses[k].resource;
+                            unused_count += 1;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // NOTE: passes that write nothing are only kept with side effects
+    for (uint32_t i = 0; i < graph->pass_count; i++) {
+        struct RenderGraphPass* pass = &graph->passes[i];
+        pass->culled = pass->culled || (pass->ref_count == 0 && !pass->side_effects);
+        if (pass->culled) {
+            graph->stats.culled_pass_count += 1;
+        }
+    }
+}
+
+static void
+render_graph_alias_textures(struct RenderGraph* graph) {
+    for (uint32_t i = 0; i < graph->pass_count; i++) {
+        const struct RenderGraphPass* pass = &graph->passes[i];
+        if (pass->culled) {
+            continue;
+        }
+        for (uint32_t j = 0; j < pass->access_count; j++) {
+            struct RenderGraphResource* resource = &graph->resources[pass->accesses[j].resource];
+            resource->first_pass = resource->first_pass == RENDER_GRAPH_NULL ? i : resource->first_pass;
+            resource->last_pass = i;
+        }
+    }
+
+    for (uint32_t i = 0; i < graph->pass_count; i++) {
+        for (uint32_t j = 0; j < graph->resource_count; j++) {
+            struct RenderGraphResource* resource = &graph->resources[j];
+            if (resource->imported || !resource->is_texture || resource->first_pass != i) {
+                continue;
+            }
+            resource->physical_texture = render_target_pool_acquire(&graph->pool, &resource->desc);
+            resource->object = graph->pool.targets[resource->physical_texture].texture;
+            graph->stats.transient_texture_count += 1;
+        }
+        // NOTE: released after the pass so its own transients never share a texture
+        for (uint32_t j = 0; j < graph->resource_count; j++) {
+            const struct RenderGraphResource* resource = &graph->resources[j];
+            if (resource->physical_texture != RENDER_GRAPH_NULL && resource->last_pass == i) {
+                render_target_pool_release(&graph->pool, resource->physical_texture);
+            }
+        }
+    }
+    for (uint32_t i = 0; i < graph->pool.target_count; i++) {
+        if (graph->pool.targets[i].last_used_frame == graph->pool.frame_number) {
+            graph->stats.physical_texture_count += 1;
+        }
+    }
+}
+
+static void
+render_graph_place_barriers(struct RenderGraph* graph) {
+    for (uint32_t i = 0; i < graph->pass_count; i++) {
+        struct RenderGraphPass* pass = &graph->passes[i];
+        if (pass->culled) {
+            continue;
+        }
+        for (uint32_t j = 0; j < pass->access_count; j++) {
+            const struct RenderGraphAccess* access = &pass->accesses[j];
+            const struct RenderGraphResource* resource = &graph->resources[access->resource];
+            GLbitfield barrier = render_graph_usage_barrier(access->usage, resource->is_texture);
+            if (resource->incoherent_write_pending && (resource->synchronized_barriers & barrier) == 0) {
+                pass->barriers |= barrier;
+            }
+        }
+
+        // NOTE: a barrier covers every write issued before it, not only the resources that asked for it
+        for (uint32_t j = 0; j < graph->resource_count; j++) {
+            graph->resources[j].synchronized_barriers |= pass->barriers;
+        }
+        for (uint32_t j = 0; j < pass->access_count; j++) {
+            const struct RenderGraphAccess* access = &pass->accesses[j];
+            if (access->write && render_graph_usage_is_incoherent(access->usage)) {
+                graph->resources[access->resource].incoherent_write_pending = true;
+                graph->resources[access->resource].synchronized_barriers = 0;
+            }
+        }
+        if (pass->barriers != 0) {
+            graph->stats.barrier_count += 1;
+        }
+    }
+}
+
+// NOTE: culls, assigns physical textures and places barriers, must be called from the context thread
+static void
+render_graph_compile(struct RenderGraph* graph) {
+    memset(&graph->stats, 0, sizeof(graph->stats));
+    graph->stats.pass_count = graph->pass_count;
+
+    render_graph_cull(graph);
+    render_graph_alias_textures(graph);
+    render_graph_place_barriers(graph);
+}
+
+// NOTE: graphics passes render into the textures they write as attachments (or the default framebuffer).
+// passes that only copy get a framebuffer of the textures they copy from instead, to be blitted from
+static void
+render_graph_setup_framebuffer(struct RenderGraph* graph, uint32_t pass_index) {
+    struct RenderGraphPass* pass = &graph->passes[pass_index];
+    GLuint color_textures[RENDER_TARGET_MAX_COLOR_ATTACHMENTS];
+    uint32_t color_count = 0;
+    GLuint depth_texture = 0;
+    bool writes_backbuffer = false;
+    for (uint32_t i = 0; i < pass->access_count; i++) {
+        const struct RenderGraphAccess* access = &pass->accesses[i];
+        const struct RenderGraphResource* resource = &graph->resources[access->resource];
+        if (access->write && resource->imported && resource->is_texture && resource->object == 0) {
+            writes_backbuffer = writes_backbuffer || access->usage != RENDER_GRAPH_USAGE_TRANSFER;
+        } else if (access->usage == RENDER_GRAPH_USAGE_COLOR_ATTACHMENT && access->write) {
+            ASSERT(color_count < RENDER_TARGET_MAX_COLOR_ATTACHMENTS);
+            color_textures[color_count] = resource->object;
+            color_count += 1;
+        } else if (access->usage == RENDER_GRAPH_USAGE_DEPTH_ATTACHMENT) {
+            depth_texture = resource->object;
+        }
+    }
+    bool has_attachments = color_count > 0 || depth_texture != 0;
+    if (writes_backbuffer) {
+        ASSERT(!has_attachments);
+        pass->framebuffer = 0;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        return;
+    }
+    if (!has_attachments) {
+        for (uint32_t i = 0; i < pass->access_count; i++) {
+            const struct RenderGraphAccess* access = &pass->accesses[i];
+            const struct RenderGraphResource* resource = &graph->resources[access->resource];
+            if (!access->write && access->usage == RENDER_GRAPH_USAGE_TRANSFER && resource->is_texture && color_count < RENDER_TARGET_MAX_COLOR_ATTACHMENTS) {
+                color_textures[color_count] = resource->object;
+                color_count += 1;
+            }
+        }
+    }
+
+    pass->framebuffer = 0;
+    if (color_count > 0 || depth_texture != 0) {
+        pass->framebuffer = render_target_pool_framebuffer(&graph->pool, color_textures, color_count, depth_texture);
+    }
+    if (has_attachments) {
+        glBindFramebuffer(GL_FRAMEBUFFER, pass->framebuffer);
+    }
+}
+
+// NOTE: must be called from the context thread, leaves the default framebuffer bound
+static void
+render_graph_execute(struct RenderGraph* graph) {
+    for (uint32_t i = 0; i < graph->pass_count; i++) {
+        struct RenderGraphPass* pass = &graph->passes[i];
+        if (pass->culled) {
+            continue;
+        }
+        if (pass->barriers != 0) {
+            glMemoryBarrier(pass->barriers);
+        }
+        if (pass->type == RENDER_GRAPH_PASS_GRAPHICS) {
+            render_graph_setup_framebuffer(graph, i);
+        }
+        pass->execute(pass->data, graph, i);
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    render_target_pool_end_frame(&graph->pool);
+}
+
+static void
+render_graph_print_stats(const struct RenderGraph* graph) {
+    const struct RenderGraphStats* stats = &graph->stats;
+    printf(
+        "render graph: %u passes (%u culled), %u transient textures in %u physical, %u barriers\n",
+        stats->pass_count,
+        stats->culled_pass_count,
+        stats->transient_texture_count,
+        stats->physical_texture_count,
+        stats->barrier_count
+    );
+    render_target_pool_print_stats(&graph->pool);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// shaders
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// glsl is written inline in the c source through `SHADER_SRC`, which turns its arguments into a string
+// (the preprocessor keeps them on one line, so `#version` and `#define` lines go in separate strings).
+// shaders are made of a few of those strings concatenated, a shader that doesn't compile is a bug so
+// its log goes to the debugger and it stops there
+
+#define SHADER_SRC(...) #__VA_ARGS__
+
+static GLuint
+shader_create(GLenum type, const char* const* sources, GLsizei source_count) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, source_count, sources, /* length */ NULL);
+    glCompileShader(shader);
+    GLint success = 0;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        char shader_log_buf[1024];
+        glGetShaderInfoLog(shader, sizeof(shader_log_buf), /* length */ NULL, shader_log_buf);
+        OutputDebugStringA("shader compile error:\n");
+        OutputDebugStringA(shader_log_buf);
+        OutputDebugStringA("\n");
+        UNREACHABLE;
+    }
+    return shader;
+}
+
+static GLuint
+compute_program_create(const char* source) {
+    GLuint program = glCreateShaderProgramv(GL_COMPUTE_SHADER, 1, &source);
+    GLint link_success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &link_success);
+    if (!link_success) {
+        char program_log_buf[1024];
+        glGetProgramInfoLog(program, sizeof(program_log_buf), /* length */ NULL, program_log_buf);
+        OutputDebugStringA("compute shader error:\n");
+        OutputDebugStringA(program_log_buf);
+        OutputDebugStringA("\n");
+        UNREACHABLE;
+    }
+    return program;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// occlusion culling
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// the frustum culled objects are also tested against a hierarchical depth (hi-z) pyramid on the gpu and
+// drawn with multi draw indirect in two phases. first the objects that were visible last frame are drawn
+// as they are, then the pyramid is built (max of each 2x2 texels, so a texel holds the farthest depth
+// under it) from their depth. every object is then tested by projecting its bounding box and comparing
+// its nearest depth with the pyramid level where the box covers at most 2x2 texels. the ones that pass
+// and weren't drawn yet are drawn in the second phase, and what passed is what's visible next frame.
+// an object becoming visible is drawn the same frame it does, so nothing pops in. visibility is the number
+// of the frame an object was last visible in, so one coming back into the frustum isn't drawn in the first
+// phase on a stale bit from before it left.
+// every candidate has a fixed command slot per submesh (in the front to back order of the draw items)
+// and culled ones get an instance count of zero, so the command count is known without reading back.
+// the draws find their object with an instanced object index attribute, the base instance of the command
+// see "practical, dynamic visibility for games" (hill, collin) and "gpu-driven rendering pipelines" (haar, aaltonen)
+
+#define OCCLUSION_CULLING_GROUP_SIZE 64
+#define OCCLUSION_CULLING_PYRAMID_GROUP_SIZE 8
+#define OCCLUSION_CULLING_MAX_LEVELS 16
+
+// NOTE: `glMultiDrawElementsIndirect` command layout
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instance_count;
+    GLuint first_index;
+    GLint base_vertex;
+    GLuint base_instance;
+};
+
+struct OcclusionCulling {
+    GLuint cull_program;
+    GLuint pyramid_program;
+    GLuint candidate_buffer; // NOTE: object index of every frustum visible draw item
+    GLuint visibility_buffer; // NOTE: per object, the number of the frame it was last visible in
+    GLuint submesh_buffer; // NOTE: command templates for the mesh lod 0 submeshes
+    GLuint command_buffers[2]; // NOTE: first and second phase
+    GLuint pyramid; // NOTE: r32f with every mip level
+    GLsizei pyramid_width;
+    GLsizei pyramid_height;
+    uint32_t object_count;
+    uint32_t submesh_count;
+    uint32_t transform_stride; // NOTE: in mat4s
+    uint32_t candidate_count;
+    GLsizei width;
+    GLsizei height;
+    uint32_t level_count;
+    uint32_t frame; // NOTE: starts at 2 so the zeroed visibility never matches the previous frame
+};
+
+static const char* occlusion_cull_shader_src =
+    "#version 450\n"
+    SHADER_SRC(
+    layout(local_size_x = 64) in;
+    struct DrawCommand {
+        uint count;
+        uint instance_count;
+        uint first_index;
+        int base_vertex;
+        uint base_instance;
+    };
+    layout(std430, binding = 0) readonly buffer transforms_buffer { mat4 transforms[]; };
+    layout(std430, binding = 1) readonly buffer candidates_buffer { uint candidates[]; };
+    layout(std430, binding = 2) buffer visibility_buffer { uint visibility[]; };
+    layout(std430, binding = 3) readonly buffer submeshes_buffer { DrawCommand submeshes[]; };
+    layout(std430, binding = 4) writeonly buffer commands_buffer { DrawCommand commands[]; };
+    layout(binding = 0) uniform sampler2D pyramid;
+    layout(location = 0) uniform uint candidate_count;
+    layout(location = 1) uniform uint second_phase;
+    layout(location = 2) uniform uint transform_stride;
+    layout(location = 3) uniform uint submesh_count;
+    layout(location = 4) uniform vec3 bounds_min;
+    layout(location = 5) uniform vec3 bounds_max;
+    layout(location = 6) uniform ivec2 pyramid_size;
+    layout(location = 7) uniform int level_count;
+    layout(location = 8) uniform uint frame;
+
+    bool is_occluded(mat4 transform) {
+        vec3 ndc_min = vec3(1.0);
+        vec3 ndc_max = vec3(-1.0);
+        for (int i = 0; i < 8; i++) {
+            vec3 corner = vec3(
+                (i & 1) != 0 ? bounds_max.x : bounds_min.x,
+                (i & 2) != 0 ? bounds_max.y : bounds_min.y,
+                (i & 4) != 0 ? bounds_max.z : bounds_min.z
+            );
+            vec4 clip = transform * vec4(corner, 1.0);
+            if (clip.w <= 0.0) {
+                return false;
+            }
+            vec3 ndc = clip.xyz / clip.w;
+            ndc_min = min(ndc_min, ndc);
+            ndc_max = max(ndc_max, ndc);
+        }
+
+        // NOTE: with the upper left origin ndc y = 1 is the first row, so y flips and its min and max swap
+        vec2 pixel_min = clamp(vec2(ndc_min.x, -ndc_max.y) * 0.5 + 0.5, 0.0, 1.0) * vec2(pyramid_size);
+        vec2 pixel_max = clamp(vec2(ndc_max.x, -ndc_min.y) * 0.5 + 0.5, 0.0, 1.0) * vec2(pyramid_size);
+        float extent = max(max(pixel_max.x - pixel_min.x, pixel_max.y - pixel_min.y), 1.0);
+        int level = clamp(int(ceil(log2(extent))), 0, level_count - 1);
+        ivec2 level_last = max((pyramid_size + (1 << level) - 1) >> level, ivec2(1)) - 1;
+        ivec2 texel_min = min(ivec2(pixel_min) >> level, level_last);
+        ivec2 texel_max = min(ivec2(pixel_max) >> level, level_last);
+        float depth = max(
+            max(texelFetch(pyramid, texel_min, level).r, texelFetch(pyramid, ivec2(texel_max.x, texel_min.y), level).r),
+            max(texelFetch(pyramid, ivec2(texel_min.x, texel_max.y), level).r, texelFetch(pyramid, texel_max, level).r)
+        );
+        return ndc_min.z > depth;
+    }
+
+    void main() {
+        uint index = gl_GlobalInvocationID.x;
+        if (index >= candidate_count) {
+            return;
+        }
+        uint object = candidates[index];
+        bool draw = visibility[object] == frame - 1;
+        if (second_phase != 0) {
+            bool visible = !is_occluded(transforms[object * transform_stride]);
+            draw = visible && !draw;
+            visibility[object] = visible ? frame : 0;
+        }
+        for (uint i = 0; i < submesh_count; i++) {
+            DrawCommand command = submeshes[i];
+            command.instance_count = draw ? 1 : 0;
+            command.base_instance = object;
+            commands[index * submesh_count + i] = command;
+        }
+    }
+    );
+
+// NOTE: level 0 is a copy of the depth buffer, every other level is the max of 2x2 texels of the one
+// before it. odd sizes round up and clamp so every texel is covered
+static const char* occlusion_pyramid_shader_src =
+    "#version 450\n"
+    SHADER_SRC(
+    layout(local_size_x = 8, local_size_y = 8) in;
+    layout(binding = 0) uniform sampler2D depth;
+    layout(binding = 0, r32f) uniform readonly image2D source_level;
+    layout(binding = 1, r32f) uniform writeonly image2D destination_level;
+    layout(location = 0) uniform ivec2 source_size;
+    layout(location = 1) uniform ivec2 destination_size;
+    layout(location = 2) uniform int from_depth;
+    void main() {
+        ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+        if (any(greaterThanEqual(texel, destination_size))) {
+            return;
+        }
+        if (from_depth != 0) {
+            imageStore(destination_level, texel, vec4(texelFetch(depth, texel, 0).r));
+            return;
+        }
+        ivec2 last = source_size - 1;
+        ivec2 source = texel * 2;
+        float depth = max(
+            max(imageLoad(source_level, min(source, last)).r, imageLoad(source_level, min(source + ivec2(1, 0), last)).r),
+            max(imageLoad(source_level, min(source + ivec2(0, 1), last)).r, imageLoad(source_level, min(source + ivec2(1, 1), last)).r)
+        );
+        imageStore(destination_level, texel, vec4(depth));
+    }
+    );
+
+// NOTE: the object transforms are read from the uniform blocks (`uniform_stride` apart) as a storage buffer
+static void
+occlusion_culling_init(struct OcclusionCulling* culling, const struct Mesh* mesh, uint32_t object_count, uint32_t uniform_stride) {
+    memset(culling, 0, sizeof(*culling));
+    ASSERT(uniform_stride % sizeof(struct Mat4) == 0);
+    culling->object_count = object_count;
+    culling->submesh_count = mesh->lods[0].submesh_count;
+    culling->transform_stride = uniform_stride / (uint32_t)sizeof(struct Mat4);
+    culling->frame = 1;
+
+    culling->cull_program = compute_program_create(occlusion_cull_shader_src);
+    culling->pyramid_program = compute_program_create(occlusion_pyramid_shader_src);
+    glProgramUniform1ui(culling->cull_program, /* location */ 2, culling->transform_stride);
+    glProgramUniform1ui(culling->cull_program, /* location */ 3, culling->submesh_count);
+    glProgramUniform3fv(culling->cull_program, /* location */ 4, /* count */ 1, mesh->bounds_min);
+    glProgramUniform3fv(culling->cull_program, /* location */ 5, /* count */ 1, mesh->bounds_max);
+
+    struct DrawElementsIndirectCommand submeshes[MESH_FILE_MAX_SUBMESHES];
+    for (uint32_t i = 0; i < culling->submesh_count; i++) {
+        const struct MeshFileSubmesh* submesh = &mesh->submeshes[mesh->lods[0].first_submesh + i];
+        submeshes[i].count = submesh->index_count;
+        submeshes[i].instance_count = 0;
+        submeshes[i].first_index = mesh->first_index + submesh->first_index;
+        submeshes[i].base_vertex = mesh->base_vertex + (GLint)submesh->base_vertex;
+        submeshes[i].base_instance = 0;
+    }
+
+    uint32_t command_buffer_size = object_count * culling->submesh_count * (uint32_t)sizeof(struct DrawElementsIndirectCommand);
+    glCreateBuffers(1, &culling->candidate_buffer);
+    glNamedBufferStorage(culling->candidate_buffer, object_count * sizeof(uint32_t), /* data */ NULL, GL_DYNAMIC_STORAGE_BIT);
+    glCreateBuffers(1, &culling->visibility_buffer);
+    glNamedBufferStorage(culling->visibility_buffer, object_count * sizeof(uint32_t), /* data */ NULL, /* flags */ 0);
+    glClearNamedBufferData(culling->visibility_buffer, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, /* data (zeros) */ NULL);
+    glCreateBuffers(1, &culling->submesh_buffer);
+    glNamedBufferStorage(culling->submesh_buffer, culling->submesh_count * sizeof(submeshes[0]), submeshes, /* flags */ 0);
+    glCreateBuffers(LEN(culling->command_buffers), culling->command_buffers);
+    for (uint32_t i = 0; i < LEN(culling->command_buffers); i++) {
+        glNamedBufferStorage(culling->command_buffers[i], command_buffer_size, /* data */ NULL, /* flags */ 0);
+    }
+}
+
+static void
+occlusion_culling_deinit(struct OcclusionCulling* culling) {
+    glDeleteProgram(culling->cull_program);
+    glDeleteProgram(culling->pyramid_program);
+    glDeleteBuffers(1, &culling->candidate_buffer);
+    glDeleteBuffers(1, &culling->visibility_buffer);
+    glDeleteBuffers(1, &culling->submesh_buffer);
+    glDeleteBuffers(LEN(culling->command_buffers), culling->command_buffers);
+    glDeleteTextures(1, &culling->pyramid);
+    memset(culling, 0, sizeof(*culling));
+}
+
+// NOTE: uploads the candidates of the frame (the frustum visible draw items, front to back) and makes sure
+// the pyramid fits the viewport. scratch memory comes from `arena`
+static void
+occlusion_culling_begin_frame(
+    struct OcclusionCulling* culling,
+    const struct DrawItem* draw_items,
+    uint32_t draw_count,
+    GLsizei width,
+    GLsizei height,
+    struct LinearArena* arena
+) {
+    size_t scratch_mark = arena->used;
+    uint32_t* candidates = LINEAR_ALLOC(arena, uint32_t, draw_count);
+    for (uint32_t i = 0; i < draw_count; i++) {
+        candidates[i] = draw_items[i].object_index;
+    }
+    glNamedBufferSubData(culling->candidate_buffer, /* offset */ 0, draw_count * sizeof(uint32_t), candidates);
+    arena->used = scratch_mark;
+    culling->candidate_count = draw_count;
+    culling->frame += 1;
+
+    // NOTE: power of two sizes so every level (halving rounded up) of the viewport rectangle fits in the
+    // level of the pyramid. it's kept while the viewport fits and isn't much smaller, so resizing doesn't
+    // reallocate every frame
+    GLsizei width_pow2 = width > 1 ? (GLsizei)(2u << bit_scan_reverse((uint32_t)width - 1)) : 1;
+    GLsizei height_pow2 = height > 1 ? (GLsizei)(2u << bit_scan_reverse((uint32_t)height - 1)) : 1;
+    bool fits =
+        culling->pyramid != 0 &&
+        width <= culling->pyramid_width &&
+        height <= culling->pyramid_height &&
+        (int64_t)culling->pyramid_width * culling->pyramid_height <= (int64_t)width_pow2 * height_pow2 * RENDER_TARGET_POOL_MAX_WASTE;
+    if (!fits) {
+        glDeleteTextures(1, &culling->pyramid);
+        culling->pyramid_width = width_pow2;
+        culling->pyramid_height = height_pow2;
+        uint32_t levels = bit_scan_reverse((uint32_t)(width_pow2 > height_pow2 ? width_pow2 : height_pow2)) + 1;
+        glCreateTextures(GL_TEXTURE_2D, 1, &culling->pyramid);
+        glTextureStorage2D(culling->pyramid, (GLsizei)levels, GL_R32F, width_pow2, height_pow2);
+    }
+
+    // NOTE: only the viewport rectangle of the pyramid is used, down to 1x1
+    culling->width = width;
+    culling->height = height;
+    culling->level_count = 1;
+    for (GLsizei size = width > height ? width : height; size > 1; size = (size + 1) / 2) {
+        culling->level_count += 1;
+    }
+    ASSERT(culling->level_count <= OCCLUSION_CULLING_MAX_LEVELS);
+}
+
+// NOTE: `transforms` is the buffer range of the uniform blocks of every object
+static void
+occlusion_culling_cull(const struct OcclusionCulling* culling, bool second_phase, GLuint transforms, GLintptr transforms_offset, GLsizeiptr transforms_size) {
+    glUseProgram(culling->cull_program);
+    glProgramUniform1ui(culling->cull_program, /* location */ 0, culling->candidate_count);
+    glProgramUniform1ui(culling->cull_program, /* location */ 1, second_phase ? 1 : 0);
+    glProgramUniform2i(culling->cull_program, /* location */ 6, culling->width, culling->height);
+    glProgramUniform1i(culling->cull_program, /* location */ 7, (GLint)culling->level_count);
+    glProgramUniform1ui(culling->cull_program, /* location */ 8, culling->frame);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, /* binding */ 0, transforms, transforms_offset, transforms_size);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, /* binding */ 1, culling->candidate_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, /* binding */ 2, culling->visibility_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, /* binding */ 3, culling->submesh_buffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, /* binding */ 4, culling->command_buffers[second_phase ? 1 : 0]);
+    glBindTextureUnit(/* unit */ 0, culling->pyramid);
+    uint32_t group_count = (culling->candidate_count + OCCLUSION_CULLING_GROUP_SIZE - 1) / OCCLUSION_CULLING_GROUP_SIZE;
+    if (group_count > 0) {
+        glDispatchCompute(group_count, 1, 1);
+    }
+    glBindTextureUnit(/* unit */ 0, 0);
+    glUseProgram(0);
+}
+
+// NOTE: one dispatch per level, each reading the one before it through image loads
+static void
+occlusion_culling_build_pyramid(const struct OcclusionCulling* culling, GLuint depth_texture) {
+    glUseProgram(culling->pyramid_program);
+    glBindTextureUnit(/* unit */ 0, depth_texture);
+    GLsizei source_width = culling->width;
+    GLsizei source_height = culling->height;
+    for (uint32_t level = 0; level < culling->level_count; level++) {
+        GLsizei width = level == 0 ? source_width : (source_width + 1) / 2;
+        GLsizei height = level == 0 ? source_height : (source_height + 1) / 2;
+        if (level > 0) {
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            glBindImageTexture(/* unit */ 0, culling->pyramid, (GLint)level - 1, /* layered */ GL_FALSE, /* layer */ 0, GL_READ_ONLY, GL_R32F);
+        }
+        glBindImageTexture(/* unit */ 1, culling->pyramid, (GLint)level, /* layered */ GL_FALSE, /* layer */ 0, GL_WRITE_ONLY, GL_R32F);
+        glProgramUniform2i(culling->pyramid_program, /* location */ 0, source_width, source_height);
+        glProgramUniform2i(culling->pyramid_program, /* location */ 1, width, height);
+        glProgramUniform1i(culling->pyramid_program, /* location */ 2, level == 0 ? 1 : 0);
+        glDispatchCompute(
+            (GLuint)(width + OCCLUSION_CULLING_PYRAMID_GROUP_SIZE - 1) / OCCLUSION_CULLING_PYRAMID_GROUP_SIZE,
+            (GLuint)(height + OCCLUSION_CULLING_PYRAMID_GROUP_SIZE - 1) / OCCLUSION_CULLING_PYRAMID_GROUP_SIZE,
+            1
+        );
+        source_width = width;
+        source_height = height;
+    }
+    glBindTextureUnit(/* unit */ 0, 0);
+    glUseProgram(0);
+}
+
+// NOTE: draws the commands of the given phases, expects the vertex array with the object index attribute
+// and a program reading the transforms from storage buffer binding 0 to be bound
+static void
+occlusion_culling_draw(const struct OcclusionCulling* culling, uint32_t first_phase, uint32_t phase_count, GLenum index_type) {
+    for (uint32_t i = first_phase; i < first_phase + phase_count; i++) {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, culling->command_buffers[i]);
+        glMultiDrawElementsIndirect(
+            GL_TRIANGLES,
+            index_type,
+            /* indirect */ NULL,
+            (GLsizei)(culling->candidate_count * culling->submesh_count),
+            /* stride (tightly packed) */ 0
+        );
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// occlusion queries
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// the alternative to the depth pyramid when there's no compute to spare: every object has an occlusion
+// query its bounding box proxy is drawn in, and its real draw is conditional on that query without
+// waiting for it (see `draw_list_record_queried`). an object is only skipped when the gpu already knows
+// that nothing of its proxy passed the depth test, otherwise it's drawn as if there were no query.
+// a proxy is 12 triangles so this only pays off for heavy meshes
+
+#define OCCLUSION_QUERY_MIN_TRIANGLES 256
+
+struct OcclusionQueries {
+    GLuint* queries; // NOTE: one per object
+    uint32_t query_count;
+    struct Mesh proxy_mesh; // NOTE: the bounding box of the mesh the queries are for
+};
+
+static bool
+occlusion_queries_worth_it(const struct Mesh* mesh) {
+    return mesh->lods[0].index_count / 3 >= OCCLUSION_QUERY_MIN_TRIANGLES;
+}
+
+// NOTE: the proxy positions have as many components as the mesh ones so both draw with the same vertex array
+static void
+occlusion_queries_init(struct OcclusionQueries* queries, const struct Mesh* mesh, struct GpuArena* arena, uint32_t object_count) {
+    memset(queries, 0, sizeof(*queries));
+    queries->queries = os_alloc(object_count * sizeof(GLuint));
+    queries->query_count = object_count;
+    glCreateQueries(GL_ANY_SAMPLES_PASSED_CONSERVATIVE, (GLsizei)object_count, queries->queries);
+
+    float vertices[8 * 4];
+    uint32_t component_count = mesh->position_component_count;
+    ASSERT(component_count >= 3 && component_count <= 4);
+    for (uint32_t i = 0; i < 8; i++) {
+        float* vertex = &vertices[i * component_count];
+        vertex[0] = (i & 1) ? mesh->bounds_max[0] : mesh->bounds_min[0];
+        vertex[1] = (i & 2) ? mesh->bounds_max[1] : mesh->bounds_min[1];
+        vertex[2] = (i & 4) ? mesh->bounds_max[2] : mesh->bounds_min[2];
+        if (component_count == 4) {
+            vertex[3] = 1.0f;
+        }
+    }
+    const uint32_t indices[] = {
+        0, 2, 1, 1, 2, 3, // -z
+        4, 5, 6, 5, 7, 6, // +z
+        0, 1, 4, 1, 5, 4, // -y
+        2, 6, 3, 3, 6, 7, // +y
+        0, 4, 2, 2, 4, 6, // -x
+        1, 3, 5, 3, 7, 5, // +x
+    };
+    struct MeshFileAttribute attribute = {
+        .location = 0,
+        .component_count = component_count,
+        .component_type = GL_FLOAT,
+        .normalized = GL_FALSE,
+        .relative_offset = 0,
+    };
+    struct MeshFileBuildDesc desc = {
+        .vertex_count = 8,
+        .vertex_stride = component_count * (uint32_t)sizeof(float),
+        .attribute_count = 1,
+        .lod_count = 1,
+        .lod_index_counts = {LEN(indices)},
+        .allow_8bit_indices = true,
+    };
+    desc.vertices = vertices;
+    desc.attributes = &attribute;
+    desc.lod_indices[0] = indices;
+
+    size_t size = mesh_file_build(&desc, /* buffer */ NULL, /* buffer_size */ 0);
+    void* data = os_alloc(size);
+    ASSERT(mesh_file_build(&desc, data, size) == size);
+    struct MeshFile mesh_file;
+    ASSERT(mesh_file_parse(&mesh_file, data, size));
+    ASSERT(mesh_upload(&queries->proxy_mesh, arena, &mesh_file));
+    os_free(data);
+}
+
+static void
+occlusion_queries_deinit(struct OcclusionQueries* queries, struct GpuArena* arena) {
+    glDeleteQueries((GLsizei)queries->query_count, queries->queries);
+    os_free(queries->queries);
+    mesh_free(&queries->proxy_mesh, arena);
+    memset(queries, 0, sizeof(*queries));
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// virtual texturing
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// a texture far too big to ever be resident (the map, a terapixel with sparse textures) is split in pages
+// of 128x128 texels for each of its mip levels. only the pages something on screen needs are in a cache
+// texture with a fixed number of slots, and a page table texture (one texel per page, a mip level per
+// level of pages) says which slot a page is in. shaders walk up the page table levels from the one they
+// want to the first resident page, so a missing page shows blurrier instead of missing. the pages that are
+// wanted come from a low resolution feedback pass writing the page each pixel would sample, read back
+// without waiting on it a few frames later. the missing pages are made (generated here, read from disk in
+// a real case) a few per frame by priority, in place of the least recently used ones.
+// slots have a border of texels of the neighbouring pages so bilinear filtering doesn't have to know about
+// pages. with GL_ARB_sparse_texture only the parts of the page table around resident pages have memory
+// so it can have the levels of a terapixel, without it the page table is smaller and fully allocated.
+// see "sparse virtual textures" (barrett, https://silverspaceship.com/src/svt/) and "advanced virtual
+// texture topics" (mittring)
+
+#define VIRTUAL_TEXTURE_TILE_SIZE_LOG2 7
+#define VIRTUAL_TEXTURE_TILE_SIZE (1 << VIRTUAL_TEXTURE_TILE_SIZE_LOG2) // NOTE: texels per side of a page
+#define VIRTUAL_TEXTURE_TILE_BORDER 4
+#define VIRTUAL_TEXTURE_SLOT_SIZE (VIRTUAL_TEXTURE_TILE_SIZE + 2 * VIRTUAL_TEXTURE_TILE_BORDER)
+#define VIRTUAL_TEXTURE_CACHE_SLOTS 16 // NOTE: per side, 256 slots in a 2176x2176 rgba8 texture (18 MiB)
+#define VIRTUAL_TEXTURE_SLOT_COUNT (VIRTUAL_TEXTURE_CACHE_SLOTS * VIRTUAL_TEXTURE_CACHE_SLOTS)
+#define VIRTUAL_TEXTURE_CACHE_SIZE (VIRTUAL_TEXTURE_CACHE_SLOTS * VIRTUAL_TEXTURE_SLOT_SIZE)
+#define VIRTUAL_TEXTURE_SPARSE_LEVELS 14 // NOTE: 8192x8192 pages, 2^20 texels per side
+#define VIRTUAL_TEXTURE_DENSE_LEVELS 12 // NOTE: 2048x2048 pages, 21 MiB of page table
+#define VIRTUAL_TEXTURE_PINNED_LEVELS 3 // NOTE: the coarsest levels (1 + 4 + 16 pages) never leave the cache
+#define VIRTUAL_TEXTURE_UPLOADS_PER_FRAME 8
+#define VIRTUAL_TEXTURE_FEEDBACK_DIVISOR 8 // NOTE: of the window size
+#define VIRTUAL_TEXTURE_FEEDBACK_MAX_EXTENT 512
+#define VIRTUAL_TEXTURE_REQUEST_CAPACITY 8192 // NOTE: twice the distinct pages a feedback image can ask for
+#define VIRTUAL_TEXTURE_PAGE_MAP_CAPACITY 1024 // NOTE: at least twice the slot count
+#define VIRTUAL_TEXTURE_FIRST_OCTAVE 2
+#define VIRTUAL_TEXTURE_LATTICE_CAPACITY (VIRTUAL_TEXTURE_SLOT_SIZE / 2 + 2)
+#define VIRTUAL_TEXTURE_NULL UINT32_MAX
+
+// NOTE: open addressing with linear probing from page keys to a value, kept at most half full.
+// `VIRTUAL_TEXTURE_NULL` keys are empty and the capacity is a power of two
+struct VirtualTexturePageMap {
+    uint32_t* keys;
+    uint32_t* values;
+    uint32_t capacity;
+    uint32_t count;
+};
+
+struct VirtualTextureStats {
+    uint64_t upload_count;
+    uint64_t eviction_count;
+    uint32_t feedback_count;
+    uint32_t dropped_feedback_count; // NOTE: not done on the gpu when their readback slot came around again
+    uint32_t dropped_request_count; // NOTE: pages that didn't fit in the request map
+    uint32_t committed_region_count; // NOTE: of the sparse page table
+    uint32_t max_committed_region_count;
+    double generate_seconds;
+};
+
+struct VirtualTexture {
+    uint32_t level_count;
+    uint32_t page_count; // NOTE: per side of level 0
+    uint32_t size_log2; // NOTE: of the texels per side of level 0
+    GLuint page_table; // NOTE: rgba8ui, the slot x and y of each page and 255 in alpha when it's resident
+    GLuint cache;
+    GLuint page_table_sampler;
+    GLuint cache_sampler;
+    GLuint program;
+    GLuint feedback_program;
+    GLuint vertex_array; // NOTE: empty, the plane is made from the vertex index
+    bool sparse;
+    GLint sparse_page_width; // NOTE: the commitment granularity of the page table, in texels
+    GLint sparse_page_height;
+    uint32_t sparse_level_count; // NOTE: levels after these are the mip tail, committed as a whole at init
+    uint32_t region_offsets[VIRTUAL_TEXTURE_SPARSE_LEVELS];
+    uint32_t region_columns[VIRTUAL_TEXTURE_SPARSE_LEVELS];
+    uint16_t* region_page_counts; // NOTE: resident pages in each commitment region of the sparse levels
+    uint32_t slot_pages[VIRTUAL_TEXTURE_SLOT_COUNT];
+    uint64_t slot_last_used[VIRTUAL_TEXTURE_SLOT_COUNT]; // NOTE: frame number
+    bool slot_pinned[VIRTUAL_TEXTURE_SLOT_COUNT];
+    struct VirtualTexturePageMap resident; // NOTE: page to slot
+    struct VirtualTexturePageMap requests; // NOTE: page to pixel count, of the feedback being processed
+    struct VirtualTexturePageMap loads; // NOTE: missing page to the pixel count waiting on it
+    unsigned char* staging; // NOTE: the texels of a slot for each upload of a frame
+    GLuint readback_buffer;
+    const uint32_t* readback; // NOTE: persistently mapped, a feedback image per frame in flight
+    GLsync feedback_fences[FRAME_ARENA_FRAME_COUNT];
+    GLsizei feedback_widths[FRAME_ARENA_FRAME_COUNT];
+    GLsizei feedback_heights[FRAME_ARENA_FRAME_COUNT];
+    uint32_t feedback_slot; // NOTE: where the feedback of this frame goes
+    uint64_t frame_number;
+    struct VirtualTextureStats stats;
+};
+
+// NOTE: what the job generating the texels of the pages of a frame needs
+struct VirtualTextureGeneration {
+    const struct VirtualTexture* texture;
+    const uint32_t* pages;
+};
+
+// NOTE: the height to color gradient of the generated map, height then rgb
+static const float virtual_texture_palette[][4] = {
+    {-1.00f, 12.0f, 28.0f, 84.0f}, // deep water
+    {-0.06f, 40.0f, 96.0f, 168.0f},
+    {0.00f, 214.0f, 200.0f, 146.0f}, // sand
+    {0.03f, 96.0f, 148.0f, 58.0f}, // grass
+    {0.30f, 54.0f, 96.0f, 40.0f},
+    {0.50f, 118.0f, 108.0f, 98.0f}, // rock
+    {0.70f, 244.0f, 244.0f, 248.0f}, // snow
+};
+
+// NOTE: pages are keyed by their level and coordinates in it, it's also what the feedback pass writes
+static uint32_t
+virtual_texture_page_key(uint32_t level, uint32_t x, uint32_t y) {
+    return level << 26 | y << 13 | x;
+}
+
+static uint32_t
+virtual_texture_page_level(uint32_t page) {
+    return page >> 26;
+}
+
+static uint32_t
+virtual_texture_page_x(uint32_t page) {
+    return page & 0x1fff;
+}
+
+static uint32_t
+virtual_texture_page_y(uint32_t page) {
+    return (page >> 13) & 0x1fff;
+}
+
+static uint32_t
+virtual_texture_page_parent(uint32_t page) {
+    return virtual_texture_page_key(virtual_texture_page_level(page) + 1, virtual_texture_page_x(page) >> 1, virtual_texture_page_y(page) >> 1);
+}
+
+static void
+virtual_texture_page_map_clear(struct VirtualTexturePageMap* map) {
+    memset(map->keys, 0xff, map->capacity * sizeof(uint32_t));
+    map->count = 0;
+}
+
+static void
+virtual_texture_page_map_init(struct VirtualTexturePageMap* map, uint32_t capacity) {
+    ASSERT((capacity & (capacity - 1)) == 0);
+    map->keys = os_alloc(capacity * 2 * sizeof(uint32_t));
+    map->values = map->keys + capacity;
+    map->capacity = capacity;
+    virtual_texture_page_map_clear(map);
+}
+
+static void
+virtual_texture_page_map_deinit(struct VirtualTexturePageMap* map) {
+    os_free(map->keys);
+    memset(map, 0, sizeof(*map));
+}
+
+static uint32_t
+virtual_texture_page_map_home(const struct VirtualTexturePageMap* map, uint32_t page) {
+    uint32_t hash = page * 2654435761u;
+    return (hash ^ (hash >> 16)) & (map->capacity - 1);
+}
+
+// NOTE: where the page is, or the empty entry ending its probe sequence when it's not there
+static uint32_t
+virtual_texture_page_map_probe(const struct VirtualTexturePageMap* map, uint32_t page) {
+    uint32_t index = virtual_texture_page_map_home(map, page);
+    while (map->keys[index] != page && map->keys[index] != VIRTUAL_TEXTURE_NULL) {
+        index = (index + 1) & (map->capacity - 1);
+    }
+    return index;
+}
+
+static uint32_t*
+virtual_texture_page_map_find(struct VirtualTexturePageMap* map, uint32_t page) {
+    uint32_t index = virtual_texture_page_map_probe(map, page);
+    return map->keys[index] == page ? &map->values[index] : NULL;
+}
+
+// NOTE: the value of the page, zero when it's new. NULL when the map is full
+static uint32_t*
+virtual_texture_page_map_insert(struct VirtualTexturePageMap* map, uint32_t page) {
+    uint32_t index = virtual_texture_page_map_probe(map, page);
+    if (map->keys[index] != page) {
+        if (map->count * 2 >= map->capacity) {
+            return NULL;
+        }
+        map->keys[index] = page;
+        map->values[index] = 0;
+        map->count += 1;
+    }
+    return &map->values[index];
+}
+
+// NOTE: backward shift deletion, entries after the hole that can get closer to their home move into it so
+// there are no tombstones to skip
+static void
+virtual_texture_page_map_remove(struct VirtualTexturePageMap* map, uint32_t page) {
+    uint32_t mask = map->capacity - 1;
+    uint32_t hole = virtual_texture_page_map_probe(map, page);
+    ASSERT(map->keys[hole] == page);
+    for (uint32_t index = (hole + 1) & mask; map->keys[index] != VIRTUAL_TEXTURE_NULL; index = (index + 1) & mask) {
+        uint32_t home = virtual_texture_page_map_home(map, map->keys[index]);
+        if (((index - home) & mask) >= ((index - hole) & mask)) {
+            map->keys[hole] = map->keys[index];
+            map->values[hole] = map->values[index];
+            hole = index;
+        }
+    }
+    map->keys[hole] = VIRTUAL_TEXTURE_NULL;
+    map->count -= 1;
+}
+
+// NOTE: a value in [-1, 1] for each point of the lattice of an octave
+static float
+virtual_texture_lattice_value(uint32_t octave, uint32_t x, uint32_t y) {
+    uint32_t hash = (x * 0x8da6b343u) ^ (y * 0xd8163841u) ^ (octave * 0xcb1ab31fu);
+    hash ^= hash >> 15;
+    hash *= 0x2c1b3c6du;
+    hash ^= hash >> 12;
+    hash *= 0x297a2d39u;
+    hash ^= hash >> 15;
+    return (float)(hash >> 8) * (2.0f / 16777215.0f) - 1.0f;
+}
+
+static float
+virtual_texture_smoothstep(float t) {
+    return t * t * (3.0f - 2.0f * t);
+}
+
+// NOTE: one row of the slot of a page (borders included) of a procedural map: octaves of value noise wrapping
+// around the texture (so the borders of edge pages come from the other side) as heights through a palette.
+// positions are in units of half a level 0 texel so texel centers of every level are exact integers. octaves
+// finer than two texels of the level are left out, they would average to zero over a texel anyway, which
+// makes every level look like a downsampled version of the one before it and keeps coarse pages cheap.
+// the lattice values along the row are interpolated vertically once per octave (those spanning the row
+// fit in `VIRTUAL_TEXTURE_LATTICE_CAPACITY` as the lattice is at least two texels apart)
+static void
+virtual_texture_generate_row(uint32_t size_log2, uint32_t page, uint32_t row, unsigned char* rgba) {
+    uint32_t level = virtual_texture_page_level(page);
+    uint32_t level_mask = (1u << (size_log2 - level)) - 1;
+    uint32_t first_x = virtual_texture_page_x(page) * VIRTUAL_TEXTURE_TILE_SIZE - VIRTUAL_TEXTURE_TILE_BORDER;
+    uint32_t y = (virtual_texture_page_y(page) * VIRTUAL_TEXTURE_TILE_SIZE + row - VIRTUAL_TEXTURE_TILE_BORDER) & level_mask;
+    uint32_t position_y = (2 * y + 1) << level;
+
+    float heights[VIRTUAL_TEXTURE_SLOT_SIZE] = {0};
+    float amplitude = 1.0f;
+    for (uint32_t octave = VIRTUAL_TEXTURE_FIRST_OCTAVE; octave + level + 1 <= size_log2; octave++) {
+        uint32_t spacing_log2 = size_log2 + 1 - octave;
+        uint32_t fraction_mask = (1u << spacing_log2) - 1;
+        float inverse_spacing = 1.0f / (float)(1u << spacing_log2);
+        uint32_t cell_mask = (1u << octave) - 1;
+        uint32_t cell_y = position_y >> spacing_log2;
+        float weight_y = virtual_texture_smoothstep((float)(position_y & fraction_mask) * inverse_spacing);
+
+        // NOTE: the whole lattice row when it's small, the part under the row starting at its first texel otherwise
+        bool whole = cell_mask < VIRTUAL_TEXTURE_LATTICE_CAPACITY;
+        uint32_t first_cell = whole ? 0 : (((2 * (first_x & level_mask) + 1) << level) >> spacing_log2);
+        uint32_t lattice_count = whole ? cell_mask + 1 : VIRTUAL_TEXTURE_LATTICE_CAPACITY;
+        float lattice[VIRTUAL_TEXTURE_LATTICE_CAPACITY];
+        for (uint32_t i = 0; i < lattice_count; i++) {
+            uint32_t cell_x = (first_cell + i) & cell_mask;
+            float top = virtual_texture_lattice_value(octave, cell_x, cell_y & cell_mask);
+            float bottom = virtual_texture_lattice_value(octave, cell_x, (cell_y + 1) & cell_mask);
+            lattice[i] = top + (bottom - top) * weight_y;
+        }
+
+        for (uint32_t x = 0; x < VIRTUAL_TEXTURE_SLOT_SIZE; x++) {
+            uint32_t position_x = (2 * ((first_x + x) & level_mask) + 1) << level;
+            uint32_t index = ((position_x >> spacing_log2) - first_cell) & cell_mask;
+            float left = lattice[index];
+            float right = lattice[(index + 1) & cell_mask];
+            float weight_x = virtual_texture_smoothstep((float)(position_x & fraction_mask) * inverse_spacing);
+            heights[x] += (left + (right - left) * weight_x) * amplitude;
+        }
+        amplitude *= 0.5f;
+    }
+
+    for (uint32_t x = 0; x < VIRTUAL_TEXTURE_SLOT_SIZE; x++) {
+        uint32_t stop = 1;
+        while (stop < LEN(virtual_texture_palette) - 1 && heights[x] > virtual_texture_palette[stop][0]) {
+            stop += 1;
+        }
+        const float* low = virtual_texture_palette[stop - 1];
+        const float* high = virtual_texture_palette[stop];
+        float t = (heights[x] - low[0]) / (high[0] - low[0]);
+        t = t < 0.0f ? 0.0f : t > 1.0f ? 1.0f : t;
+        for (uint32_t c = 0; c < 3; c++) {
+            rgba[x * 4 + c] = (unsigned char)(low[c + 1] + (high[c + 1] - low[c + 1]) * t + 0.5f);
+        }
+        rgba[x * 4 + 3] = 255;
+    }
+}
+
+static void
+virtual_texture_generate_job(void* data, uint32_t first, uint32_t count, uint32_t worker_index) {
+    (void)worker_index;
+    const struct VirtualTextureGeneration* generation = data;
+    const struct VirtualTexture* texture = generation->texture;
+    for (uint32_t i = first; i < first + count; i++) {
+        uint32_t upload = i / VIRTUAL_TEXTURE_SLOT_SIZE;
+        uint32_t row = i % VIRTUAL_TEXTURE_SLOT_SIZE;
+        unsigned char* rgba = texture->staging + ((size_t)upload * VIRTUAL_TEXTURE_SLOT_SIZE + row) * VIRTUAL_TEXTURE_SLOT_SIZE * 4;
+        virtual_texture_generate_row(texture->size_log2, generation->pages[upload], row, rgba);
+    }
+}
+
+// NOTE: points the page table entry of a page at a slot, or marks it not resident with `VIRTUAL_TEXTURE_NULL`.
+// with a sparse page table the commitment region of the entry is committed with its first resident page
+// (and cleared, committed memory starts undefined) and decommitted with its last one
+static void
+virtual_texture_write_entry(struct VirtualTexture* texture, uint32_t page, uint32_t slot) {
+    uint32_t level = virtual_texture_page_level(page);
+    uint32_t x = virtual_texture_page_x(page);
+    uint32_t y = virtual_texture_page_y(page);
+    bool resident = slot != VIRTUAL_TEXTURE_NULL;
+    if (texture->sparse && level < texture->sparse_level_count) {
+        uint32_t region_width = (uint32_t)texture->sparse_page_width;
+        uint32_t region_height = (uint32_t)texture->sparse_page_height;
+        uint32_t region = texture->region_offsets[level] + (y / region_height) * texture->region_columns[level] + x / region_width;
+        uint32_t extent = texture->page_count >> level;
+        uint32_t region_x = x / region_width * region_width;
+        uint32_t region_y = y / region_height * region_height;
+        GLsizei width = (GLsizei)(extent - region_x < region_width ? extent - region_x : region_width);
+        GLsizei height = (GLsizei)(extent - region_y < region_height ? extent - region_y : region_height);
+        uint16_t* page_count = &texture->region_page_counts[region];
+        if (resident && *page_count == 0) {
+            glBindTexture(GL_TEXTURE_2D, texture->page_table);
+            glTexPageCommitmentARB(GL_TEXTURE_2D, (GLint)level, (GLint)region_x, (GLint)region_y, /* zoffset */ 0, width, height, /* depth */ 1, GL_TRUE);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            glClearTexSubImage(texture->page_table, (GLint)level, (GLint)region_x, (GLint)region_y, /* zoffset */ 0, width, height, /* depth */ 1, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, /* data (zeros) */ NULL);
+            texture->stats.committed_region_count += 1;
+            if (texture->stats.committed_region_count > texture->stats.max_committed_region_count) {
+                texture->stats.max_committed_region_count = texture->stats.committed_region_count;
+            }
+        }
+        *page_count = (uint16_t)(resident ? *page_count + 1 : *page_count - 1);
+        if (!resident && *page_count == 0) {
+            glBindTexture(GL_TEXTURE_2D, texture->page_table);
+            glTexPageCommitmentARB(GL_TEXTURE_2D, (GLint)level, (GLint)region_x, (GLint)region_y, /* zoffset */ 0, width, height, /* depth */ 1, GL_FALSE);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            texture->stats.committed_region_count -= 1;
+            return;
+        }
+    }
+    unsigned char entry[4] = {0};
+    if (resident) {
+        entry[0] = (unsigned char)(slot % VIRTUAL_TEXTURE_CACHE_SLOTS);
+        entry[1] = (unsigned char)(slot / VIRTUAL_TEXTURE_CACHE_SLOTS);
+        entry[3] = 255;
+    }
+    glTextureSubImage2D(texture->page_table, (GLint)level, (GLint)x, (GLint)y, /* width */ 1, /* height */ 1, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, entry);
+}
+
+// NOTE: makes the pages (with the workers of `job_system`, called from worker 0) into the slots they were
+// given and points their page table entries at them
+static void
+virtual_texture_load(struct VirtualTexture* texture, const uint32_t* pages, const uint32_t* slots, uint32_t count, struct JobSystem* job_system) {
+    ASSERT(count <= VIRTUAL_TEXTURE_UPLOADS_PER_FRAME);
+    int64_t start = timer_now();
+    struct VirtualTextureGeneration generation = {.texture = texture, .pages = pages};
+    volatile LONG counter = 0;
+    job_system_parallel_for(job_system, /* worker_index */ 0, &virtual_texture_generate_job, &generation, count * VIRTUAL_TEXTURE_SLOT_SIZE, /* batch_size */ 8, &counter);
+    job_system_wait(job_system, /* worker_index */ 0, &counter);
+    texture->stats.generate_seconds += timer_seconds(timer_now() - start);
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t slot = slots[i];
+        glTextureSubImage2D(
+            texture->cache,
+            /* level */ 0,
+            (GLint)(slot % VIRTUAL_TEXTURE_CACHE_SLOTS * VIRTUAL_TEXTURE_SLOT_SIZE),
+            (GLint)(slot / VIRTUAL_TEXTURE_CACHE_SLOTS * VIRTUAL_TEXTURE_SLOT_SIZE),
+            VIRTUAL_TEXTURE_SLOT_SIZE,
+            VIRTUAL_TEXTURE_SLOT_SIZE,
+            GL_RGBA,
+            GL_UNSIGNED_BYTE,
+            texture->staging + (size_t)i * VIRTUAL_TEXTURE_SLOT_SIZE * VIRTUAL_TEXTURE_SLOT_SIZE * 4
+        );
+        uint32_t* resident_slot = virtual_texture_page_map_insert(&texture->resident, pages[i]);
+        ASSERT(resident_slot);
+        *resident_slot = slot;
+        texture->slot_pages[slot] = pages[i];
+        texture->slot_last_used[slot] = texture->frame_number;
+        virtual_texture_write_entry(texture, pages[i], slot);
+        texture->stats.upload_count += 1;
+    }
+}
+
+static void
+virtual_texture_evict(struct VirtualTexture* texture, uint32_t slot) {
+    uint32_t page = texture->slot_pages[slot];
+    if (page == VIRTUAL_TEXTURE_NULL) {
+        return;
+    }
+    virtual_texture_page_map_remove(&texture->resident, page);
+    virtual_texture_write_entry(texture, page, VIRTUAL_TEXTURE_NULL);
+    texture->slot_pages[slot] = VIRTUAL_TEXTURE_NULL;
+    texture->stats.eviction_count += 1;
+}
+
+// NOTE: a free slot, or the least recently used one nothing asked for in the feedback being processed.
+// `VIRTUAL_TEXTURE_NULL` when they're all pinned or in use
+static uint32_t
+virtual_texture_find_slot(const struct VirtualTexture* texture) {
+    uint32_t best = VIRTUAL_TEXTURE_NULL;
+    uint64_t best_last_used = texture->frame_number;
+    for (uint32_t slot = 0; slot < VIRTUAL_TEXTURE_SLOT_COUNT; slot++) {
+        if (texture->slot_pinned[slot]) {
+            continue;
+        }
+        if (texture->slot_pages[slot] == VIRTUAL_TEXTURE_NULL) {
+            return slot;
+        }
+        if (texture->slot_last_used[slot] < best_last_used) {
+            best = slot;
+            best_last_used = texture->slot_last_used[slot];
+        }
+    }
+    return best;
+}
+
+static void
+virtual_texture_touch(struct VirtualTexture* texture, uint32_t slot) {
+    texture->slot_last_used[slot] = texture->frame_number;
+}
+
+// NOTE: a quad of `plane.xy` half extents at `plane.z` made from the vertex index (a 4 vertex strip) with
+// `uv_rect` (offset and size) of the texture over it, uvs outside of 0 to 1 wrap around
+static const char* virtual_texture_vertex_shader_src =
+    SHADER_SRC(
+    layout(location = 0) uniform mat4 view_projection;
+    layout(location = 1) uniform vec4 plane;
+    layout(location = 2) uniform vec4 uv_rect;
+    out vec2 uv;
+    void main() {
+        vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+        uv = uv_rect.xy + corner * uv_rect.zw;
+        gl_Position = view_projection * vec4((corner * 2.0 - 1.0) * plane.xy, plane.z, 1.0);
+    }
+    );
+
+// NOTE: the page level a pixel wants, from the gradients of the unwrapped uvs in level 0 texels. it's
+// rounded down so the cache (which has no mip levels) is magnified rather than minified by up to 2x
+static const char* virtual_texture_lod_shader_src =
+    SHADER_SRC(
+    layout(location = 3) uniform float lod_bias;
+    in vec2 uv;
+    int page_level() {
+        vec2 texels = uv * float(PAGE_COUNT * TILE_SIZE);
+        vec2 dx = dFdx(texels);
+        vec2 dy = dFdy(texels);
+        float lod = 0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1e-8)) + lod_bias;
+        return int(clamp(floor(lod), 0.0, float(LEVEL_COUNT - 1)));
+    }
+    ivec2 page_of(vec2 wrapped, int level) {
+        int pages = PAGE_COUNT >> level;
+        return min(ivec2(wrapped * float(pages)), ivec2(pages - 1));
+    }
+    );
+
+static const char* virtual_texture_feedback_shader_src =
+    SHADER_SRC(
+    layout(location = 0) out uint feedback;
+    void main() {
+        int level = page_level();
+        ivec2 page = page_of(fract(uv), level);
+        feedback = uint(level) << 26 | uint(page.y) << 13 | uint(page.x);
+    }
+    );
+
+// NOTE: walks up from the wanted level to the first resident page, the coarsest level always is
+static const char* virtual_texture_fragment_shader_src =
+    SHADER_SRC(
+    layout(binding = 0) uniform usampler2D page_table;
+    layout(binding = 1) uniform sampler2D cache;
+    layout(location = 0) out vec4 frag_color;
+    void main() {
+        int level = page_level();
+        vec2 wrapped = fract(uv);
+        uvec4 entry = texelFetch(page_table, page_of(wrapped, level), level);
+        while (entry.a == 0u && level < LEVEL_COUNT - 1) {
+            level += 1;
+            entry = texelFetch(page_table, page_of(wrapped, level), level);
+        }
+        vec2 in_page = fract(wrapped * float(PAGE_COUNT >> level));
+        vec2 texel = vec2(entry.xy) * float(SLOT_SIZE) + float(TILE_BORDER) + in_page * float(TILE_SIZE);
+        frag_color = textureLod(cache, texel / float(CACHE_SIZE), 0.0);
+    }
+    );
+
+static GLuint
+virtual_texture_program_create(const char* header, const char* fragment_src) {
+    const char* vertex_sources[] = {header, virtual_texture_vertex_shader_src};
+    const char* fragment_sources[] = {header, virtual_texture_lod_shader_src, fragment_src};
+    GLuint shaders[2] = {
+        shader_create(GL_VERTEX_SHADER, vertex_sources, LEN(vertex_sources)),
+        shader_create(GL_FRAGMENT_SHADER, fragment_sources, LEN(fragment_sources)),
+    };
+    GLuint program = glCreateProgram();
+    glAttachShader(program, shaders[0]);
+    glAttachShader(program, shaders[1]);
+    glLinkProgram(program);
+    glDeleteShader(shaders[0]);
+    glDeleteShader(shaders[1]);
+    GLint link_success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &link_success);
+    ASSERT(link_success);
+    return program;
+}
+
+// NOTE: the coarsest levels are loaded right away (with the workers of `job_system`, called from worker 0),
+// they're what every pixel falls back to so they're never evicted
+static void
+virtual_texture_init(struct VirtualTexture* texture, struct SamplerCache* samplers, struct JobSystem* job_system) {
+    memset(texture, 0, sizeof(*texture));
+
+    // NOTE: GL_ARB_sparse_texture2 makes reads of uncommitted texels return zeros (not resident) which the
+    // shaders rely on, GL_ARB_sparse_texture alone leaves them undefined
+    bool sparse = gl_has_extension("GL_ARB_sparse_texture") && gl_has_extension("GL_ARB_sparse_texture2");
+    #define X(type, name) sparse = sparse && LOAD_OPTIONAL_PROC(type, name);
+    GL_ARB_SPARSE_TEXTURE_PROCS
+    #undef X
+    if (sparse) {
+        GLint max_size = 0;
+        GLint page_size_count = 0;
+        glGetIntegerv(GL_MAX_SPARSE_TEXTURE_SIZE_ARB, &max_size);
+        glGetInternalformativ(GL_TEXTURE_2D, GL_RGBA8UI, GL_NUM_VIRTUAL_PAGE_SIZES_ARB, /* count */ 1, &page_size_count);
+        if (page_size_count > 0) {
+            glGetInternalformativ(GL_TEXTURE_2D, GL_RGBA8UI, GL_VIRTUAL_PAGE_SIZE_X_ARB, /* count */ 1, &texture->sparse_page_width);
+            glGetInternalformativ(GL_TEXTURE_2D, GL_RGBA8UI, GL_VIRTUAL_PAGE_SIZE_Y_ARB, /* count */ 1, &texture->sparse_page_height);
+        }
+        sparse =
+            max_size >= (1 << (VIRTUAL_TEXTURE_SPARSE_LEVELS - 1)) &&
+            texture->sparse_page_width > 0 &&
+            texture->sparse_page_height > 0;
+    }
+    texture->sparse = sparse;
+    texture->level_count = sparse ? VIRTUAL_TEXTURE_SPARSE_LEVELS : VIRTUAL_TEXTURE_DENSE_LEVELS;
+    texture->page_count = 1u << (texture->level_count - 1);
+    texture->size_log2 = texture->level_count - 1 + VIRTUAL_TEXTURE_TILE_SIZE_LOG2;
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture->page_table);
+    if (sparse) {
+        glTextureParameteri(texture->page_table, GL_TEXTURE_SPARSE_ARB, GL_TRUE);
+    }
+    glTextureStorage2D(texture->page_table, (GLsizei)texture->level_count, GL_RGBA8UI, (GLsizei)texture->page_count, (GLsizei)texture->page_count);
+    if (sparse) {
+        GLint sparse_level_count = 0;
+        glGetTextureParameteriv(texture->page_table, GL_NUM_SPARSE_LEVELS_ARB, &sparse_level_count);
+        texture->sparse_level_count = (uint32_t)sparse_level_count < texture->level_count ? (uint32_t)sparse_level_count : texture->level_count;
+        uint32_t region_count = 0;
+        for (uint32_t level = 0; level < texture->sparse_level_count; level++) {
+            uint32_t extent = texture->page_count >> level;
+            uint32_t columns = (extent + (uint32_t)texture->sparse_page_width - 1) / (uint32_t)texture->sparse_page_width;
+            uint32_t rows = (extent + (uint32_t)texture->sparse_page_height - 1) / (uint32_t)texture->sparse_page_height;
+            texture->region_offsets[level] = region_count;
+            texture->region_columns[level] = columns;
+            region_count += columns * rows;
+        }
+        texture->region_page_counts = os_alloc((region_count > 0 ? region_count : 1) * sizeof(uint16_t));
+
+        // NOTE: the levels smaller than a commitment region share the mip tail which is committed as a whole
+        glBindTexture(GL_TEXTURE_2D, texture->page_table);
+        for (uint32_t level = texture->sparse_level_count; level < texture->level_count; level++) {
+            GLsizei extent = (GLsizei)(texture->page_count >> level);
+            glTexPageCommitmentARB(GL_TEXTURE_2D, (GLint)level, /* xoffset */ 0, /* yoffset */ 0, /* zoffset */ 0, extent, extent, /* depth */ 1, GL_TRUE);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+    // NOTE: everything with memory starts as not resident
+    for (uint32_t level = texture->sparse_level_count; level < texture->level_count; level++) {
+        glClearTexImage(texture->page_table, (GLint)level, GL_RGBA_INTEGER, GL_UNSIGNED_BYTE, /* data (zeros) */ NULL);
+    }
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture->cache);
+    glTextureStorage2D(texture->cache, /* levels */ 1, GL_RGBA8, VIRTUAL_TEXTURE_CACHE_SIZE, VIRTUAL_TEXTURE_CACHE_SIZE);
+    struct SamplerDesc page_table_sampler_desc = {
+        .min_filter = GL_NEAREST_MIPMAP_NEAREST,
+        .mag_filter = GL_NEAREST,
+        .wrap = GL_CLAMP_TO_EDGE,
+        .anisotropy = 1.0f,
+        .lod_bias = 0.0f,
+    };
+    texture->page_table_sampler = sampler_cache_get(samplers, &page_table_sampler_desc);
+    texture->cache_sampler = sampler_cache_preset(samplers, SAMPLER_PRESET_BILINEAR, GL_CLAMP_TO_EDGE);
+
+    char shader_header[256];
+    snprintf(
+        shader_header,
+        sizeof(shader_header),
+        "#version 450\n"
+        "#define PAGE_COUNT %u\n"
+        "#define LEVEL_COUNT %u\n"
+        "#define TILE_SIZE %u\n"
+        "#define TILE_BORDER %u\n"
+        "#define SLOT_SIZE %u\n"
+        "#define CACHE_SIZE %u\n",
+        texture->page_count,
+        texture->level_count,
+        VIRTUAL_TEXTURE_TILE_SIZE,
+        VIRTUAL_TEXTURE_TILE_BORDER,
+        VIRTUAL_TEXTURE_SLOT_SIZE,
+        VIRTUAL_TEXTURE_CACHE_SIZE
+    );
+    texture->program = virtual_texture_program_create(shader_header, virtual_texture_fragment_shader_src);
+    texture->feedback_program = virtual_texture_program_create(shader_header, virtual_texture_feedback_shader_src);
+    glCreateVertexArrays(1, &texture->vertex_array);
+
+    virtual_texture_page_map_init(&texture->resident, VIRTUAL_TEXTURE_PAGE_MAP_CAPACITY);
+    virtual_texture_page_map_init(&texture->requests, VIRTUAL_TEXTURE_REQUEST_CAPACITY);
+    virtual_texture_page_map_init(&texture->loads, VIRTUAL_TEXTURE_REQUEST_CAPACITY);
+    texture->staging = os_alloc((size_t)VIRTUAL_TEXTURE_UPLOADS_PER_FRAME * VIRTUAL_TEXTURE_SLOT_SIZE * VIRTUAL_TEXTURE_SLOT_SIZE * 4);
+
+    size_t readback_size = (size_t)FRAME_ARENA_FRAME_COUNT * VIRTUAL_TEXTURE_FEEDBACK_MAX_EXTENT * VIRTUAL_TEXTURE_FEEDBACK_MAX_EXTENT * sizeof(uint32_t);
+    GLbitfield readback_flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &texture->readback_buffer);
+    glNamedBufferStorage(texture->readback_buffer, (GLsizeiptr)readback_size, /* data */ NULL, readback_flags);
+    texture->readback = glMapNamedBufferRange(texture->readback_buffer, /* offset */ 0, (GLsizeiptr)readback_size, readback_flags);
+    ASSERT(texture->readback);
+
+    for (uint32_t slot = 0; slot < VIRTUAL_TEXTURE_SLOT_COUNT; slot++) {
+        texture->slot_pages[slot] = VIRTUAL_TEXTURE_NULL;
+    }
+    uint32_t pages[VIRTUAL_TEXTURE_UPLOADS_PER_FRAME];
+    uint32_t slots[VIRTUAL_TEXTURE_UPLOADS_PER_FRAME];
+    uint32_t count = 0;
+    uint32_t slot = 0;
+    for (uint32_t level = texture->level_count - VIRTUAL_TEXTURE_PINNED_LEVELS; level < texture->level_count; level++) {
+        uint32_t extent = texture->page_count >> level;
+        for (uint32_t y = 0; y < extent; y++) {
+            for (uint32_t x = 0; x < extent; x++) {
+                ASSERT(slot < VIRTUAL_TEXTURE_SLOT_COUNT);
+                texture->slot_pinned[slot] = true;
+                pages[count] = virtual_texture_page_key(level, x, y);
+                slots[count] = slot;
+                count += 1;
+                slot += 1;
+                if (count == VIRTUAL_TEXTURE_UPLOADS_PER_FRAME) {
+                    virtual_texture_load(texture, pages, slots, count, job_system);
+                    count = 0;
+                }
+            }
+        }
+    }
+    virtual_texture_load(texture, pages, slots, count, job_system);
+}
+
+static void
+virtual_texture_deinit(struct VirtualTexture* texture) {
+    for (uint32_t i = 0; i < FRAME_ARENA_FRAME_COUNT; i++) {
+        if (texture->feedback_fences[i]) {
+            glDeleteSync(texture->feedback_fences[i]);
+        }
+    }
+    glUnmapNamedBuffer(texture->readback_buffer);
+    glDeleteBuffers(1, &texture->readback_buffer);
+    glDeleteTextures(1, &texture->page_table);
+    glDeleteTextures(1, &texture->cache);
+    glDeleteProgram(texture->program);
+    glDeleteProgram(texture->feedback_program);
+    glDeleteVertexArrays(1, &texture->vertex_array);
+    virtual_texture_page_map_deinit(&texture->resident);
+    virtual_texture_page_map_deinit(&texture->requests);
+    virtual_texture_page_map_deinit(&texture->loads);
+    os_free(texture->staging);
+    os_free(texture->region_page_counts);
+    memset(texture, 0, sizeof(*texture));
+}
+
+static void
+virtual_texture_print_stats(const struct VirtualTexture* texture) {
+    const struct VirtualTextureStats* stats = &texture->stats;
+    printf(
+        "pages uploaded = %llu (%.3f ms to generate each), evicted = %llu\n",
+        (unsigned long long)stats->upload_count,
+        stats->upload_count > 0 ? stats->generate_seconds * 1000.0 / (double)stats->upload_count : 0.0,
+        (unsigned long long)stats->eviction_count
+    );
+    printf(
+        "feedback frames = %u processed, %u dropped (not ready in time), %u pages dropped (request map full)\n",
+        stats->feedback_count, stats->dropped_feedback_count, stats->dropped_request_count
+    );
+    if (texture->sparse) {
+        size_t region_size = (size_t)texture->sparse_page_width * (size_t)texture->sparse_page_height * 4;
+        printf(
+            "sparse page table regions committed = %u (%u at most, %.1f KiB)\n",
+            stats->committed_region_count,
+            stats->max_committed_region_count,
+            (double)((size_t)stats->max_committed_region_count * region_size) / 1024.0
+        );
+    }
+}
+
+// NOTE: called at the start of every frame (from worker 0 of `job_system`, before the feedback pass). the
+// feedback in the readback slot of this frame is from `FRAME_ARENA_FRAME_COUNT` frames ago, if the gpu
+// isn't done with it by now it's dropped instead of waited on. every pixel counts for the page it wants:
+// resident pages are marked used, missing ones count for their coarsest missing ancestor (the next one
+// to load on the way there) and mark the resident page they fall back to as used. then the most wanted
+// missing pages are loaded, coarser ones first as finer ones show through them, in place of pages that
+// nothing asked for the longest
+static void
+virtual_texture_update(struct VirtualTexture* texture, struct JobSystem* job_system) {
+    texture->frame_number += 1;
+    uint32_t feedback_slot = (uint32_t)(texture->frame_number % FRAME_ARENA_FRAME_COUNT);
+    texture->feedback_slot = feedback_slot;
+    GLsync fence = texture->feedback_fences[feedback_slot];
+    if (!fence) {
+        return;
+    }
+    texture->feedback_fences[feedback_slot] = NULL;
+    GLenum status = glClientWaitSync(fence, /* flags */ 0, /* timeout */ 0);
+    glDeleteSync(fence);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+        texture->stats.dropped_feedback_count += 1;
+        return;
+    }
+    texture->stats.feedback_count += 1;
+
+    // NOTE: neighbouring pixels mostly want the same page so runs of it are only looked up once
+    virtual_texture_page_map_clear(&texture->requests);
+    const uint32_t* pixels = texture->readback + (size_t)feedback_slot * VIRTUAL_TEXTURE_FEEDBACK_MAX_EXTENT * VIRTUAL_TEXTURE_FEEDBACK_MAX_EXTENT;
+    uint32_t pixel_count = (uint32_t)texture->feedback_widths[feedback_slot] * (uint32_t)texture->feedback_heights[feedback_slot];
+    uint32_t previous_page = VIRTUAL_TEXTURE_NULL;
+    uint32_t* previous_count = NULL;
+    for (uint32_t i = 0; i < pixel_count; i++) {
+        uint32_t page = pixels[i];
+        if (page == VIRTUAL_TEXTURE_NULL) {
+            continue;
+        }
+        if (page != previous_page) {
+            uint32_t level = virtual_texture_page_level(page);
+            bool valid =
+                level < texture->level_count &&
+                virtual_texture_page_x(page) < texture->page_count >> level &&
+                virtual_texture_page_y(page) < texture->page_count >> level;
+            previous_page = page;
+            previous_count = valid ? virtual_texture_page_map_insert(&texture->requests, page) : NULL;
+            if (valid && !previous_count) {
+                texture->stats.dropped_request_count += 1;
+            }
+        }
+        if (previous_count) {
+            *previous_count += 1;
+        }
+    }
+
+    virtual_texture_page_map_clear(&texture->loads);
+    for (uint32_t i = 0; i < texture->requests.capacity; i++) {
+        uint32_t page = texture->requests.keys[i];
+        if (page == VIRTUAL_TEXTURE_NULL) {
+            continue;
+        }
+        uint32_t* slot = virtual_texture_page_map_find(&texture->resident, page);
+        if (slot) {
+            virtual_texture_touch(texture, *slot);
+            continue;
+        }
+        uint32_t missing = page;
+        uint32_t parent = virtual_texture_page_parent(page);
+        uint32_t* parent_slot = virtual_texture_page_map_find(&texture->resident, parent);
+        while (!parent_slot) {
+            missing = parent;
+            parent = virtual_texture_page_parent(parent);
+            ASSERT(virtual_texture_page_level(parent) < texture->level_count);
+            parent_slot = virtual_texture_page_map_find(&texture->resident, parent);
+        }
+        virtual_texture_touch(texture, *parent_slot);
+        uint32_t* load_count = virtual_texture_page_map_insert(&texture->loads, missing);
+        if (load_count) {
+            *load_count += texture->requests.values[i];
+        }
+    }
+
+    // NOTE: the best few by level (coarsest first) then pixel count, kept sorted by insertion
+    uint32_t pages[VIRTUAL_TEXTURE_UPLOADS_PER_FRAME];
+    uint64_t priorities[VIRTUAL_TEXTURE_UPLOADS_PER_FRAME];
+    uint32_t page_count = 0;
+    for (uint32_t i = 0; i < texture->loads.capacity; i++) {
+        uint32_t page = texture->loads.keys[i];
+        if (page == VIRTUAL_TEXTURE_NULL) {
+            continue;
+        }
+        uint64_t priority = (uint64_t)virtual_texture_page_level(page) << 32 | texture->loads.values[i];
+        if (page_count == VIRTUAL_TEXTURE_UPLOADS_PER_FRAME && priority <= priorities[page_count - 1]) {
+            continue;
+        }
+        uint32_t index = page_count < VIRTUAL_TEXTURE_UPLOADS_PER_FRAME ? page_count : page_count - 1;
+        page_count = page_count < VIRTUAL_TEXTURE_UPLOADS_PER_FRAME ? page_count + 1 : page_count;
+        while (index > 0 && priorities[index - 1] < priority) {
+            pages[index] = pages[index - 1];
+            priorities[index] = priorities[index - 1];
+            index -= 1;
+        }
+        pages[index] = page;
+        priorities[index] = priority;
+    }
+
+    uint32_t slots[VIRTUAL_TEXTURE_UPLOADS_PER_FRAME];
+    uint32_t load_count = 0;
+    while (load_count < page_count) {
+        uint32_t slot = virtual_texture_find_slot(texture);
+        if (slot == VIRTUAL_TEXTURE_NULL) {
+            break;
+        }
+        virtual_texture_evict(texture, slot);
+        // NOTE: taken right away so it isn't found again
+        texture->slot_pages[slot] = pages[load_count];
+        texture->slot_last_used[slot] = texture->frame_number;
+        slots[load_count] = slot;
+        load_count += 1;
+    }
+    if (load_count > 0) {
+        virtual_texture_load(texture, pages, slots, load_count, job_system);
+    }
+}
+
+// NOTE: the size of the feedback image for a view, small enough for the readback slots
+static void
+virtual_texture_feedback_size(GLsizei width, GLsizei height, GLsizei* feedback_width, GLsizei* feedback_height) {
+    GLsizei widths[2] = {width, height};
+    GLsizei* sizes[2] = {feedback_width, feedback_height};
+    for (uint32_t i = 0; i < 2; i++) {
+        GLsizei size = (widths[i] + VIRTUAL_TEXTURE_FEEDBACK_DIVISOR - 1) / VIRTUAL_TEXTURE_FEEDBACK_DIVISOR;
+        *sizes[i] = size < 1 ? 1 : size > VIRTUAL_TEXTURE_FEEDBACK_MAX_EXTENT ? VIRTUAL_TEXTURE_FEEDBACK_MAX_EXTENT : size;
+    }
+}
+
+// NOTE: draws the texture over a plane of `plane[0]` by `plane[1]` half extents at z `plane[2]`, `uv_rect` is
+// the offset and size of the part of the texture over it. the feedback version writes the page keys the
+// pixels want instead. drawn at a lower resolution than the view its derivatives are larger by the ratio, so
+// `lod_bias` is minus its log2 to ask for the pages the view samples
+static void
+virtual_texture_draw(const struct VirtualTexture* texture, bool feedback, const struct Mat4* view_projection, const float plane[4], const float uv_rect[4], float lod_bias) {
+    GLuint program = feedback ? texture->feedback_program : texture->program;
+    glUseProgram(program);
+    glProgramUniformMatrix4fv(program, /* location */ 0, /* count */ 1, GL_FALSE, &view_projection->columns[0][0]);
+    glProgramUniform4fv(program, /* location */ 1, /* count */ 1, plane);
+    glProgramUniform4fv(program, /* location */ 2, /* count */ 1, uv_rect);
+    glProgramUniform1f(program, /* location */ 3, lod_bias);
+    if (!feedback) {
+        glBindTextureUnit(/* unit */ 0, texture->page_table);
+        glBindSampler(/* unit */ 0, texture->page_table_sampler);
+        glBindTextureUnit(/* unit */ 1, texture->cache);
+        glBindSampler(/* unit */ 1, texture->cache_sampler);
+    }
+    glBindVertexArray(texture->vertex_array);
+    glDrawArrays(GL_TRIANGLE_STRIP, /* first */ 0, /* count */ 4);
+
+    glUseProgram(0);
+    glBindTextureUnit(0, 0);
+    glBindSampler(0, 0);
+    glBindTextureUnit(1, 0);
+    glBindSampler(1, 0);
+    glBindVertexArray(0);
+}
+
+// NOTE: copies the feedback image (the `width` x `height` corner of `feedback_texture`) into the readback
+// slot of this frame and fences it, the cpu looks at it when the slot comes around again
+static void
+virtual_texture_read_feedback(struct VirtualTexture* texture, GLuint feedback_texture, GLsizei width, GLsizei height) {
+    uint32_t slot = texture->feedback_slot;
+    ASSERT(!texture->feedback_fences[slot]);
+    GLsizei slot_size = VIRTUAL_TEXTURE_FEEDBACK_MAX_EXTENT * VIRTUAL_TEXTURE_FEEDBACK_MAX_EXTENT * (GLsizei)sizeof(uint32_t);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, texture->readback_buffer);
+    glGetTextureSubImage(
+        feedback_texture,
+        /* level */ 0,
+        /* offset */ 0, 0, 0,
+        width,
+        height,
+        /* depth */ 1,
+        GL_RED_INTEGER,
+        GL_UNSIGNED_INT,
+        slot_size,
+        (void*)((uintptr_t)slot * (uintptr_t)slot_size)
+    );
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    texture->feedback_fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, /* flags */ 0);
+    texture->feedback_widths[slot] = width;
+    texture->feedback_heights[slot] = height;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// video textures
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// video frames as a decoder hands them out (planar yuv, raw y4m files stand in for the decoder here) are
+// shown on planes in the scene without converting them to rgb on the cpu. the luma plane goes to an R8
+// texture and the two chroma planes, interleaved on the way (the NV12 layout), to an RG8 texture of the
+// chroma size, so a 4:2:0 frame moves 1.5 bytes per texel instead of the 4 of rgba8. the planes of a new
+// frame are copied by the workers into the next slot of a ring of persistently mapped pixel unpack
+// buffer slots (one per frame in flight) and the textures are updated from the slot, which only queues
+// the copy for the gpu. the slot is fenced, when the gpu still has it by the time it comes around again
+// that video skips a frame instead of waiting. the fragment shader filters both textures (the chroma up
+// to the luma size) and converts to rgb with the matrix of the stream, a few multiply adds per pixel on
+// screen instead of per texel of every frame
+// https://wiki.multimedia.cx/index.php/YUV4MPEG2
+// https://www.khronos.org/opengl/wiki/Pixel_Buffer_Object
+// https://www.itu.int/rec/R-REC-BT.709
+
+#define VIDEO_TEXTURE_MAX_COUNT 6 // NOTE: their textures are read by the same render graph pass, 2 accesses each
+#define VIDEO_TEXTURE_MAX_EXTENT 8192
+#define VIDEO_TEXTURE_RING_SIZE FRAME_ARENA_FRAME_COUNT
+#define VIDEO_TEXTURE_COPY_BATCH 32 // NOTE: rows per copy job
+
+// NOTE: an 8 bit y4m file, mapped. the planes of a frame are the luma then both chroma planes
+struct Y4mFile {
+    struct MappedFile file;
+    uint32_t width;
+    uint32_t height;
+    uint32_t chroma_width; // NOTE: zero for gray (mono) streams
+    uint32_t chroma_height;
+    const char* chroma_name;
+    uint32_t frame_rate[2]; // NOTE: numerator and denominator
+    bool full_range; // NOTE: XCOLORRANGE=FULL, video range (16 to 235) otherwise
+    uint32_t frame_count;
+    size_t* frame_offsets; // NOTE: of the planes of every whole frame, after their FRAME line
+};
+
+struct VideoTexture {
+    struct Y4mFile source;
+    char name[MAX_PATH];
+    GLuint luma; // NOTE: GL_R8
+    GLuint chroma; // NOTE: GL_RG8, a single gray texel for mono streams
+    uint32_t luma_pitch; // NOTE: bytes per row in the upload slots, rows are 4 byte aligned like GL_UNPACK_ALIGNMENT wants
+    uint32_t chroma_pitch;
+    size_t slot_size;
+    GLuint upload_buffer;
+    unsigned char* upload; // NOTE: persistently mapped, `VIDEO_TEXTURE_RING_SIZE` slots
+    GLsync upload_fences[VIDEO_TEXTURE_RING_SIZE];
+    uint32_t upload_slot; // NOTE: where the next frame goes
+    uint32_t frame; // NOTE: the one shown, `UINT32_MAX` before the first
+    const unsigned char* copy_source; // NOTE: the planes being copied this update, NULL when there's no new frame
+    unsigned char* copy_destination;
+    float color_matrix[16]; // NOTE: from (y, cb, cr, 1) to rgb with the range offsets folded in
+    float rect[4]; // NOTE: center and half extents of its plane
+};
+
+struct VideoTextureStats {
+    uint64_t upload_count;
+    uint64_t upload_size;
+    uint64_t late_count; // NOTE: new frames whose upload slot the gpu still had
+    uint64_t copy_update_count; // NOTE: updates that copied any frame
+    double copy_seconds;
+};
+
+struct VideoTextures {
+    uint32_t count;
+    struct VideoTexture videos[VIDEO_TEXTURE_MAX_COUNT];
+    float plane_z;
+    GLuint program;
+    GLuint vertex_array; // NOTE: empty, the planes are made from the vertex index
+    GLuint sampler;
+    struct VideoTextureStats stats;
+};
+
+// NOTE: the digits of `text` up to `end`
+static bool
+y4m_parse_uint(const char* text, const char* end, uint32_t* value) {
+    *value = 0;
+    if (text == end) {
+        return false;
+    }
+    for (const char* cursor = text; cursor < end; cursor++) {
+        if (*cursor < '0' || *cursor > '9' || *value > 100000000) {
+            return false;
+        }
+        *value = *value * 10 + (uint32_t)(*cursor - '0');
+    }
+    return true;
+}
+
+static size_t
+y4m_frame_size(const struct Y4mFile* y4m) {
+    return (size_t)y4m->width * y4m->height + (size_t)y4m->chroma_width * y4m->chroma_height * 2;
+}
+
+// NOTE: the frames after the header, their offsets are written when `offsets` isn't NULL. a truncated last
+// frame is left out
+static uint32_t
+y4m_scan_frames(const struct Y4mFile* y4m, size_t position, size_t* offsets) {
+    const unsigned char* data = y4m->file.data;
+    size_t size = y4m->file.size;
+    size_t frame_size = y4m_frame_size(y4m);
+    uint32_t count = 0;
+    while (size - position >= 6 && memcmp(data + position, "FRAME", 5) == 0) {
+        size_t search_size = size - position < 256 ? size - position : 256;
+        const unsigned char* line_end = memchr(data + position, '\n', search_size);
+        if (!line_end) {
+            break;
+        }
+        size_t planes = (size_t)(line_end + 1 - data);
+        if (size - planes < frame_size) {
+            break;
+        }
+        if (offsets) {
+            offsets[count] = planes;
+        }
+        count += 1;
+        position = planes + frame_size;
+    }
+    return count;
+}
+
+static bool
+y4m_parse(struct Y4mFile* y4m) {
+    const char* data = y4m->file.data;
+    size_t search_size = y4m->file.size < 1024 ? y4m->file.size : 1024;
+    const char* line_end = memchr(data, '\n', search_size);
+    if (!line_end || y4m->file.size < 10 || memcmp(data, "YUV4MPEG2 ", 10) != 0) {
+        return false;
+    }
+    uint32_t chroma_shift[2] = {1, 1}; // NOTE: 4:2:0 unless the header says otherwise
+    bool mono = false;
+    y4m->chroma_name = "4:2:0";
+    y4m->frame_rate[0] = 30;
+    y4m->frame_rate[1] = 1;
+    for (const char* token = data + 10; token < line_end;) {
+        const char* token_end = token;
+        while (token_end < line_end && *token_end != ' ') {
+            token_end += 1;
+        }
+        const char* value = token + 1;
+        size_t value_length = token < token_end ? (size_t)(token_end - value) : 0;
+        bool valid = true;
+        if (token == token_end) {
+            // NOTE: repeated spaces
+        } else if (*token == 'W') {
+            valid = y4m_parse_uint(value, token_end, &y4m->width);
+        } else if (*token == 'H') {
+            valid = y4m_parse_uint(value, token_end, &y4m->height);
+        } else if (*token == 'F') {
+            const char* colon = memchr(value, ':', value_length);
+            valid =
+                colon &&
+                y4m_parse_uint(value, colon, &y4m->frame_rate[0]) &&
+                y4m_parse_uint(colon + 1, token_end, &y4m->frame_rate[1]) &&
+                y4m->frame_rate[0] > 0 &&
+                y4m->frame_rate[1] > 0;
+        } else if (*token == 'C') {
+            // NOTE: the 4:2:0 variants only differ in where the chroma samples sit, which is ignored
+            if (value_length >= 3 && memcmp(value, "420", 3) == 0) {
+                valid =
+                    value_length == 3 ||
+                    (value_length == 7 && memcmp(value, "420jpeg", 7) == 0) ||
+                    (value_length == 8 && (memcmp(value, "420mpeg2", 8) == 0 || memcmp(value, "420paldv", 8) == 0));
+            } else if (value_length == 3 && memcmp(value, "422", 3) == 0) {
+                chroma_shift[1] = 0;
+                y4m->chroma_name = "4:2:2";
+            } else if (value_length == 3 && memcmp(value, "444", 3) == 0) {
+                chroma_shift[0] = 0;
+                chroma_shift[1] = 0;
+                y4m->chroma_name = "4:4:4";
+            } else if (value_length == 4 && memcmp(value, "mono", 4) == 0) {
+                mono = true;
+                y4m->chroma_name = "mono";
+            } else {
+                valid = false; // NOTE: more than 8 bits, alpha
+            }
+        } else if (*token == 'X') {
+            if (value_length == 15 && memcmp(value, "COLORRANGE=FULL", 15) == 0) {
+                y4m->full_range = true;
+            }
+        }
+        if (!valid) {
+            return false;
+        }
+        token = token_end + 1;
+    }
+    if (y4m->width == 0 || y4m->width > VIDEO_TEXTURE_MAX_EXTENT || y4m->height == 0 || y4m->height > VIDEO_TEXTURE_MAX_EXTENT) {
+        return false;
+    }
+    if (!mono) {
+        y4m->chroma_width = (y4m->width + (1u << chroma_shift[0]) - 1) >> chroma_shift[0];
+        y4m->chroma_height = (y4m->height + (1u << chroma_shift[1]) - 1) >> chroma_shift[1];
+    }
+
+    size_t header_size = (size_t)(line_end + 1 - data);
+    y4m->frame_count = y4m_scan_frames(y4m, header_size, /* offsets */ NULL);
+    if (y4m->frame_count == 0) {
+        return false;
+    }
+    y4m->frame_offsets = os_alloc(y4m->frame_count * sizeof(size_t));
+    y4m_scan_frames(y4m, header_size, y4m->frame_offsets);
+    return true;
+}
+
+static void
+y4m_close(struct Y4mFile* y4m) {
+    mapped_file_close(&y4m->file);
+    os_free(y4m->frame_offsets);
+    memset(y4m, 0, sizeof(*y4m));
+}
+
+// NOTE: false when it can't be opened or isn't an 8 bit y4m file with at least one frame
+static bool
+y4m_open(struct Y4mFile* y4m, const char* path) {
+    memset(y4m, 0, sizeof(*y4m));
+    if (!mapped_file_open(&y4m->file, path)) {
+        return false;
+    }
+    if (!y4m_parse(y4m)) {
+        y4m_close(y4m);
+        return false;
+    }
+    return true;
+}
+
+// NOTE: BT.601 for standard definition and BT.709 above it, as y4m files don't say. the offsets of the
+// range are folded into the last column, the shader multiplies (y, cb, cr, 1)
+static void
+video_color_matrix(const struct Y4mFile* y4m, float* matrix) {
+    bool bt709 = y4m->height > 576;
+    float red_cr = bt709 ? 1.5748f : 1.402f;
+    float green_cb = bt709 ? 0.187324f : 0.344136f;
+    float green_cr = bt709 ? 0.468124f : 0.714136f;
+    float blue_cb = bt709 ? 1.8556f : 1.772f;
+    float luma_scale = y4m->full_range ? 1.0f : 255.0f / 219.0f;
+    float chroma_scale = y4m->full_range ? 1.0f : 255.0f / 224.0f;
+    float luma_offset = y4m->full_range ? 0.0f : 16.0f / 255.0f;
+    float chroma_offset = 128.0f / 255.0f;
+    float columns[3][3] = {
+        {luma_scale, luma_scale, luma_scale},
+        {0.0f, -green_cb * chroma_scale, blue_cb * chroma_scale},
+        {red_cr * chroma_scale, -green_cr * chroma_scale, 0.0f},
+    };
+    for (uint32_t row = 0; row < 3; row++) {
+        matrix[0 * 4 + row] = columns[0][row];
+        matrix[1 * 4 + row] = columns[1][row];
+        matrix[2 * 4 + row] = columns[2][row];
+        matrix[3 * 4 + row] = -(columns[0][row] * luma_offset + (columns[1][row] + columns[2][row]) * chroma_offset);
+    }
+    matrix[3] = 0.0f;
+    matrix[7] = 0.0f;
+    matrix[11] = 0.0f;
+    matrix[15] = 1.0f;
+}
+
+// NOTE: the separate chroma planes into the (u, v) pairs of the RG8 texture
+static void
+video_interleave_chroma(const unsigned char* u, const unsigned char* v, unsigned char* uv, uint32_t count) {
+    uint32_t i = 0;
+#if defined(_M_X64)
+    for (; i + 16 <= count; i += 16) {
+        __m128i us = _mm_loadu_si128((const __m128i*)(u + i));
+        __m128i vs = _mm_loadu_si128((const __m128i*)(v + i));
+        _mm_storeu_si128((__m128i*)(uv + i * 2), _mm_unpacklo_epi8(us, vs));
+        _mm_storeu_si128((__m128i*)(uv + i * 2 + 16), _mm_unpackhi_epi8(us, vs));
+    }
+#endif
+    for (; i < count; i++) {
+        uv[i * 2] = u[i];
+        uv[i * 2 + 1] = v[i];
+    }
+}
+
+// NOTE: the items are the rows of the luma plane then the rows of the chroma planes
+static void
+video_texture_copy_job(void* data, uint32_t first, uint32_t count, uint32_t worker_index) {
+    (void)worker_index;
+    const struct VideoTexture* video = data;
+    const struct Y4mFile* source = &video->source;
+    size_t luma_size = (size_t)source->width * source->height;
+    size_t chroma_size = (size_t)source->chroma_width * source->chroma_height;
+    for (uint32_t row = first; row < first + count; row++) {
+        if (row < source->height) {
+            memcpy(video->copy_destination + (size_t)row * video->luma_pitch, video->copy_source + (size_t)row * source->width, source->width);
+        } else {
+            uint32_t chroma_row = row - source->height;
+            const unsigned char* u = video->copy_source + luma_size + (size_t)chroma_row * source->chroma_width;
+            unsigned char* uv = video->copy_destination + (size_t)video->luma_pitch * source->height + (size_t)chroma_row * video->chroma_pitch;
+            video_interleave_chroma(u, u + chroma_size, uv, source->chroma_width);
+        }
+    }
+}
+
+// NOTE: a quad of `rect` (center and half extents) at `plane_z` made from the vertex index (a 4 vertex
+// strip), the first row of the video at the top
+static const char* video_texture_vertex_shader_src =
+    "#version 450\n"
+    SHADER_SRC(
+    layout(location = 0) uniform mat4 view_projection;
+    layout(location = 1) uniform vec4 rect;
+    layout(location = 2) uniform float plane_z;
+    out vec2 uv;
+    void main() {
+        vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+        uv = vec2(corner.x, 1.0 - corner.y);
+        gl_Position = view_projection * vec4(rect.xy + (corner * 2.0 - 1.0) * rect.zw, plane_z, 1.0);
+    }
+    );
+
+static const char* video_texture_fragment_shader_src =
+    "#version 450\n"
+    SHADER_SRC(
+    layout(binding = 0) uniform sampler2D luma;
+    layout(binding = 1) uniform sampler2D chroma;
+    layout(location = 3) uniform mat4 color_matrix;
+    in vec2 uv;
+    layout(location = 0) out vec4 frag_color;
+    void main() {
+        vec4 yuv = vec4(texture(luma, uv).r, texture(chroma, uv).rg, 1.0);
+        frag_color = vec4(clamp((color_matrix * yuv).rgb, 0.0, 1.0), 1.0);
+    }
+    );
+
+// NOTE: the textures and upload ring of a video whose `source` is open
+static void
+video_texture_init(struct VideoTexture* video) {
+    const struct Y4mFile* source = &video->source;
+    video->frame = UINT32_MAX;
+    video->luma_pitch = ALIGN_UP(source->width, 4);
+    video->chroma_pitch = ALIGN_UP(source->chroma_width * 2, 4);
+    video->slot_size = ALIGN_UP((size_t)video->luma_pitch * source->height + (size_t)video->chroma_pitch * source->chroma_height, 64);
+    video_color_matrix(source, video->color_matrix);
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &video->luma);
+    glTextureStorage2D(video->luma, /* levels */ 1, GL_R8, (GLsizei)source->width, (GLsizei)source->height);
+    glCreateTextures(GL_TEXTURE_2D, 1, &video->chroma);
+    if (source->chroma_width > 0) {
+        glTextureStorage2D(video->chroma, /* levels */ 1, GL_RG8, (GLsizei)source->chroma_width, (GLsizei)source->chroma_height);
+    } else {
+        glTextureStorage2D(video->chroma, /* levels */ 1, GL_RG8, /* width */ 1, /* height */ 1);
+        glClearTexImage(video->chroma, /* level */ 0, GL_RG, GL_UNSIGNED_BYTE, (unsigned char[]){128, 128});
+    }
+
+    size_t upload_size = video->slot_size * VIDEO_TEXTURE_RING_SIZE;
+    GLbitfield upload_flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glCreateBuffers(1, &video->upload_buffer);
+    glNamedBufferStorage(video->upload_buffer, (GLsizeiptr)upload_size, /* data */ NULL, upload_flags);
+    video->upload = glMapNamedBufferRange(video->upload_buffer, /* offset */ 0, (GLsizeiptr)upload_size, upload_flags);
+    ASSERT(video->upload);
+}
+
+static void
+video_texture_deinit(struct VideoTexture* video) {
+    for (uint32_t i = 0; i < VIDEO_TEXTURE_RING_SIZE; i++) {
+        if (video->upload_fences[i]) {
+            glDeleteSync(video->upload_fences[i]);
+        }
+    }
+    glUnmapNamedBuffer(video->upload_buffer);
+    glDeleteBuffers(1, &video->upload_buffer);
+    glDeleteTextures(1, &video->luma);
+    glDeleteTextures(1, &video->chroma);
+    y4m_close(&video->source);
+    memset(video, 0, sizeof(*video));
+}
+
+// NOTE: the y4m files of the `path` directory, up to `VIDEO_TEXTURE_MAX_COUNT` of them, are laid out in a
+// grid of cells over `area` (half extents and z), every video as big as fits in its cell
+static void
+video_textures_init(struct VideoTextures* textures, const char* path, struct SamplerCache* samplers, const float area[3]) {
+    memset(textures, 0, sizeof(*textures));
+    char pattern[MAX_PATH];
+    snprintf(pattern, sizeof(pattern), "%s\\*.y4m", path);
+    WIN32_FIND_DATAA find_data;
+    HANDLE find = FindFirstFileA(pattern, &find_data);
+    if (find == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    do {
+        struct VideoTexture* video = &textures->videos[textures->count];
+        char file_path[MAX_PATH];
+        int length = snprintf(file_path, sizeof(file_path), "%s\\%s", path, find_data.cFileName);
+        if ((find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) || length < 0 || (size_t)length >= sizeof(file_path)) {
+            continue;
+        }
+        if (y4m_open(&video->source, file_path)) {
+            snprintf(video->name, sizeof(video->name), "%s", find_data.cFileName);
+            video_texture_init(video);
+            textures->count += 1;
+        }
+    } while (textures->count < VIDEO_TEXTURE_MAX_COUNT && FindNextFileA(find, &find_data));
+    FindClose(find);
+    if (textures->count == 0) {
+        return;
+    }
+
+    uint32_t columns = 1;
+    while (columns * columns < textures->count) {
+        columns += 1;
+    }
+    uint32_t rows = (textures->count + columns - 1) / columns;
+    float cell_width = area[0] * 2.0f / (float)columns;
+    float cell_height = area[1] * 2.0f / (float)rows;
+    for (uint32_t i = 0; i < textures->count; i++) {
+        struct VideoTexture* video = &textures->videos[i];
+        float aspect_ratio = (float)video->source.width / (float)video->source.height;
+        float half_width = cell_width * 0.45f;
+        float half_height = half_width / aspect_ratio;
+        if (half_height > cell_height * 0.45f) {
+            half_height = cell_height * 0.45f;
+            half_width = half_height * aspect_ratio;
+        }
+        video->rect[0] = -area[0] + ((float)(i % columns) + 0.5f) * cell_width;
+        video->rect[1] = area[1] - ((float)(i / columns) + 0.5f) * cell_height;
+        video->rect[2] = half_width;
+        video->rect[3] = half_height;
+    }
+    textures->plane_z = area[2];
+
+    GLuint shaders[2] = {
+        shader_create(GL_VERTEX_SHADER, &video_texture_vertex_shader_src, /* source_count */ 1),
+        shader_create(GL_FRAGMENT_SHADER, &video_texture_fragment_shader_src, /* source_count */ 1),
+    };
+    textures->program = glCreateProgram();
+    glAttachShader(textures->program, shaders[0]);
+    glAttachShader(textures->program, shaders[1]);
+    glLinkProgram(textures->program);
+    glDeleteShader(shaders[0]);
+    glDeleteShader(shaders[1]);
+    GLint link_success = 0;
+    glGetProgramiv(textures->program, GL_LINK_STATUS, &link_success);
+    ASSERT(link_success);
+    glCreateVertexArrays(1, &textures->vertex_array);
+    textures->sampler = sampler_cache_preset(samplers, SAMPLER_PRESET_BILINEAR, GL_CLAMP_TO_EDGE);
+}
+
+static void
+video_textures_deinit(struct VideoTextures* textures) {
+    for (uint32_t i = 0; i < textures->count; i++) {
+        video_texture_deinit(&textures->videos[i]);
+    }
+    if (textures->count > 0) {
+        glDeleteProgram(textures->program);
+        glDeleteVertexArrays(1, &textures->vertex_array);
+    }
+    memset(textures, 0, sizeof(*textures));
+}
+
+static void
+video_textures_print_stats(const struct VideoTextures* textures) {
+    const struct VideoTextureStats* stats = &textures->stats;
+    printf(
+        "video frames uploaded = %llu (%.1f MiB, %.3f ms of copying per update with new frames), %llu late (upload slot still in use)\n",
+        (unsigned long long)stats->upload_count,
+        (double)stats->upload_size / (1024.0 * 1024.0),
+        stats->copy_update_count > 0 ? stats->copy_seconds * 1000.0 / (double)stats->copy_update_count : 0.0,
+        (unsigned long long)stats->late_count
+    );
+}
+
+// NOTE: called at the start of every frame (from worker 0 of `job_system`) with the seconds since the start.
+// every video moves to the frame of that time (looping around) when it's a new one: the planes are copied
+// into its next upload slot by the workers (every video at once), then the textures are updated from the slot
+static void
+video_textures_update(struct VideoTextures* textures, double seconds, struct JobSystem* job_system) {
+    if (textures->count == 0) {
+        return;
+    }
+    int64_t start = timer_now();
+    volatile LONG counter = 0;
+    bool copied = false;
+    for (uint32_t i = 0; i < textures->count; i++) {
+        struct VideoTexture* video = &textures->videos[i];
+        const struct Y4mFile* source = &video->source;
+        video->copy_source = NULL;
+        uint64_t frame_number = (uint64_t)(seconds * (double)source->frame_rate[0] / (double)source->frame_rate[1]);
+        uint32_t frame = (uint32_t)(frame_number % source->frame_count);
+        if (frame == video->frame) {
+            continue;
+        }
+        GLsync fence = video->upload_fences[video->upload_slot];
+        if (fence) {
+            GLenum status = glClientWaitSync(fence, /* flags */ 0, /* timeout */ 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+                textures->stats.late_count += 1;
+                continue;
+            }
+            glDeleteSync(fence);
+            video->upload_fences[video->upload_slot] = NULL;
+        }
+        video->frame = frame;
+        video->copy_source = (const unsigned char*)source->file.data + source->frame_offsets[frame];
+        video->copy_destination = video->upload + (size_t)video->upload_slot * video->slot_size;
+        uint32_t row_count = source->height + source->chroma_height;
+        job_system_parallel_for(job_system, /* worker_index */ 0, &video_texture_copy_job, video, row_count, VIDEO_TEXTURE_COPY_BATCH, &counter);
+        copied = true;
+    }
+    if (!copied) {
+        return;
+    }
+    job_system_wait(job_system, /* worker_index */ 0, &counter);
+    textures->stats.copy_seconds += timer_seconds(timer_now() - start);
+    textures->stats.copy_update_count += 1;
+
+    for (uint32_t i = 0; i < textures->count; i++) {
+        struct VideoTexture* video = &textures->videos[i];
+        const struct Y4mFile* source = &video->source;
+        if (!video->copy_source) {
+            continue;
+        }
+        uintptr_t offset = (uintptr_t)video->upload_slot * video->slot_size;
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, video->upload_buffer);
+        glTextureSubImage2D(
+            video->luma,
+            /* level */ 0,
+            /* offset */ 0, 0,
+            (GLsizei)source->width,
+            (GLsizei)source->height,
+            GL_RED,
+            GL_UNSIGNED_BYTE,
+            (void*)offset
+        );
+        if (source->chroma_width > 0) {
+            glTextureSubImage2D(
+                video->chroma,
+                /* level */ 0,
+                /* offset */ 0, 0,
+                (GLsizei)source->chroma_width,
+                (GLsizei)source->chroma_height,
+                GL_RG,
+                GL_UNSIGNED_BYTE,
+                (void*)(offset + (uintptr_t)video->luma_pitch * source->height)
+            );
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        video->upload_fences[video->upload_slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, /* flags */ 0);
+        video->upload_slot = (video->upload_slot + 1) % VIDEO_TEXTURE_RING_SIZE;
+        textures->stats.upload_count += 1;
+        textures->stats.upload_size += y4m_frame_size(source);
+    }
+}
+
+static void
+video_textures_draw(const struct VideoTextures* textures, const struct Mat4* view_projection) {
+    glUseProgram(textures->program);
+    glProgramUniformMatrix4fv(textures->program, /* location */ 0, /* count */ 1, GL_FALSE, &view_projection->columns[0][0]);
+    glProgramUniform1f(textures->program, /* location */ 2, textures->plane_z);
+    glBindSampler(/* unit */ 0, textures->sampler);
+    glBindSampler(/* unit */ 1, textures->sampler);
+    glBindVertexArray(textures->vertex_array);
+    for (uint32_t i = 0; i < textures->count; i++) {
+        const struct VideoTexture* video = &textures->videos[i];
+        glProgramUniform4fv(textures->program, /* location */ 1, /* count */ 1, video->rect);
+        glProgramUniformMatrix4fv(textures->program, /* location */ 3, /* count */ 1, GL_FALSE, video->color_matrix);
+        glBindTextureUnit(/* unit */ 0, video->luma);
+        glBindTextureUnit(/* unit */ 1, video->chroma);
+        glDrawArrays(GL_TRIANGLE_STRIP, /* first */ 0, /* count */ 4);
+    }
+
+    glUseProgram(0);
+    glBindTextureUnit(0, 0);
+    glBindSampler(0, 0);
+    glBindTextureUnit(1, 0);
+    glBindSampler(1, 0);
+    glBindVertexArray(0);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// frame passes
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// the render graph passes of the frame: the scene is drawn into offscreen targets and then blitted to
+// the default framebuffer. the scene can first be drawn depth only (from the position only vertex stream
+// with color writes off) so the main pass, testing with `GL_EQUAL` and not writing depth, runs the
+// fragment shader once per pixel however many objects overlap there. draws are sorted front to back so
+// the depth only draws reject as much as they can too. fragment shader invocations are counted with
+// pipeline statistics queries to compare with and without the prepass (and each occlusion culling mode).
+// with depth pyramid occlusion culling the scene is drawn in the two phases described in the occlusion
+// culling section, as passes around the compute passes that cull and build the pyramid. with occlusion
+// queries it's the scene pass recording queried draw lists instead of replaying the baked ones
+
+#define SCENE_COLOR_FORMAT GL_RGBA8
+#define SCENE_DEPTH_FORMAT GL_DEPTH_COMPONENT32F
+#define FRAGMENT_STATISTICS_PRINT_FRAMES 240
+
+// NOTE: one query per frame in flight, a query is read back when its slot comes around again
+// (`FRAME_ARENA_FRAME_COUNT` frames later) so waiting on the result never stalls
+struct FragmentStatistics {
+    bool supported;
+    GLuint queries[FRAME_ARENA_FRAME_COUNT];
+    bool query_pending[FRAME_ARENA_FRAME_COUNT];
+    bool query_depth_prepass[FRAME_ARENA_FRAME_COUNT];
+    enum OcclusionCullingMode query_occlusion_culling[FRAME_ARENA_FRAME_COUNT];
+    uint32_t frame_number;
+    uint64_t invocations[OCCLUSION_CULLING_MODE_COUNT][2]; // NOTE: indexed by the culling mode and whether the depth prepass was on
+    uint32_t frame_counts[OCCLUSION_CULLING_MODE_COUNT][2];
+};
+
+struct ScenePass {
+    struct SceneUpdate* scene_update;
+    uint32_t draw_count; // NOTE: the draw items are gathered and sorted front to back
+    const struct DrawListRecording* draw_list; // NOTE: everything but the draw items
+    const struct DrawListRecording* depth_draw_list;
+    struct BakedCommandList* baked_list; // NOTE: draws every object of the scene front to back
+    struct BakedCommandList* depth_baked_list;
+    struct BakedCommandList* equal_baked_list; // NOTE: captured with the after prepass depth state
+    const struct DrawListRecording* queried_draw_list; // NOTE: null unless drawing with occlusion queries
+    GLuint material_buffer;
+    struct FragmentStatistics* fragment_statistics;
+    bool depth_prepass;
+    struct JobSystem* job_system;
+    struct LinearArena* frame_memory;
+    GLsizei width;
+    GLsizei height;
+};
+
+struct OcclusionCullPass {
+    struct OcclusionCulling* culling;
+    bool second_phase;
+    GLuint transforms;
+    GLintptr transforms_offset;
+    GLsizeiptr transforms_size;
+};
+
+struct OcclusionPyramidPass {
+    struct OcclusionCulling* culling;
+    uint32_t depth; // NOTE: render graph resource
+};
+
+// NOTE: the scene draws of one or both occlusion culling phases
+struct OcclusionDrawPass {
+    const struct OcclusionCulling* culling;
+    struct FragmentStatistics* fragment_statistics;
+    GLuint program;
+    GLuint texture;
+    GLuint sampler;
+    GLuint material_buffer;
+    GLuint vertex_array;
+    GLenum index_type;
+    GLuint transforms;
+    GLintptr transforms_offset;
+    GLsizeiptr transforms_size;
+    uint32_t first_phase;
+    uint32_t phase_count;
+    bool clear_color;
+    bool clear_depth;
+    bool depth_equal;
+    bool begin_statistics;
+    bool end_statistics;
+    bool depth_prepass;
+    GLsizei width;
+    GLsizei height;
+};
+
+// NOTE: the feedback pass and the pass drawing the virtual texture over the scene
+struct VirtualTexturePass {
+    struct VirtualTexture* texture;
+    struct Mat4 view_projection;
+    float plane[4];
+    float uv_rect[4];
+    uint32_t feedback; // NOTE: render graph resource
+    GLsizei width;
+    GLsizei height;
+    float lod_bias;
+};
+
+// NOTE: the video planes drawn over the scene
+struct VideoPass {
+    const struct VideoTextures* textures;
+    struct Mat4 view_projection;
+    GLsizei width;
+    GLsizei height;
+};
+
+struct PresentPass {
+    GLsizei width;
+    GLsizei height;
+};
+
+static const float scene_clear_color[4] = {0.8f, 0.6f, 0.4f, 1.0f};
+
+static void
+fragment_statistics_init(struct FragmentStatistics* statistics) {
+    memset(statistics, 0, sizeof(*statistics));
+    statistics->supported = gl_has_extension("GL_ARB_pipeline_statistics_query");
+    if (statistics->supported) {
+        glCreateQueries(GL_FRAGMENT_SHADER_INVOCATIONS_ARB, LEN(statistics->queries), statistics->queries);
+    }
+}
+
+static void
+fragment_statistics_deinit(struct FragmentStatistics* statistics) {
+    if (statistics->supported) {
+        glDeleteQueries(LEN(statistics->queries), statistics->queries);
+    }
+    memset(statistics, 0, sizeof(*statistics));
+}
+
+static void
+fragment_statistics_print(const struct FragmentStatistics* statistics) {
+    for (uint32_t culling = 0; culling < OCCLUSION_CULLING_MODE_COUNT; culling++) {
+        const uint32_t* frame_counts = statistics->frame_counts[culling];
+        double averages[2] = {0};
+        for (uint32_t i = 0; i < LEN(averages); i++) {
+            if (frame_counts[i] > 0) {
+                averages[i] = (double)statistics->invocations[culling][i] / (double)frame_counts[i];
+            }
+        }
+        const char* culling_name = occlusion_culling_mode_names[culling];
+        if (frame_counts[0] > 0 && frame_counts[1] > 0) {
+            double saved = averages[0] > 0.0 ? (1.0 - averages[1] / averages[0]) * 100.0 : 0.0;
+            printf(
+                "fragment shader invocations per frame (occlusion culling %s) = %.0f with depth prepass, %.0f without (%.1f%% saved)\n",
+                culling_name, averages[1], averages[0], saved
+            );
+        } else if (frame_counts[1] > 0) {
+            printf("fragment shader invocations per frame (occlusion culling %s) = %.0f with depth prepass (press P to compare)\n", culling_name, averages[1]);
+        } else if (frame_counts[0] > 0) {
+            printf("fragment shader invocations per frame (occlusion culling %s) = %.0f without depth prepass (press P to compare)\n", culling_name, averages[0]);
+        }
+    }
+}
+
+// NOTE: reads back the query of this slot from `FRAME_ARENA_FRAME_COUNT` frames ago and starts counting
+static void
+fragment_statistics_begin(struct FragmentStatistics* statistics, bool depth_prepass, enum OcclusionCullingMode occlusion_culling) {
+    if (!statistics->supported) {
+        return;
+    }
+    uint32_t slot = statistics->frame_number % FRAME_ARENA_FRAME_COUNT;
+    if (statistics->query_pending[slot]) {
+        GLuint64 available = 0;
+        glGetQueryObjectui64v(statistics->queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) {
+            GLuint64 invocations = 0;
+            glGetQueryObjectui64v(statistics->queries[slot], GL_QUERY_RESULT, &invocations);
+            uint32_t culling = (uint32_t)statistics->query_occlusion_culling[slot];
+            uint32_t prepass = statistics->query_depth_prepass[slot] ? 1 : 0;
+            statistics->invocations[culling][prepass] += invocations;
+            statistics->frame_counts[culling][prepass] += 1;
+        }
+    }
+
+    statistics->query_pending[slot] = true;
+    statistics->query_depth_prepass[slot] = depth_prepass;
+    statistics->query_occlusion_culling[slot] = occlusion_culling;
+    glBeginQuery(GL_FRAGMENT_SHADER_INVOCATIONS_ARB, statistics->queries[slot]);
+}
+
+static void
+fragment_statistics_end(struct FragmentStatistics* statistics) {
+    if (!statistics->supported) {
+        return;
+    }
+    glEndQuery(GL_FRAGMENT_SHADER_INVOCATIONS_ARB);
+    statistics->frame_number += 1;
+    if (statistics->frame_number % FRAGMENT_STATISTICS_PRINT_FRAMES == 0) {
+        fragment_statistics_print(statistics);
+    }
+}
+
+// NOTE: the baked list when every object is visible (it draws them all in the same order the recorded
+// draw items would be in) or the command buffers recorded by the workers otherwise (always without a baked list)
+static void
+scene_pass_draw(
+    const struct ScenePass* scene_pass,
+    const struct DrawListRecording* draw_list_template,
+    struct BakedCommandList* baked_list,
+    uint32_t draw_count,
+    GLuint framebuffer,
+    struct CommandExecutionState* execution_state
+) {
+    if (baked_list && draw_count == scene_pass->scene_update->scene->object_count) {
+        if (baked_list->nv_token_buffer != 0) {
+            baked_command_list_replay_nv(baked_list, framebuffer, &execution_state->stats);
+        } else {
+            baked_command_list_replay(baked_list, &execution_state->stats);
+        }
+        // NOTE: replaying expects all zeros state so the binds it leaves behind are reset for the next list
+        glUseProgram(0);
+        glBindTextureUnit(0, 0);
+        glBindSampler(0, 0);
+        glBindVertexArray(0);
+    } else {
+        struct DrawListRecording draw_list = *draw_list_template;
+        draw_list.draw_items = scene_pass->scene_update->draw_items;
+        draw_list.draw_count = draw_count;
+        draw_list_record(&draw_list, scene_pass->job_system, scene_pass->frame_memory);
+        for (uint32_t i = 0; i < draw_list_batch_count(&draw_list); i++) {
+            command_buffer_execute(&draw_list.command_buffers[i], execution_state);
+        }
+    }
+}
+
+static void
+scene_pass_execute(void* data, const struct RenderGraph* graph, uint32_t pass) {
+    const struct ScenePass* scene_pass = data;
+    GLuint framebuffer = render_graph_pass_framebuffer(graph, pass);
+
+    glViewport(/* x */ 0, /* y */ 0, scene_pass->width, scene_pass->height);
+    glClearNamedFramebufferfv(framebuffer, GL_COLOR, /* drawbuffer */ 0, scene_clear_color);
+    glClearNamedFramebufferfv(framebuffer, GL_DEPTH, /* drawbuffer */ 0, (float[]){1.0f});
+
+    // NOTE: when nothing is culled the baked lists draw exactly the visible objects. otherwise workers
+    // record the visible draws into command buffers which are then executed here in order
+
+    // NOTE: the state left by the previous frame cleanup is all zeros
+    struct CommandExecutionState execution_state = {0};
+    uint32_t draw_count = scene_pass->draw_count;
+
+    // NOTE: queried draws set the depth state of the pass themselves after each group of proxies
+    struct DrawListRecording queried_draw_list = {0};
+    if (scene_pass->queried_draw_list) {
+        queried_draw_list = *scene_pass->queried_draw_list;
+        queried_draw_list.depth_func = scene_pass->depth_prepass ? GL_EQUAL : GL_LESS;
+        queried_draw_list.depth_write = !scene_pass->depth_prepass;
+    }
+    enum OcclusionCullingMode occlusion_culling = scene_pass->queried_draw_list ? OCCLUSION_CULLING_QUERIES : OCCLUSION_CULLING_NONE;
+
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIALS_STORAGE_BINDING, scene_pass->material_buffer);
+    fragment_statistics_begin(scene_pass->fragment_statistics, scene_pass->depth_prepass, occlusion_culling);
+    if (scene_pass->depth_prepass) {
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        scene_pass_draw(scene_pass, scene_pass->depth_draw_list, scene_pass->depth_baked_list, draw_count, framebuffer, &execution_state);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+        if (scene_pass->queried_draw_list) {
+            scene_pass_draw(scene_pass, &queried_draw_list, /* baked_list */ NULL, draw_count, framebuffer, &execution_state);
+        } else {
+            scene_pass_draw(scene_pass, scene_pass->draw_list, scene_pass->equal_baked_list, draw_count, framebuffer, &execution_state);
+        }
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+    } else if (scene_pass->queried_draw_list) {
+        scene_pass_draw(scene_pass, &queried_draw_list, /* baked_list */ NULL, draw_count, framebuffer, &execution_state);
+    } else {
+        scene_pass_draw(scene_pass, scene_pass->draw_list, scene_pass->baked_list, draw_count, framebuffer, &execution_state);
+    }
+    fragment_statistics_end(scene_pass->fragment_statistics);
+
+    // cleanup opengl state (not really required)
+    glUseProgram(0);
+    glBindTextureUnit(0, 0);
+    glBindSampler(0, 0);
+    glBindVertexArray(0);
+}
+
+static void
+occlusion_cull_pass_execute(void* data, const struct RenderGraph* graph, uint32_t pass) {
+    (void)graph;
+    (void)pass;
+    const struct OcclusionCullPass* cull_pass = data;
+    if (!cull_pass->second_phase) {
+        // NOTE: the visibility was written by the second phase of the previous frame which the graph doesn't see
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+    occlusion_culling_cull(cull_pass->culling, cull_pass->second_phase, cull_pass->transforms, cull_pass->transforms_offset, cull_pass->transforms_size);
+}
+
+static void
+occlusion_pyramid_pass_execute(void* data, const struct RenderGraph* graph, uint32_t pass) {
+    (void)pass;
+    const struct OcclusionPyramidPass* pyramid_pass = data;
+    occlusion_culling_build_pyramid(pyramid_pass->culling, render_graph_object(graph, pyramid_pass->depth));
+}
+
+static void
+occlusion_draw_pass_execute(void* data, const struct RenderGraph* graph, uint32_t pass) {
+    const struct OcclusionDrawPass* draw_pass = data;
+    GLuint framebuffer = render_graph_pass_framebuffer(graph, pass);
+
+    glViewport(/* x */ 0, /* y */ 0, draw_pass->width, draw_pass->height);
+    if (draw_pass->clear_color) {
+        glClearNamedFramebufferfv(framebuffer, GL_COLOR, /* drawbuffer */ 0, scene_clear_color);
+    }
+    if (draw_pass->clear_depth) {
+        glClearNamedFramebufferfv(framebuffer, GL_DEPTH, /* drawbuffer */ 0, (float[]){1.0f});
+    }
+    if (draw_pass->begin_statistics) {
+        fragment_statistics_begin(draw_pass->fragment_statistics, draw_pass->depth_prepass, OCCLUSION_CULLING_DEPTH_PYRAMID);
+    }
+    if (draw_pass->depth_equal) {
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+    }
+
+    glUseProgram(draw_pass->program);
+    glBindTextureUnit(/* unit */ 0, draw_pass->texture);
+    glBindSampler(/* unit */ 0, draw_pass->sampler);
+    glBindVertexArray(draw_pass->vertex_array);
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, /* binding */ 0, draw_pass->transforms, draw_pass->transforms_offset, draw_pass->transforms_size);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIALS_STORAGE_BINDING, draw_pass->material_buffer);
+    occlusion_culling_draw(draw_pass->culling, draw_pass->first_phase, draw_pass->phase_count, draw_pass->index_type);
+
+    if (draw_pass->depth_equal) {
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+    }
+    if (draw_pass->end_statistics) {
+        fragment_statistics_end(draw_pass->fragment_statistics);
+    }
+
+    // cleanup opengl state (not really required)
+    glUseProgram(0);
+    glBindTextureUnit(0, 0);
+    glBindSampler(0, 0);
+    glBindVertexArray(0);
+}
+
+static void
+virtual_texture_feedback_pass_execute(void* data, const struct RenderGraph* graph, uint32_t pass) {
+    const struct VirtualTexturePass* feedback_pass = data;
+    GLuint framebuffer = render_graph_pass_framebuffer(graph, pass);
+
+    glViewport(/* x */ 0, /* y */ 0, feedback_pass->width, feedback_pass->height);
+    glClearNamedFramebufferuiv(framebuffer, GL_COLOR, /* drawbuffer */ 0, (GLuint[]){VIRTUAL_TEXTURE_NULL, 0, 0, 0});
+    glDisable(GL_CULL_FACE);
+    virtual_texture_draw(feedback_pass->texture, /* feedback */ true, &feedback_pass->view_projection, feedback_pass->plane, feedback_pass->uv_rect, feedback_pass->lod_bias);
+    glEnable(GL_CULL_FACE);
+    virtual_texture_read_feedback(feedback_pass->texture, render_graph_object(graph, feedback_pass->feedback), feedback_pass->width, feedback_pass->height);
+}
+
+// NOTE: drawn over the scene, depth tested against it but not written
+static void
+virtual_texture_map_pass_execute(void* data, const struct RenderGraph* graph, uint32_t pass) {
+    (void)graph;
+    (void)pass;
+    const struct VirtualTexturePass* map_pass = data;
+
+    glViewport(/* x */ 0, /* y */ 0, map_pass->width, map_pass->height);
+    glDisable(GL_CULL_FACE);
+    glDepthMask(GL_FALSE);
+    virtual_texture_draw(map_pass->texture, /* feedback */ false, &map_pass->view_projection, map_pass->plane, map_pass->uv_rect, map_pass->lod_bias);
+    glDepthMask(GL_TRUE);
+    glEnable(GL_CULL_FACE);
+}
+
+// NOTE: like the map, depth tested against the scene but not written
+static void
+video_pass_execute(void* data, const struct RenderGraph* graph, uint32_t pass) {
+    (void)graph;
+    (void)pass;
+    const struct VideoPass* video_pass = data;
+
+    glViewport(/* x */ 0, /* y */ 0, video_pass->width, video_pass->height);
+    glDisable(GL_CULL_FACE);
+    glDepthMask(GL_FALSE);
+    video_textures_draw(video_pass->textures, &video_pass->view_projection);
+    glDepthMask(GL_TRUE);
+    glEnable(GL_CULL_FACE);
+}
+
+static void
+present_pass_execute(void* data, const struct RenderGraph* graph, uint32_t pass) {
+    const struct PresentPass* present_pass = data;
+    glBlitNamedFramebuffer(
+        render_graph_pass_framebuffer(graph, pass),
+        /* drawFramebuffer */ 0,
+        /* src */ 0, 0, present_pass->width, present_pass->height,
+        /* dst */ 0, 0, present_pass->width, present_pass->height,
+        GL_COLOR_BUFFER_BIT,
+        GL_NEAREST
+    );
+}
+
+#if defined(BENCHMARKS)
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// benchmarks
+///////////////////////////////////////////////////////////////////////////////////////////////////
+
+// NOTE: the multithreaded benchmarks run with 1, 2, 4... workers up to one per logical processor
+static uint32_t
+benchmark_max_worker_count(void) {
+    SYSTEM_INFO system_info = {0};
+    GetSystemInfo(&system_info);
+    return (uint32_t)system_info.dwNumberOfProcessors < JOB_MAX_WORKERS ? (uint32_t)system_info.dwNumberOfProcessors : JOB_MAX_WORKERS;
+}
+
+static uint32_t
+benchmark_next_worker_count(uint32_t worker_count, uint32_t max_worker_count) {
+    return worker_count * 2 < max_worker_count ? worker_count * 2 : max_worker_count;
+}
+
+// NOTE: builds a typical frame worth of cpu side render data (draw items, sort keys and uniform blocks)
+// from the frame arena and compares against allocating the same from the os every frame
+static void
+benchmark_frame_arena(void) {
+    struct BenchmarkDrawItem {
+        uint64_t sort_key;
+        uint32_t mesh_index;
+        uint32_t uniform_index;
+    };
+    struct BenchmarkUniforms {
+        float transform[4][4];
+    };
+
+    enum { FRAME_COUNT = 1000, THREAD_COUNT = 4, DRAWS_PER_THREAD = 4096 };
+
+    struct FrameArena* frame_arena = os_alloc(sizeof(struct FrameArena));
+    frame_arena_init(frame_arena, THREAD_COUNT, /* thread_capacity */ 1024 * 1024);
+
+    uint64_t checksum = 0;
+    for (uint32_t pass = 0; pass < 2; pass++) {
+        bool use_frame_arena = pass == 0;
+        LONG allocation_count = os_allocation_count;
+        int64_t start = timer_now();
+
+        for (uint32_t frame = 0; frame < FRAME_COUNT; frame++) {
+            void* os_allocations[THREAD_COUNT * 2] = {0};
+            if (use_frame_arena) {
+                frame_arena_begin(frame_arena);
+            }
+
+            // NOTE: each sub-arena is what a worker thread would be filling in parallel
+            for (uint32_t thread = 0; thread < THREAD_COUNT; thread++) {
+                struct BenchmarkDrawItem* draws = NULL;
+                struct BenchmarkUniforms* uniforms = NULL;
+                if (use_frame_arena) {
+                    struct LinearArena* arena = frame_arena_thread(frame_arena, thread);
+                    draws = LINEAR_ALLOC(arena, struct BenchmarkDrawItem, DRAWS_PER_THREAD);
+                    uniforms = LINEAR_ALLOC(arena, struct BenchmarkUniforms, DRAWS_PER_THREAD);
+                } else {
+                    draws = os_alloc(sizeof(struct BenchmarkDrawItem) * DRAWS_PER_THREAD);
+                    uniforms = os_alloc(sizeof(struct BenchmarkUniforms) * DRAWS_PER_THREAD);
+                    os_allocations[thread * 2 + 0] = draws;
+                    os_allocations[thread * 2 + 1] = uniforms;
+                }
+
+                for (uint32_t i = 0; i < DRAWS_PER_THREAD; i++) {
+                    uint32_t index = thread * DRAWS_PER_THREAD + i;
+                    draws[i].sort_key = ((uint64_t)(index * 2654435761u) << 32) | index;
+                    draws[i].mesh_index = index % 64;
+                    draws[i].uniform_index = i;
+                    memset(&uniforms[i], 0, sizeof(uniforms[i]));
+                    uniforms[i].transform[3][0] = (float)i;
+                    checksum += draws[i].sort_key;
+                }
+            }
+
+            for (uint32_t i = 0; i < LEN(os_allocations); i++) {
+                os_free(os_allocations[i]);
+            }
+        }
+
+        double seconds = timer_seconds(timer_now() - start);
+        printf(
+            "frame arena (%s): %.3f us/frame, %.2f os allocations/frame\n",
+            use_frame_arena ? "frame arena" : "os alloc",
+            seconds * 1000000.0 / FRAME_COUNT,
+            (double)(os_allocation_count - allocation_count) / FRAME_COUNT
+        );
+        if (use_frame_arena) {
+            // NOTE: the steady state frame path must not allocate at all
+            ASSERT(os_allocation_count == allocation_count);
+        }
+    }
+
+    frame_arena_print_stats(frame_arena);
+    printf("(checksum %llu)\n", (unsigned long long)checksum);
+    frame_arena_deinit(frame_arena);
+    os_free(frame_arena);
+}
+
+// NOTE: transforms a million object matrices (and points) like a big scene would every frame
+// with one matrix at a time and with the batched structure of arrays kernels
+static void
+benchmark_math(void) {
+    enum { COUNT = 1000 * 1000, ITERATION_COUNT = 20 };
+
+    size_t memory_size = 2 * COUNT * sizeof(struct Mat4) + 2 * (16 + 4) * (size_t)math_array_capacity(COUNT) * sizeof(float) + 4096;
+    struct LinearArena arena = {.base = os_alloc(memory_size), .capacity = memory_size};
+
+    struct Mat4* models = LINEAR_ALLOC(&arena, struct Mat4, COUNT);
+    struct Mat4* results = LINEAR_ALLOC(&arena, struct Mat4, COUNT);
+    struct Mat4Array model_array = mat4_array_alloc(&arena, COUNT);
+    struct Mat4Array result_array = mat4_array_alloc(&arena, COUNT);
+    struct Vec4Array point_array = vec4_array_alloc(&arena, COUNT);
+    struct Vec4Array result_point_array = vec4_array_alloc(&arena, COUNT);
+
+    struct Vec3 axis = vec3_normalize((struct Vec3){1.0f, 2.0f, 3.0f});
+    for (uint32_t i = 0; i < COUNT; i++) {
+        struct Vec3 position = {(float)(i % 1000), (float)(i / 1000), 0.0f};
+        models[i] = mat4_transform(position, axis, (float)i * 0.001f, 1.0f);
+        mat4_array_set(&model_array, i, &models[i]);
+        point_array.components[0][i] = position.x;
+        point_array.components[1][i] = position.y;
+        point_array.components[2][i] = position.z;
+        point_array.components[3][i] = 1.0f;
+    }
+
+    struct Mat4 view = mat4_look_at((struct Vec3){0.0f, 0.0f, 10.0f}, (struct Vec3){0.0f, 0.0f, 0.0f}, (struct Vec3){0.0f, 1.0f, 0.0f});
+    struct Mat4 projection = mat4_perspective(1.0471976f, 16.0f / 9.0f, 0.1f, 100.0f);
+    struct Mat4 view_projection = mat4_mul(&projection, &view);
+
+    double checksum = 0.0;
+    for (uint32_t kernel = 0; kernel < 5; kernel++) {
+        const char* name = NULL;
+        switch (kernel) {
+            case 0: name = "mat4 x mat4, one at a time"; break;
+            case 1: name = "mat4 x mat4, soa 4 wide"; break;
+            case 2: name = "mat4 x mat4, soa avx2"; break;
+            case 3: name = "mat4 x vec4, soa 4 wide"; break;
+            default: name = "mat4 x vec4, soa avx2"; break;
+        }
+        bool is_avx2 = kernel == 2 || kernel == 4;
+        if (is_avx2 && !cpu_features.avx2) {
+            printf("math (%s): skipped, no avx2\n", name);
+            continue;
+        }
+
+        int64_t start = timer_now();
+        for (uint32_t iteration = 0; iteration < ITERATION_COUNT; iteration++) {
+            switch (kernel) {
+                case 0:
+                    for (uint32_t i = 0; i < COUNT; i++) {
+                        results[i] = mat4_mul(&view_projection, &models[i]);
+                    }
+                    break;
+                case 1: mat4_array_mul_f32x4(&view_projection, &model_array, &result_array); break;
+                case 3: mat4_mul_vec4_array_f32x4(&view_projection, &point_array, &result_point_array); break;
+#if defined(_M_X64)
+                case 2: mat4_array_mul_avx2(&view_projection, &model_array, &result_array); break;
+                case 4: mat4_mul_vec4_array_avx2(&view_projection, &point_array, &result_point_array); break;
+#endif
+                default: break;
+            }
+        }
+        double seconds = timer_seconds(timer_now() - start) / ITERATION_COUNT;
+        printf("math (%s): %.3f ms per 1M, %.2f ns each\n", name, seconds * 1000.0, seconds * 1000000000.0 / COUNT);
+
+        checksum += kernel == 0 ? results[COUNT - 1].columns[3][0] : kernel < 3 ? result_array.elements[12][COUNT - 1] : result_point_array.components[0][COUNT - 1];
+    }
+
+    // NOTE: every path must agree with the single matrix one
+    struct Mat4 batched = {0};
+    mat4_array_mul(&view_projection, &model_array, &result_array);
+    mat4_array_get(&result_array, COUNT - 1, &batched);
+    mat4_mul_vec4_array(&view_projection, &point_array, &result_point_array);
+    for (uint32_t i = 0; i < 16; i++) {
+        float expected = results[COUNT - 1].columns[i / 4][i % 4];
+        ASSERT(fabsf(batched.columns[i / 4][i % 4] - expected) <= 1e-3f * fmaxf(1.0f, fabsf(expected)));
+    }
+    for (uint32_t i = 0; i < 4; i++) {
+        float expected = results[COUNT - 1].columns[3][i];
+        ASSERT(fabsf(result_point_array.components[i][COUNT - 1] - expected) <= 1e-3f * fmaxf(1.0f, fabsf(expected)));
+    }
+
+    printf("(checksum %f)\n", checksum);
+    os_free(arena.base);
+}
+
+// NOTE: frustum culls a million boxes scattered around the camera (about a fifth of them visible)
+// on one core, one box at a time and 8 at a time with AVX2
+static void
+benchmark_frustum_culling(void) {
+    enum { COUNT = 1000 * 1000, ITERATION_COUNT = 50 };
+
+    size_t memory_size = 6 * (size_t)math_array_capacity(COUNT) * sizeof(float) + 2 * (size_t)math_array_capacity(COUNT) * sizeof(uint32_t) + 4096;
+    struct LinearArena arena = {.base = os_alloc(memory_size), .capacity = memory_size};
+    struct AabbArray boxes = aabb_array_alloc(&arena, COUNT);
+    uint32_t* visible_indices = LINEAR_ALLOC(&arena, uint32_t, math_array_capacity(COUNT));
+    uint32_t* expected_indices = LINEAR_ALLOC(&arena, uint32_t, math_array_capacity(COUNT));
+
+    uint32_t random = 1;
+    for (uint32_t i = 0; i < COUNT; i++) {
+        for (uint32_t j = 0; j < 3; j++) {
+            random = random * 1664525u + 1013904223u;
+            float center = ((float)(random >> 8) / (float)(1 << 24) - 0.5f) * 200.0f;
+            boxes.min[j][i] = center - 0.5f;
+            boxes.max[j][i] = center + 0.5f;
+        }
+    }
+
+    struct Mat4 view = mat4_look_at((struct Vec3){0.0f, 0.0f, 0.0f}, (struct Vec3){0.0f, 0.0f, -1.0f}, (struct Vec3){0.0f, 1.0f, 0.0f});
+    struct Mat4 projection = mat4_perspective(1.0471976f, 16.0f / 9.0f, 0.1f, 100.0f);
+    struct Mat4 view_projection = mat4_mul(&projection, &view);
+    float planes[6][4];
+    frustum_planes_from_matrix(&view_projection, planes);
+
+    uint32_t expected_count = frustum_cull_aabbs_scalar(planes, &boxes, expected_indices);
+    for (uint32_t kernel = 0; kernel < 2; kernel++) {
+        const char* name = kernel == 0 ? "one at a time" : "soa avx2";
+        if (kernel == 1 && !cpu_features.avx2) {
+            printf("frustum culling (%s): skipped, no avx2\n", name);
+            continue;
+        }
+
+        uint32_t visible_count = 0;
+        int64_t start = timer_now();
+        for (uint32_t iteration = 0; iteration < ITERATION_COUNT; iteration++) {
+#if defined(_M_X64)
+            if (kernel == 1) {
+                visible_count = frustum_cull_aabbs_avx2(planes, &boxes, visible_indices);
+                continue;
+            }
+#endif
+            visible_count = frustum_cull_aabbs_scalar(planes, &boxes, visible_indices);
+        }
+        double seconds = timer_seconds(timer_now() - start) / ITERATION_COUNT;
+        printf("frustum culling (%s): %.3f ms per 1M, %u visible\n", name, seconds * 1000.0, visible_count);
+
+        // NOTE: every path must find the same boxes in the same order
+        ASSERT(visible_count == expected_count);
+        ASSERT(memcmp(visible_indices, expected_indices, visible_count * sizeof(uint32_t)) == 0);
+    }
+
+    os_free(arena.base);
+}
+
+// NOTE: 4 million objects scattered in a big volume around the camera, frustum culled one box at a time
+// against all of them and through the bvh (with the exact test on its candidates), then refit with 1% of
+// them moved and picked with rays through the view
+static void
+benchmark_bvh(void) {
+    enum { COUNT = 4 * 1000 * 1000, ITERATION_COUNT = 10, MOVED_COUNT = COUNT / 100, RAY_COUNT = 10000 };
+
+    size_t memory_size =
+        6 * (size_t)math_array_capacity(COUNT) * sizeof(float) +
+        bvh_memory_size(COUNT) +
+        bvh_build_scratch_size(COUNT) +
+        3 * (size_t)math_array_capacity(COUNT) * sizeof(uint32_t) +
+        MOVED_COUNT * (sizeof(uint32_t) + 6 * sizeof(float)) + 4096;
+    struct LinearArena arena = {.base = os_alloc(memory_size), .capacity = memory_size};
+    struct AabbArray boxes = aabb_array_alloc(&arena, COUNT);
+    struct Bvh bvh;
+    bvh_init(&bvh, &arena, COUNT);
+    uint32_t* brute_force_indices = LINEAR_ALLOC(&arena, uint32_t, math_array_capacity(COUNT));
+    uint32_t* candidates = LINEAR_ALLOC(&arena, uint32_t, math_array_capacity(COUNT));
+    uint32_t* moved_objects = LINEAR_ALLOC(&arena, uint32_t, MOVED_COUNT);
+
+    uint32_t random = 1;
+    for (uint32_t i = 0; i < COUNT; i++) {
+        for (uint32_t j = 0; j < 3; j++) {
+            random = random * 1664525u + 1013904223u;
+            float center = ((float)(random >> 8) / (float)(1 << 24) - 0.5f) * 1000.0f;
+            boxes.min[j][i] = center - 0.5f;
+            boxes.max[j][i] = center + 0.5f;
+        }
+    }
+
+    int64_t start = timer_now();
+    bvh_build(&bvh, &boxes, &arena);
+    printf(
+        "bvh build (4M objects): %.1f ms, %u nodes, depth %u, sah cost %.2f\n",
+        timer_seconds(timer_now() - start) * 1000.0, bvh.node_count, bvh.depth, bvh.built_cost
+    );
+
+    struct Mat4 view = mat4_look_at((struct Vec3){0.0f, 0.0f, 0.0f}, (struct Vec3){0.0f, 0.0f, -1.0f}, (struct Vec3){0.0f, 1.0f, 0.0f});
+    struct Mat4 projection = mat4_perspective(1.0471976f, 16.0f / 9.0f, 0.1f, 100.0f);
+    struct Mat4 view_projection = mat4_mul(&projection, &view);
+    float planes[6][4];
+    frustum_planes_from_matrix(&view_projection, planes);
+
+    uint32_t brute_force_count = 0;
+    start = timer_now();
+    for (uint32_t iteration = 0; iteration < ITERATION_COUNT; iteration++) {
+        brute_force_count = frustum_cull_aabbs(planes, &boxes, brute_force_indices);
+    }
+    double brute_force_seconds = timer_seconds(timer_now() - start) / ITERATION_COUNT;
+
+    uint32_t candidate_count = 0;
+    uint32_t visible_count = 0;
+    start = timer_now();
+    for (uint32_t iteration = 0; iteration < ITERATION_COUNT; iteration++) {
+        candidate_count = bvh_cull_frustum(&bvh, planes, candidates);
+        visible_count = 0;
+        for (uint32_t i = 0; i < candidate_count; i++) {
+            if (aabb_in_frustum(planes, &boxes, candidates[i])) {
+                visible_count += 1;
+            }
+        }
+    }
+    double bvh_seconds = timer_seconds(timer_now() - start) / ITERATION_COUNT;
+    printf("frustum culling (4M objects, all of them): %.3f ms, %u visible\n", brute_force_seconds * 1000.0, brute_force_count);
+    printf("frustum culling (4M objects, bvh): %.3f ms, %u candidates, %u visible\n", bvh_seconds * 1000.0, candidate_count, visible_count);
+
+    // NOTE: checked against the scalar test the bvh candidates go through, so it's the tree that's checked
+    ASSERT(visible_count == frustum_cull_aabbs_scalar(planes, &boxes, brute_force_indices));
+
+    // NOTE: moves 1% of the objects a little, spread over the whole tree
+    for (uint32_t i = 0; i < MOVED_COUNT; i++) {
+        uint32_t object = i * (COUNT / MOVED_COUNT);
+        moved_objects[i] = object;
+        for (uint32_t j = 0; j < 3; j++) {
+            boxes.min[j][object] += 2.0f;
+            boxes.max[j][object] += 2.0f;
+        }
+    }
+    start = timer_now();
+    bool rebuild = bvh_refit(&bvh, &boxes, moved_objects, MOVED_COUNT);
+    printf(
+        "bvh refit (1%% moved): %.3f ms, sah cost %.2f, %s\n",
+        timer_seconds(timer_now() - start) * 1000.0, bvh_sah_cost(&bvh), rebuild ? "rebuild" : "no rebuild"
+    );
+    // NOTE: the cost kept up by refitting against summing it over the whole tree again
+    double area_cost = 0.0;
+    for (uint32_t i = 0; i < bvh.node_count; i++) {
+        area_cost += bvh_node_cost(&bvh.nodes[i]);
+    }
+    ASSERT(fabs(area_cost - bvh.area_cost) <= 1e-6 * area_cost);
+
+    uint32_t hit_count = 0;
+    start = timer_now();
+    for (uint32_t i = 0; i < RAY_COUNT; i++) {
+        float x = ((float)(i % 100) / 50.0f - 1.0f) * 0.5f;
+        float y = ((float)(i / 100) / 50.0f - 1.0f) * 0.5f;
+        float distance = 0.0f;
+        if (bvh_raycast(&bvh, &boxes, (struct Vec3){0.0f, 0.0f, 0.0f}, vec3_normalize((struct Vec3){x, y, -1.0f}), &distance) != UINT32_MAX) {
+            hit_count += 1;
+        }
+    }
+    double ray_seconds = timer_seconds(timer_now() - start);
+    printf("bvh raycast (4M objects): %.3f us per ray, %u of %u hit\n", ray_seconds * 1000000.0 / RAY_COUNT, hit_count, RAY_COUNT);
+
+    os_free(arena.base);
+}
+
+// NOTE: runs the scene update (transforms, culling, sort keys and uniform packing) for a million objects
+// with 1, 2, 4, ... workers up to one per logical processor
+static void
+benchmark_job_system(void) {
+    enum { GRID_SIZE = 1000, FRAME_COUNT = 20, BATCH_SIZE = 1024 };
+    uint32_t object_count = GRID_SIZE * GRID_SIZE;
+    uint32_t uniform_stride = sizeof(struct UniformData);
+
+    size_t memory_size =
+        scene_memory_size(object_count) +
+        (size_t)object_count * (uniform_stride + sizeof(uint32_t) + sizeof(struct DrawItem)) +
+        (object_count / BATCH_SIZE + 1) * sizeof(uint32_t) + 4096;
+    struct LinearArena arena = {.base = os_alloc(memory_size), .capacity = memory_size};
+
+    float bounds_min[3] = {-0.5f, -0.5f, 0.0f};
+    float bounds_max[3] = {0.5f, 0.5f, 0.0f};
+    struct Scene scene;
+    scene_init(&scene, &arena, GRID_SIZE, /* layer_count */ 1, /* spacing */ 1.0f, bounds_min, bounds_max);
+
+    // NOTE: sees about a fifth of the grid
+    struct Vec3 camera_position = {0.0f, 0.0f, 300.0f};
+    struct Mat4 view = mat4_look_at(camera_position, (struct Vec3){0.0f, 0.0f, 0.0f}, (struct Vec3){0.0f, 1.0f, 0.0f});
+    struct Mat4 projection = mat4_perspective(1.0471976f, 16.0f / 9.0f, 0.1f, 1000.0f);
+
+    struct SceneUpdate update = {0};
+    update.scene = &scene;
+    update.view_projection = mat4_mul(&projection, &view);
+    frustum_planes_from_matrix(&update.view_projection, update.frustum_planes);
+    update.camera_position = camera_position;
+    update.batch_size = BATCH_SIZE;
+    update.uniform_stride = uniform_stride;
+    update.uniform_data = linear_arena_alloc(&arena, (size_t)object_count * uniform_stride, 16);
+    update.candidates = LINEAR_ALLOC(&arena, uint32_t, object_count);
+    update.draw_items = LINEAR_ALLOC(&arena, struct DrawItem, object_count);
+    update.batch_draw_counts = LINEAR_ALLOC(&arena, uint32_t, object_count / BATCH_SIZE + 1);
+
+    uint32_t max_worker_count = benchmark_max_worker_count();
+
+    struct JobSystem* job_system = os_alloc(sizeof(struct JobSystem));
+    struct FrameArena* frame_arena = os_alloc(sizeof(struct FrameArena));
+    double single_worker_seconds = 0.0;
+    for (uint32_t worker_count = 1;; worker_count = benchmark_next_worker_count(worker_count, max_worker_count)) {
+        job_system_init(job_system, worker_count);
+        frame_arena_init(frame_arena, worker_count, /* thread_capacity */ 1024 * 1024);
+        update.frame_arena = frame_arena;
+
+        int64_t start = timer_now();
+        uint32_t draw_count = 0;
+        for (uint32_t frame = 0; frame < FRAME_COUNT; frame++) {
+            frame_arena_begin(frame_arena);
+            update.time = (float)frame * 0.016f;
+            update.orbit = mat4_transform((struct Vec3){0.0f, 0.0f, 0.0f}, (struct Vec3){0.0f, 0.0f, 1.0f}, update.time * 0.1f, 1.0f);
+            scene_update(&update, job_system);
+
+            draw_count = 0;
+            for (uint32_t i = 0; i < (update.candidate_count + BATCH_SIZE - 1) / BATCH_SIZE; i++) {
+                draw_count += update.batch_draw_counts[i];
+            }
+        }
+        double seconds = timer_seconds(timer_now() - start) / FRAME_COUNT;
+        single_worker_seconds = worker_count == 1 ? seconds : single_worker_seconds;
+        printf(
+            "job system (%u workers): %.3f ms/frame, %.2fx, %u of %u objects visible\n",
+            worker_count,
+            seconds * 1000.0,
+            single_worker_seconds / seconds,
+            draw_count,
+            object_count
+        );
+
+        frame_arena_deinit(frame_arena);
+        job_system_deinit(job_system);
+        if (worker_count == max_worker_count) {
+            break;
+        }
+    }
+
+    os_free(frame_arena);
+    os_free(job_system);
+    os_free(arena.base);
+}
+
+// NOTE: a 4k noise texture drawn minified into a 512x512 target with every sampler preset (the same
+// texture, the first two only read its top level), timed on the gpu. the uvs are stretched 4 times more vertically so the footprint
+// of a pixel is 8x32 texels, which is where anisotropic filtering differs from trilinear. also times the
+// mip chain made on the cpu (checking both paths give the same bytes) and with `glGenerateTextureMipmap`
+static void
+benchmark_texture_sampling(void) {
+    enum { SIZE = 4096, TARGET_SIZE = 512, DRAW_COUNT = 20 };
+
+    uint32_t level_count = mip_level_count(SIZE, SIZE);
+    size_t chain_size = mip_chain_size(SIZE, SIZE, level_count);
+    unsigned char* chain = os_alloc(chain_size);
+    unsigned char* expected_chain = os_alloc(chain_size);
+    for (uint32_t i = 0; i < SIZE * SIZE; i++) {
+        uint32_t hash = (i + 1) * 2654435761u;
+        hash ^= hash >> 15;
+        hash *= 2246822519u;
+        hash ^= hash >> 13;
+        memcpy(chain + (size_t)i * 4, &hash, 4);
+        chain[(size_t)i * 4 + 3] = 255;
+    }
+    memcpy(expected_chain, chain, (size_t)SIZE * SIZE * 4);
+
+    int64_t start = timer_now();
+    unsigned char* level = expected_chain;
+    for (uint32_t i = 1; i < level_count; i++) {
+        uint32_t level_size = mip_level_extent(SIZE, i - 1);
+        mip_downsample_scalar(level, level_size, level_size, level + (size_t)level_size * level_size * 4);
+        level += (size_t)level_size * level_size * 4;
+    }
+    double scalar_seconds = timer_seconds(timer_now() - start);
+    printf("mip chain (4096x4096, cpu one texel at a time): %.2f ms, %.0f megatexels/s\n", scalar_seconds * 1000.0, (double)SIZE * SIZE / scalar_seconds / 1e6);
+    if (cpu_features.avx2) {
+        start = timer_now();
+        mip_chain_generate(chain, SIZE, SIZE, level_count);
+        double seconds = timer_seconds(timer_now() - start);
+        printf("mip chain (4096x4096, cpu avx2): %.2f ms, %.0f megatexels/s, %.2fx\n", seconds * 1000.0, (double)SIZE * SIZE / seconds / 1e6, scalar_seconds / seconds);
+        ASSERT(memcmp(chain, expected_chain, chain_size) == 0);
+    } else {
+        printf("mip chain (4096x4096, cpu avx2): skipped, no avx2\n");
+    }
+
+    // NOTE: the cpu made chain and the gpu made one
+    GLuint textures[2] = {0};
+    glCreateTextures(GL_TEXTURE_2D, LEN(textures), textures);
+    glTextureStorage2D(textures[0], (GLsizei)level_count, GL_RGBA8, SIZE, SIZE);
+    mip_chain_upload(textures[0], /* layer */ -1, expected_chain, SIZE, SIZE, level_count);
+    glTextureStorage2D(textures[1], (GLsizei)level_count, GL_RGBA8, SIZE, SIZE);
+    mip_chain_upload(textures[1], /* layer */ -1, expected_chain, SIZE, SIZE, /* level_count */ 1);
+    glFinish();
+    start = timer_now();
+    glGenerateTextureMipmap(textures[1]);
+    glFinish();
+    printf("mip chain (4096x4096, glGenerateTextureMipmap): %.2f ms\n", timer_seconds(timer_now() - start) * 1000.0);
+    os_free(chain);
+    os_free(expected_chain);
+
+    const char* vertex_shader_src =
+        "#version 450\n"
+        SHADER_SRC(
+            out vec2 uv;
+            void main() {
+                uv = vec2(gl_VertexID & 1, gl_VertexID >> 1) * 2.0;
+                gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+            }
+        );
+    const char* fragment_shader_src =
+        "#version 450\n"
+        SHADER_SRC(
+            in vec2 uv;
+            out vec4 frag_color;
+            layout(binding = 0) uniform sampler2D noise;
+            void main() {
+                frag_color = texture(noise, uv * vec2(1.0, 4.0));
+            }
+        );
+    GLuint shaders[2] = {
+        shader_create(GL_VERTEX_SHADER, &vertex_shader_src, /* source_count */ 1),
+        shader_create(GL_FRAGMENT_SHADER, &fragment_shader_src, /* source_count */ 1),
+    };
+    GLuint program = glCreateProgram();
+    glAttachShader(program, shaders[0]);
+    glAttachShader(program, shaders[1]);
+    glLinkProgram(program);
+    glDeleteShader(shaders[0]);
+    glDeleteShader(shaders[1]);
+
+    GLuint target = 0;
+    glCreateTextures(GL_TEXTURE_2D, 1, &target);
+    glTextureStorage2D(target, /* levels */ 1, GL_RGBA8, TARGET_SIZE, TARGET_SIZE);
+    GLuint framebuffer = 0;
+    glCreateFramebuffers(1, &framebuffer);
+    glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, target, /* level */ 0);
+    GLuint vertex_array = 0;
+    glCreateVertexArrays(1, &vertex_array);
+    GLuint query = 0;
+    glCreateQueries(GL_TIME_ELAPSED, 1, &query);
+    struct SamplerCache sampler_cache;
+    sampler_cache_init(&sampler_cache);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(/* x */ 0, /* y */ 0, TARGET_SIZE, TARGET_SIZE);
+    glUseProgram(program);
+    glBindVertexArray(vertex_array);
+    glBindTextureUnit(/* unit */ 0, textures[0]);
+    for (uint32_t preset = 0; preset < SAMPLER_PRESET_COUNT; preset++) {
+        glBindSampler(/* unit */ 0, sampler_cache_preset(&sampler_cache, (enum SamplerPreset)preset, GL_REPEAT));
+        glDrawArrays(GL_TRIANGLES, /* first */ 0, /* count */ 3);
+
+        glBeginQuery(GL_TIME_ELAPSED, query);
+        for (uint32_t i = 0; i < DRAW_COUNT; i++) {
+            glDrawArrays(GL_TRIANGLES, /* first */ 0, /* count */ 3);
+        }
+        glEndQuery(GL_TIME_ELAPSED);
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+        double seconds = (double)nanoseconds * 1e-9 / DRAW_COUNT;
+        printf(
+            "texture sampling (4096x4096 minified to 512x512, %s): %.3f ms per pass, %.0f megapixels/s\n",
+            sampler_preset_names[preset],
+            seconds * 1000.0,
+            (double)TARGET_SIZE * TARGET_SIZE / seconds / 1e6
+        );
+    }
+    glBindTextureUnit(/* unit */ 0, 0);
+    glBindSampler(/* unit */ 0, 0);
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    sampler_cache_deinit(&sampler_cache);
+    glDeleteQueries(1, &query);
+    glDeleteVertexArrays(1, &vertex_array);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteTextures(1, &target);
+    glDeleteProgram(program);
+    glDeleteTextures(LEN(textures), textures);
+}
+
+// NOTE: encodes a 512x512 image (smooth gradients, noise, hard edges and an alpha ramp) to every format at
+// every quality, with one worker and with one per logical processor. the avx2 index search is checked
+// against the scalar one by turning it off for a run
+static void
+benchmark_texture_encoding(void) {
+    enum { SIZE = 512 };
+    static const enum TextureFormat formats[] = {TEXTURE_FORMAT_BC1, TEXTURE_FORMAT_BC3, TEXTURE_FORMAT_BC7};
+
+    unsigned char* rgba = os_alloc((size_t)SIZE * SIZE * 4);
+    unsigned char* blocks = os_alloc(texture_level_size(TEXTURE_FORMAT_BC7, SIZE, SIZE));
+    unsigned char* expected_blocks = os_alloc(texture_level_size(TEXTURE_FORMAT_BC7, SIZE, SIZE));
+    for (uint32_t y = 0; y < SIZE; y++) {
+        for (uint32_t x = 0; x < SIZE; x++) {
+            uint32_t hash = (y * SIZE + x + 1) * 2654435761u;
+            hash ^= hash >> 15;
+            unsigned char* texel = rgba + ((size_t)y * SIZE + x) * 4;
+            if (y < SIZE / 2) {
+                texel[0] = (unsigned char)(x / 2);
+                texel[1] = (unsigned char)(y);
+                texel[2] = (unsigned char)(255 - x / 2);
+            } else if (x < SIZE / 2) {
+                texel[0] = (unsigned char)(128 + (hash & 31));
+                texel[1] = (unsigned char)(96 + (hash >> 8 & 31));
+                texel[2] = (unsigned char)(64 + (hash >> 16 & 63));
+            } else {
+                bool light = ((x / 8) ^ (y / 8)) & 1;
+                texel[0] = light ? 230 : 40;
+                texel[1] = light ? 200 : 30;
+                texel[2] = light ? 40 : 120;
+            }
+            texel[3] = (unsigned char)(x % 256);
+        }
+    }
+
+    uint32_t max_worker_count = benchmark_max_worker_count();
+    struct JobSystem* job_system = os_alloc(sizeof(struct JobSystem));
+    for (uint32_t i = 0; i < LEN(formats); i++) {
+        enum TextureFormat format = formats[i];
+        size_t size = texture_level_size(format, SIZE, SIZE);
+        uint32_t channel_count = format == TEXTURE_FORMAT_BC1 ? 3 : 4;
+        for (uint32_t quality = 0; quality < TEXTURE_ENCODE_QUALITY_COUNT; quality++) {
+            bool avx2 = cpu_features.avx2;
+            cpu_features.avx2 = false;
+            memset(expected_blocks, 0, size);
+            texture_encode(format, (enum TextureEncodeQuality)quality, rgba, SIZE, SIZE, expected_blocks, /* job_system */ NULL);
+            cpu_features.avx2 = avx2;
+
+            uint64_t error = 0;
+            for (uint32_t worker_count = 1;; worker_count = max_worker_count) {
+                job_system_init(job_system, worker_count);
+                memset(blocks, 0, size);
+                int64_t start = timer_now();
+                error = texture_encode(format, (enum TextureEncodeQuality)quality, rgba, SIZE, SIZE, blocks, job_system);
+                double seconds = timer_seconds(timer_now() - start);
+                job_system_deinit(job_system);
+                ASSERT(memcmp(blocks, expected_blocks, size) == 0);
+                printf(
+                    "texture encoding (%s %s, %u workers): %.2f ms, %.2f megapixels/s, %.2f per worker\n",
+                    texture_format_infos[format].name,
+                    texture_encode_quality_names[quality],
+                    worker_count,
+                    seconds * 1000.0,
+                    (double)SIZE * SIZE / seconds / 1e6,
+                    (double)SIZE * SIZE / seconds / 1e6 / worker_count
+                );
+                if (worker_count == max_worker_count) {
+                    break;
+                }
+            }
+            printf(
+                "texture encoding (%s %s): %.2f dB psnr\n",
+                texture_format_infos[format].name,
+                texture_encode_quality_names[quality],
+                texture_encode_psnr(error, (uint64_t)SIZE * SIZE * channel_count)
+            );
+        }
+    }
+
+    os_free(job_system);
+    os_free(expected_blocks);
+    os_free(blocks);
+    os_free(rgba);
+}
+
+struct ImageDecodingBenchmark {
+    struct ImageDecode* images;
+    uint64_t* hashes;
+    unsigned char* rgba;
+    size_t rgba_size; // NOTE: per worker, of the biggest image
+    unsigned char* scratch;
+    size_t scratch_size; // NOTE: per worker
+};
+
+// NOTE: decodes every image of the batch into the buffer of the worker and hashes it, so thousands of
+// images don't need to be in memory at once
+static void
+benchmark_image_decoding_job(void* data, uint32_t first, uint32_t count, uint32_t worker_index) {
+    struct ImageDecodingBenchmark* benchmark = data;
+    unsigned char* rgba = benchmark->rgba + (size_t)worker_index * benchmark->rgba_size;
+    unsigned char* scratch = benchmark->scratch + (size_t)worker_index * benchmark->scratch_size;
+    for (uint32_t i = first; i < first + count; i++) {
+        const struct ImageDecode* image = &benchmark->images[i];
+        size_t size = (size_t)image->info.width * image->info.height * 4;
+        bool decoded = image_decode(&image->info, image->data, image->size, IMAGE_DECODE_PREMULTIPLY, rgba, scratch);
+        uint64_t hash = decoded ? 14695981039346656037ull : 0;
+        for (size_t j = 0; decoded && j + 8 <= size; j += 8) {
+            uint64_t value;
+            memcpy(&value, rgba + j, 8);
+            hash = (hash ^ value) * 1099511628211ull;
+        }
+        benchmark->hashes[i] = hash;
+    }
+}
+
+// NOTE: decodes the files of an `images` directory in the working directory (thousands of them to be
+// meaningful) with 1, 2, 4, ... workers up to one per logical processor, checked against decoding them
+// one at a time without avx2
+static void
+benchmark_image_decoding(void) {
+    // NOTE: a table of 3 one bit codes (as in a malformed DHT segment) would index past `fast`, it has to be
+    // refused before anything is written. the luminance dc table of the standard builds
+    struct JpegHuffman* huffman = os_alloc(sizeof(struct JpegHuffman));
+    unsigned char values[256] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+    unsigned char overfull_counts[16] = {3};
+    unsigned char dc_counts[16] = {0, 1, 5, 1, 1, 1, 1, 1, 1};
+    unsigned char long_counts[16] = {[15] = 255};
+    ASSERT(!jpeg_huffman_build(huffman, overfull_counts, values, /* value_count */ 3));
+    ASSERT(!jpeg_huffman_build(huffman, dc_counts, values, /* value_count */ 11));
+    ASSERT(jpeg_huffman_build(huffman, dc_counts, values, /* value_count */ 12));
+    ASSERT(jpeg_huffman_build(huffman, long_counts, values, /* value_count */ 255));
+    os_free(huffman);
+
+    struct ImageDirectory directory;
+    image_directory_open(&directory, "images", /* max_count */ 16384);
+    if (directory.count == 0) {
+        printf("image decoding: no images directory, skipped\n");
+        image_directory_close(&directory);
+        return;
+    }
+    // NOTE: the files are paged in before timing anything
+    uint64_t touched = 0;
+    for (uint32_t i = 0; i < directory.count; i++) {
+        const unsigned char* bytes = directory.images[i].data;
+        for (size_t j = 0; j < directory.images[i].size; j += 4096) {
+            touched += bytes[j];
+        }
+    }
+    (void)touched;
+
+    uint32_t max_worker_count = benchmark_max_worker_count();
+    struct ImageDecodingBenchmark benchmark = {.images = directory.images, .scratch_size = 64}; // NOTE: qoi needs none
+    uint64_t pixel_count = 0;
+    for (uint32_t i = 0; i < directory.count; i++) {
+        const struct ImageInfo* info = &directory.images[i].info;
+        size_t rgba_size = (size_t)info->width * info->height * 4;
+        benchmark.rgba_size = rgba_size > benchmark.rgba_size ? rgba_size : benchmark.rgba_size;
+        benchmark.scratch_size = info->scratch_size > benchmark.scratch_size ? info->scratch_size : benchmark.scratch_size;
+        pixel_count += (uint64_t)info->width * info->height;
+    }
+    benchmark.rgba_size = ALIGN_UP(benchmark.rgba_size, 64);
+    benchmark.scratch_size = ALIGN_UP(benchmark.scratch_size, 64);
+    benchmark.rgba = os_alloc(benchmark.rgba_size * max_worker_count);
+    benchmark.scratch = os_alloc(benchmark.scratch_size * max_worker_count);
+    benchmark.hashes = os_alloc(directory.count * sizeof(uint64_t));
+    uint64_t* expected_hashes = os_alloc(directory.count * sizeof(uint64_t));
+
+    bool avx2 = cpu_features.avx2;
+    cpu_features.avx2 = false;
+    benchmark_image_decoding_job(&benchmark, /* first */ 0, directory.count, /* worker_index */ 0);
+    cpu_features.avx2 = avx2;
+    memcpy(expected_hashes, benchmark.hashes, directory.count * sizeof(uint64_t));
+    uint32_t failed_count = 0;
+    for (uint32_t i = 0; i < directory.count; i++) {
+        failed_count += expected_hashes[i] == 0;
+    }
+    printf(
+        "image decoding: %u images (%u png, %u jpeg, %u qoi, %u malformed), %.1f MiB encoded, %.1f megapixels\n",
+        directory.count,
+        directory.format_counts[IMAGE_FORMAT_PNG],
+        directory.format_counts[IMAGE_FORMAT_JPEG],
+        directory.format_counts[IMAGE_FORMAT_QOI],
+        failed_count,
+        (double)directory.encoded_size / (1024.0 * 1024.0),
+        (double)pixel_count / 1e6
+    );
+
+    struct JobSystem* job_system = os_alloc(sizeof(struct JobSystem));
+    for (uint32_t worker_count = 1;; worker_count = benchmark_next_worker_count(worker_count, max_worker_count)) {
+        job_system_init(job_system, worker_count);
+        memset(benchmark.hashes, 0, directory.count * sizeof(uint64_t));
+        int64_t start = timer_now();
+        volatile LONG counter = 0;
+        job_system_parallel_for(job_system, /* worker_index */ 0, &benchmark_image_decoding_job, &benchmark, directory.count, /* batch_size */ 1, &counter);
+        job_system_wait(job_system, /* worker_index */ 0, &counter);
+        double seconds = timer_seconds(timer_now() - start);
+        job_system_deinit(job_system);
+        ASSERT(memcmp(benchmark.hashes, expected_hashes, directory.count * sizeof(uint64_t)) == 0);
+        printf(
+            "image decoding (%u workers): %.2f ms, %.1f images/s, %.2f megapixels/s, %.2f per worker\n",
+            worker_count,
+            seconds * 1000.0,
+            (double)directory.count / seconds,
+            (double)pixel_count / seconds / 1e6,
+            (double)pixel_count / seconds / 1e6 / worker_count
+        );
+        if (worker_count == max_worker_count) {
+            break;
+        }
+    }
+
+    os_free(job_system);
+    os_free(expected_hashes);
+    os_free(benchmark.hashes);
+    os_free(benchmark.scratch);
+    os_free(benchmark.rgba);
+    image_directory_close(&directory);
+}
+
+// NOTE: copies a 3840x2160 4:2:0 frame into an upload slot (the cpu side of a video texture update) with
+// 1, 2, 4, ... workers up to one per logical processor, as how many 60 fps streams that would keep up with
+static void
+benchmark_video_upload(void) {
+    enum { WIDTH = 3840, HEIGHT = 2160, FRAME_COUNT = 20 };
+
+    struct VideoTexture* video = os_alloc(sizeof(struct VideoTexture));
+    video->source.width = WIDTH;
+    video->source.height = HEIGHT;
+    video->source.chroma_width = WIDTH / 2;
+    video->source.chroma_height = HEIGHT / 2;
+    video->luma_pitch = ALIGN_UP(WIDTH, 4);
+    video->chroma_pitch = ALIGN_UP(WIDTH, 4);
+    size_t frame_size = y4m_frame_size(&video->source);
+    unsigned char* planes = os_alloc(frame_size);
+    for (size_t i = 0; i < frame_size; i++) {
+        planes[i] = (unsigned char)(i * 2654435761u >> 24);
+    }
+    video->copy_source = planes;
+    video->copy_destination = os_alloc(frame_size);
+
+    uint32_t max_worker_count = benchmark_max_worker_count();
+    struct JobSystem* job_system = os_alloc(sizeof(struct JobSystem));
+    for (uint32_t worker_count = 1;; worker_count = benchmark_next_worker_count(worker_count, max_worker_count)) {
+        job_system_init(job_system, worker_count);
+        int64_t start = timer_now();
+        for (uint32_t frame = 0; frame < FRAME_COUNT; frame++) {
+            volatile LONG counter = 0;
+            job_system_parallel_for(job_system, /* worker_index */ 0, &video_texture_copy_job, video, HEIGHT + HEIGHT / 2, VIDEO_TEXTURE_COPY_BATCH, &counter);
+            job_system_wait(job_system, /* worker_index */ 0, &counter);
+        }
+        double seconds = timer_seconds(timer_now() - start) / FRAME_COUNT;
+        job_system_deinit(job_system);
+        printf(
+            "video upload (3840x2160 4:2:0, %u workers): %.2f ms per frame, %.2f GiB/s, %.1f streams at 60 fps\n",
+            worker_count,
+            seconds * 1000.0,
+            (double)frame_size / seconds / (1024.0 * 1024.0 * 1024.0),
+            1.0 / seconds / 60.0
+        );
+        if (worker_count == max_worker_count) {
+            break;
+        }
+    }
+    const unsigned char* u = planes + (size_t)WIDTH * HEIGHT;
+    const unsigned char* uv = video->copy_destination + (size_t)WIDTH * HEIGHT;
+    for (size_t i = 0; i < (size_t)WIDTH / 2 * HEIGHT / 2; i++) {
+        ASSERT(uv[i * 2] == u[i] && uv[i * 2 + 1] == u[i + (size_t)WIDTH / 2 * HEIGHT / 2]);
+    }
+    ASSERT(memcmp(video->copy_destination, planes, (size_t)WIDTH * HEIGHT) == 0);
+
+    os_free(job_system);
+    os_free(video->copy_destination);
+    os_free(planes);
+    os_free(video);
+}
+
+// NOTE: culls four boxes, one in each quadrant of a 64x64 depth buffer whose top left quadrant is an
+// occluder in front of them. only the top left box may be occluded, a lookup mirrored in either direction
+// occludes another one. then three of the boxes leave the frustum for a frame and come back, and only the
+// one that stayed may be drawn in the first phase
+static void
+benchmark_occlusion_culling(void) {
+    enum { SIZE = 64 };
+
+    struct Mesh mesh = {
+        .lod_count = 1,
+        .lods = {{.first_submesh = 0, .submesh_count = 1, .index_count = 36}},
+        .submesh_count = 1,
+        .submeshes = {{.index_count = 36}},
+        .bounds_min = {-0.2f, -0.2f, 0.5f},
+        .bounds_max = {0.2f, 0.2f, 0.5f},
+    };
+    struct OcclusionCulling culling;
+    occlusion_culling_init(&culling, &mesh, /* object_count */ 4, /* uniform_stride */ sizeof(struct Mat4));
+
+    // NOTE: top left, top right, bottom left, bottom right in ndc (y up)
+    struct Mat4 transforms[4];
+    for (uint32_t i = 0; i < 4; i++) {
+        struct Vec3 position = {(i & 1) ? 0.5f : -0.5f, (i & 2) ? -0.5f : 0.5f, 0.0f};
+        transforms[i] = mat4_transform(position, /* axis */ (struct Vec3){0.0f, 0.0f, 1.0f}, /* angle */ 0.0f, /* scale */ 1.0f);
+    }
+    GLuint transform_buffer;
+    glCreateBuffers(1, &transform_buffer);
+    glNamedBufferStorage(transform_buffer, sizeof(transforms), transforms, /* flags */ 0);
+
+    // NOTE: the first row is the top of the image
+    float* depths = os_alloc(SIZE * SIZE * sizeof(float));
+    for (uint32_t y = 0; y < SIZE; y++) {
+        for (uint32_t x = 0; x < SIZE; x++) {
+            depths[y * SIZE + x] = x < SIZE / 2 && y < SIZE / 2 ? 0.1f : 1.0f;
+        }
+    }
+    GLuint depth;
+    glCreateTextures(GL_TEXTURE_2D, 1, &depth);
+    glTextureStorage2D(depth, /* levels */ 1, GL_R32F, SIZE, SIZE);
+    glTextureSubImage2D(depth, /* level */ 0, /* x */ 0, /* y */ 0, SIZE, SIZE, GL_RED, GL_FLOAT, depths);
+
+    struct LinearArena arena = {.base = os_alloc(4096), .capacity = 4096};
+    struct DrawItem draw_items[4];
+    for (uint32_t i = 0; i < 4; i++) {
+        draw_items[i] = (struct DrawItem){.sort_key = i, .object_index = i};
+    }
+    uint32_t frame_draw_counts[] = {4, 1, 4};
+    uint32_t first_phase_instances[4];
+    uint32_t visibility[4];
+    for (uint32_t frame = 0; frame < LEN(frame_draw_counts); frame++) {
+        // NOTE: the one box that stays is the top right one
+        struct DrawItem* frame_draw_items = frame_draw_counts[frame] == 1 ? &draw_items[1] : draw_items;
+        occlusion_culling_begin_frame(&culling, frame_draw_items, frame_draw_counts[frame], SIZE, SIZE, &arena);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+        occlusion_culling_cull(&culling, /* second_phase */ false, transform_buffer, /* offset */ 0, sizeof(transforms));
+        occlusion_culling_build_pyramid(&culling, depth);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_TEXTURE_FETCH_BARRIER_BIT);
+        occlusion_culling_cull(&culling, /* second_phase */ true, transform_buffer, /* offset */ 0, sizeof(transforms));
+        glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+
+        struct DrawElementsIndirectCommand commands[4];
+        glGetNamedBufferSubData(culling.command_buffers[0], /* offset */ 0, frame_draw_counts[frame] * sizeof(commands[0]), commands);
+        for (uint32_t i = 0; i < frame_draw_counts[frame]; i++) {
+            first_phase_instances[frame_draw_items[i].object_index] = commands[i].instance_count;
+        }
+        glGetNamedBufferSubData(culling.visibility_buffer, /* offset */ 0, sizeof(visibility), visibility);
+        if (frame == 0) {
+            ASSERT(visibility[0] == 0);
+            ASSERT(visibility[1] == culling.frame && visibility[2] == culling.frame && visibility[3] == culling.frame);
+        }
+    }
+    ASSERT(first_phase_instances[0] == 0 && first_phase_instances[1] == 1);
+    ASSERT(first_phase_instances[2] == 0 && first_phase_instances[3] == 0);
+    ASSERT(visibility[0] == 0);
+    ASSERT(visibility[1] == culling.frame && visibility[2] == culling.frame && visibility[3] == culling.frame);
+    printf("occlusion culling: off center occluder and boxes coming back into the frustum checked\n");
+
+    os_free(arena.base);
+    os_free(depths);
+    glDeleteTextures(1, &depth);
+    glDeleteBuffers(1, &transform_buffer);
+    occlusion_culling_deinit(&culling);
+}
+
+// NOTE: records 100k draws into command buffers with 1, 2, 4, ... workers up to one per logical processor
+static void
+benchmark_command_buffers(void) {
+    enum { DRAW_COUNT = 100 * 1000, FRAME_COUNT = 50 };
+
+    size_t memory_size = DRAW_COUNT * sizeof(struct DrawItem) + 4096;
+    struct LinearArena arena = {.base = os_alloc(memory_size), .capacity = memory_size};
+    struct DrawItem* draw_items = LINEAR_ALLOC(&arena, struct DrawItem, DRAW_COUNT);
+    for (uint32_t i = 0; i < DRAW_COUNT; i++) {
+        draw_items[i].sort_key = i;
+        draw_items[i].object_index = i;
+        draw_items[i].reserved = 0;
+    }
 
-///////////////////////////////////////////////////////////////////////////////////////////////////
-// used wgl procedures table
-///////////////////////////////////////////////////////////////////////////////////////////////////
-#define WGL_PROCS \
-X(PFNWGLGETEXTENSIONSSTRINGARBPROC, wglGetExtensionsStringARB)\
-X(PFNWGLCHOOSEPIXELFORMATARBPROC, wglChoosePixelFormatARB)\
-X(PFNWGLCREATECONTEXTATTRIBSARBPROC, wglCreateContextAttribsARB)\
-X(PFNWGLSWAPINTERVALEXTPROC, wglSwapIntervalEXT)\
-///////////////////////////////////////////////////////////////////////////////////////////////////
+    // NOTE: a single submesh single lod mesh, nothing is drawn
+    struct Mesh mesh;
+    memset(&mesh, 0, sizeof(mesh));
+    mesh.index_type = GL_UNSIGNED_SHORT;
+    mesh.lod_count = 1;
+    mesh.lods[0].submesh_count = 1;
+    mesh.lods[0].index_count = 3;
+    mesh.submesh_count = 1;
+    mesh.submeshes[0].index_count = 3;
 
-// NOTE: declare all used opengl and wgl procedures
-#define X(type, name) static type name;
-GL_PROCS
-WGL_PROCS
-#undef X
+    uint32_t max_worker_count = benchmark_max_worker_count();
 
-#define LOAD_PROC(type, name) do { name = (type)(void*)wglGetProcAddress(#name); ASSERT(name); } while (0)
+    struct JobSystem* job_system = os_alloc(sizeof(struct JobSystem));
+    struct FrameArena* frame_arena = os_alloc(sizeof(struct FrameArena));
+    double single_worker_seconds = 0.0;
+    for (uint32_t worker_count = 1;; worker_count = benchmark_next_worker_count(worker_count, max_worker_count)) {
+        job_system_init(job_system, worker_count);
+        frame_arena_init(frame_arena, worker_count, /* thread_capacity */ 8 * 1024 * 1024);
 
-static const wchar_t* window_class_name = L"DefaultWindowClass";
-static bool should_quit = false;
+        struct DrawListRecording recording = {0};
+        recording.draw_items = draw_items;
+        recording.draw_count = DRAW_COUNT;
+        recording.batch_size = DRAW_LIST_BATCH_SIZE;
+        recording.frame_arena = frame_arena;
+        recording.mesh = &mesh;
+        recording.uniform_stride = 256;
+        recording.uniform_size = 64;
 
-static LRESULT WINAPI
-process_window_message(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
-    if (uMsg == WM_CLOSE) {
-        should_quit = true;
+        int64_t start = timer_now();
+        uint64_t size = 0;
+        for (uint32_t frame = 0; frame < FRAME_COUNT; frame++) {
+            frame_arena_begin(frame_arena);
+            draw_list_record(&recording, job_system, frame_arena_thread(frame_arena, 0));
+            size = 0;
+            for (uint32_t i = 0; i < draw_list_batch_count(&recording); i++) {
+                size += recording.command_buffers[i].size;
+            }
+        }
+        double seconds = timer_seconds(timer_now() - start) / FRAME_COUNT;
+        single_worker_seconds = worker_count == 1 ? seconds : single_worker_seconds;
+        printf(
+            "command buffers (%u workers): %.3f ms to record %u draws, %.2fx, %llu KB\n",
+            worker_count,
+            seconds * 1000.0,
+            DRAW_COUNT,
+            single_worker_seconds / seconds,
+            (unsigned long long)(size / 1024)
+        );
+
+        frame_arena_deinit(frame_arena);
+        job_system_deinit(job_system);
+        if (worker_count == max_worker_count) {
+            break;
+        }
     }
-    return DefWindowProcW(hwnd, uMsg, wParam, lParam);
+
+    os_free(frame_arena);
+    os_free(job_system);
+    os_free(arena.base);
 }
 
-static void APIENTRY
-gl_debug_message_callback(
-    GLenum source, GLenum type, GLuint id, GLenum severity,
-    GLsizei length, const GLchar* message, const void* user
-) {
-    (void)source;
-    (void)type;
-    (void)id;
-    (void)length;
-    (void)user;
+// NOTE: submits 100k draws of the scene mesh recorded every frame, executed from already recorded command
+// buffers and replayed from a baked command list (and its GL_NV_command_list tokens when supported).
+// only the cpu side submit is timed, the uniform ranges are zeroed so the gpu has almost nothing to draw.
+// when the tokens are supported they're checked to give the gpu the same draws and primitives as the
+// baked replay they were made from
+static void
+benchmark_baked_command_lists(const struct DrawListRecording* scene_draw_list, uint32_t object_count) {
+    enum { DRAW_COUNT = 100 * 1000, FRAME_COUNT = 20 };
 
-    #define PREFIX "GL DEBUG MESSAGE CALLBACK: "
+    uint32_t uniform_size = object_count * scene_draw_list->uniform_stride;
+    size_t memory_size =
+        DRAW_COUNT * (sizeof(struct DrawItem) + sizeof(struct BakedUniformRange)) +
+        DRAW_COUNT * scene_draw_list->mesh->lods[0].submesh_count * sizeof(struct BakedDraw) +
+        uniform_size + 64 * 1024;
+    struct LinearArena arena = {.base = os_alloc(memory_size), .capacity = memory_size};
+    struct DrawItem* draw_items = LINEAR_ALLOC(&arena, struct DrawItem, DRAW_COUNT);
+    for (uint32_t i = 0; i < DRAW_COUNT; i++) {
+        draw_items[i].sort_key = i;
+        draw_items[i].object_index = i % object_count;
+        draw_items[i].reserved = 0;
+    }
+    void* zero_uniforms = linear_arena_alloc(&arena, uniform_size, 16);
+    glNamedBufferSubData(scene_draw_list->uniform_buffer, scene_draw_list->uniform_offset, uniform_size, zero_uniforms);
 
-    printf(PREFIX);
-    puts(message);
+    // NOTE: a single worker so every variant runs on the context thread only
+    struct JobSystem* job_system = os_alloc(sizeof(struct JobSystem));
+    job_system_init(job_system, /* worker_count */ 1);
+    struct FrameArena* frame_arena = os_alloc(sizeof(struct FrameArena));
+    frame_arena_init(frame_arena, /* thread_count */ 1, /* thread_capacity */ 16 * 1024 * 1024);
 
-    OutputDebugStringA(PREFIX);
-    OutputDebugStringA(message);
-    OutputDebugStringA("\n");
+    struct DrawListRecording recording = *scene_draw_list;
+    recording.draw_items = draw_items;
+    recording.draw_count = DRAW_COUNT;
+    recording.frame_arena = frame_arena;
 
-    #undef PREFIX
+    frame_arena_begin(frame_arena);
+    draw_list_record(&recording, job_system, frame_arena_thread(frame_arena, 0));
+    struct BakedCommandList baked_list;
+    baked_command_list_bake(&baked_list, recording.command_buffers, draw_list_batch_count(&recording), &arena);
 
-    bool error;
+    const char* pass_names[] = {"record + execute", "execute recorded", "baked replay", "baked GL_NV_command_list"};
+    double record_seconds = 0.0;
+    GLuint primitives_query = 0;
+    glCreateQueries(GL_PRIMITIVES_GENERATED, 1, &primitives_query);
+    uint32_t replay_draw_counts[2] = {0};
+    GLuint64 replay_primitive_counts[2] = {0};
+    for (uint32_t pass = 0; pass < LEN(pass_names); pass++) {
+        if (pass == 3 && baked_list.nv_token_buffer == 0) {
+            printf("%s: not supported\n", pass_names[pass]);
+            continue;
+        }
 
-    error =
-        type == GL_DEBUG_SOURCE_API ||
-        type == GL_DEBUG_SOURCE_WINDOW_SYSTEM ||
-        type == GL_DEBUG_SOURCE_SHADER_COMPILER ||
-        type == GL_DEBUG_SOURCE_THIRD_PARTY ||
-        type == GL_DEBUG_SOURCE_APPLICATION;
-    if (error) {
-        UNREACHABLE;
-    }
+        double seconds = 0.0;
+        struct CommandExecutionState state = {0};
+        for (uint32_t frame = 0; frame < FRAME_COUNT; frame++) {
+            glFinish();
+            memset(&state, 0, sizeof(state));
+            int64_t start = timer_now();
+            if (pass == 0) {
+                frame_arena_begin(frame_arena);
+                draw_list_record(&recording, job_system, frame_arena_thread(frame_arena, 0));
+            }
+            if (pass <= 1) {
+                for (uint32_t i = 0; i < draw_list_batch_count(&recording); i++) {
+                    command_buffer_execute(&recording.command_buffers[i], &state);
+                }
+            } else if (pass == 2) {
+                baked_command_list_replay(&baked_list, &state.stats);
+            } else {
+                baked_command_list_replay_nv(&baked_list, /* framebuffer */ 0, &state.stats);
+            }
+            seconds += timer_seconds(timer_now() - start);
 
-    error =
-        severity == GL_DEBUG_SEVERITY_HIGH ||
-        severity == GL_DEBUG_SEVERITY_MEDIUM ||
-        severity == GL_DEBUG_SEVERITY_LOW;
-    if (error) {
-        UNREACHABLE;
+            // NOTE: back to the all zeros state every variant expects
+            glUseProgram(0);
+            glBindTextureUnit(0, 0);
+            glBindSampler(0, 0);
+            glBindVertexArray(0);
+        }
+        seconds /= FRAME_COUNT;
+        record_seconds = pass == 0 ? seconds : record_seconds;
+        printf(
+            "%s: %.3f ms to submit %u draws with %u commands, %.2fx\n",
+            pass_names[pass],
+            seconds * 1000.0,
+            state.stats.draw_count,
+            state.stats.command_count,
+            record_seconds / seconds
+        );
+
+        // NOTE: one more untimed replay counting what reaches the gpu
+        if (pass >= 2) {
+            struct CommandExecutionStats stats = {0};
+            glBeginQuery(GL_PRIMITIVES_GENERATED, primitives_query);
+            if (pass == 2) {
+                baked_command_list_replay(&baked_list, &stats);
+            } else {
+                baked_command_list_replay_nv(&baked_list, /* framebuffer */ 0, &stats);
+            }
+            glEndQuery(GL_PRIMITIVES_GENERATED);
+            glUseProgram(0);
+            glBindTextureUnit(0, 0);
+            glBindSampler(0, 0);
+            glBindVertexArray(0);
+            replay_draw_counts[pass - 2] = stats.draw_count;
+            glGetQueryObjectui64v(primitives_query, GL_QUERY_RESULT, &replay_primitive_counts[pass - 2]);
+        }
+    }
+    glFinish();
+    glDeleteQueries(1, &primitives_query);
+    if (baked_list.nv_token_buffer != 0) {
+        printf(
+            "baked GL_NV_command_list check: %u/%u draws, %llu/%llu primitives\n",
+            replay_draw_counts[1],
+            replay_draw_counts[0],
+            (unsigned long long)replay_primitive_counts[1],
+            (unsigned long long)replay_primitive_counts[0]
+        );
+        ASSERT(replay_draw_counts[1] == replay_draw_counts[0]);
+        ASSERT(replay_primitive_counts[1] == replay_primitive_counts[0]);
     }
+
+    baked_command_list_deinit(&baked_list);
+    frame_arena_deinit(frame_arena);
+    job_system_deinit(job_system);
+    os_free(frame_arena);
+    os_free(job_system);
+    os_free(arena.base);
+}
+
+static void
+run_benchmarks(void) {
+    printf("\n== benchmarks ==\n");
+    benchmark_frame_arena();
+    benchmark_math();
+    benchmark_frustum_culling();
+    benchmark_bvh();
+    benchmark_job_system();
+    benchmark_command_buffers();
+    benchmark_occlusion_culling();
+    benchmark_texture_sampling();
+    benchmark_texture_encoding();
+    benchmark_image_decoding();
+    benchmark_video_upload();
 }
+#endif
 
 int WINAPI
 WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR pCmdLine, int nCmdShow) {
     (void)hInstance;
     (void)hPrevInstance;
-    (void)pCmdLine;
     (void)nCmdShow;
 
     SetProcessDPIAware();
 
+    cpu_features_detect();
+    mip_chain_tables_init();
+    printf("\n== cpu features ==\n");
+    printf("avx2 = %s\n", cpu_features.avx2 ? "yes" : "no");
+
     HINSTANCE hinstance = GetModuleHandleW(NULL);
     ASSERT(hinstance);
 
@@ -347,6 +14213,15 @@ WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR pCmdLine, int nCmdSh
     GL_PROCS
     #undef X
 
+    // NOTE: optional, baked command lists are also baked into its token stream when it's there
+    nv_command_list_init();
+    printf("\n== command lists ==\n");
+    printf("GL_NV_command_list = %s\n", nv_command_list.supported ? "yes" : "no");
+
+    // NOTE: optional, the anisotropic preset falls back to trilinear
+    struct SamplerCache sampler_cache;
+    sampler_cache_init(&sampler_cache);
+
     ///////////////////////////////////////////////////////////////////////////////////////////////////
     // setup debug layer
     ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -358,6 +14233,10 @@ WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR pCmdLine, int nCmdSh
     glDebugMessageCallback(&gl_debug_message_callback, /* userParam */ NULL);
 #endif
 
+#if defined(BENCHMARKS)
+    run_benchmarks();
+#endif
+
     ///////////////////////////////////////////////////////////////////////////////////////////////////
     // create vertex, index, vertex array and uniform buffers
     ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -367,197 +14246,548 @@ WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR pCmdLine, int nCmdSh
         float col[4];
         float uv[2];
     };
-    const struct VertexData vertices[] = {
-        { .pos = { 0.0f, -0.5f, 0.0f}, .col = {1.0f, 0.0f, 0.0f, 1.0f}, .uv = {1.0f, 1.0f} },
-        { .pos = {-0.5f,  0.5f, 0.0f}, .col = {0.0f, 0.0f, 1.0f, 1.0f}, .uv = {0.0f, 0.0f} },
-        { .pos = { 0.5f,  0.5f, 0.0f}, .col = {0.0f, 1.0f, 0.0f, 1.0f}, .uv = {1.0f, 0.0f} },
-    };
-    ASSERT(sizeof(unsigned short) == 2);
-    const unsigned short indices[] = {0, 1, 2};
 
-    // create vertex buffer (VBO)
-    GLuint vertex_buffer = 0;
-    glCreateBuffers(1, &vertex_buffer);
-    glNamedBufferStorage(vertex_buffer, sizeof(vertices), vertices, GL_DYNAMIC_STORAGE_BIT);
+    // NOTE: a mesh file path can be passed as the command line (unquoted), it's memory mapped and its
+    // blobs are uploaded as is. otherwise the builtin triangle is serialized into the same format
+    struct MappedFile mesh_mapped_file = {0};
+    void* builtin_mesh_file_data = NULL;
+    struct MeshFile mesh_file = {0};
+    if (pCmdLine && pCmdLine[0] != '\0' && mapped_file_open(&mesh_mapped_file, pCmdLine)) {
+        ASSERT(mesh_file_parse(&mesh_file, mesh_mapped_file.data, mesh_mapped_file.size));
+    } else {
+        const struct VertexData vertices[] = {
+            { .pos = { 0.0f,  0.5f, 0.0f}, .col = {1.0f, 0.0f, 0.0f, 1.0f}, .uv = {1.0f, 1.0f} },
+            { .pos = {-0.5f, -0.5f, 0.0f}, .col = {0.0f, 0.0f, 1.0f, 1.0f}, .uv = {0.0f, 0.0f} },
+            { .pos = { 0.5f, -0.5f, 0.0f}, .col = {0.0f, 1.0f, 0.0f, 1.0f}, .uv = {1.0f, 0.0f} },
+        };
+        const uint32_t indices[] = {0, 1, 2};
+        const struct MeshFileAttribute attributes[] = {
+            {
+                .location = 0,
+                .component_count = LEN(vertices[0].pos),
+                .component_type = GL_FLOAT,
+                .normalized = GL_FALSE,
+                .relative_offset = OFFSET_OF(struct VertexData, pos),
+            },
+            {
+                .location = 1,
+                .component_count = LEN(vertices[0].col),
+                .component_type = GL_FLOAT,
+                .normalized = GL_FALSE,
+                .relative_offset = OFFSET_OF(struct VertexData, col),
+            },
+            {
+                .location = 2,
+                .component_count = LEN(vertices[0].uv),
+                .component_type = GL_FLOAT,
+                .normalized = GL_FALSE,
+                .relative_offset = OFFSET_OF(struct VertexData, uv),
+            },
+        };
+
+        struct MeshFileBuildDesc mesh_desc = {
+            .vertex_count = LEN(vertices),
+            .vertex_stride = sizeof(vertices[0]),
+            .attribute_count = LEN(attributes),
+            .lod_count = 1,
+            .lod_index_counts = {LEN(indices)},
+            .max_submesh_vertices = 0x10000,
+            .allow_8bit_indices = true,
+            .compress_indices = true,
+        };
+        mesh_desc.vertices = vertices;
+        mesh_desc.attributes = attributes;
+        mesh_desc.lod_indices[0] = indices;
+
+        size_t builtin_mesh_file_size = mesh_file_build(&mesh_desc, /* buffer */ NULL, /* buffer_size */ 0);
+        builtin_mesh_file_data = os_alloc(builtin_mesh_file_size);
+        ASSERT(mesh_file_build(&mesh_desc, builtin_mesh_file_data, builtin_mesh_file_size) == builtin_mesh_file_size);
+        ASSERT(mesh_file_parse(&mesh_file, builtin_mesh_file_data, builtin_mesh_file_size));
+    }
+
+    // NOTE: every vertex, index and uniform range is carved out of a few big immutable storage buffers
+    // so all meshes with the same vertex layout can share a single vertex array object
+    GLint uniform_buffer_offset_alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniform_buffer_offset_alignment);
+    gpu_uniform_buffer_offset_alignment = (uint32_t)uniform_buffer_offset_alignment;
 
-    // create index buffer (IBO/EBO (E standing for element))
-    GLuint index_buffer = 0;
-    glCreateBuffers(1, &index_buffer);
-    glNamedBufferStorage(index_buffer, sizeof(indices), indices, GL_DYNAMIC_STORAGE_BIT);
+    struct GpuArena geometry_arena;
+    gpu_arena_init(&geometry_arena, /* size */ 64 * 1024 * 1024, GL_DYNAMIC_STORAGE_BIT | GL_MAP_WRITE_BIT, /* block_capacity */ 4096);
+    struct GpuArena uniform_arena;
+    gpu_arena_init(&uniform_arena, /* size */ 1024 * 1024, GL_DYNAMIC_STORAGE_BIT, /* block_capacity */ 1024);
+
+    // upload the mesh vertex and index blobs into the geometry arena
+    struct Mesh main_mesh;
+    ASSERT(mesh_upload(&main_mesh, &geometry_arena, &mesh_file));
 
     // create vertex array object (VAO)
     GLuint vertex_array = 0;
     glCreateVertexArrays(1, &vertex_array);
 
-    // bind the vertex buffer to binding 0 (there can be more than one vertex buffer bound)
+    // bind the geometry arena as the vertex buffer to binding 0 (there can be more than one vertex buffer bound)
+    // meshes select their range with a base vertex which is why vertex ranges are stride aligned
     glVertexArrayVertexBuffer(
         vertex_array,
         /* bindingindex */ 0,
-        vertex_buffer,
+        geometry_arena.buffer,
         /* offset */ 0,
-        /* stride */ sizeof(vertices[0])
+        /* stride */ (GLsizei)main_mesh.vertex_stride
     );
     // for when using instance drawing (since we're not using it, divisor is 0
     glVertexArrayBindingDivisor(vertex_array, /* bindingindex */ 0, /* divisor */ 0);
 
-    // bind the index buffer (there can be only one index buffer)
-    glVertexArrayElementBuffer(vertex_array, index_buffer);
+    // bind the geometry arena as the index buffer too (there can be only one index buffer)
+    glVertexArrayElementBuffer(vertex_array, geometry_arena.buffer);
 
-    // enables and informs the format of the attribute (vertex shader input) at index 0 (pos)
-    glEnableVertexArrayAttrib(vertex_array, /* attribindex */ 0);
-    glVertexArrayAttribFormat(
-        vertex_array,
-        /* attribindex */ 0,
-        /* size */ LEN(vertices[0].pos),
-        GL_FLOAT,
-        /* normalized */ GL_FALSE,
-        /* relativeoffset */ OFFSET_OF(struct VertexData, pos)
-    );
-    // make the attribute at index 0 take its data from binding 0 (that is, the previously bound vertex buffer)
-    glVertexArrayAttribBinding(vertex_array, /* attribindex */ 0, /* bindingindex */ 0);
-
-    // enables and informs the format of the attribute (vertex shader input) at index 1 (col)
-    glEnableVertexArrayAttrib(vertex_array, /* attribindex */ 1);
-    glVertexArrayAttribFormat(
-        vertex_array,
-        /* attribindex */ 1,
-        /* size */ LEN(vertices[0].col),
-        GL_FLOAT,
-        /* normalized */ GL_FALSE,
-        /* relativeoffset */ OFFSET_OF(struct VertexData, col)
-    );
-    // make the attribute at index 0 take its data from binding 0 (that is, the previously bound vertex buffer)
-    glVertexArrayAttribBinding(vertex_array, /* attribindex */ 1, /* bindingindex */ 0);
-
-    // enables and informs the format of the attribute (vertex shader input) at index 2 (uv)
-    glEnableVertexArrayAttrib(vertex_array, /* attribindex */ 2);
-    glVertexArrayAttribFormat(
-        vertex_array,
-        /* attribindex */ 2,
-        /* size */ LEN(vertices[0].uv),
-        GL_FLOAT,
-        /* normalized */ GL_FALSE,
-        /* relativeoffset */ OFFSET_OF(struct VertexData, uv)
+    // enables and informs the format of each attribute (vertex shader input) from the mesh file vertex layout
+    // (for the builtin triangle: index 0 is pos, index 1 is col and index 2 is uv)
+    for (uint32_t i = 0; i < mesh_file.header->attribute_count; i++) {
+        const struct MeshFileAttribute* attribute = &mesh_file.header->attributes[i];
+        glEnableVertexArrayAttrib(vertex_array, attribute->location);
+        glVertexArrayAttribFormat(
+            vertex_array,
+            attribute->location,
+            /* size */ (GLint)attribute->component_count,
+            attribute->component_type,
+            /* normalized */ attribute->normalized ? GL_TRUE : GL_FALSE,
+            attribute->relative_offset
+        );
+        // make the attribute take its data from binding 0 (that is, the previously bound vertex buffer)
+        glVertexArrayAttribBinding(vertex_array, attribute->location, /* bindingindex */ 0);
+    }
+
+    // the depth prepass vertex array only reads the tightly packed positions (index 0) from binding 0
+    GLuint depth_vertex_array = 0;
+    glCreateVertexArrays(1, &depth_vertex_array);
+    glVertexArrayVertexBuffer(
+        depth_vertex_array,
+        /* bindingindex */ 0,
+        geometry_arena.buffer,
+        /* offset */ 0,
+        /* stride */ (GLsizei)(main_mesh.position_component_count * sizeof(float))
     );
-    // make the attribute at index 0 take its data from binding 0 (that is, the previously bound vertex buffer)
-    glVertexArrayAttribBinding(vertex_array, /* attribindex */ 2, /* bindingindex */ 0);
+    glVertexArrayElementBuffer(depth_vertex_array, geometry_arena.buffer);
+    glEnableVertexArrayAttrib(depth_vertex_array, /* attribindex */ 0);
+    glVertexArrayAttribFormat(depth_vertex_array, /* attribindex */ 0, (GLint)main_mesh.position_component_count, GL_FLOAT, GL_FALSE, /* relativeoffset */ 0);
+    glVertexArrayAttribBinding(depth_vertex_array, /* attribindex */ 0, /* bindingindex */ 0);
 
-    struct UniformData {
-        float transform[4][4];
-    };
+    // NOTE: the driver has its own copy of the blobs now so the mesh file can be released
+    memset(&mesh_file, 0, sizeof(mesh_file));
+    mapped_file_close(&mesh_mapped_file);
+    os_free(builtin_mesh_file_data);
+
+    // NOTE: the scene is a grid of copies of the main mesh, see the scene section. a few layers deep so
+    // there's some overdraw for the depth prepass to save. its memory also holds the baked lists
+    uint32_t grid_size = 16;
+    uint32_t layer_count = 4;
+    float grid_spacing = 0.5f;
+    size_t scene_memory_capacity = scene_memory_size(grid_size * grid_size * layer_count) + 1024 * 1024;
+    struct LinearArena scene_memory = {.base = os_alloc(scene_memory_capacity), .capacity = scene_memory_capacity};
+    struct Scene scene;
+    scene_init(&scene, &scene_memory, grid_size, layer_count, grid_spacing, main_mesh.bounds_min, main_mesh.bounds_max);
+    printf("\n== bvh ==\n");
+    printf("nodes = %u, depth = %u, sah cost = %.2f (left click to pick)\n", scene.bvh.node_count, scene.bvh.depth, scene.bvh.built_cost);
+
+    // NOTE: every 16th object bobs along the view axis so the bvh gets refit every frame
+    uint32_t bobbing_count = (scene.object_count + 15) / 16;
+    uint32_t* bobbing_objects = LINEAR_ALLOC(&scene_memory, uint32_t, bobbing_count);
+    struct Vec3* bobbing_rest_positions = LINEAR_ALLOC(&scene_memory, struct Vec3, bobbing_count);
+    for (uint32_t i = 0; i < bobbing_count; i++) {
+        uint32_t object = i * 16;
+        bobbing_objects[i] = object;
+        bobbing_rest_positions[i].x = scene.grid_positions.components[0][object];
+        bobbing_rest_positions[i].y = scene.grid_positions.components[1][object];
+        bobbing_rest_positions[i].z = scene.grid_positions.components[2][object];
+    }
+
+    // allocate the uniform buffer (UBO) range for every object from the uniform arena
+    // each object binds its own block so blocks are placed at the uniform buffer offset alignment
+    // (a multiple of a mat4 too as the occlusion culling reads the transforms out of the blocks as an array of them)
+    uint32_t uniform_stride = ALIGN_UP(ALIGN_UP((uint32_t)sizeof(struct UniformData), (uint32_t)sizeof(struct Mat4)), gpu_uniform_buffer_offset_alignment);
+    struct GpuAllocation uniform_allocation;
+    ASSERT(gpu_arena_alloc_for_usage(&uniform_arena, GPU_BUFFER_USAGE_UNIFORM, scene.object_count * uniform_stride, /* element_size */ 0, &uniform_allocation));
+
+    // NOTE: occlusion culled draws are multi draw indirect and find their object with an instanced object
+    // index attribute (index 3, from binding 1) as the base instance of every draw is its object index
+    struct GpuAllocation object_index_allocation;
+    ASSERT(gpu_arena_alloc_for_usage(&geometry_arena, GPU_BUFFER_USAGE_VERTEX, scene.object_count * sizeof(uint32_t), sizeof(uint32_t), &object_index_allocation));
+    {
+        uint32_t* object_indices = os_alloc(scene.object_count * sizeof(uint32_t));
+        for (uint32_t i = 0; i < scene.object_count; i++) {
+            object_indices[i] = i;
+        }
+        glNamedBufferSubData(geometry_arena.buffer, object_index_allocation.offset, scene.object_count * sizeof(uint32_t), object_indices);
+        os_free(object_indices);
+    }
+    glVertexArrayVertexBuffer(vertex_array, /* bindingindex */ 1, geometry_arena.buffer, object_index_allocation.offset, /* stride */ sizeof(uint32_t));
+    glVertexArrayBindingDivisor(vertex_array, /* bindingindex */ 1, /* divisor */ 1);
+    glEnableVertexArrayAttrib(vertex_array, /* attribindex */ 3);
+    glVertexArrayAttribIFormat(vertex_array, /* attribindex */ 3, /* size */ 1, GL_UNSIGNED_INT, /* relativeoffset */ 0);
+    glVertexArrayAttribBinding(vertex_array, /* attribindex */ 3, /* bindingindex */ 1);
+
+    // NOTE: the occlusion culled draws read the transforms out of the uniform blocks as a storage buffer
+    GLint storage_buffer_offset_alignment = 0;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storage_buffer_offset_alignment);
+    ASSERT(uniform_allocation.offset % (uint32_t)storage_buffer_offset_alignment == 0);
+
+    printf("\n== gpu arenas ==\n");
+    gpu_arena_print_stats("geometry", &geometry_arena);
+    gpu_arena_print_stats("uniform", &uniform_arena);
 
-    // create uniform buffer (UBO)
-    GLuint uniform_buffer = 0;
-    glCreateBuffers(1, &uniform_buffer);
-    glNamedBufferStorage(uniform_buffer, sizeof(struct UniformData), /* data */ NULL, GL_DYNAMIC_STORAGE_BIT);
+    // NOTE: one worker per logical processor (the main thread being worker 0) for the cpu frame work
+    struct JobSystem* job_system = os_alloc(sizeof(struct JobSystem));
+    job_system_init(job_system, /* worker_count */ 0);
+    printf("\n== job system ==\n");
+    printf("workers = %u\n", job_system->worker_count);
+
+    // NOTE: everything the frame loop builds on the cpu comes from here, with a sub-arena per worker
+    struct FrameArena* frame_arena = os_alloc(sizeof(struct FrameArena));
+    frame_arena_init(frame_arena, job_system->worker_count, /* thread_capacity */ 1024 * 1024);
 
     ///////////////////////////////////////////////////////////////////////////////////////////////////
-    // create main texture
+    // create materials
     ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-    // NOTE: checkers pattern
-    unsigned char main_texture_rgba[] = {
-        255, 255, 255, 255, 127, 127, 127, 255,
-        127, 127, 127, 255, 255, 255, 255, 255,
-    };
-    GLsizei main_texture_rgba_width = 2;
-    GLsizei main_texture_rgba_height = 2;
-    ASSERT(main_texture_rgba_width * main_texture_rgba_height == LEN(main_texture_rgba) / 4);
-
-    GLuint main_texture = 0;
-    glCreateTextures(GL_TEXTURE_2D, 1, &main_texture);
-    glTextureParameteri(main_texture, GL_TEXTURE_MAX_LEVEL, 0);
-    glTextureParameteri(main_texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTextureParameteri(main_texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTextureParameteri(main_texture, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTextureParameteri(main_texture, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTextureParameteri(main_texture, GL_TEXTURE_WRAP_R, GL_REPEAT);
-    glTextureStorage2D(main_texture, /* levels */ 1, GL_RGBA8, main_texture_rgba_width, main_texture_rgba_height);
-    glTextureSubImage2D(
-        main_texture,
-        /* level */ 0,
-        /* xoffset */ 0,
-        /* yoffset */ 0,
-        main_texture_rgba_width,
-        main_texture_rgba_height,
-        GL_RGBA,
-        GL_UNSIGNED_BYTE,
-        main_texture_rgba
+    // NOTE: lots of small checkers textures of different sizes and tints, like a sheet of icons, tiling a
+    // different number of times. see the materials and texture atlas sections
+    uint32_t material_count = 200;
+    struct MaterialImage* material_images = os_alloc(material_count * sizeof(struct MaterialImage));
+    unsigned char* material_texels = os_alloc(material_count * 32 * 32 * 4);
+    for (uint32_t i = 0; i < material_count; i++) {
+        uint32_t hash = (i + 1) * 2654435761u;
+        uint32_t width = 4u << ((hash >> 8) & 3);
+        uint32_t height = 4u << ((hash >> 12) & 3);
+        unsigned char tint[3] = {(unsigned char)(128 + ((hash >> 16) & 127)), (unsigned char)(128 + ((hash >> 23) & 127)), (unsigned char)(128 + (hash & 127))};
+        unsigned char* rgba = material_texels + i * 32 * 32 * 4;
+        for (uint32_t y = 0; y < height; y++) {
+            for (uint32_t x = 0; x < width; x++) {
+                bool light = ((x * 2 / width) ^ (y * 2 / height)) == 0;
+                for (uint32_t c = 0; c < 3; c++) {
+                    rgba[(y * width + x) * 4 + c] = light ? tint[c] : (unsigned char)(tint[c] / 2);
+                }
+                rgba[(y * width + x) * 4 + 3] = 255;
+            }
+        }
+        material_images[i].rgba = rgba;
+        material_images[i].width = width;
+        material_images[i].height = height;
+        material_images[i].uv_scale = (float)(1 + i % 4);
+    }
+
+    // NOTE: a `texture.ktx2` or `texture.dds` in the working directory is used by the first material
+    struct MappedFile texture_mapped_file = {0};
+    struct TextureFile texture_file = {0};
+    bool texture_file_parsed =
+        (mapped_file_open(&texture_mapped_file, "texture.ktx2") || mapped_file_open(&texture_mapped_file, "texture.dds")) &&
+        texture_file_parse(&texture_file, texture_mapped_file.data, texture_mapped_file.size);
+    if (texture_file_parsed) {
+        material_images[0].file = &texture_file;
+        material_images[0].uv_scale = 1.0f;
+    }
+
+    // NOTE: the png, jpeg and qoi files of an `images` directory in the working directory replace the
+    // materials after the first one, decoded on the workers. see the image decoding section
+    struct ImageDirectory image_directory;
+    image_directory_open(&image_directory, "images", material_count - 1);
+    unsigned char* image_texels = NULL;
+    uint32_t image_decoded_count = 0;
+    uint64_t image_pixel_count = 0;
+    double image_seconds = 0.0;
+    if (image_directory.count > 0) {
+        image_texels = os_alloc(image_directory.rgba_size);
+        unsigned char* rgba = image_texels;
+        for (uint32_t i = 0; i < image_directory.count; i++) {
+            struct ImageDecode* image = &image_directory.images[i];
+            image->rgba = rgba;
+            rgba += (size_t)image->info.width * image->info.height * 4;
+            image_pixel_count += (uint64_t)image->info.width * image->info.height;
+        }
+        int64_t start = timer_now();
+        image_decoded_count = image_decode_all(image_directory.images, image_directory.count, IMAGE_DECODE_PREMULTIPLY, job_system);
+        image_seconds = timer_seconds(timer_now() - start);
+        for (uint32_t i = 0, material = 1; i < image_directory.count; i++) {
+            const struct ImageDecode* image = &image_directory.images[i];
+            if (image->decoded) {
+                material_images[material].rgba = image->rgba;
+                material_images[material].width = image->info.width;
+                material_images[material].height = image->info.height;
+                material_images[material].uv_scale = 1.0f;
+                material += 1;
+            }
+        }
+    }
+
+    texture_formats_detect();
+    struct TextureStreaming* texture_streaming = os_alloc(sizeof(struct TextureStreaming));
+    texture_streaming_init(texture_streaming, TEXTURE_STREAMING_BUDGET);
+    struct Materials materials;
+    materials_init(&materials, material_images, material_count, &sampler_cache, texture_streaming, job_system);
+    mapped_file_close(&texture_mapped_file);
+    os_free(material_texels);
+    os_free(material_images);
+    printf("\n== materials ==\n");
+    if (materials.bindless) {
+        printf("materials = %u (bindless texture handles)\n", materials.count);
+    } else {
+        printf(
+            "materials = %u (texture atlas, %u pages of %ux%u, %.1f%% used)\n",
+            materials.count, materials.atlas_page_count, MATERIALS_ATLAS_PAGE_SIZE, MATERIALS_ATLAS_PAGE_SIZE, materials.atlas_usage * 100.0f
+        );
+    }
+    printf("texture filtering = %s (max anisotropy %.0fx)\n", sampler_preset_names[MATERIALS_SAMPLER_PRESET], sampler_cache.max_anisotropy);
+    if (materials.bindless) {
+        printf(
+            "texture streaming = %.1f KiB budget, %.1f KiB resident at first (levels up to %ux%u)\n",
+            (double)texture_streaming->budget / 1024.0,
+            (double)texture_streaming->resident_size / 1024.0,
+            TEXTURE_STREAMING_PINNED_EXTENT,
+            TEXTURE_STREAMING_PINNED_EXTENT
+        );
+    } else {
+        printf("texture streaming = off (the atlas pages are shared by every material)\n");
+    }
+    if (materials.encoded) {
+        printf(
+            "texture memory = %.1f KiB (%.1f KiB as rgba8), images encoded to %s %s at %.2f dB\n",
+            (double)materials.texture_size / 1024.0,
+            (double)materials.rgba8_texture_size / 1024.0,
+            texture_format_infos[MATERIALS_ENCODE_FORMAT].name,
+            texture_encode_quality_names[MATERIALS_ENCODE_QUALITY],
+            texture_encode_psnr(materials.encode_error, materials.encode_value_count)
+        );
+    } else {
+        printf("texture memory = %.1f KiB, images uploaded as rgba8\n", (double)materials.texture_size / 1024.0);
+    }
+    printf("compressed formats =");
+    for (uint32_t i = 0; i < TEXTURE_FORMAT_COUNT; i++) {
+        if (i != TEXTURE_FORMAT_RGBA8) {
+            printf(" %s%s", texture_format_infos[i].name, texture_format_supported[i] ? "" : " (transcoded)");
+        }
+    }
+    printf("\n");
+    if (texture_file_parsed) {
+        printf(
+            "texture file = %ux%u %s%s, %u levels, %s\n",
+            texture_file.width,
+            texture_file.height,
+            texture_format_infos[texture_file.format].name,
+            texture_file.srgb ? " srgb" : "",
+            texture_file.level_count,
+            materials.file_count == 0 ? "not usable" :
+                !materials.bindless ? "decoded into the atlas" :
+                texture_format_supported[texture_file.format] ? "uploaded as is" :
+                "transcoded to bc7"
+        );
+    }
+    if (image_directory.count > 0) {
+        printf(
+            "images = %u of %u decoded (%u png, %u jpeg, %u qoi) in %.2f ms on %u workers, %.2f megapixels/s\n",
+            image_decoded_count,
+            image_directory.count,
+            image_directory.format_counts[IMAGE_FORMAT_PNG],
+            image_directory.format_counts[IMAGE_FORMAT_JPEG],
+            image_directory.format_counts[IMAGE_FORMAT_QOI],
+            image_seconds * 1000.0,
+            job_system->worker_count,
+            (double)image_pixel_count / image_seconds / 1e6
+        );
+    }
+    image_directory_close(&image_directory);
+    os_free(image_texels);
+
+    // NOTE: a map far bigger than would fit in memory, drawn on a plane behind the grid
+    struct VirtualTexture* virtual_texture = os_alloc(sizeof(struct VirtualTexture));
+    virtual_texture_init(virtual_texture, &sampler_cache, job_system);
+    printf("\n== virtual texture ==\n");
+    printf(
+        "virtual texture = %llux%llu texels, %u levels of %ux%u pages, page table %s\n",
+        1ull << virtual_texture->size_log2,
+        1ull << virtual_texture->size_log2,
+        virtual_texture->level_count,
+        VIRTUAL_TEXTURE_TILE_SIZE,
+        VIRTUAL_TEXTURE_TILE_SIZE,
+        virtual_texture->sparse ? "sparse (GL_ARB_sparse_texture)" : "fully allocated (no GL_ARB_sparse_texture2)"
+    );
+    if (virtual_texture->sparse) {
+        printf(
+            "sparse page table = %dx%d entries per commitment region, %u levels before the mip tail\n",
+            virtual_texture->sparse_page_width, virtual_texture->sparse_page_height, virtual_texture->sparse_level_count
+        );
+    }
+    printf(
+        "page cache = %u slots of %ux%u (%u texel borders), %.1f MiB\n",
+        VIRTUAL_TEXTURE_SLOT_COUNT,
+        VIRTUAL_TEXTURE_SLOT_SIZE,
+        VIRTUAL_TEXTURE_SLOT_SIZE,
+        VIRTUAL_TEXTURE_TILE_BORDER,
+        (double)VIRTUAL_TEXTURE_CACHE_SIZE * VIRTUAL_TEXTURE_CACHE_SIZE * 4.0 / (1024.0 * 1024.0)
     );
+    // NOTE: wanders around the map zooming in and out, from the whole map to about a window sized part of it
+    double map_center[2] = {0.5, 0.5};
+    double map_max_zoom = (double)virtual_texture->size_log2 - 10.0;
+    double map_previous_time = 0.0;
+
+    // NOTE: the y4m files of a `videos` directory in the working directory play in front of the map
+    struct VideoTextures* video_textures = os_alloc(sizeof(struct VideoTextures));
+    video_textures_init(video_textures, "videos", &sampler_cache, (float[]){12.0f, 8.0f, -1.5f});
+    if (video_textures->count > 0) {
+        printf("\n== video textures ==\n");
+        for (uint32_t i = 0; i < video_textures->count; i++) {
+            const struct VideoTexture* video = &video_textures->videos[i];
+            printf(
+                "video = %s, %ux%u %s%s, %u frames at %.2f fps, %.1f MiB upload ring\n",
+                video->name,
+                video->source.width,
+                video->source.height,
+                video->source.chroma_name,
+                video->source.full_range ? " full range" : "",
+                video->source.frame_count,
+                (double)video->source.frame_rate[0] / (double)video->source.frame_rate[1],
+                (double)(video->slot_size * VIDEO_TEXTURE_RING_SIZE) / (1024.0 * 1024.0)
+            );
+        }
+    }
+
+    // NOTE: neighbours along both grid axes get different materials
+    for (uint32_t i = 0; i < scene.object_count; i++) {
+        uint32_t layer_index = i % (grid_size * grid_size);
+        scene.materials[i] = (layer_index % grid_size + layer_index / grid_size * 2) % materials.count;
+    }
 
     ///////////////////////////////////////////////////////////////////////////////////////////////////
     // shaders
     ///////////////////////////////////////////////////////////////////////////////////////////////////
 
-    #define SHADER_SRC(...) #__VA_ARGS__
-    const char* vertex_shader_src =
+    // NOTE: the uniform block has to be command bindable for GL_NV_command_list tokens to bind it (and std140
+    // so it matches `UniformData`)
+    const char* vertex_shader_header = nv_command_list.supported ?
         "#version 450\n"
+        "#extension GL_NV_command_list : require\n"
+        "#define UNIFORM_LAYOUT layout(std140, commandBindableNV, binding = 0)\n" :
+        "#version 450\n"
+        "#define UNIFORM_LAYOUT layout(std140, binding = 0)\n";
+    // NOTE: `invariant` so the depth prepass and the main pass compute the exact same depths for `GL_EQUAL`
+    const char* vertex_shader_src =
         SHADER_SRC(
             layout(location = 0) in vec3 pos;
             layout(location = 1) in vec4 col;
             layout(location = 2) in vec2 texcoord;
-            layout(binding = 0) uniform uniforms0 {
+            UNIFORM_LAYOUT uniform uniforms0 {
                 mat4 transform;
+                uint object_material_index;
             };
             out vec4 color;
             out vec2 uv;
+            flat out uint material_index;
+            invariant gl_Position;
             void main() {
                 gl_Position = transform * vec4(pos, 1.0);
                 color = col;
                 uv = texcoord;
+                material_index = object_material_index;
             }
         );
 
-    const char* frag_shader_src =
+    const char* depth_vertex_shader_src =
+        SHADER_SRC(
+            layout(location = 0) in vec3 pos;
+            UNIFORM_LAYOUT uniform uniforms0 {
+                mat4 transform;
+            };
+            invariant gl_Position;
+            void main() {
+                gl_Position = transform * vec4(pos, 1.0);
+            }
+        );
+
+    // NOTE: the occlusion culled draws get their transform and material index from the uniform blocks
+    // through the object index, reading them as vec4s (`UniformData` layout)
+    const char* culled_vertex_shader_src =
         "#version 450\n"
         SHADER_SRC(
+            layout(location = 0) in vec3 pos;
+            layout(location = 1) in vec4 col;
+            layout(location = 2) in vec2 texcoord;
+            layout(location = 3) in uint object_index;
+            layout(std430, binding = 0) readonly buffer objects_buffer {
+                vec4 objects[];
+            };
+            layout(location = 0) uniform uint object_stride;
+            out vec4 color;
+            out vec2 uv;
+            flat out uint material_index;
+            invariant gl_Position;
+            void main() {
+                uint object = object_index * object_stride;
+                mat4 transform = mat4(objects[object], objects[object + 1], objects[object + 2], objects[object + 3]);
+                gl_Position = transform * vec4(pos, 1.0);
+                color = col;
+                uv = texcoord;
+                material_index = floatBitsToUint(objects[object + 4].x);
+            }
+        );
+
+    const char* frag_shader_src =
+        SHADER_SRC(
+        struct Material {
+            uvec2 texture_handle;
+            uint layer;
+            float uv_scale;
+            vec4 uv_rect;
+        };
+        layout(std430, binding = 1) readonly buffer materials_buffer {
+            Material materials[];
+        };
         in vec4 color;
         in vec2 uv;
+        flat in uint material_index;
         out vec4 frag_color;
-        layout(binding = 0) uniform sampler2D main_texture;
         void main() {
-            // NOTE: the `uv * 3.0` will make the checkers texture tile three times
-            vec4 tex_color = texture(main_texture, uv * 3.0);
+            // NOTE: the uv scale makes the checkers texture tile that many times
+            Material material = materials[material_index];
+            vec4 tex_color = MATERIAL_TEXTURE(material, uv * material.uv_scale);
             frag_color = color * tex_color;
         }
         );
-    #undef SHADER_SRC
 
-    GLuint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex_shader, 1, &vertex_shader_src, NULL);
-    glCompileShader(vertex_shader);
-    GLint vertex_shader_success = 0;
-    glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &vertex_shader_success);
-    if (!vertex_shader_success) {
-        char shader_log_buf[1024];
-        glGetShaderInfoLog(vertex_shader, sizeof(shader_log_buf), /* length */ NULL, shader_log_buf);
-        OutputDebugStringA("vertex shader compile error:\n");
-        OutputDebugStringA(shader_log_buf);
-        OutputDebugStringA("\n");
-        UNREACHABLE;
-    }
+    const char* vertex_shader_srcs[] = {vertex_shader_header, vertex_shader_src};
+    GLuint vertex_shader = shader_create(GL_VERTEX_SHADER, vertex_shader_srcs, LEN(vertex_shader_srcs));
 
-    GLuint frag_shader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(frag_shader, 1, &frag_shader_src, NULL);
-    glCompileShader(frag_shader);
-    GLint frag_shader_success = 0;
-    glGetShaderiv(frag_shader, GL_COMPILE_STATUS, &frag_shader_success);
-    if (!frag_shader_success) {
-        char shader_log_buf[1024];
-        glGetShaderInfoLog(frag_shader, sizeof(shader_log_buf), /* length */ NULL, shader_log_buf);
-        OutputDebugStringA("frag shader compile error:\n");
-        OutputDebugStringA(shader_log_buf);
-        OutputDebugStringA("\n");
-        UNREACHABLE;
-    }
+    const char* frag_shader_srcs[] = {"#version 450\n", materials_shader_header(&materials), frag_shader_src};
+    GLuint frag_shader = shader_create(GL_FRAGMENT_SHADER, frag_shader_srcs, LEN(frag_shader_srcs));
 
     GLuint shader_program = glCreateProgram();
     glAttachShader(shader_program, vertex_shader);
     glAttachShader(shader_program, frag_shader);
     glLinkProgram(shader_program);
 
+    GLuint culled_vertex_shader = shader_create(GL_VERTEX_SHADER, &culled_vertex_shader_src, /* source_count */ 1);
+
+    // NOTE: with and without the fragment shader, for the occlusion culled draws with and without depth prepass
+    GLuint culled_shader_program = glCreateProgram();
+    glAttachShader(culled_shader_program, culled_vertex_shader);
+    glAttachShader(culled_shader_program, frag_shader);
+    glLinkProgram(culled_shader_program);
+    glProgramUniform1ui(culled_shader_program, /* location */ 0, uniform_stride / (uint32_t)(4 * sizeof(float)));
+
+    GLuint culled_depth_shader_program = glCreateProgram();
+    glAttachShader(culled_depth_shader_program, culled_vertex_shader);
+    glLinkProgram(culled_depth_shader_program);
+    glProgramUniform1ui(culled_depth_shader_program, /* location */ 0, uniform_stride / (uint32_t)(4 * sizeof(float)));
+
     glDeleteShader(vertex_shader);
     glDeleteShader(frag_shader);
+    glDeleteShader(culled_vertex_shader);
+
+    // NOTE: the depth prepass program has no fragment shader at all, depth is written without one
+    const char* depth_vertex_shader_srcs[] = {vertex_shader_header, depth_vertex_shader_src};
+    GLuint depth_vertex_shader = shader_create(GL_VERTEX_SHADER, depth_vertex_shader_srcs, LEN(depth_vertex_shader_srcs));
+
+    GLuint depth_shader_program = glCreateProgram();
+    glAttachShader(depth_shader_program, depth_vertex_shader);
+    glLinkProgram(depth_shader_program);
+
+    glDeleteShader(depth_vertex_shader);
 
     ///////////////////////////////////////////////////////////////////////////////////////////////////
     // set opengl default state
@@ -572,10 +14802,139 @@ WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR pCmdLine, int nCmdSh
     glEnable(GL_DEPTH_TEST);
     glDepthFunc(GL_LESS);
 
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+    // bake static draws
+    ///////////////////////////////////////////////////////////////////////////////////////////////////
+
+    // NOTE: everything a frame needs to record the scene draws, only the draw items change
+    struct DrawListRecording scene_draw_list = {0};
+    scene_draw_list.batch_size = DRAW_LIST_BATCH_SIZE;
+    scene_draw_list.frame_arena = frame_arena;
+    scene_draw_list.mesh = &main_mesh;
+    scene_draw_list.program = shader_program;
+    scene_draw_list.texture = materials.texture_array;
+    scene_draw_list.sampler = materials.sampler;
+    scene_draw_list.vertex_array = vertex_array;
+    scene_draw_list.uniform_buffer = uniform_arena.buffer;
+    scene_draw_list.uniform_offset = uniform_allocation.offset;
+    scene_draw_list.uniform_stride = uniform_stride;
+    scene_draw_list.uniform_size = sizeof(struct UniformData);
+
+    struct DrawListRecording depth_draw_list = scene_draw_list;
+    depth_draw_list.program = depth_shader_program;
+    depth_draw_list.texture = 0;
+    depth_draw_list.sampler = 0;
+    depth_draw_list.vertex_array = depth_vertex_array;
+    depth_draw_list.positions_only = true;
+
+    // NOTE: the grid issues the same binds and draws every frame, only its uniforms change. so the draws
+    // of every object are recorded once and baked, it must happen after the default state is set and with
+    // a framebuffer like the scene pass one bound because GL_NV_command_list state objects capture both.
+    // that includes the depth and color write state so there's a list for each way the scene is drawn.
+    // they're baked front to back, which stays so as the grid orbits around the view axis
+    struct Vec3 camera_position = {0.0f, 0.0f, 10.0f};
+    struct BakedCommandList scene_baked_list;
+    struct BakedCommandList depth_baked_list;
+    struct BakedCommandList equal_baked_list;
+    {
+        GLuint capture_textures[2] = {0};
+        glCreateTextures(GL_TEXTURE_2D, LEN(capture_textures), capture_textures);
+        glTextureStorage2D(capture_textures[0], /* levels */ 1, SCENE_COLOR_FORMAT, /* width */ 1, /* height */ 1);
+        glTextureStorage2D(capture_textures[1], /* levels */ 1, SCENE_DEPTH_FORMAT, /* width */ 1, /* height */ 1);
+        GLuint capture_framebuffer = 0;
+        glCreateFramebuffers(1, &capture_framebuffer);
+        glNamedFramebufferTexture(capture_framebuffer, GL_COLOR_ATTACHMENT0, capture_textures[0], /* level */ 0);
+        glNamedFramebufferTexture(capture_framebuffer, GL_DEPTH_ATTACHMENT, capture_textures[1], /* level */ 0);
+        glBindFramebuffer(GL_FRAMEBUFFER, capture_framebuffer);
+
+        frame_arena_begin(frame_arena);
+        struct LinearArena* frame_memory = frame_arena_thread(frame_arena, /* thread_index */ 0);
+        struct DrawListRecording recording = scene_draw_list;
+        struct DrawItem* draw_items = LINEAR_ALLOC(frame_memory, struct DrawItem, scene.object_count);
+        for (uint32_t i = 0; i < scene.object_count; i++) {
+            struct Vec3 position = {scene.grid_positions.components[0][i], scene.grid_positions.components[1][i], scene.grid_positions.components[2][i]};
+            struct Vec3 offset = vec3_sub(position, camera_position);
+            float distance_squared = vec3_dot(offset, offset);
+            uint32_t depth_bits = 0;
+            memcpy(&depth_bits, &distance_squared, sizeof(depth_bits));
+            draw_items[i].sort_key = ((uint64_t)depth_bits << 32) | i;
+            draw_items[i].object_index = i;
+            draw_items[i].reserved = 0;
+        }
+        draw_items_sort(draw_items, scene.object_count, frame_memory);
+        recording.draw_items = draw_items;
+        recording.draw_count = scene.object_count;
+        draw_list_record(&recording, job_system, frame_memory);
+        baked_command_list_bake(&scene_baked_list, recording.command_buffers, draw_list_batch_count(&recording), &scene_memory);
+
+        glDepthFunc(GL_EQUAL);
+        glDepthMask(GL_FALSE);
+        baked_command_list_bake(&equal_baked_list, recording.command_buffers, draw_list_batch_count(&recording), &scene_memory);
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+
+        struct DrawListRecording depth_recording = depth_draw_list;
+        depth_recording.draw_items = draw_items;
+        depth_recording.draw_count = scene.object_count;
+        draw_list_record(&depth_recording, job_system, frame_memory);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        baked_command_list_bake(&depth_baked_list, depth_recording.command_buffers, draw_list_batch_count(&depth_recording), &scene_memory);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glDeleteFramebuffers(1, &capture_framebuffer);
+        glDeleteTextures(LEN(capture_textures), capture_textures);
+
+        printf("\n== baked scene ==\n");
+        printf("state blocks = %u\n", scene_baked_list.state_block_count);
+        printf("draws = %u\n", scene_baked_list.draw_count);
+        printf("dropped binds = %u\n", scene_baked_list.dropped_bind_count);
+    }
+
+    // NOTE: counts fragment shader invocations of the scene pass when pipeline statistics queries are there
+    struct FragmentStatistics fragment_statistics;
+    fragment_statistics_init(&fragment_statistics);
+    printf("\n== depth prepass ==\n");
+    printf("GL_ARB_pipeline_statistics_query = %s\n", fragment_statistics.supported ? "yes" : "no");
+    printf("depth prepass = %s (press P to toggle)\n", depth_prepass_enabled ? "on" : "off");
+
+    // NOTE: gpu occlusion culling against a depth pyramid, see the occlusion culling section
+    struct OcclusionCulling occlusion_culling;
+    occlusion_culling_init(&occlusion_culling, &main_mesh, scene.object_count, uniform_stride);
+
+    // NOTE: occlusion queries on bounding box proxies, see the occlusion queries section. a light mesh
+    // (like the builtin triangle) costs about as much as its proxy so it's just drawn without queries
+    struct OcclusionQueries occlusion_queries = {0};
+    bool occlusion_queries_used = occlusion_queries_worth_it(&main_mesh);
+    struct DrawListRecording queried_draw_list = scene_draw_list;
+    if (occlusion_queries_used) {
+        occlusion_queries_init(&occlusion_queries, &main_mesh, &geometry_arena, scene.object_count);
+        queried_draw_list.occlusion_queries = occlusion_queries.queries;
+        queried_draw_list.proxy_mesh = &occlusion_queries.proxy_mesh;
+        queried_draw_list.proxy_program = depth_shader_program;
+        queried_draw_list.proxy_vertex_array = depth_vertex_array;
+        // NOTE: the camera could be inside the proxy of anything closer than its bounding radius (plus some margin)
+        queried_draw_list.proxy_min_distance_squared = 4.0f * scene.object_radius * scene.object_radius;
+    }
+
+    printf("\n== occlusion culling ==\n");
+    printf("occlusion culling = %s (press O to cycle)\n", occlusion_culling_mode_names[occlusion_culling_mode]);
+    printf("occlusion queries = %s (%u triangles per object)\n", occlusion_queries_used ? "used" : "not worth it", main_mesh.lods[0].index_count / 3);
+
+#if defined(BENCHMARKS)
+    benchmark_baked_command_lists(&scene_draw_list, scene.object_count);
+#endif
+
+    // NOTE: the frame is declared as render graph passes every frame, see the render graph section
+    struct RenderGraph* render_graph = os_alloc(sizeof(struct RenderGraph));
+    render_graph_init(render_graph);
+
     ///////////////////////////////////////////////////////////////////////////////////////////////////
     // draw
     ///////////////////////////////////////////////////////////////////////////////////////////////////
 
+    int64_t start_time = timer_now();
+    struct SceneUpdate scene_update_data = {0};
     for (;;) {
         MSG message;
         while (PeekMessageW(&message, NULL, 0, 0, PM_REMOVE)) {
@@ -586,49 +14945,353 @@ WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR pCmdLine, int nCmdSh
             break;
         }
 
+        frame_arena_begin(frame_arena);
+        struct LinearArena* frame_memory = frame_arena_thread(frame_arena, /* thread_index */ 0);
+        LONG frame_allocation_count = os_allocation_count;
+        virtual_texture_update(virtual_texture, job_system);
+        video_textures_update(video_textures, timer_seconds(timer_now() - start_time), job_system);
+
         RECT window_client_size = {0};
         ASSERT(GetClientRect(window_handle, &window_client_size));
         GLsizei window_width = (GLsizei)window_client_size.right;
         GLsizei window_height = (GLsizei)window_client_size.bottom;
 
         {
-            // NOTE: update uniform buffers
+            // NOTE: update the scene (transforms, culling, sort keys and uniform packing run on the job system)
+            // and upload the uniform buffer
 
             float aspect_ratio = (float)window_width / (float)window_height;
-            float h = 1.7320509f;
-            struct UniformData uniform_data = {
-                .transform = {
-                    // NOTE: a precalculated view projection matrix as an example
-                    {h / aspect_ratio, 0.0f,        0.0f,  0.0f},
-                    {            0.0f,    h,        0.0f,  0.0f},
-                    {            0.0f, 0.0f,  -1.001001f, -1.0f},
-                    {            0.0f, 0.0f, 2.99299312f,  4.0f},
-                },
-            };
-            glNamedBufferSubData(uniform_buffer, /* offset */ 0, sizeof(uniform_data), &uniform_data);
+            struct Mat4 view = mat4_look_at(camera_position, /* target */ (struct Vec3){0.0f, 0.0f, 0.0f}, /* up */ (struct Vec3){0.0f, 1.0f, 0.0f});
+            float fov_y = 1.0471976f; // NOTE: 60 degrees
+            struct Mat4 projection = mat4_perspective(fov_y, aspect_ratio, /* near_plane */ 0.1f, /* far_plane */ 100.0f);
+
+            scene_update_data.scene = &scene;
+            scene_update_data.frame_arena = frame_arena;
+            scene_update_data.view_projection = mat4_mul(&projection, &view);
+            frustum_planes_from_matrix(&scene_update_data.view_projection, scene_update_data.frustum_planes);
+            scene_update_data.camera_position = camera_position;
+            scene_update_data.time = (float)timer_seconds(timer_now() - start_time);
+            scene_update_data.orbit = mat4_transform(/* translation */ (struct Vec3){0.0f, 0.0f, 0.0f}, /* axis */ (struct Vec3){0.0f, 0.0f, 1.0f}, scene_update_data.time * 0.1f, /* scale */ 1.0f);
+
+            struct Vec3* bobbing_positions = LINEAR_ALLOC(frame_memory, struct Vec3, bobbing_count);
+            for (uint32_t i = 0; i < bobbing_count; i++) {
+                bobbing_positions[i] = bobbing_rest_positions[i];
+                bobbing_positions[i].z += sinf(scene_update_data.time * 2.0f + (float)i) * grid_spacing * 0.25f;
+            }
+            scene_move_objects(&scene, bobbing_objects, bobbing_positions, bobbing_count, frame_memory);
+
+            if (pick_requested && window_width > 0 && window_height > 0) {
+                // NOTE: the ray through the pixel center goes to grid space (the inverse orbit) where the bvh is
+                pick_requested = false;
+                float tan_half_fov = tanf(fov_y * 0.5f);
+                float x = ((2.0f * ((float)pick_x + 0.5f) / (float)window_width) - 1.0f) * tan_half_fov * aspect_ratio;
+                float y = (1.0f - (2.0f * ((float)pick_y + 0.5f) / (float)window_height)) * tan_half_fov;
+                struct Vec3 forward = vec3_normalize(vec3_sub((struct Vec3){0.0f, 0.0f, 0.0f}, camera_position));
+                struct Vec3 right = vec3_normalize(vec3_cross(forward, (struct Vec3){0.0f, 1.0f, 0.0f}));
+                struct Vec3 up = vec3_cross(right, forward);
+                struct Vec3 direction = vec3_normalize((struct Vec3){
+                    forward.x + right.x * x + up.x * y,
+                    forward.y + right.y * x + up.y * y,
+                    forward.z + right.z * x + up.z * y,
+                });
+
+                struct Mat4 inverse_orbit = mat4_transform(/* translation */ (struct Vec3){0.0f, 0.0f, 0.0f}, /* axis */ (struct Vec3){0.0f, 0.0f, 1.0f}, -scene_update_data.time * 0.1f, /* scale */ 1.0f);
+                struct Vec3 grid_origin = mat4_mul_vec3(&inverse_orbit, camera_position, /* w */ 1.0f);
+                struct Vec3 grid_direction = mat4_mul_vec3(&inverse_orbit, direction, /* w */ 0.0f);
+                float distance = 0.0f;
+                uint32_t picked = bvh_raycast(&scene.bvh, &scene.grid_bounds, grid_origin, grid_direction, &distance);
+                if (picked != UINT32_MAX) {
+                    printf("picked object %u, %.2f away\n", picked, distance);
+                } else {
+                    printf("picked nothing\n");
+                }
+            }
+
+            scene_update_data.batch_size = SCENE_BATCH_SIZE;
+            scene_update_data.uniform_stride = uniform_stride;
+            scene_update_data.uniform_data = linear_arena_alloc(frame_memory, scene.object_count * uniform_stride, 16);
+            scene_update_data.candidates = LINEAR_ALLOC(frame_memory, uint32_t, scene.object_count);
+            scene_update_data.draw_items = LINEAR_ALLOC(frame_memory, struct DrawItem, scene.object_count);
+            scene_update_data.batch_draw_counts = LINEAR_ALLOC(frame_memory, uint32_t, scene.object_count / SCENE_BATCH_SIZE + 1);
+            scene_update_data.screen_scale = (float)window_height * 0.5f / tanf(fov_y * 0.5f);
+            scene_update_data.material_count = materials.count;
+            scene_update_data.material_screen_sizes = LINEAR_ALLOC(frame_memory, float, job_system->worker_count * materials.count);
+            memset(scene_update_data.material_screen_sizes, 0, job_system->worker_count * materials.count * sizeof(float));
+            scene_update(&scene_update_data, job_system);
+            materials_stream(&materials, scene_update_data.material_screen_sizes, job_system->worker_count, job_system);
+
+            glNamedBufferSubData(uniform_arena.buffer, uniform_allocation.offset, scene.object_count * uniform_stride, scene_update_data.uniform_data);
         }
 
-        glViewport(/* x */ 0, /* y */ 0, window_width, window_height);
-        glClearNamedFramebufferfv(/* framebuffer */ 0, GL_COLOR, /* drawbuffer */ 0, (float[]){0.8f, 0.6f, 0.4f, 1.0f});
-        glClearNamedFramebufferfv(/* framebuffer */ 0, GL_DEPTH, /* drawbuffer */ 0, (float[]){1.0f});
+        // NOTE: the visible draw items front to back
+        uint32_t draw_count = scene_gather_draw_items(&scene_update_data);
+        draw_items_sort(scene_update_data.draw_items, draw_count, frame_memory);
 
         {
-            // NOTE: render loop
+            // NOTE: the scene is drawn into transient offscreen targets and blitted to the window
+            // (a zero sized minimized window still gets 1x1 targets)
 
-            glUseProgram(shader_program);
-            glBindTextureUnit(0, main_texture);
-            glBindVertexArray(vertex_array);
-            glBindBufferBase(GL_UNIFORM_BUFFER, /* bindingindex */ 0, uniform_buffer);
-            glDrawElements(GL_TRIANGLES, LEN(indices), GL_UNSIGNED_SHORT, /* offset in bytes */ 0);
-        }
+            struct RenderTargetDesc color_desc = {
+                .format = SCENE_COLOR_FORMAT,
+                .width = window_width > 0 ? window_width : 1,
+                .height = window_height > 0 ? window_height : 1,
+            };
+            struct RenderTargetDesc depth_desc = color_desc;
+            depth_desc.format = SCENE_DEPTH_FORMAT;
 
-        // cleanup opengl state (not really required)
-        glUseProgram(0);
-        glBindTextureUnit(0, 0);
-        glBindVertexArray(0);
+            struct ScenePass scene_pass_data = {0};
+            scene_pass_data.scene_update = &scene_update_data;
+            scene_pass_data.draw_count = draw_count;
+            scene_pass_data.draw_list = &scene_draw_list;
+            scene_pass_data.depth_draw_list = &depth_draw_list;
+            scene_pass_data.baked_list = &scene_baked_list;
+            scene_pass_data.depth_baked_list = &depth_baked_list;
+            scene_pass_data.equal_baked_list = &equal_baked_list;
+            if (occlusion_culling_mode == OCCLUSION_CULLING_QUERIES && occlusion_queries_used) {
+                scene_pass_data.queried_draw_list = &queried_draw_list;
+            }
+            scene_pass_data.material_buffer = materials.buffer;
+            scene_pass_data.fragment_statistics = &fragment_statistics;
+            scene_pass_data.depth_prepass = depth_prepass_enabled;
+            scene_pass_data.job_system = job_system;
+            scene_pass_data.frame_memory = frame_memory;
+            scene_pass_data.width = color_desc.width;
+            scene_pass_data.height = color_desc.height;
+            struct PresentPass present_pass_data = {
+                .width = color_desc.width,
+                .height = color_desc.height,
+            };
+
+            render_graph_begin(render_graph);
+            uint32_t backbuffer = render_graph_import_backbuffer(render_graph);
+            uint32_t geometry_buffer = render_graph_import_buffer(render_graph, "geometry", geometry_arena.buffer);
+            uint32_t uniform_buffer = render_graph_import_buffer(render_graph, "uniforms", uniform_arena.buffer);
+            uint32_t material_buffer = render_graph_import_buffer(render_graph, "materials", materials.buffer);
+            uint32_t scene_color = render_graph_create_texture(render_graph, "scene color", color_desc);
+            uint32_t scene_depth = render_graph_create_texture(render_graph, "scene depth", depth_desc);
+
+            // NOTE: the occlusion culled scene is the two phases of culling and drawing around the depth pyramid,
+            // with the depth prepass both phases only draw depth and the color is drawn at the end
+            struct OcclusionCullPass cull_pass_data[2];
+            struct OcclusionPyramidPass pyramid_pass_data;
+            struct OcclusionDrawPass draw_pass_data[3];
+            if (occlusion_culling_mode == OCCLUSION_CULLING_DEPTH_PYRAMID) {
+                occlusion_culling_begin_frame(&occlusion_culling, scene_update_data.draw_items, draw_count, color_desc.width, color_desc.height, frame_memory);
+                uint32_t candidate_buffer = render_graph_import_buffer(render_graph, "occlusion candidates", occlusion_culling.candidate_buffer);
+                uint32_t visibility_buffer = render_graph_import_buffer(render_graph, "occlusion visibility", occlusion_culling.visibility_buffer);
+                uint32_t command_buffers[2] = {
+                    render_graph_import_buffer(render_graph, "occlusion first phase commands", occlusion_culling.command_buffers[0]),
+                    render_graph_import_buffer(render_graph, "occlusion second phase commands", occlusion_culling.command_buffers[1]),
+                };
+                uint32_t depth_pyramid = render_graph_import_texture(render_graph, "depth pyramid", occlusion_culling.pyramid);
+
+                struct OcclusionDrawPass draw_pass_template = {0};
+                draw_pass_template.culling = &occlusion_culling;
+                draw_pass_template.fragment_statistics = &fragment_statistics;
+                draw_pass_template.program = depth_prepass_enabled ? culled_depth_shader_program : culled_shader_program;
+                draw_pass_template.texture = materials.texture_array;
+                draw_pass_template.sampler = materials.sampler;
+                draw_pass_template.material_buffer = materials.buffer;
+                draw_pass_template.vertex_array = vertex_array;
+                draw_pass_template.index_type = main_mesh.index_type;
+                draw_pass_template.transforms = uniform_arena.buffer;
+                draw_pass_template.transforms_offset = uniform_allocation.offset;
+                draw_pass_template.transforms_size = uniform_allocation.size;
+                draw_pass_template.phase_count = 1;
+                draw_pass_template.depth_prepass = depth_prepass_enabled;
+                draw_pass_template.width = color_desc.width;
+                draw_pass_template.height = color_desc.height;
+
+                const char* cull_pass_names[2] = {"occlusion cull first phase", "occlusion cull second phase"};
+                const char* draw_pass_names[2] = {"scene first phase", "scene second phase"};
+                for (uint32_t phase = 0; phase < 2; phase++) {
+                    if (phase == 1) {
+                        pyramid_pass_data.culling = &occlusion_culling;
+                        pyramid_pass_data.depth = scene_depth;
+                        uint32_t pyramid_pass = render_graph_add_pass(render_graph, "depth pyramid", RENDER_GRAPH_PASS_COMPUTE, &occlusion_pyramid_pass_execute, &pyramid_pass_data);
+                        render_graph_read(render_graph, pyramid_pass, scene_depth, RENDER_GRAPH_USAGE_SAMPLED);
+                        render_graph_write(render_graph, pyramid_pass, depth_pyramid, RENDER_GRAPH_USAGE_STORAGE_IMAGE);
+                    }
+
+                    cull_pass_data[phase].culling = &occlusion_culling;
+                    cull_pass_data[phase].second_phase = phase == 1;
+                    cull_pass_data[phase].transforms = uniform_arena.buffer;
+                    cull_pass_data[phase].transforms_offset = uniform_allocation.offset;
+                    cull_pass_data[phase].transforms_size = uniform_allocation.size;
+                    uint32_t cull_pass = render_graph_add_pass(render_graph, cull_pass_names[phase], RENDER_GRAPH_PASS_COMPUTE, &occlusion_cull_pass_execute, &cull_pass_data[phase]);
+                    render_graph_read(render_graph, cull_pass, uniform_buffer, RENDER_GRAPH_USAGE_STORAGE_BUFFER);
+                    render_graph_read(render_graph, cull_pass, candidate_buffer, RENDER_GRAPH_USAGE_STORAGE_BUFFER);
+                    render_graph_read(render_graph, cull_pass, visibility_buffer, RENDER_GRAPH_USAGE_STORAGE_BUFFER);
+                    if (phase == 1) {
+                        render_graph_read(render_graph, cull_pass, depth_pyramid, RENDER_GRAPH_USAGE_SAMPLED);
+                        render_graph_write(render_graph, cull_pass, visibility_buffer, RENDER_GRAPH_USAGE_STORAGE_BUFFER);
+                    }
+                    render_graph_write(render_graph, cull_pass, command_buffers[phase], RENDER_GRAPH_USAGE_STORAGE_BUFFER);
+
+                    draw_pass_data[phase] = draw_pass_template;
+                    draw_pass_data[phase].first_phase = phase;
+                    draw_pass_data[phase].clear_color = phase == 0 && !depth_prepass_enabled;
+                    draw_pass_data[phase].clear_depth = phase == 0;
+                    draw_pass_data[phase].begin_statistics = phase == 0;
+                    draw_pass_data[phase].end_statistics = phase == 1 && !depth_prepass_enabled;
+                    uint32_t draw_pass = render_graph_add_pass(render_graph, draw_pass_names[phase], RENDER_GRAPH_PASS_GRAPHICS, &occlusion_draw_pass_execute, &draw_pass_data[phase]);
+                    render_graph_read(render_graph, draw_pass, command_buffers[phase], RENDER_GRAPH_USAGE_INDIRECT_BUFFER);
+                    render_graph_read(render_graph, draw_pass, geometry_buffer, RENDER_GRAPH_USAGE_VERTEX_BUFFER);
+                    render_graph_read(render_graph, draw_pass, geometry_buffer, RENDER_GRAPH_USAGE_INDEX_BUFFER);
+                    render_graph_read(render_graph, draw_pass, uniform_buffer, RENDER_GRAPH_USAGE_STORAGE_BUFFER);
+                    render_graph_read(render_graph, draw_pass, material_buffer, RENDER_GRAPH_USAGE_STORAGE_BUFFER);
+                    if (!depth_prepass_enabled) {
+                        render_graph_write(render_graph, draw_pass, scene_color, RENDER_GRAPH_USAGE_COLOR_ATTACHMENT);
+                    }
+                    render_graph_write(render_graph, draw_pass, scene_depth, RENDER_GRAPH_USAGE_DEPTH_ATTACHMENT);
+                }
+
+                if (depth_prepass_enabled) {
+                    draw_pass_data[2] = draw_pass_template;
+                    draw_pass_data[2].program = culled_shader_program;
+                    draw_pass_data[2].first_phase = 0;
+                    draw_pass_data[2].phase_count = 2;
+                    draw_pass_data[2].clear_color = true;
+                    draw_pass_data[2].depth_equal = true;
+                    draw_pass_data[2].end_statistics = true;
+                    uint32_t color_pass = render_graph_add_pass(render_graph, "scene color", RENDER_GRAPH_PASS_GRAPHICS, &occlusion_draw_pass_execute, &draw_pass_data[2]);
+                    render_graph_read(render_graph, color_pass, command_buffers[0], RENDER_GRAPH_USAGE_INDIRECT_BUFFER);
+                    render_graph_read(render_graph, color_pass, command_buffers[1], RENDER_GRAPH_USAGE_INDIRECT_BUFFER);
+                    render_graph_read(render_graph, color_pass, geometry_buffer, RENDER_GRAPH_USAGE_VERTEX_BUFFER);
+                    render_graph_read(render_graph, color_pass, geometry_buffer, RENDER_GRAPH_USAGE_INDEX_BUFFER);
+                    render_graph_read(render_graph, color_pass, uniform_buffer, RENDER_GRAPH_USAGE_STORAGE_BUFFER);
+                    render_graph_read(render_graph, color_pass, material_buffer, RENDER_GRAPH_USAGE_STORAGE_BUFFER);
+                    render_graph_read(render_graph, color_pass, scene_depth, RENDER_GRAPH_USAGE_DEPTH_ATTACHMENT);
+                    render_graph_write(render_graph, color_pass, scene_color, RENDER_GRAPH_USAGE_COLOR_ATTACHMENT);
+                }
+            } else {
+                uint32_t scene_pass = render_graph_add_pass(render_graph, "scene", RENDER_GRAPH_PASS_GRAPHICS, &scene_pass_execute, &scene_pass_data);
+                render_graph_read(render_graph, scene_pass, geometry_buffer, RENDER_GRAPH_USAGE_VERTEX_BUFFER);
+                render_graph_read(render_graph, scene_pass, geometry_buffer, RENDER_GRAPH_USAGE_INDEX_BUFFER);
+                render_graph_read(render_graph, scene_pass, uniform_buffer, RENDER_GRAPH_USAGE_UNIFORM_BUFFER);
+                render_graph_read(render_graph, scene_pass, material_buffer, RENDER_GRAPH_USAGE_STORAGE_BUFFER);
+                render_graph_write(render_graph, scene_pass, scene_color, RENDER_GRAPH_USAGE_COLOR_ATTACHMENT);
+                render_graph_write(render_graph, scene_pass, scene_depth, RENDER_GRAPH_USAGE_DEPTH_ATTACHMENT);
+            }
+
+            // NOTE: the map plane is drawn after the scene, its feedback is drawn separately at a lower resolution
+            struct VirtualTexturePass virtual_texture_pass_data = {0};
+            {
+                double map_time = (double)scene_update_data.time;
+                double zoom = map_max_zoom * (0.5 - 0.5 * cos(map_time * 0.1));
+                double scale = exp2(-zoom);
+                for (uint32_t i = 0; i < 2; i++) {
+                    map_center[i] += (i == 0 ? 0.05 : 0.03) * scale * (map_time - map_previous_time);
+                    map_center[i] = fmod(map_center[i], 1.0);
+                    virtual_texture_pass_data.uv_rect[i] = (float)(map_center[i] - scale * 0.5);
+                    virtual_texture_pass_data.uv_rect[i + 2] = (float)scale;
+                }
+                map_previous_time = map_time;
+            }
+            virtual_texture_pass_data.texture = virtual_texture;
+            virtual_texture_pass_data.view_projection = scene_update_data.view_projection;
+            virtual_texture_pass_data.plane[0] = 16.0f;
+            virtual_texture_pass_data.plane[1] = 16.0f;
+            virtual_texture_pass_data.plane[2] = -2.0f;
+            struct VirtualTexturePass virtual_texture_feedback_pass_data = virtual_texture_pass_data;
+            virtual_texture_feedback_size(color_desc.width, color_desc.height, &virtual_texture_feedback_pass_data.width, &virtual_texture_feedback_pass_data.height);
+            virtual_texture_feedback_pass_data.lod_bias = -log2f((float)color_desc.width / (float)virtual_texture_feedback_pass_data.width);
+            virtual_texture_pass_data.width = color_desc.width;
+            virtual_texture_pass_data.height = color_desc.height;
+
+            struct RenderTargetDesc feedback_desc = {
+                .format = GL_R32UI,
+                .width = virtual_texture_feedback_pass_data.width,
+                .height = virtual_texture_feedback_pass_data.height,
+            };
+            uint32_t page_table = render_graph_import_texture(render_graph, "virtual texture page table", virtual_texture->page_table);
+            uint32_t page_cache = render_graph_import_texture(render_graph, "virtual texture cache", virtual_texture->cache);
+            uint32_t feedback_readback = render_graph_import_buffer(render_graph, "virtual texture readback", virtual_texture->readback_buffer);
+            virtual_texture_feedback_pass_data.feedback = render_graph_create_texture(render_graph, "virtual texture feedback", feedback_desc);
+            uint32_t feedback_pass = render_graph_add_pass(render_graph, "virtual texture feedback", RENDER_GRAPH_PASS_GRAPHICS, &virtual_texture_feedback_pass_execute, &virtual_texture_feedback_pass_data);
+            render_graph_write(render_graph, feedback_pass, virtual_texture_feedback_pass_data.feedback, RENDER_GRAPH_USAGE_COLOR_ATTACHMENT);
+            render_graph_read(render_graph, feedback_pass, virtual_texture_feedback_pass_data.feedback, RENDER_GRAPH_USAGE_TRANSFER);
+            render_graph_write(render_graph, feedback_pass, feedback_readback, RENDER_GRAPH_USAGE_TRANSFER);
+            uint32_t map_pass = render_graph_add_pass(render_graph, "virtual texture map", RENDER_GRAPH_PASS_GRAPHICS, &virtual_texture_map_pass_execute, &virtual_texture_pass_data);
+            render_graph_read(render_graph, map_pass, page_table, RENDER_GRAPH_USAGE_SAMPLED);
+            render_graph_read(render_graph, map_pass, page_cache, RENDER_GRAPH_USAGE_SAMPLED);
+            render_graph_read(render_graph, map_pass, scene_depth, RENDER_GRAPH_USAGE_DEPTH_ATTACHMENT);
+            render_graph_write(render_graph, map_pass, scene_color, RENDER_GRAPH_USAGE_COLOR_ATTACHMENT);
+
+            struct VideoPass video_pass_data = {
+                .textures = video_textures,
+                .view_projection = scene_update_data.view_projection,
+                .width = color_desc.width,
+                .height = color_desc.height,
+            };
+            if (video_textures->count > 0) {
+                uint32_t video_pass = render_graph_add_pass(render_graph, "videos", RENDER_GRAPH_PASS_GRAPHICS, &video_pass_execute, &video_pass_data);
+                for (uint32_t i = 0; i < video_textures->count; i++) {
+                    render_graph_read(render_graph, video_pass, render_graph_import_texture(render_graph, "video luma", video_textures->videos[i].luma), RENDER_GRAPH_USAGE_SAMPLED);
+                    render_graph_read(render_graph, video_pass, render_graph_import_texture(render_graph, "video chroma", video_textures->videos[i].chroma), RENDER_GRAPH_USAGE_SAMPLED);
+                }
+                render_graph_read(render_graph, video_pass, scene_depth, RENDER_GRAPH_USAGE_DEPTH_ATTACHMENT);
+                render_graph_write(render_graph, video_pass, scene_color, RENDER_GRAPH_USAGE_COLOR_ATTACHMENT);
+            }
+
+            uint32_t present_pass = render_graph_add_pass(render_graph, "present", RENDER_GRAPH_PASS_GRAPHICS, &present_pass_execute, &present_pass_data);
+            render_graph_read(render_graph, present_pass, scene_color, RENDER_GRAPH_USAGE_TRANSFER);
+            render_graph_write(render_graph, present_pass, backbuffer, RENDER_GRAPH_USAGE_TRANSFER);
+
+            render_graph_compile(render_graph);
+            render_graph_execute(render_graph);
+        }
 
         ASSERT(SwapBuffers(dc));
+
+        // NOTE: the steady state frame must never allocate from the os
+        ASSERT(os_allocation_count == frame_allocation_count);
+    }
+
+    printf("\n== virtual texture ==\n");
+    virtual_texture_print_stats(virtual_texture);
+    virtual_texture_deinit(virtual_texture);
+    os_free(virtual_texture);
+    if (video_textures->count > 0) {
+        printf("\n== video textures ==\n");
+        video_textures_print_stats(video_textures);
+    }
+    video_textures_deinit(video_textures);
+    os_free(video_textures);
+    render_graph_print_stats(render_graph);
+    render_graph_deinit(render_graph);
+    os_free(render_graph);
+    printf("\n== fragment statistics ==\n");
+    fragment_statistics_print(&fragment_statistics);
+    fragment_statistics_deinit(&fragment_statistics);
+    occlusion_culling_deinit(&occlusion_culling);
+    if (occlusion_queries_used) {
+        occlusion_queries_deinit(&occlusion_queries, &geometry_arena);
     }
+    baked_command_list_deinit(&scene_baked_list);
+    baked_command_list_deinit(&depth_baked_list);
+    baked_command_list_deinit(&equal_baked_list);
+    materials_deinit(&materials);
+    if (texture_streaming->count > 0) {
+        printf("\n== texture streaming ==\n");
+        texture_streaming_print_stats(texture_streaming);
+    }
+    texture_streaming_deinit(texture_streaming, job_system);
+    os_free(texture_streaming);
+    sampler_cache_deinit(&sampler_cache);
+    frame_arena_print_stats(frame_arena);
+    frame_arena_deinit(frame_arena);
+    os_free(frame_arena);
+    job_system_deinit(job_system);
+    os_free(job_system);
+    os_free(scene_memory.base);
+
+    // release gpu arenas (not really required as the process is about to exit)
+    mesh_free(&main_mesh, &geometry_arena);
+    gpu_arena_free(&geometry_arena, &object_index_allocation);
+    gpu_arena_free(&uniform_arena, &uniform_allocation);
+    gpu_arena_deinit(&geometry_arena);
+    gpu_arena_deinit(&uniform_arena);
 
     return 0;
 }